@@ -62,6 +62,26 @@ namespace ARC {
          */
         void diffuse(ARC_States &state, double dt) const;
 
+        /**
+         * diffuse() with the random number generator of the calling worker
+         * @param state Pointer to the state that has to be manipulated.
+         * @param rng random number generator of the calling worker
+         */
+        void diffuse(ARC_States &state, double dt,
+                     const libPF::RandomNumberGenerationStrategy* rng) const;
+
+        /**
+         * \brief per-epoch update of cycle slips and phase-bias reset flags
+         *
+         * the rtk control struct is updated once per epoch here,and then drift()
+         * only updates the states of particle,so drift() and diffuse() can run
+         * in parallel. call it after SetObs() and SetComSatList()
+         */
+        void PrepareEpoch();
+
+        /// \brief drift() and diffuse() can run in parallel after PrepareEpoch()
+        bool isThreadSafe() const;
+
         /// \brief set the standard deviation of index-th states
         inline void SetStdX(double Std,int Index){
             StdX[Index]=Std;
@@ -76,7 +96,7 @@ namespace ARC {
         }
         /// \brief set the observation data
         inline void SetObs(const ARC_OBSD* OBS,int Nobs){
-            m_OBS=OBS; m_Nobs=Nobs;
+            m_OBS=OBS; m_Nobs=Nobs; m_Prepared=0;
         }
         /// \brief set the arc-srtk solution data
         inline void SetSRTK(ARC_RTK* SRTK) {
@@ -134,6 +154,12 @@ namespace ARC {
         mutable double PF_ROVERPOS_STD;
         /// \brief particle fiter ambguity min and max search
         mutable double PF_AMB_MIN,PF_AMB_MAX;
+        /// \brief phase-bias reset flags of this epoch
+        int m_Reset[MAXSAT*NFREQ];
+        /// \brief phase-code phase-bias of common satellites of this epoch
+        double m_Bias[MAXSAT*NFREQ];
+        /// \brief flag of per-epoch update is done
+        int m_Prepared;
     };
 }
 #endif //ARC_ARC_MOVEMENTMODEL_H
@@ -32,6 +32,27 @@
 #include "arc_PF.h"
 #include "arc_assert_macros.hpp"
 
+/// max double-difference/single-difference residuals of observation model
+#define ARC_PF_MAXRES                      (MAXSAT*2)
+
+/// per-epoch precomputed observation model,which is independent of particles
+typedef struct {
+    int ns;                          /// numbers of common satellites
+    int sat[MAXSAT];                 /// common satellites
+    int sys[MAXSAT];                 /// navigation system of common satellites
+    double rs[MAXSAT*3];             /// satellite positions of common satellites (ecef)
+    double yu[MAXSAT*2];             /// rover observables minus all corrections but geometric-range
+    double yb[MAXSAT*2];             /// base station undifferenced residuals
+    double disp[3];                  /// earth tide displacement of rover station
+    int nd;                          /// numbers of double-difference residuals
+    int di[ARC_PF_MAXRES];           /// reference satellite index of double-difference
+    int dj[ARC_PF_MAXRES];           /// other satellite index of double-difference
+    int df[ARC_PF_MAXRES];           /// frequency index of double-difference (f<nf:phase)
+    int nsd;                         /// numbers of single-difference residuals
+    int sj[ARC_PF_MAXRES];           /// satellite index of single-difference
+    int sf[ARC_PF_MAXRES];           /// frequency index of single-difference
+} ARC_PFPRE;
+
 namespace ARC {
 
     class ARC_ObservationModel:
@@ -54,6 +75,10 @@ namespace ARC {
          * @return weight for the given state.
          */
         double measure(const ARC_States& state) const;
+        /// \brief measure() can run in parallel after PrepareEpoch()
+        bool isThreadSafe() const {
+            return m_PreValid!=0;
+        }
         /**
          * \brief set the true states of ARC-SRTK Observation Model
          * @param state the true state of the ARC-SRTK Observation Model
@@ -75,7 +100,7 @@ namespace ARC {
         }
         /// \brief set the observation data
         void SetObs(const ARC_OBSD* OBS,int Nobs) {
-            m_OBS=OBS; m_NObs=Nobs;
+            m_OBS=OBS; m_NObs=Nobs; m_PreValid=0;
         }
         /// \brief set the arc-srtk solution data
         void SetSRTK(ARC_RTK* SRTK) {
@@ -83,6 +108,15 @@ namespace ARC {
         }
         /// \brief compute the particel weight
         double getWeight();
+        /**
+         * \brief per-epoch precompute of observation model
+         *
+         * satellite positions/clocks,base station residuals,troposphere,ionosphere,
+         * antenna and earth tide corrections are computed once at the true states,
+         * and then measure() only recomputes the geometric-range of each particle
+         * @return 1:ok,0:error (measure() uses the full observation model)
+         */
+        int PrepareEpoch();
         /// \brief set the flag of use single-difference or double-difference
         inline void SetDDorSD(int flag){
             if (flag!=0||flag!=1) return;
@@ -103,6 +137,10 @@ namespace ARC {
         const ARC_NAV*  m_NAV;
         /// \brief flag of use single-difference double-difference - 0:SD,1:DD
         int USE_SD_OR_DD;
+        /// \brief per-epoch precomputed observation model
+        ARC_PFPRE m_Pre;
+        /// \brief flag of per-epoch precomputed observation model is valid
+        int m_PreValid;
     };
 }
 #endif //ARC_ARC_OBSERVATIONMODEL_H
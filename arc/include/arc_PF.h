@@ -38,6 +38,7 @@
 #define ARC_PF_AMB_MAX                     (+2)
 #define ARC_PF_ITERS                       1
 #define ARC_PF_NUM                         5000            /// particle numbers
+#define ARC_PF_SEED                        20170707ULL     /// seed of particle filter random number streams
 #define ARC_PF_USE_SD                      0
 #define ARC_PF_USE_DD                      1
 
@@ -51,20 +51,27 @@ namespace ARC {
         ARC_States();
         ARC_States(const ARC_OPT* OPT);
         ARC_States(int Num);
+        ARC_States(const ARC_States &other);
         /**
          * Destructor
          */
         virtual ~ARC_States();
         /**
-         * Opereator
+         * Opereator,only the active states are computed and copied
          */
+        ARC_States &operator=(const ARC_States &other){
+            m_N=other.m_N;
+            for (int i=0;i<m_N;i++) X[i]=other.X[i];
+            return *this;
+        };
         ARC_States operator*(double factor) const{
-            ARC_States State;
-            for (int i=0;i<MAXPFSTETAS;i++) State.SetStatesValue(X[i]*factor,i);
+            ARC_States State(m_N);
+            for (int i=0;i<m_N;i++) State.X[i]=X[i]*factor;
             return State;
         };
         ARC_States &operator+=(const ARC_States &other){
-            for (int i=0;i<MAXPFSTETAS;i++) X[i]=X[i]+other.getStateValue(i);
+            for (int i=0;i<m_N;i++) X[i]=X[i]+other.X[i];
+            return *this;
         };
         /// \brief set the value of states
         inline void SetStatesValue(const double Val,int Index) {
@@ -74,17 +81,22 @@ namespace ARC {
         inline double getStateValue(int Index) const{
             return X[Index];
         };
-        /// \brief get the numbers of states
+        /// \brief get the numbers of active states
         inline int getStatesNum() const {
-            return MAXPFSTETAS;
+            return m_N;
         };
         /// \brief get the states value
         inline double *getStatesVal() {
             return X;
         }
+        inline const double *getStatesVal() const {
+            return X;
+        }
     private:
         /// \brief need to estimate states,this is same to rtklib
         mutable double X[MAXPFSTETAS];
+        /// \brief numbers of active states (X[0..m_N-1]),no more than MAXPFSTETAS
+        int m_N;
     };
 }
 #endif //ARC_ARC_STATES_H
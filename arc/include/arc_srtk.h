@@ -53,6 +53,15 @@ extern "C" {
 #define ARC_UKF         1
 #define ARC_NOUKF       0
 #define ARC_RINEX_SKIP_LOG
+#ifdef ARC_PROF                           /* per-stage latency profiler (-DARC_PROF) */
+#define PROF_TIC(p,s,t)     double t=arc_prof_enter(p,s)
+#define PROF_TOC(p,s,t)     arc_prof_leave(p,s,t)
+#define PROF_SCOPE(p,s)     prof_scope_t prof_scope_(p,s)
+#else
+#define PROF_TIC(p,s,t)
+#define PROF_TOC(p,s,t)
+#define PROF_SCOPE(p,s)
+#endif
 /* single frequency rtk position post-processing ------------------------------*/
 extern int  arc_postpos(gtime_t ts, gtime_t te, double ti, double tu,
                         prcopt_t *popt, const solopt_t *sopt,
@@ -65,6 +74,8 @@ extern int  arc_pf_srtk(gtime_t ts, gtime_t te, double ti, double tu,
 /* single frequency rtk positioning ------------------------------------------*/
 extern int  arc_srtkpos (rtk_t *rtk, const obsd_t *obs, int nobs, const nav_t *nav);
 extern int  arc_srtkpos2(rtk_t *rtk, const obsd_t *obs, int nobs, const nav_t *nav);
+extern void arc_epctx_init(epctx_t *ctx, geoctx_t *geo, const obsd_t *obs,
+                           int n, const nav_t *nav, const prcopt_t *opt);
 /* arc trace log functions ---------------------------------------------------*/
 extern void arc_traceopen(const char *file);
 extern void arc_traceclose(void);
@@ -117,6 +128,10 @@ extern double arc_tropmapf_chao(gtime_t time, const double *pos, const double *a
                                 double *mapfw);
 extern double arc_tropmapf_cfa2_2(gtime_t time, const double *pos, const double *azel,
                                   double *mapfw);
+extern void   arc_mapt_init(mapt_t *mapt, mapfunc_t func, gtime_t time,
+                            const double *pos);
+extern double arc_mapt(mapt_t *mapt, gtime_t time, const double *pos,
+                       const double *azel, double *mapfw);
 extern double sbstropcorr(gtime_t time, const double *pos, const double *azel,
                           double *var,double *zwd);
 /* ukf filter -------------------------------------------------------------------*/
@@ -133,6 +148,56 @@ extern void arc_ukf_filter_get_state(ukf_t *filter, double *x, double *P);
 extern int  arc_ukf_filter_update(ukf_t *filter, double *y, double *u,double*F,
                                   double *G);
 extern void arc_ukf_free_problem();
+extern int  arc_srukf_factor(const double *P, int n, const int *ix, int na, double *S);
+extern int  arc_srukf_update(double *x, double *P, int n, const int *ix, int na,
+                             double *S, const double *z, const double *R, int m,
+                             srukf_function hfun, void *ctx, double alpha,
+                             double kappa, double beta, int nthread);
+
+/* sliding-window solver --------------------------------------------------------*/
+extern swin_t *arc_swin_new(int nx, int nr, int nw);
+extern void arc_swin_free(swin_t *w);
+extern int  arc_swin_update(swin_t *w, gtime_t time, double *x, double *P,
+                            const double *v, const double *H, const double *R,
+                            const int *vflg, int nv, const double *rs,
+                            const int *sat, const int *iu, int ns, double varb,
+                            int prior);
+
+/* static normal equation -------------------------------------------------------*/
+extern neq_t *arc_neq_new(int nx, int nr, const double *x0);
+extern void arc_neq_free(neq_t *q);
+extern void arc_neq_retire(neq_t *q, int i);
+extern int  arc_neq_add(neq_t *q, gtime_t time, const double *x, const double *P,
+                        const double *v, const double *H, const double *R, int nv,
+                        double varb);
+extern int  arc_neq_merge(neq_t *q, const neq_t *src);
+extern int  arc_neq_solve(const neq_t *q, const prcopt_t *opt, sol_t *sol);
+
+/* fixed-lag smoother -----------------------------------------------------------*/
+extern fls_t *arc_fls_new(const prcopt_t *opt);
+extern void arc_fls_free(fls_t *s);
+extern int  arc_fls_add(fls_t *s, const rtk_t *rtk);
+extern int  arc_fls_get(fls_t *s, sol_t *sol, double *rb, int flush);
+extern void arc_fls_retire(fls_t *s, int i);
+extern void arc_fls_udpos(fls_t *s, double tt);
+extern void arc_fls_pred(fls_t *s, const rtk_t *rtk);
+
+/* stream and real-time server ---------------------------------------------------*/
+extern int  arc_stropen(stream_t *s, int type, int mode, const char *path);
+extern void arc_strclose(stream_t *s);
+extern int  arc_strread(stream_t *s, unsigned char *buff, int n, int timeout);
+extern int  arc_strwrite(stream_t *s, const unsigned char *buff, int n);
+extern int  arc_strwait(stream_t *s, int timeout);
+extern FILE *arc_strfopen(stream_t *s);
+extern int  arc_strtype(const char *spec, char *path);
+extern int  arc_rtsvr_start(rtsvr_t *svr, const prcopt_t *popt, const solopt_t *sopt,
+                            const nav_t *nav, const int *strs, const int *fmts,
+                            char **paths);
+extern void arc_rtsvr_stop(rtsvr_t *svr);
+extern double arc_rtsvr_latency(rtsvr_t *svr, double p);
+extern int  arc_replay_start(replay_t *rp, const char *file, int fmt, int type,
+                             const char *path, double speed);
+extern void arc_replay_stop(replay_t *rp);
 
 /* satellites, systems, codes functions --------------------------------------*/
 extern int  satno   (int sys, int prn);
@@ -147,8 +212,10 @@ extern int  testsnr(int base, int freq, double el, double snr,
 extern void setcodepri(int sys, int freq, const char *pri);
 extern int  getcodepri(int sys, unsigned char code, const char *opt);
 extern unsigned int getbitu(const unsigned char *buff, int pos, int len);
+extern int getbits(const unsigned char *buff, int pos, int len);
 extern int execcmd(const char *cmd);
 extern void setbitu(unsigned char *buff, int pos, int len, unsigned int data);
+extern void setbits(unsigned char *buff, int pos, int len, int data);
 extern double arc_snr_varerr(const double dbhz,int f,int nf,const prcopt_t* opt);
 
 /* matrix and vector functions -----------------------------------------------*/
@@ -175,6 +242,9 @@ extern int  arc_smoother(const double *xf, const double *Qf, const double *xb,
 extern int arc_filter_active(double *x, double *P, const double *H, const double *v,
                              const double *R, int n, int m,double *D,
                              const int *active,int na);
+extern int arc_filter_inno(double *x, double *P, const double *H, const double *v,
+                           const double *R, int n, int m, const int *active,
+                           int na, innov_t *inn);
 extern void arc_add_fatal(fatalfunc_t *func);
 
 /* time and string functions -------------------------------------------------*/
@@ -264,17 +334,24 @@ extern int arc_tropcorr(gtime_t time, const nav_t *nav, const double *pos,
 
 /* antenna models ------------------------------------------------------------*/
 extern int  arc_readpcv(const char *file, pcvs_t *pcvs);
+extern void arc_freepcv(pcvs_t *pcvs);
 extern pcv_t *arc_searchpcv(int sat, const char *type, gtime_t time,
                             const pcvs_t *pcvs);
 extern void arc_antmodel(const pcv_t *pcv, const double *del, const double *azel,
                          int opt, double *dant);
 extern void arc_antmodel_s(const pcv_t *pcv, double nadir, double *dant);
+extern void arc_pcvt_init(pcvt_t *pcvt, const pcv_t *pcv, const double *del);
+extern void arc_antmodel_t(const pcvt_t *pcvt, const double *azel, int opt,
+                           double *dant);
 
 /* earth tide models ---------------------------------------------------------*/
 extern void arc_sunmoonpos(gtime_t tutc, const double *erpv, double *rsun,
                            double *rmoon, double *gmst);
 extern void arc_tidedisp(gtime_t tutc, const double *rr, int opt, const erp_t *erp,
                          const double *odisp, double *dr);
+extern void arc_geoctx_update(geoctx_t *ctx, gtime_t tutc, const erp_t *erp);
+extern void arc_tidedisp_ctx(const geoctx_t *ctx, gtime_t tutc, const double *rr,
+                             int opt, const double *odisp, double *dr);
 
 /* rinex functions -----------------------------------------------------------*/
 extern int arc_readrnx(const char *file, int rcv, const char *opt, obs_t *obs,
@@ -284,6 +361,17 @@ extern int arc_readrnxt(const char *file, int rcv, gtime_t ts, gtime_t te,
                         sta_t *sta);
 extern int arc_readrnxc(const char *file, nav_t *nav);
 extern int arc_rtk_uncompress(const char *file, char *uncfile);
+extern int arc_init_rnxctr(rnxctr_t *rnx);
+extern void arc_free_rnxctr(rnxctr_t *rnx);
+extern int arc_open_rnxctr(rnxctr_t *rnx, FILE *fp);
+extern int arc_input_rnxctr(rnxctr_t *rnx, FILE *fp);
+
+/* rtcm functions ------------------------------------------------------------*/
+extern unsigned int arc_crc24q(const unsigned char *buff, int len);
+extern int arc_init_rtcm(rtcm_t *rtcm);
+extern void arc_free_rtcm(rtcm_t *rtcm);
+extern int arc_input_rtcm3(rtcm_t *rtcm, unsigned char data);
+extern int arc_input_rtcm3f(rtcm_t *rtcm, FILE *fp);
 
 /* ephemeris and clock functions ---------------------------------------------*/
 extern double arc_eph2clk(gtime_t time, const eph_t *eph);
@@ -297,13 +385,22 @@ extern void arc_seph2pos(gtime_t time, const seph_t *seph, double *rs, double *d
                          double *var);
 extern int  arc_peph2pos(gtime_t time, int sat, const nav_t *nav, int opt,
                          double *rs, double *dts, double *var);
+extern int  arc_peph2poss(const gtime_t *time, const int *sat, int n,
+                          const nav_t *nav, int opt, const double *rsun,
+                          double *rs, double *dts, double *var, int *stat);
+extern int  arc_pephc_init(nav_t *nav);
+extern void arc_pephc_free(nav_t *nav);
+extern void arc_ephc_init(ephc_t *c, int dense);
+extern void arc_ephc_free(ephc_t *c);
+extern ephc_t *arc_ephc_bind(ephc_t *c);
 extern void arc_satantoff(gtime_t time, const double *rs, int sat, const nav_t *nav,
-                          double *dant);
+                          const double *rsun, double *dant);
 extern int  arc_satpos(gtime_t time, gtime_t teph, int sat, int ephopt,
                        const nav_t *nav, double *rs, double *dts, double *var,
                        int *svh);
 extern void arc_satposs(gtime_t time, const obsd_t *obs, int n, const nav_t *nav,
-                        int sateph, double *rs, double *dts, double *var, int *svh);
+                        int sateph, const double *rsun, double *rs, double *dts,
+                        double *var, int *svh);
 extern void arc_readsp3(const char *file, nav_t *nav, int opt);
 extern int  arc_readsap(const char *file, gtime_t time, nav_t *nav);
 extern int  arc_readdcb(const char *file, nav_t *nav, const sta_t *sta);
@@ -319,6 +416,8 @@ extern int arc_lambda(int n, int m, const double *a, const double *Q, double *F,
 extern int lambda_reduction(int n, const double *Q, double *Z);
 extern int lambda_search(int n, int m, const double *a, const double *Q,
                          double *F, double *s);
+extern unsigned int arc_lambda_nodes(int reset);
+extern double arc_lambda_deadline(double tick);
 
 extern int arc_par_lambda(const double *a,const double *Qa,int n,int m,double *F,
                           double *s,double p0);
@@ -331,6 +430,9 @@ extern double arc_amb_bs_success(const double *D,int n);
 extern int arc_pntpos(const obsd_t *obs, int n, const nav_t *nav,
                       const prcopt_t *opt, sol_t *sol, double *azel,
                       ssat_t *ssat, char *msg);
+extern int arc_pntposs(const obsd_t *obs, const int *iobs, const int *nobs,
+                       int ne, const nav_t *nav, const prcopt_t *opt, int nthread,
+                       sol_t *sol, double *ra, double *Qa);
 /* precise positioning -------------------------------------------------------*/
 extern void arc_rtkinit(rtk_t *rtk, const prcopt_t *opt);
 extern void arc_rtkfree(rtk_t *rtk);
@@ -373,6 +475,7 @@ extern void arc_setbdsnav(const char *file);
 extern int rtkoutstat(rtk_t *rtk, char *buff);
 extern void rtkclosestat(void);
 extern int rtkopenstat(const char *file, int level);
+extern int rtkopenstatb(const char *file, int level);
 extern int outsolheads(unsigned char *buff, const solopt_t *opt);
 extern void outsolhead(FILE *fp, const solopt_t *opt);
 extern void createdir(const char *path);
@@ -386,14 +489,52 @@ extern int outsolexs(unsigned char *buff, const sol_t *sol, const ssat_t *ssat,
 extern int outsols(unsigned char *buff, const sol_t *sol, const double *rb,
                    const solopt_t *opt);
 extern int outprcopts(unsigned char *buff, const prcopt_t *opt);
+extern int outsolbs(unsigned char *buff, const sol_t *sol, const double *rb);
+extern int inputsolb(const unsigned char *buff, sol_t *sol, double *rb);
+extern void outsolbhead(FILE *fp);
+extern int readsolbhead(FILE *fp);
+extern int readsolb(FILE *fp, sol_t *sol, double *rb);
+extern solw_t *solw_open(FILE *fp);
+extern void solw_write(solw_t *w, const unsigned char *buff, int n);
+extern void solw_push(solw_t *w, const sol_t *sol, const double *rb);
+extern void solw_close(solw_t *w);
+extern sstat_t *sstat_openw(FILE *fp, int level);
+extern sstat_t *sstat_openr(FILE *fp);
+extern void sstat_write(sstat_t *s, const solstate_t *state, const solstat_t *sat,
+                        int n);
+extern int sstat_read(sstat_t *s, solstate_t *state, solstat_t *sat, int nmax);
+extern void sstat_close(sstat_t *s);
+extern int readsolstatb(const char *file, solstatbuf_t *statbuf);
+extern void outsstat(FILE *fp, const solstate_t *state, const solstat_t *sat,
+                     int n, int level);
 extern void rtkinit(rtk_t *rtk, const prcopt_t *opt);
 extern void rtkfree(rtk_t *rtk);
 extern void rtkclosestat2(void);
 extern int rtkoutstat2(rtk_t *rtk, char *buff);
 extern int rtkopenstat2(const char *file, int level);
+/* per-stage latency profiler -----------------------------------------------*/
+extern prof_t *arc_prof_new(void);
+extern void arc_prof_free(prof_t *prof);
+extern double arc_prof_tic(void);
+extern void arc_prof_begin(prof_t *prof);
+extern double arc_prof_enter(prof_t *prof, int stage);
+extern void arc_prof_leave(prof_t *prof, int stage, double tick);
+extern void arc_prof_add(prof_t *prof, int stage, double t);
+extern void arc_prof_end(prof_t *prof, gtime_t time, int ns, int nx);
+extern double arc_prof_stage(const prof_t *prof, int stage, double p);
+extern double arc_prof_count(const prof_t *prof, int type, double p);
+extern int arc_prof_slow(const prof_t *prof, profep_t *ep, int n);
+extern void arc_prof_dump(const prof_t *prof, FILE *fp);
 /* plot----------------------------------------------------------------------*/
 extern int arc_plot(int argc, char *argv[]);
 #ifdef __cplusplus
 }
+#ifdef ARC_PROF
+struct prof_scope_t {                     /* scoped stage timer of profiler */
+    prof_t *prof; int stage; double tick;
+    prof_scope_t(prof_t *p, int s): prof(p),stage(s),tick(arc_prof_enter(p,s)) {}
+    ~prof_scope_t() {arc_prof_leave(prof,stage,tick);}
+};
+#endif
 #endif
 #endif
\ No newline at end of file
@@ -223,6 +223,8 @@ extern "C" {
 #ifndef MAXOBS
 #define MAXOBS      64                  /* max number of obs in an epoch */
 #endif
+#define MAXGLOKNOT  32                  /* max knots of glonass orbit cache in each direction */
+#define MAXMAPT     361                 /* elevation grid points of mapping function table */
 #define MAXRCV      64                  /* max receiver number (1 to MAXRCV) */
 #define MAXOBSTYPE  64                  /* max number of obs type in RINEX */
 #define DTTOL       0.005               /* tolerance of time difference (s) */
@@ -251,6 +253,16 @@ extern "C" {
 #define MAXSTRRTK   8                   /* max number of stream in RTK server */
 #define MAXSBSMSG   32                  /* max number of SBAS msg in RTK server */
 #define MAXSOLMSG   8191                /* max length of solution message */
+#define SOLBLEN     128                 /* length of binary solution record (bytes) */
+#define RTSVRNBUF   32                  /* epochs of real-time server input buffers */
+#define RTSVRNLAT   1000                /* bins of real-time server latency histogram (0.1 ms) */
+#define RTSVRNEPH   64                  /* max received ephemerides not yet used */
+#define SOLWBUFF    262144              /* buffer size of solution writer (bytes) (2^n) */
+#define SSTATBLK    65536               /* block size of binary solution statistics (bytes) */
+#define PROFNBIN    640                 /* bins of profiler histograms (2^k*32 range,16 sub-bins) */
+#define PROFNSLOW   8                   /* slowest epochs kept by profiler */
+#define SSTATNX     (26+NFREQ*2)        /* number of states of binary solution statistics */
+#define SSTATNS     12                  /* number of satellite states of binary solution statistics */
 #define MAXRAWLEN   4096                /* max length of receiver raw message */
 #define MAXERRMSG   4096                /* max length of error/warning message */
 #define MAXANT      64                  /* max length of station name/antenna type */
@@ -351,6 +363,16 @@ extern "C" {
 #define AMBFIX_BOOTS   2                /* ambiguity fix: boostraping */
 #define AMBFIX_FFRATIO 3                /* ambiguity fix: FF-ratio test */
 #define AMBFIX_PART    4                /* ambiguity fix: partial fixing */
+#define AMBFIX_ENSEMBLE 5               /* ambiguity fix: ensemble of strategies */
+
+#define ENSCAND_LAMBDA  0x01            /* ensemble candidate: lambda */
+#define ENSCAND_INHERIT 0x02            /* ensemble candidate: lambda with double-difference inherit */
+#define ENSCAND_GROUP   0x04            /* ensemble candidate: group-lambda */
+#define ENSCAND_BOOTS   0x08            /* ensemble candidate: bootstrapping */
+
+#define INNOV_NONE     0                /* innovation weighting: none */
+#define INNOV_ROBUST   1                /* innovation weighting: robust (IGG-III) */
+#define INNOV_ADAPT    2                /* innovation weighting: adaptive factor */
 
 #define AMB_FLOAT      1                /* ambiguity float */
 #define AMB_FIX        2                /* ambiguity fix */
@@ -358,12 +380,21 @@ extern "C" {
 #define AMB_INHERIT_FLOAT 0             /* inherit double-difference float */
 #define AMB_INHERIT_FIX   1             /* inherit double-difference fix */
 
+#define ARDEG_NONE     0                /* ar out of time budget: none */
+#define ARDEG_SKIP     1                /* ar out of time budget: skipped,float kept */
+#define ARDEG_BOOT     2                /* ar out of time budget: bootstrapping instead of search */
+#define ARDEG_INHERIT  3                /* ar out of time budget: inherited fix */
+#define ARDEG_FLOAT    4                /* ar out of time budget: search stopped,float kept */
+
+#define LAMBDA_TIMEOUT -2               /* lambda search stopped by deadline */
+
 #define SOLF_LLH    0                   /* solution format: lat/lon/height */
 #define SOLF_XYZ    1                   /* solution format: x/y/z-ecef */
 #define SOLF_ENU    2                   /* solution format: e/n/u-baseline */
 #define SOLF_NMEA   3                   /* solution format: NMEA-183 */
 #define SOLF_STAT   4                   /* solution format: solution status */
 #define SOLF_GSIF   5                   /* solution format: GSI F1/F2 */
+#define SOLF_BIN    6                   /* solution format: binary records */
 
 #define SOLQ_NONE   0                   /* solution status: no solution */
 #define SOLQ_FIX    1                   /* solution status: fix */
@@ -412,6 +443,37 @@ extern "C" {
 #define ARMODE_INST 2                   /* AR mode: instantaneous */
 #define ARMODE_FIXHOLD 3                /* AR mode: fix and hold */
 
+#define STR_NONE     0                  /* stream type: none */
+#define STR_FILE     1                  /* stream type: file (tail on read) */
+#define STR_PIPE     2                  /* stream type: named pipe */
+#define STR_TCPSVR   3                  /* stream type: tcp server */
+#define STR_TCPCLI   4                  /* stream type: tcp client */
+
+#define STR_MODE_R  0x1                 /* stream mode: read */
+#define STR_MODE_W  0x2                 /* stream mode: write */
+
+#define STRFMT_RINEX 0                  /* stream format: rinex observation */
+#define STRFMT_RTCM3 1                  /* stream format: rtcm 3 */
+
+#define PROF_SATPOS  0                  /* profiler stage: satellite positions */
+#define PROF_ZDRESB  1                  /* profiler stage: undifferenced residuals of base */
+#define PROF_ZDRESR  2                  /* profiler stage: undifferenced residuals of rover */
+#define PROF_UDSTATE 3                  /* profiler stage: temporal update of states */
+#define PROF_DDRES   4                  /* profiler stage: double-differenced residuals */
+#define PROF_FILTER  5                  /* profiler stage: measurement update of states */
+#define PROF_RESAMB  6                  /* profiler stage: ambiguity resolution */
+#define PROF_VALPOS  7                  /* profiler stage: validation of solution */
+#define PROF_SOLSTAT 8                  /* profiler stage: output of solution status */
+#define PROF_OUTSOL  9                  /* profiler stage: output of solution */
+#define PROF_EPOCH   10                 /* profiler stage: whole epoch of arc_srtkpos */
+#define PROF_NSTAGE  11                 /* number of profiler stages */
+
+#define PROF_NSAT    0                  /* profiler counter: satellites of solution */
+#define PROF_NX      1                  /* profiler counter: number of states */
+#define PROF_NAMB    2                  /* profiler counter: ambiguities to be fixed */
+#define PROF_NODE    3                  /* profiler counter: nodes of lambda search */
+#define PROF_NCOUNT  4                  /* number of profiler counters */
+
 #define POSOPT_POS   0                  /* pos option: LLH/XYZ */
 #define POSOPT_SINGLE 1                 /* pos option: average of single pos */
 #define POSOPT_FILE  2                  /* pos option: read from pos file */
@@ -455,6 +517,9 @@ extern "C" {
 #define initlock(f) InitializeCriticalSection(f)
 #define lock(f)     EnterCriticalSection(f)
 #define unlock(f)   LeaveCriticalSection(f)
+#define THREADLOCAL __declspec(thread)
+#define atomic_get(p)   InterlockedCompareExchange((volatile LONG *)(p),0,0)
+#define atomic_set(p,v) InterlockedExchange((volatile LONG *)(p),(LONG)(v))
 #define FILEPATHSEP '\\'
 #else
 #define thread_t    pthread_t
@@ -462,6 +527,9 @@ extern "C" {
 #define initlock(f) pthread_mutex_init(f,NULL)
 #define lock(f)     pthread_mutex_lock(f)
 #define unlock(f)   pthread_mutex_unlock(f)
+#define THREADLOCAL __thread
+#define atomic_get(p)   __atomic_load_n(p,__ATOMIC_ACQUIRE)
+#define atomic_set(p,v) __atomic_store_n(p,v,__ATOMIC_RELEASE)
 #define FILEPATHSEP '/'
 #endif
 
@@ -515,8 +583,19 @@ typedef struct {        /* antenna parameter type */
 typedef struct {        /* antenna parameters type */
     int n,nmax;         /* number of data/allocated */
     pcv_t *pcv;         /* antenna parameters data */
+    int nh;             /* number of antenna type hash buckets */
+    int *htype;         /* first data of antenna type hash buckets (-1:none) */
+    int *hsat;          /* first data of satellites {MAXSAT} (-1:none) */
+    int *next;          /* next data of same bucket or satellite (-1:none) */
 } pcvs_t;
 
+typedef struct {        /* receiver antenna pcv table type */
+    int stat;           /* status (0:not set,1:set) */
+    double off[NFREQ][3]; /* phase center offset plus antenna delta e/n/u (m) */
+    double var[NFREQ][19]; /* phase center variation at zenith angle 0,5,... (m) */
+    double dvar[NFREQ][19]; /* variation difference to next zenith angle (m) */
+} pcvt_t;
+
 typedef struct {        /* almanac type */
     int sat;            /* satellite number */
     int svh;            /* sv health (0:ok) */
@@ -565,6 +644,13 @@ typedef struct {        /* GLONASS broadcast ephemeris type */
     double dtaun;       /* delay between L1 and L2 (s) */
 } geph_t;
 
+typedef struct {        /* GLONASS orbit integration cache type */
+    gtime_t toe;        /* epoch of cached ephemeris (0:none) */
+    double pos[3];      /* satellite position of cached ephemeris (ecef) (m) */
+    int n[2];           /* number of integrated knots {forward,backward} */
+    double x[2][MAXGLOKNOT][6]; /* satellite state at toe+-k*TSTEP (ecef) (m|m/s) */
+} gloc_t;
+
 typedef struct {        /* precise ephemeris type */
     gtime_t time;       /* time (GPST) */
     int index;          /* ephemeris index for multiple files */
@@ -583,6 +669,18 @@ typedef struct {        /* precise clock type */
     float  std[MAXSAT][1]; /* satellite clock std (s) */
 } pclk_t;
 
+typedef struct {        /* precise ephemeris coefficients type */
+    int n;              /* number of segments between ephemeris epochs */
+    double *coef[MAXSAT]; /* chebyshev coefficients of orbit (NULL:no data) */
+    unsigned char *stat[MAXSAT]; /* status of segments (1:ok,0:outage) */
+} pephc_t;
+
+typedef struct {        /* ephemeris evaluation state type */
+    int cur,curc;       /* last segment of ephemeris/clock searched (-1:none) */
+    int dense;          /* glonass orbit dense output between knots (0:off,1:on) */
+    gloc_t *glo;        /* glonass orbit integration caches {NSATGLO} (NULL:none) */
+} ephc_t;
+
 typedef struct {        /* SBAS ephemeris type */
     int sat;            /* satellite number */
     gtime_t t0;         /* reference epoch time (GPST) */
@@ -638,6 +736,7 @@ typedef struct {        /* navigation data type */
     double glo_cpbias[4];       /* glonass code-phase bias {1C,1P,2C,2P} (m) */
     char glo_fcn[MAXPRNGLO+1];  /* glonass frequency channel number + 8 */
     pcv_t pcvs[MAXSAT];         /* satellite antenna pcv */
+    pephc_t *pephc;             /* precise ephemeris coefficients (NULL:none) */
 } nav_t;
 
 typedef struct {        /* station parameter type */
@@ -708,6 +807,7 @@ typedef struct {        /* solution type */
     double clk_dri;     /* rover station clock drift */
     amb_t bias;         /* double-difference ambiguity,different from rtk's */
     int clk_jmp;        /* reciver clock jump detect flag */
+    unsigned char ardeg; /* ambiguity resolution degraded by time budget (ARDEG_???) */
 } sol_t;
 
 typedef struct {        /* solution status type */
@@ -719,12 +819,29 @@ typedef struct {        /* solution status type */
     float resc;         /* carrier-phase residual (m) */
     unsigned char flag; /* flags: (vsat<<5)+(slip<<3)+fix */
     unsigned char snr;  /* signal strength (0.25 dBHz) */
-    unsigned short lock;  /* lock counter */
-    unsigned short outc;  /* outage counter */
-    unsigned short slipc; /* slip counter */
-    unsigned short rejc;  /* reject counter */
+    int lock;           /* lock counter */
+    unsigned int outc;  /* outage counter */
+    unsigned int slipc; /* slip counter */
+    unsigned int rejc;  /* reject counter */
+    float ion[2];       /* ionospheric delay float/fixed (m) */
 } solstat_t;
 
+typedef struct {        /* solution state type */
+    gtime_t time;       /* time (GPST) */
+    unsigned char stat; /* solution status (SOLQ_???) */
+    unsigned char ion;  /* ionospheric delay estimated (0:no,1:yes) */
+    unsigned char ntrp; /* number of tropospheric parameters (0:none,2:rover/base) */
+    unsigned char nf;   /* number of receiver h/w biases (0:none) */
+    double pos[3];      /* receiver position float (ecef) (m) */
+    double posa[3];     /* receiver position fixed (ecef) (m) */
+    float vel[3],acc[3]; /* receiver velocity/acceleration float (enu) (m/s|m/s^2) */
+    float vela[3],acca[3]; /* receiver velocity/acceleration fixed (enu) (m/s|m/s^2) */
+    double dtr[4];      /* receiver clocks (ns) */
+    float trp[2][2];    /* ztd of rover/base float/fixed (m) */
+    float hwb[NFREQ][2]; /* receiver h/w biases float/fixed (m) */
+    unsigned char ardeg; /* ambiguity resolution degraded by time budget (ARDEG_???) */
+} solstate_t;
+
 typedef struct {        /* solution status buffer type */
     int n,nmax;         /* number of solution/max number of buffer */
     solstat_t *data;    /* solution status data */
@@ -752,7 +869,7 @@ typedef struct {           /* SNR mask type */
 
 typedef struct {        /* processing options type */
     int mode;           /* positioning mode (PMODE_???) */
-    int soltype;        /* solution type (0:forward,1:backward,2:combined) */
+    int soltype;        /* solution type (0:forward,1:backward,2:combined,3:fixed-lag) */
     int nf;             /* number of frequencies (1:L1,2:L1+L2,3:L1+L2+L5) */
     int navsys;         /* navigation system */
     double elmin;       /* elevation mask angle (rad) */
@@ -884,6 +1001,21 @@ typedef struct {        /* processing options type */
     double inherit_IF;     /* inherit double-difference ambiguity impact factor */
     double lambda_diff;    /* thres of lambda difference test */
     double lambda_project_thres; /* lambda project test thres */
+    int amb_ens_nthread;   /* ensemble ambiguity resolution threads (0:one per strategy,1:serial) */
+    double amb_ens_budget; /* ensemble ambiguity resolution time budget per epoch (ms) (0:no limit) */
+    int ukf_nthread;       /* ukf sigma point measurement threads (0,1:serial) */
+    int neq_static;        /* static normal equation accumulation (0:off,1:on) */
+    double neq_ckpt;       /* static normal equation solution interval (s) (0:end only) */
+    int neq_nthread;       /* static normal equation accumulation threads (0,1:serial) */
+    int tropmapt;          /* troposphere mapping function table (0:off,1:on) */
+    int glodense;          /* glonass orbit dense output between knots (0:off,1:on) */
+    int spp_nthread;       /* batch single point positioning threads (0,1:serial) */
+    double fls_lag;        /* fixed-lag smoother lag (s) */
+    int pipeline;          /* pipelined epoch processing (0:off,1:on) */
+    double amb_budget;     /* ambiguity resolution time budget per epoch (ms) (0:no limit) */
+    int pf_nthread;        /* particle filter threads (0,1:serial) */
+    double amb_bootps;     /* min bootstrapping success rate out of time budget (0:thresar[1]) */
+    int amb_ens_cand;      /* ensemble ambiguity resolution candidates (ENSCAND_???) (0:lambda+boots,+inherit by amb_inherit) */
 
 } prcopt_t;
 
@@ -906,8 +1038,31 @@ typedef struct {        /* solution options type */
     char sep[64];       /* field separator */
     char prog[64];      /* program name */
     double maxsolstd;   /* max std-dev for solution output (m) (0:all) */
+    int sstatf;         /* solution statistics format (0:text,1:binary) */
 } solopt_t;
 
+typedef struct {        /* binary solution writer type */
+    FILE *fp;           /* output file pointer */
+    unsigned char *buff; /* ring buffer {SOLWBUFF} */
+    unsigned int head;  /* number of pushed bytes (processing thread) */
+    unsigned int tail;  /* number of written bytes (writer thread) */
+    int state;          /* state (1:running,0:stop request) */
+    int run;            /* writer thread running flag */
+    thread_t thread;    /* writer thread */
+} solw_t;
+
+typedef struct {        /* binary solution statistics stream type */
+    FILE *fp;           /* stream file pointer */
+    solw_t *w;          /* writer (NULL: reader) */
+    int level;          /* statistics level (1:states,2:residuals) */
+    int ver;            /* format version of epochs */
+    unsigned char *buff; /* block buffer */
+    int nb,ne,ib;       /* bytes and epochs of block, read pointer */
+    long long t;        /* previous time (ns) */
+    long long x[SSTATNX]; /* previous quantized states */
+    long long *s;       /* previous quantized satellite states {SSTATNS*NFREQ*MAXSAT} */
+} sstat_t;
+
 typedef struct {              /* file options type */
     char satantp[MAXSTRPATH]; /* satellite antenna parameters file */
     char rcvantp[MAXSTRPATH]; /* receiver antenna parameters file */
@@ -1011,6 +1166,7 @@ typedef struct {        /* ambiguity control type */
 /* ukf ---------------------------------------------*/
 typedef void (*filter_function)(int, double *,double *);
 typedef void (*measure_function)(double *, double *);
+typedef int (*srukf_function)(const double *, int, double *, int, void *);
 
 typedef struct                 /* filter structure */
 {
@@ -1044,6 +1200,172 @@ typedef struct                 /* filter structure */
     double *KL;
 } ukf_t;
 
+/* sliding-window solver ---------------------------*/
+#define SWIN_NBROW  4          /* max ambiguity partials per residual */
+
+typedef struct {               /* sliding-window epoch block type */
+    gtime_t time;              /* epoch time */
+    int ne;                    /* number of epoch states */
+    int *ie;                   /* epoch states index in states vector (ne) */
+    double *xe;                /* epoch states estimate (ne) */
+    double *x0;                /* epoch states at linearization point (ne) */
+    double *xp,*Ip;            /* epoch states prior and its information matrix (ne x ne) */
+    int nv;                    /* number of double-differenced residuals */
+    double *v0;                /* residuals at linearization point (nv) */
+    double *He;                /* partials by epoch states (ne x nv) */
+    int *bs;                   /* ambiguity slots of partials (SWIN_NBROW x nv) (-1:none) */
+    double *bh;                /* ambiguity partials (SWIN_NBROW x nv) */
+    double *b0;                /* ambiguity at linearization point (SWIN_NBROW x nv) */
+    double *rs;                /* satellite positions of residual pair (6 x nv) */
+    int *geo;                  /* residual with geometric range of rover (nv) */
+    double *W;                 /* weight matrix (R^-1) (nv x nv) */
+} swblk_t;
+
+typedef struct {               /* sliding-window solver type */
+    int nw;                    /* window size (epochs) */
+    int nb,nl;                 /* number of blocks in window, index of newest block */
+    swblk_t *blk;              /* epoch blocks (ring buffer of nw) */
+    int nx,nr;                 /* number of states, number of epoch states (index<nr) */
+    int ns,nsmax;              /* number of/allocated ambiguity slots */
+    int *sidx;                 /* states index of slots (-1:retired) */
+    int *sref;                 /* number of residuals refering slots */
+    double *sx0;               /* reference value of slots */
+    double *sx;                /* estimate of slots relative to reference value */
+    double *L,*eta;            /* marginalization prior information matrix and vector */
+    double *A,*g;              /* reduced normal equation (nsmax x nsmax) */
+    int *slot;                 /* current slot of ambiguity states (nx-nr) (-1:none) */
+} swin_t;
+
+typedef struct {               /* static normal equation type */
+    gtime_t ts,te;             /* time of first/last accumulated epoch */
+    int nx,nr;                 /* number of states, number of epoch states (index<nr) */
+    int ns,nsmax;              /* number of/allocated ambiguity parameters */
+    int nep,nv;                /* number of accumulated epochs/residuals */
+    int warm;                  /* warm-up epochs left (no accumulation) */
+    double x0[3];              /* linearization point of rover position (ecef) (m) */
+    int *slot;                 /* current parameter of ambiguity states (nx-nr) (-1:none) */
+    int *sidx;                 /* states index of parameters (-1:retired) */
+    int *sst;                  /* states index of parameters at start */
+    int *head;                 /* parameter started in warm-up epochs */
+    int *nobs;                 /* number of residuals of parameters */
+    double *sx0;               /* reference value of parameters (cycle) */
+    double *N,*u;              /* normal equation of position and parameters (3+nsmax) */
+} neq_t;
+
+typedef struct {               /* fixed-lag smoother epoch type */
+    gtime_t time;              /* epoch time (gpst) */
+    unsigned char stat,ns;     /* solution status, number of valid satellites */
+    unsigned char flt;         /* filtered states available (0:pass-through) */
+    unsigned char link;        /* states propagated from previous epoch */
+    unsigned char sm;          /* states smoothed (x,P: smoothed states) */
+    float age,ratio,thres;     /* solution age, ratio and ratio threshold */
+    double rr[6];              /* solution position/velocity (ecef) (m|m/s) */
+    float qr[6];               /* solution position variance/covariance (m^2) */
+    double rb[3];              /* base position (ecef) (m) */
+    int na;                    /* number of filtered states */
+    int *ix;                   /* index of filtered states in rtk->x (na) */
+    double *x,*P;              /* filtered/smoothed states and covariance (na,na x na) */
+    double *xp,*Pp;            /* predicted from previous epoch (link) (na,na x na) */
+    double *C;                 /* smoother gain to next epoch (na x na of next epoch) */
+} flsep_t;
+
+typedef struct {               /* fixed-lag smoother type */
+    int np;                    /* number of position/velocity states (3,6) */
+    double lag;                /* smoother lag (s) */
+    int n,nmax,head;           /* number of/allocated epochs, index of oldest epoch */
+    unsigned int ntu;          /* position time updates of newest epoch */
+    int nx;                    /* number of filter states (rtk->nx) */
+    int tu;                    /* time update since newest epoch (0:none,1:predicted) */
+    double *Pc;                /* covariance of filtered states of newest epoch and
+                                  filter states in time update (na x nx) */
+    double *xp,*Pp;            /* predicted filter states and covariance (nx,nx x nx) */
+    flsep_t *ep;               /* epochs (ring buffer) */
+} fls_t;
+
+typedef struct {               /* innovation weighting type */
+    int mode;                  /* weighting mode (INNOV_???) */
+    double k0,k1;              /* thresholds of normalized innovations (robust) */
+    const double *qd;          /* process noise variance of states (n) (adaptive) */
+    double lam;                /* adaptive factor (adaptive) (output) */
+    double *e;                 /* normalized innovations (m) (output,NULL:no output) */
+    double *d;                 /* equivalent weights (m) (output,NULL:no output) */
+} innov_t;
+
+typedef struct {               /* undifferenced residual context type */
+    gtime_t time;              /* epoch time of context (time.time==0:none) */
+    int n;                     /* number of observations */
+    double rr[3];              /* linearization point of models (ecef) (m) */
+    double disp[3];            /* tide displacement (ecef) (m) */
+    double pos[3];             /* geodetic position {lat,lon,h} (rad,m) */
+    double zhd;                /* zenith hydrostatic delay (m) */
+    int sat[MAXOBS];           /* satellite number */
+    int stat[MAXOBS];          /* model status (0:not computed,1:valid,-1:rejected) */
+    double trop[MAXOBS];       /* slant hydrostatic delay (m) */
+    double dion[MAXOBS];       /* ionospheric delay (m) */
+    double vion[MAXOBS];       /* ionospheric delay variance (m^2) */
+    double dant[MAXOBS*NFREQ]; /* receiver antenna phase center correction (m) */
+    double phw[MAXOBS];        /* phase windup correction (cycle) */
+} zdctx_t;
+
+typedef struct {               /* geophysical context type */
+    gtime_t time;              /* time of epoch values (utc) (time.time==0:none) */
+    int erp;                   /* erp values available (0:no,1:yes) */
+    double erpv[5];            /* erp values {xp,yp,ut1_utc,lod} (rad,rad,s,s/d) */
+    double rsun[3],rmoon[3];   /* sun/moon position (ecef) (m) */
+    double gmst;               /* greenwich mean sidereal time (rad) */
+    gtime_t tk;                /* time of center knot (utc) (tk.time==0:none) */
+    double ksun[9],kmoon[9];   /* sun/moon position at knots tk-dt,tk,tk+dt (ecef) (m) */
+} geoctx_t;
+
+typedef struct {               /* precomputed epoch context type */
+    gtime_t time;              /* epoch time (time.time==0:none) */
+    int n;                     /* number of observations (rover+base) */
+    int sat[MAXOBS*2];         /* satellite number */
+    double rs[MAXOBS*2*6];     /* satellite positions/velocities (ecef) (m|m/s) */
+    double dts[MAXOBS*2*2];    /* satellite clocks bias/drift (s|s/s) */
+    double var[MAXOBS*2];      /* satellite position and clock variances (m^2) */
+    int svh[MAXOBS*2];         /* satellite health flags */
+    geoctx_t geo;              /* geophysical context of epoch */
+    int zdb;                   /* base station terms valid (0:no,1:yes) */
+    zdctx_t zdc;               /* undifferenced residual context of base station */
+} epctx_t;
+
+typedef struct {               /* profiler histogram type */
+    unsigned int bin[PROFNBIN]; /* counts of log-linear bins of integer values */
+    unsigned int n;            /* number of samples */
+    double sum,max;            /* sum and max of samples */
+} profh_t;
+
+typedef struct {               /* profiler epoch record type */
+    gtime_t time;              /* epoch time */
+    double t[PROF_NSTAGE];     /* stage times (s) */
+    int ns,nx,nb;              /* satellites, states, ambiguities */
+    unsigned int node;         /* nodes of lambda search */
+} profep_t;
+
+typedef struct {               /* per-stage latency profiler type */
+    profh_t h[PROF_NSTAGE];    /* stage time histograms (ns) */
+    profh_t hc[PROF_NCOUNT];   /* per-epoch counter histograms */
+    profep_t ep;               /* record of current epoch */
+    double tick;               /* start of current epoch (s) */
+    unsigned int act;          /* active stages of current epoch (bit mask) */
+    profep_t slow[PROFNSLOW];  /* slowest epochs (sorted by epoch time) */
+    int nslow;                 /* number of slowest epochs */
+} prof_t;
+
+typedef double (*mapfunc_t)(gtime_t time, const double *pos, const double *azel,
+                            double *mapfw); /* troposphere mapping function type */
+
+typedef struct {               /* troposphere mapping function table type */
+    mapfunc_t func;            /* mapping function (NULL:not initialized) */
+    gtime_t time;              /* time of table */
+    double pos[3];             /* receiver position of table {lat,lon,h} (rad,m) */
+    double gh[MAXMAPT];        /* dry mapping function*sin(el) at elevation grid */
+    double gw[MAXMAPT];        /* wet mapping function*sin(el) at elevation grid */
+    double dh[MAXMAPT][2];     /* 1st/2nd height derivatives of gh (/m,/m^2) */
+    double dw[MAXMAPT][2];     /* 1st/2nd height derivatives of gw (/m,/m^2) */
+} mapt_t;
+
 typedef struct {         /* RTK control/result type */
     sol_t  sol;          /* RTK solution */
     double rb[6];        /* base position/velocity (ecef) (m|m/s) */
@@ -1062,6 +1384,14 @@ typedef struct {         /* RTK control/result type */
     int *ceres_active_x;    /* ceres solver active states index in states list */
     double lam;             /* adaptive Kaman filter parameters */
     ukf_t* ukf;             /* unscented Kalman filter */
+    swin_t *swin;           /* sliding-window solver (ceres options) */
+    neq_t *neq;             /* static normal equation (NULL:kalman filter) */
+    fls_t *fls;             /* fixed-lag smoother (NULL:off) */
+    zdctx_t zdc[2];         /* undifferenced residual context (0:rover,1:base) */
+    geoctx_t geo;           /* geophysical context of epoch */
+    const epctx_t *epc;     /* precomputed epoch context (NULL:none) */
+    mapt_t mapt[2];         /* troposphere mapping function table (0:rover,1:base) */
+    pcvt_t pcvt[2];         /* receiver antenna pcv table (0:rover,1:base) */
     int sat[MAXSAT];        /* hold the double-difference satellite pair,sat[2*i] is reference satellite */
     int obs_ind[2*MAXSAT];  /* index of observations for every double-difference observations */
     int nc;                 /* phase observation numbers */
@@ -1087,8 +1417,104 @@ typedef struct {         /* RTK control/result type */
     int ddsat[MAXSAT*2];    /* double-difference satellite pair */
     int inherit_fix;        /* double-difference ambiguity inherit fix status */
     int inherix_fixc;       /* counts of double-difference ambiguity inherit fix */
+    unsigned int ntu;       /* position time updates since last reset (0:reset) */
+    prof_t *prof;           /* per-stage latency profiler (NULL:off) */
+    double ar_dl;           /* deadline of ambiguity resolution of epoch (s) (0:no limit) */
+    ephc_t ephc;            /* ephemeris evaluation state of processing thread */
+    int trpc;               /* epochs since troposphere parameters reset */
+    obsd_t obsb[MAXOBS];    /* base station observations for time-interpolation */
+    int nobsb;              /* number of base station observations for time-interpolation */
 } rtk_t;
 
+typedef struct {        /* stream type */
+    int type;           /* type (STR_???) */
+    int mode;           /* mode (STR_MODE_?) */
+    int state;          /* state (-1:error,0:close,1:open) */
+    int fd;             /* file/pipe/socket descriptor (-1:none) */
+    int sfd;            /* listening socket of tcp server (-1:none) */
+    int port;           /* tcp port */
+    volatile int stop;  /* stop request of blocking read */
+    unsigned int tcon;  /* last tcp connection trial tick (ms) */
+    unsigned int inb,outb; /* input/output bytes */
+    char host[256];     /* tcp host */
+    char path[MAXSTRPATH]; /* stream path */
+} stream_t;
+
+typedef struct {        /* rinex control type */
+    gtime_t time;       /* message time */
+    double ver;         /* rinex version */
+    char   type;        /* rinex file type ('O',...) */
+    int    sys;         /* navigation system */
+    int    tsys;        /* time system */
+    char   tobs[7][MAXOBSTYPE][4]; /* rinex obs types */
+    obs_t  obs;         /* observation data of epoch {MAXOBS} */
+    nav_t  nav;         /* navigation data of header */
+    sta_t  sta;         /* station info */
+    unsigned char slips[MAXSAT][NFREQ]; /* cycle slips */
+    char   opt[256];    /* rinex options */
+} rnxctr_t;
+
+typedef struct {        /* rtcm control struct type */
+    int staid;          /* station id */
+    int seqno;          /* issue of data station of msm */
+    gtime_t time;       /* message time */
+    obs_t obs;          /* observation data (uncorrected) */
+    nav_t nav;          /* satellite ephemerides (eph[sat-1]) */
+    sta_t sta;          /* station parameters */
+    int ephsat;         /* update satellite of ephemeris */
+    int obsflag;        /* obs data complete flag (1:ok,0:not complete) */
+    int lltime[MAXSAT][NFREQ]; /* last lock time (ms) */
+    int nbyte;          /* number of bytes in message buffer */
+    int len;            /* message length (bytes) */
+    unsigned int nerr;  /* number of parity errors */
+    unsigned int nmsg3[400]; /* message count of rtcm 3 (1-399:1001-1399,0:other) */
+    unsigned char buff[1200]; /* message buffer */
+    char opt[256];      /* rtcm dependent options */
+} rtcm_t;
+
+typedef struct {        /* real-time server epoch type */
+    double tick;        /* arrival time (s) */
+    int n;              /* number of observation data */
+    obsd_t obs[MAXOBS]; /* observation data */
+} rtsvrep_t;
+
+typedef struct {        /* real-time server type */
+    int state;          /* server state (0:stop,1:running) */
+    prcopt_t popt;      /* processing options */
+    solopt_t sopt;      /* solution options */
+    rtk_t rtk;          /* rtk control/result struct */
+    nav_t nav;          /* navigation data (ephemerides updated by streams) */
+    int fmt[2];         /* stream formats (STRFMT_???) (0:rover,1:base) */
+    stream_t str[3];    /* streams (0:rover,1:base,2:solution) */
+    rtsvrep_t *buf[2];  /* epoch ring buffers {RTSVRNBUF} (0:rover,1:base) */
+    int head[2],n[2];   /* oldest epoch and number of epochs in buffers */
+    int syncwait;       /* max wait of base epoch after rover epoch (ms) */
+    unsigned int nrecv[2]; /* received epochs (0:rover,1:base) */
+    unsigned int nover[2]; /* epochs dropped by buffer overflow */
+    unsigned int nproc,nsol,nbase; /* processed epochs, solutions, epochs with base */
+    double latsum,latmax; /* sum and max of epoch latency (s) */
+    unsigned int lath[RTSVRNLAT+1]; /* latency histogram (0.1 ms bins) */
+    eph_t ephq[RTSVRNEPH]; /* received ephemerides not yet used */
+    int neph;           /* number of received ephemerides not yet used */
+    double rbq[3];      /* received base station position not yet used (ecef) (m) */
+    int nrb;            /* received base station position not yet used (0:none) */
+    thread_t thread[3]; /* threads (0:rover,1:base,2:processing) */
+    lock_t lock;        /* lock of buffers and statistics */
+#ifndef WIN32
+    pthread_cond_t cond; /* input condition */
+#endif
+} rtsvr_t;
+
+typedef struct {        /* rinex or rtcm replay source type */
+    int state;          /* state (0:stop,1:running,2:end) */
+    FILE *fp;           /* rinex observation or rtcm 3 file */
+    int fmt;            /* file format (STRFMT_???) */
+    stream_t str;       /* output stream */
+    double speed;       /* replay speed (x real time) (0:no wait) */
+    unsigned int nep;   /* replayed epochs */
+    thread_t thread;    /* replay thread */
+} replay_t;
+
 typedef struct half_cyc_tag {  /* half-cycle correction list type */
     unsigned char sat;         /* satellite number */
     unsigned char freq;        /* frequency number (0:L1,1:L2,2:L5) */
@@ -148,6 +148,90 @@ static void arc_udbias(rtk_t *rtk, double tt, const obsd_t *obs, const int *sat,
         free(bias);
     }
 }
+/* per-epoch update of cycle slip and reset flags of phase biases ------------
+* same as the rtk control struct part of arc_udbias(),but is called only once
+* per epoch,the particle independent results are saved to reset and bias
+*-----------------------------------------------------------------------------*/
+static void arc_udslip(rtk_t *rtk, const obsd_t *obs, const int *sat,
+                       const int *iu, const int *ir, int ns, const nav_t *nav,
+                       int *reset, double *bias)
+{
+    double cp,pr,lami;
+    int i,f,nf=1,out;
+
+    for (i=0;i<ns;i++) {
+
+        /* detect cycle slip by LLI */
+        for (f=0;f<rtk->opt.nf;f++) rtk->ssat[sat[i]-1].slip[f]&=0xFC;
+        detslp_ll(rtk,obs,iu[i],1);
+        detslp_ll(rtk,obs,ir[i],2);
+
+        /* update half-cycle valid flag */
+        for (f=0;f<nf;f++) {
+            rtk->ssat[sat[i]-1].half[f]=
+                    !((obs[iu[i]].LLI[f]&2)||(obs[ir[i]].LLI[f]&2));
+        }
+    }
+    for (f=0;f<nf;f++) {
+        /* reset phase-bias if instantaneous AR or expire obs outage counter */
+        for (i=1;i<=MAXSAT;i++) {
+
+            out=++rtk->ssat[i-1].outc[f]>(unsigned int)rtk->opt.maxout;
+            reset[i-1+f*MAXSAT]=(rtk->opt.modear==ARMODE_INST||out)
+                                &&rtk->x[IB(i,f,&rtk->opt)]!=0.0;
+
+            if (rtk->opt.modear!=ARMODE_INST&&out) {
+                rtk->ssat[i-1].lock[f]=-rtk->opt.minlock;
+            }
+        }
+        /* reset phase-bias if detecting cycle slip */
+        for (i=0;i<ns;i++) {
+            if (rtk->opt.modear==ARMODE_INST||!(rtk->ssat[sat[i]-1].slip[f]&1)) continue;
+            reset[sat[i]-1+f*MAXSAT]=1;
+            rtk->ssat[sat[i]-1].lock[f]=-rtk->opt.minlock;
+        }
+        /* approximate phase-bias by phase - code */
+        for (i=0;i<ns;i++) {
+            bias[i+f*MAXSAT]=0.0;
+            cp=arc_sdobs(obs,iu[i],ir[i],f); /* cycle */
+            pr=arc_sdobs(obs,iu[i],ir[i],f+NFREQ);
+            lami=nav->lam[sat[i]-1][f];
+            if (cp==0.0||pr==0.0||lami<=0.0) continue;
+            bias[i+f*MAXSAT]=cp-pr/lami;
+        }
+    }
+}
+/* per-particle temporal update of phase biases ------------------------------
+* no update of rtk control struct,so it can be called concurrently
+*-----------------------------------------------------------------------------*/
+static void arc_udbias_x(const prcopt_t *opt, const int *sat, int ns,
+                         const int *reset, const double *bias, double *X)
+{
+    double offset;
+    int i,j,f,nf=1;
+
+    for (f=0;f<nf;f++) {
+        for (i=1;i<=MAXSAT;i++) {
+            if (reset[i-1+f*MAXSAT]) X[IB(i,f,opt)]=0.0;
+        }
+        /* correct phase-bias offset to enssure phase-code coherency */
+        for (i=j=0,offset=0.0;i<ns;i++) {
+            if (bias[i+f*MAXSAT]==0.0||X[IB(sat[i],f,opt)]==0.0) continue;
+            offset+=bias[i+f*MAXSAT]-X[IB(sat[i],f,opt)];
+            j++;
+        }
+        if (j>0) {
+            for (i=1;i<=MAXSAT;i++) {
+                if (X[IB(i,f,opt)]!=0.0) X[IB(i,f,opt)]+=offset/j;
+            }
+        }
+        /* set initial states of phase-bias */
+        for (i=0;i<ns;i++) {
+            if (bias[i+f*MAXSAT]==0.0||X[IB(sat[i],f,opt)]!=0.0) continue;
+            X[IB(sat[i],f,opt)]=bias[i+f*MAXSAT];
+        }
+    }
+}
 /* baseline length -----------------------------------------------------------*/
 static double baseline(const double *ru, const double *rb, double *dr)
 {
@@ -176,28 +260,63 @@ namespace ARC {
         PF_AMB_MIN=ARC_PF_AMB_MIN;
         PF_AMB_MAX=ARC_PF_AMB_MAX;
         m_RNG = new libPF::CRandomNumberGenerator();
+        m_SRTK=NULL; Ns=0; m_Prepared=0;
     }
     ARC_MovementModel::~ARC_MovementModel() {
         if (m_RNG) delete m_RNG;
     }
     ARC_MovementModel::ARC_MovementModel(const ARC_OPT *OPT,ARC_RTK* SRTK):
             libPF::MovementModel<ARC_States>() {
+        PF_ROVERPOS_STD=ARC_PF_ROVERPOS_STD;
+        PF_AMB_MIN=ARC_PF_AMB_MIN;
+        PF_AMB_MAX=ARC_PF_AMB_MAX;
         m_RNG = new libPF::CRandomNumberGenerator();
+        m_SRTK=SRTK; Ns=0; m_Prepared=0;
+    }
+    void ARC_MovementModel::PrepareEpoch()
+    {
+        ARC_ASSERT_TRUE(Exception,m_SRTK!=NULL,"Movement Model has no SRTK");
+        if (Ns<=0) {
+            m_Prepared=0;
+            return;
+        }
+        arc_udslip(m_SRTK,m_OBS,SatList,m_RoverSat,m_BaseSat,Ns,m_NAV,m_Reset,m_Bias);
+        m_Prepared=1;
     }
     void ARC_MovementModel::drift(ARC_States &state, double dt) const
     {
         if (Ns<=0) return;
         ARC_ASSERT_TRUE(Exception,m_SRTK->nx > 0,"Particle Filter States is Zero");
+        if (m_Prepared) {
+            arc_udbias_x(&m_SRTK->opt,SatList,Ns,m_Reset,m_Bias,state.getStatesVal());
+            return;
+        }
         arc_udstate(m_SRTK,m_OBS,SatList,m_RoverSat,m_BaseSat,Ns,m_NAV,dt,state.getStatesVal());
     }
     void ARC_MovementModel::diffuse(ARC_States &state, double dt) const
+    {
+        diffuse(state,dt,m_RNG);
+    }
+    void ARC_MovementModel::diffuse(ARC_States &state, double dt,
+                                    const libPF::RandomNumberGenerationStrategy* rng) const
     {
         ARC_ASSERT_TRUE(Exception,m_SRTK->nx > 0,"Particle Filter States is Zero");
-        for (int i=0;i<m_SRTK->nx;i++) {
+        double dpos[3],damb[MAXPFSTETAS];
+        int n=MIN(m_SRTK->nx,state.getStatesNum());
+
+        /* draw all perturbations of this particle in two batches */
+        rng->fillGaussian(dpos,3,PF_ROVERPOS_STD);
+        if (n>3) rng->fillUniform(damb,n-3,PF_AMB_MIN,PF_AMB_MAX);
+
+        for (int i=0;i<n;i++) {
             if (state.getStateValue(i)==0.0)
                 continue;
-            if (i<3) state.SetStatesValue(state.getStateValue(i)+m_RNG->getGaussian(PF_ROVERPOS_STD),i);
-            else     state.SetStatesValue(double(int(state.getStateValue(i)+m_RNG->getUniform(PF_AMB_MIN,PF_AMB_MAX))),i);
+            if (i<3) state.SetStatesValue(state.getStateValue(i)+dpos[i],i);
+            else     state.SetStatesValue(double(int(state.getStateValue(i)+damb[i-3])),i);
         }
     }
-}
\ No newline at end of file
+    bool ARC_MovementModel::isThreadSafe() const
+    {
+        return m_Prepared!=0;
+    }
+}
@@ -217,7 +217,7 @@ static double arc_intpres(gtime_t time, const obsd_t *obs, int n, const nav_t *n
     ttb=timediff(time,obsb[0].time);
     if (fabs(ttb)>opt->maxtdiff*2.0||ttb==tt) return tt;
 
-    arc_satposs(time, obsb, nb, nav, opt->sateph, rs, dts, var, svh);
+    arc_satposs(time, obsb, nb, nav, opt->sateph, NULL, rs, dts, var, svh);
 
     if (!arc_zdres(1,obsb,nb,rs,dts,svh,nav,rtk->rb,opt,1,yb,e,azel)) {
         return tt;
@@ -297,7 +297,7 @@ static int arc_relpos(rtk_t *rtk, const obsd_t *obs, int nu, int nr,
         rtk->ssat[i].snr [0]=0;
     }
     /* compute the satellite position and velecitys */
-    arc_satposs(time, obs, n, nav, opt->sateph, rs, dts, var, svh);
+    arc_satposs(time, obs, n, nav, opt->sateph, NULL, rs, dts, var, svh);
 
     if (!arc_zdres(1,obs+nu,nr,rs+nu*6,dts+nu*2,svh+nu,nav,opt->rb,opt,1,
                   y+nu*nf*2,e+nu*3,azel+nu*2)) {
@@ -332,10 +332,176 @@ static int arc_measure(rtk_t *rtk, const obsd_t *obs, int n, const nav_t *nav,
     arc_relpos(rtk,obs,nu,nr,nav,rr,ddy,nddy,sdy,nsdy);
     return 1;
 }
+/* per-epoch precompute of observation model --------------------------------
+* compute all terms of undifferenced residuals which are independent of particles
+* at the true states rr,and select the double-difference/single-difference pairs
+* args   : rtk_t *rtk       IO  rtk control/result struct
+*          obsd_t *obs      I   observation data
+*          int    n         I   number of observation data
+*          nav_t  *nav      I   navigation data
+*          double *rr       I   rover station position of true states (ecef)
+*          ARC_PFPRE *pre   O   precomputed observation model
+* return : 1:ok,0:error
+*-----------------------------------------------------------------------------*/
+static int arc_pfprepare(rtk_t *rtk, const obsd_t *obs, int n, const nav_t *nav,
+                         const double *rr, ARC_PFPRE *pre)
+{
+    prcopt_t *opt=&rtk->opt;
+    gtime_t time=obs[0].time;
+    double *rs,*dts,*var,*y,*e,*azel,rr_[3],r;
+    int i,j,k,m,f,nu,nr,ns,sat[MAXSAT],iu[MAXSAT],ir[MAXSAT];
+    int svh[MAXOBS*2],nf=1;
+
+    pre->ns=pre->nd=pre->nsd=0;
+
+    if (arc_norm(rr,3)<=0.0) return 0; /* no true states */
+
+    /* count rover/base station observations */
+    for (nu=0;nu   <n&&obs[nu   ].rcv==1;nu++) ;   /* rover */
+    for (nr=0;nu+nr<n&&obs[nu+nr].rcv==2;nr++) ;   /* base */
+
+    rs= arc_mat(6, n); dts= arc_mat(2, n); var= arc_mat(1, n);
+    y= arc_mat(nf * 2, n); e= arc_mat(3, n);
+    azel= arc_zeros(2, n);
+
+    /* initial satellite status informations */
+    for (i=0;i<MAXSAT;i++) {
+        rtk->ssat[i].sys=satsys(i+1,NULL);
+        rtk->ssat[i].vsat[0]=0;
+        rtk->ssat[i].snr [0]=0;
+    }
+    /* compute the satellite position and velecitys */
+    arc_satposs(time, obs, n, nav, opt->sateph, NULL, rs, dts, var, svh);
+
+    if (!arc_zdres(1,obs+nu,nr,rs+nu*6,dts+nu*2,svh+nu,nav,opt->rb,opt,1,
+                   y+nu*nf*2,e+nu*3,azel+nu*2)) {
+        free(rs); free(dts); free(var); free(y); free(e); free(azel);
+        return 0;
+    }
+    if (opt->intpref) {
+        arc_intpres(time,obs+nu,nr,nav,rtk,y+nu*nf*2);
+    }
+    if ((ns=arc_selsat(obs,azel,nu,nr,opt,sat,iu,ir))<=0) {
+        free(rs); free(dts); free(var); free(y); free(e); free(azel);
+        return 0;
+    }
+    /* rover station residuals at true states */
+    arc_zdres(0,obs,nu,rs,dts,svh,nav,rr,opt,0,y,e,azel);
+
+    /* earth tide displacement is same for all particles */
+    for (i=0;i<3;i++) pre->disp[i]=0.0;
+    if (opt->tidecorr) {
+        arc_tidedisp(gpst2utc(obs[0].time),rr,opt->tidecorr,&nav->erp,
+                     opt->odisp[0],pre->disp);
+    }
+    for (i=0;i<3;i++) rr_[i]=rr[i]+pre->disp[i];
+
+    for (k=0;k<ns;k++) {
+        pre->sat[k]=sat[k];
+        pre->sys[k]=rtk->ssat[sat[k]-1].sys;
+        for (i=0;i<3;i++) pre->rs[i+k*3]=rs[i+iu[k]*6];
+        r=arc_geodist(rs+iu[k]*6,rr_,e+iu[k]*3);
+
+        for (f=0;f<nf*2;f++) {
+            /* add back geometric-range,so per-particle residual is yu-r */
+            pre->yu[f+k*2]=y[f+iu[k]*nf*2]==0.0?0.0:y[f+iu[k]*nf*2]+r;
+            pre->yb[f+k*2]=y[f+ir[k]*nf*2];
+        }
+    }
+    pre->ns=ns;
+
+    /* double-difference pairs,same as arc_ddres() */
+    for (m=0;m<4;m++) for (f=0;f<2*nf;f++) {
+
+        /* search reference satellite with highest elevation */
+        for (i=-1,j=0;j<ns;j++) {
+            if (!test_sys(pre->sys[j],m)) continue;
+            if (!validobs(iu[j],ir[j],f,nf,y)) continue;
+            if (i<0||azel[1+iu[j]*2]>=azel[1+iu[i]*2]) i=j;
+        }
+        if (i<0) continue;
+
+        for (j=0;j<ns&&pre->nd<ARC_PF_MAXRES;j++) {
+            if (i==j) continue;
+            if (!test_sys(pre->sys[j],m)) continue;
+            if (!validobs(iu[j],ir[j],f,nf,y)) continue;
+            if (nav->lam[sat[i]-1][f%nf]<=0.0||nav->lam[sat[j]-1][f%nf]<=0.0) continue;
+            pre->di[pre->nd]=i; pre->dj[pre->nd]=j; pre->df[pre->nd++]=f;
+        }
+    }
+    /* single-difference list,same as arc_sdres() */
+    for (m=0;m<4;m++) for (f=0;f<2*nf;f++) {
+        for (j=0;j<ns&&pre->nsd<ARC_PF_MAXRES;j++) {
+            if (!test_sys(pre->sys[j],m)) continue;
+            if (!validobs(iu[j],ir[j],f,nf,y)) continue;
+            if (nav->lam[sat[j]-1][f%nf]<=0.0) continue;
+            pre->sj[pre->nsd]=j; pre->sf[pre->nsd++]=f;
+        }
+    }
+    free(rs); free(dts); free(var);
+    free(y); free(e); free(azel);
+    return 1;
+}
+/* per-particle residuals by precomputed observation model -------------------
+* only the geometric-range of particle and the difference combination are
+* computed,no update of rtk control struct
+* args   : ARC_PFPRE *pre   I   precomputed observation model
+*          prcopt_t *opt    I   processing options
+*          nav_t  *nav      I   navigation data
+*          double *x        I   states of particle
+*          double *ddy      O   double-difference residuals
+*          int    *nddy     O   numbers of double-difference residuals
+*          double *sdy      O   single-difference residuals
+*          int    *nsdy     O   numbers of single-difference residuals
+* return : none
+*-----------------------------------------------------------------------------*/
+static void arc_pfkernel(const ARC_PFPRE *pre, const prcopt_t *opt, const nav_t *nav,
+                         const double *x, double *ddy, int *nddy, double *sdy,
+                         int *nsdy)
+{
+    double rr[3],e[3],yu[MAXSAT*2],lami,lamj;
+    int i,j,k,f,nf=1;
+
+    for (i=0;i<3;i++) rr[i]=x[i]+pre->disp[i];
+
+    /* geometric-range of particle */
+    for (k=0;k<pre->ns;k++) {
+        double r=arc_geodist(pre->rs+k*3,rr,e);
+        for (f=0;f<nf*2;f++) {
+            yu[f+k*2]=pre->yu[f+k*2]==0.0?0.0:pre->yu[f+k*2]-r;
+        }
+    }
+    for (k=0;k<pre->nd;k++) {
+        i=pre->di[k]; j=pre->dj[k]; f=pre->df[k];
+
+        ddy[k]=(yu[f+i*2]-pre->yb[f+i*2])-(yu[f+j*2]-pre->yb[f+j*2]);
+        if (f<nf) {
+            lami=nav->lam[pre->sat[i]-1][f];
+            lamj=nav->lam[pre->sat[j]-1][f];
+            ddy[k]-=lami*x[IB(pre->sat[i],f,opt)]-lamj*x[IB(pre->sat[j],f,opt)];
+        }
+    }
+    for (k=0;k<pre->nsd;k++) {
+        j=pre->sj[k]; f=pre->sf[k];
+
+        sdy[k]=yu[f+j*2]-pre->yb[f+j*2];
+        if (f<nf) {
+            sdy[k]-=nav->lam[pre->sat[j]-1][f]*x[IB(pre->sat[j],f,opt)];
+        }
+    }
+    *nddy=pre->nd; *nsdy=pre->nsd;
+}
 ///////////////////////////////////////////////////////////////////////////////
 namespace ARC {
     ARC_ObservationModel::ARC_ObservationModel() :
             libPF::ObservationModel<ARC_States>() {
+        m_OPT=NULL;
+        m_RTK=NULL;
+        m_OBS=NULL;
+        m_NAV=NULL;
+        m_NObs=0;
+        USE_SD_OR_DD=1;
+        m_PreValid=0;
     }
 
     ARC_ObservationModel::ARC_ObservationModel(const ARC_OPT *OPT,
@@ -350,33 +516,47 @@ namespace ARC {
         m_NAV=NAV;
         m_NObs=NObs;
         USE_SD_OR_DD=1;
+        m_PreValid=0;
     }
     ARC_ObservationModel::~ARC_ObservationModel() {
     }
+    int ARC_ObservationModel::PrepareEpoch() {
+
+        double rr[3];
+
+        ARC_ASSERT_TRUE(Exception,m_RTK!=NULL,"Observation Model has no SRTK");
+
+        for (int i=0;i<3;i++) rr[i]=m_TrueArcState.getStateValue(i);
+        m_PreValid=arc_pfprepare(m_RTK,m_OBS,m_NObs,m_NAV,rr,&m_Pre);
+        return m_PreValid;
+    }
     double ARC_ObservationModel::measure(const ARC_States &state) const {
 
-        int NDDY,NSDY;
-        static double DDY[MAXSAT];
-        static double SDY[MAXSAT];
+        int NDDY=0,NSDY=0;
+        double DDY[ARC_PF_MAXRES];
+        double SDY[ARC_PF_MAXRES];
         static double Xp[MAXPFSTETAS];
         double sum=0.0;
 
         ARC_ASSERT_TRUE(Exception,m_RTK->nx > 0,"Particle Filter States is Zero");
 
-        for (int i=0;i<m_RTK->nx;i++) Xp[i]=state.getStateValue(i);
-        for (int i=0;i<m_RTK->nx;i++) {
-            m_RTK->x[i]=state.getStateValue(i);
+        if (m_PreValid) {
+            /* per-particle kernel of precomputed observation model */
+            arc_pfkernel(&m_Pre,&m_RTK->opt,m_NAV,state.getStatesVal(),
+                         DDY,&NDDY,SDY,&NSDY);
+        }
+        else {
+            for (int i=0;i<m_RTK->nx;i++) Xp[i]=state.getStateValue(i);
+            for (int i=0;i<m_RTK->nx;i++) {
+                m_RTK->x[i]=state.getStateValue(i);
+            }
+            arc_measure(m_RTK,m_OBS,m_NObs,m_NAV,Xp,DDY,&NDDY,SDY,&NSDY);
         }
-        arc_measure(m_RTK,m_OBS,m_NObs,m_NAV,Xp,DDY,&NDDY,SDY,&NSDY);
-
         if (USE_SD_OR_DD==1) {
             for (int i=0; i<NDDY;i++) sum+=SQR(DDY[i]);
             return 1.0/SQRT(sum/double(NDDY));
         }
-        else if (USE_SD_OR_DD==0) {
-            for (int i=0; i<NSDY;i++) sum+=SQR(SDY[i]);
-            return 1.0/SQRT(sum/double(NDDY));
-        }
+        for (int i=0; i<NSDY;i++) sum+=SQR(SDY[i]);
+        return 1.0/SQRT(sum/double(NSDY));
     }
 }
-
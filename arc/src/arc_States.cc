@@ -27,13 +27,22 @@
 
 /// \brief ARC Main namespace of this package.
 namespace ARC {
-    /// The default constructor.
+    /// The default constructor,all states are active.
     ARC_States::ARC_States()  {
-
+        m_N=MAXPFSTETAS;
+        for (int i=0;i<m_N;i++) X[i]=0.0;
     }
     ARC_States::ARC_States(const ARC_OPT *OPT) {
+        m_N=OPT?MIN(NX(OPT),MAXPFSTETAS):MAXPFSTETAS;
+        for (int i=0;i<m_N;i++) X[i]=0.0;
     }
     ARC_States::ARC_States(int Num) {
+        m_N=Num<=0?MAXPFSTETAS:MIN(Num,MAXPFSTETAS);
+        for (int i=0;i<m_N;i++) X[i]=0.0;
+    }
+    ARC_States::ARC_States(const ARC_States &other) {
+        m_N=other.m_N;
+        for (int i=0;i<m_N;i++) X[i]=other.X[i];
     }
     ARC_States::~ARC_States() {
     }
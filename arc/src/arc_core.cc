@@ -39,6 +39,11 @@ using namespace std;
 #define MAXINFILE   1000        /* max number of input files */
 #define USEPNTINI   1           /* using the standard position to inital solution*/
 #define USERTKLIB   0           /* using rtk position function of RTKLIB */
+#define NEQWARMUP   5           /* warm-up epochs of static normal equation chunk */
+#define NEQMAXTHRD  64          /* max threads of static normal equation */
+#define PIPESLOT    8           /* epoch slots of processing pipeline */
+#define PIPEREC     64          /* solution records of pipeline output queue */
+#define PIPESPIN    1000        /* yields before sleep of waiting pipeline stage */
 
 static pcvs_t pcvss={0};        /* receiver antenna parameters */
 static pcvs_t pcvsr={0};        /* satellite antenna parameters */
@@ -60,6 +65,8 @@ static int isolf=0;             /* current forward solutions index */
 static int isolb=0;             /* current backward solutions index */
 static char proc_rov [64]="";   /* rover for current processing */
 static char proc_base[64]="";   /* base station for current processing */
+static solw_t *solw=NULL;       /* binary solution writer */
+static fls_t *fls=NULL;         /* fixed-lag smoother */
 typedef libPF::ParticleFilter<ARC::ARC_States> ParticleFilterType;
 /* particle filter type */
 
@@ -245,6 +252,9 @@ static void arc_procpos_pf(const prcopt_t *popt, const solopt_t *sopt,
     MoveModel.SetSRTK(&rtk);
     /* set the particle filter resample */
     PF.setResamplingMode(libPF::RESAMPLE_ALWAYS);
+    /* particle filter threads with reproducible random number streams */
+    PF.setNumThreads(popt->pf_nthread>1?popt->pf_nthread:1);
+    PF.setSeed(ARC_PF_SEED);
 
     while ((nobs=arc_inputobs(obs,rtk.sol.stat,popt,&nu,&nr))>=0) {
         /*abort */
@@ -288,6 +298,8 @@ static void arc_procpos_pf(const prcopt_t *popt, const solopt_t *sopt,
                 MoveModel.SetComSatList(rsat,usat,sat,ns);
                 /* set gps and bds observation of states movement */
                 MoveModel.SetObs(obs,nu+nr);
+                /* per-epoch update of cycle slips for states movement */
+                MoveModel.PrepareEpoch();
                 /* states movement model for predicting the states */
                 MoveModel.drift(States,rtk.tt);
                 /* set the observations of gps and bds */
@@ -298,6 +310,8 @@ static void arc_procpos_pf(const prcopt_t *popt, const solopt_t *sopt,
             }
             /* set the states of observation model */
             ObsModel.setStates(States);
+            /* per-epoch precompute of observation model */
+            ObsModel.PrepareEpoch();
 
             /* particle filter */
             PF.filter();
@@ -316,114 +330,552 @@ static void arc_procpos_pf(const prcopt_t *popt, const solopt_t *sopt,
     arc_rtkfree(&rtk);
 }
 #endif
+/* output solution to binary solution writer or file ------------------------*/
+static void arc_outsol(FILE *fp, const sol_t *sol, const double *rb,
+                       const solopt_t *sopt)
+{
+    if (solw) solw_push(solw,sol,rb);
+    else outsol(fp,sol,rb,sopt);
+}
+/* processing pipeline -------------------------------------------------------*/
+typedef struct {                /* epoch slot of processing pipeline */
+    obsd_t obs[MAXOBS*2];       /* observation data (rover+base) */
+    int n;                      /* number of observation data */
+    epctx_t ctx;                /* precomputed epoch context */
+} pipeslot_t;
+
+typedef struct {                /* solution record of output queue */
+    sol_t sol;                  /* solution */
+    double rb[3];               /* base station position (ecef) (m) */
+} piperec_t;
+
+typedef struct {                /* processing pipeline type */
+    const prcopt_t *popt;       /* processing options */
+    pipeslot_t *slot;           /* epoch slots {PIPESLOT} */
+    piperec_t *rec;             /* output queue {PIPEREC} */
+    unsigned int n1,n2,n3;      /* epochs of stage 1 (aligned), 2 (precomputed), 3 (processed) */
+    unsigned int nw,nr;         /* records written by stage 3, read by stage 4 */
+    int end[3];                 /* end of stage 1,2,3 */
+    int solq;                   /* solution quality of last epoch */
+} pipe_t;
+
+typedef struct {                /* solution output of process positioning */
+    FILE *fp;                   /* output file pointer */
+    const prcopt_t *popt;       /* processing options */
+    const solopt_t *sopt;       /* solution options */
+    int mode;                   /* mode (0:forward/backward,1:combined,2:smoother) */
+    int solstatic;              /* output single static solution */
+    int c;                      /* epochs since last progress report */
+    gtime_t time;               /* time of last solution */
+    sol_t sol;                  /* static solution */
+    double rb[3];               /* base station position of static solution */
+    pipe_t *pipe;               /* pipeline (NULL:serial processing) */
+    prof_t *prof;               /* profiler of solution output (NULL:off) */
+} procout_t;
+
+/* wait for pipeline stage ---------------------------------------------------*/
+static void arc_pipe_wait(int *k)
+{
+#ifndef WIN32
+    if ((*k)++<PIPESPIN) {sched_yield(); return;}
+#endif
+    sleepms(1);
+}
+/* input observation data of epoch (stage 1) -----------------------------------
+* input observation data, exclude satellites and correct carrier-phase bias
+* return : number of observation data (-1:end,0:no observation data)
+*-----------------------------------------------------------------------------*/
+static int arc_procin(obsd_t *obs, int solq, const prcopt_t *popt)
+{
+    char prn[8]={0};
+    int i,n,nobs,nu=0,nr=0;
+
+    if ((nobs=arc_inputobs(obs,solq,popt,&nu,&nr))<0||aborts) return -1;
+
+    /* exclude satellites */
+    for (i=n=0;i<nobs;i++) {
+        if ((satsys(obs[i].sat,NULL)&popt->navsys)&&
+            popt->exsats[obs[i].sat-1]!=1) obs[n++]=obs[i];
+        if (satsys(obs[i].sat,NULL)==SYS_CMP
+            &&popt->exsats[obs[i].sat-1]==1) {  /* just for debug */
+            satno2id(obs[i].sat,prn);
+            arc_log(ARC_WARNING,"arc_procpos : "
+                    "excluded bds geo satellite %s,sat no is %d",prn,obs[i].sat);
+        }
+    }
+    if (n<=0) return 0; /* no observations */
+
+    /* carrier-phase bias correction */
+    if (navs.nf>0) {
+        arc_corr_phase_bias_fcb(obs,n,&navs);
+    }
+    return n;
+}
+/* output solution of epoch (stage 4) ----------------------------------------*/
+static void arc_procout(procout_t *out, const sol_t *sol, const double *rb)
+{
+    static const int count=20;
+    static const int pri[]={0,1,2,3,4,5,1,6};
+    gtime_t time=sol->time;
+    double dt,pgBar;
+    int i;
+    char str[128]="",time_str_[126]="",stats[16]="";
+
+    /* calculate the time that has elapsed */
+    if (time.time) {
+        dt=fabs(timediff(time,out->popt->ts));
+        pgBar=dt/fabs(timediff(out->popt->te,out->popt->ts))*(85.0)+15.0;
+        if (out->c++>=count) {
+            strcpy(time_str_,time_str(time,2));
+            strcpy(stats,sol->stat==SOLQ_FIX?": FIX":
+                         sol->stat==SOLQ_FLOAT?": FLOAT":
+                         sol->stat==SOLQ_DGPS?": DGPS":
+                         sol->stat==SOLQ_SINGLE?": SINGLE":
+                         sol->stat==SOLQ_DR?": DR":
+                         sol->stat==SOLQ_HALFFIX?": HALFFIX":
+                         sol->stat==SOLQ_INHERITFIX?": INHERIXFIX":": NONE");
+            sprintf(str,"%s%s",time_str_,stats);
+            arc_info(int(pgBar),3,str);
+            out->c=0; /* reset log-informations counts */
+        }
+    }
+    if (out->mode==2) { /* fixed-lag smoother */
+        arc_outsol(out->fp,sol,rb,out->sopt);
+    }
+    else if (out->mode==0) { /* forward/backward */
+        out->time=time;
+        if (!out->solstatic) {
+            arc_outsol(out->fp,sol,rb,out->sopt);
+        }
+        else if (time.time==0||pri[sol->stat]<=pri[out->sol.stat]) {
+            out->sol=*sol;
+            for (i=0;i<3;i++) out->rb[i]=rb[i];
+        }
+    }
+    else if (!revs) { /* combined-forward */
+        if (isolf>=nepoch) return;
+        solf[isolf]=*sol;
+        for (i=0;i<3;i++) rbf[i+isolf*3]=rb[i];
+        isolf++;
+    }
+    else { /* combined-backward */
+        if (isolb>=nepoch) return;
+        solb[isolb]=*sol;
+        for (i=0;i<3;i++) rbb[i+isolb*3]=rb[i];
+        isolb++;
+    }
+}
+/* output solution of epoch with output time to profiler --------------------*/
+static void arc_procout_prof(procout_t *out, const sol_t *sol, const double *rb)
+{
+    double tick;
+
+    if (!out->prof) {
+        arc_procout(out,sol,rb);
+        return;
+    }
+    tick=arc_prof_tic();
+    arc_procout(out,sol,rb);
+    arc_prof_add(out->prof,PROF_OUTSOL,arc_prof_tic()-tick);
+}
+/* end of solution output ----------------------------------------------------*/
+static void arc_procout_end(procout_t *out)
+{
+    if (out->mode==0&&out->solstatic&&out->time.time!=0.0) {
+        out->sol.time=out->time;
+        arc_outsol(out->fp,&out->sol,out->rb,out->sopt);
+    }
+}
+/* put solution to output stage ----------------------------------------------*/
+static void arc_procout_put(procout_t *out, const sol_t *sol, const double *rb)
+{
+    pipe_t *p=out->pipe;
+    piperec_t *rec;
+    int i,k=0;
+
+    if (!p) {
+        arc_procout_prof(out,sol,rb);
+        return;
+    }
+    while (p->nw-atomic_get(&p->nr)>=PIPEREC) {
+        arc_pipe_wait(&k); /* output queue full */
+    }
+    rec=p->rec+p->nw%PIPEREC;
+    rec->sol=*sol;
+    rec->sol.bias.amb=NULL; rec->sol.bias.nb=rec->sol.bias.nmax=0;
+    for (i=0;i<3;i++) rec->rb[i]=rb[i];
+    atomic_set(&p->nw,p->nw+1);
+}
+/* process epoch by filter and ambiguity resolution (stage 3) ----------------*/
+static void arc_procrtk(rtk_t *rtk, const obsd_t *obs, int n, fls_t *fls,
+                        procout_t *out)
+{
+    sol_t sol={{0}};
+    double rb[3];
+
+#if USERTKLIB
+    if (!arc_srtkpos2(rtk,obs,n,&navs)) return;
+#else
+    arc_srtkpos(rtk,obs,n,&navs);
+#endif
+
+    if (out->mode==2) { /* fixed-lag smoother */
+        arc_fls_add(fls,rtk);
+        while (arc_fls_get(fls,&sol,rb,0)) arc_procout_put(out,&sol,rb);
+    }
+    else arc_procout_put(out,&rtk->sol,rtk->rb);
+}
+#ifndef WIN32
+/* stage 1 thread: decode and align epochs -----------------------------------*/
+static void *arc_pipe_in(void *arg)
+{
+    pipe_t *p=(pipe_t *)arg;
+    pipeslot_t *s;
+    int k=0,n;
+
+    while (1) {
+        if (p->n1-atomic_get(&p->n3)>=PIPESLOT) {
+            arc_pipe_wait(&k); /* no free slot */
+            continue;
+        }
+        s=p->slot+p->n1%PIPESLOT;
+        if ((n=arc_procin(s->obs,atomic_get(&p->solq),
+                          p->popt))<0) break;
+        if (n==0) continue;
+        s->n=n; k=0;
+        atomic_set(&p->n1,p->n1+1);
+    }
+    atomic_set(&p->end[0],1);
+    return NULL;
+}
+/* stage 2 thread: satellite orbits/clocks and base station terms ------------*/
+static void *arc_pipe_sat(void *arg)
+{
+    pipe_t *p=(pipe_t *)arg;
+    pipeslot_t *s;
+    geoctx_t geo={{0}};
+    ephc_t ephc;
+    int k=0,end;
+
+    /* own ephemeris evaluation state (stage 3 uses the one of rtk) */
+    arc_ephc_init(&ephc,p->popt->glodense);
+    arc_ephc_bind(&ephc);
+
+    while (1) {
+        end=atomic_get(&p->end[0]);
+        if (p->n2==atomic_get(&p->n1)) {
+            if (end) break;
+            arc_pipe_wait(&k);
+            continue;
+        }
+        s=p->slot+p->n2%PIPESLOT;
+        arc_epctx_init(&s->ctx,&geo,s->obs,s->n,&navs,p->popt);
+        k=0;
+        atomic_set(&p->n2,p->n2+1);
+    }
+    arc_ephc_bind(NULL);
+    arc_ephc_free(&ephc);
+    atomic_set(&p->end[1],1);
+    return NULL;
+}
+/* stage 4 thread: output solutions ------------------------------------------*/
+static void *arc_pipe_out(void *arg)
+{
+    procout_t *out=(procout_t *)arg;
+    pipe_t *p=out->pipe;
+    piperec_t *rec;
+    int k=0,end;
+
+    while (1) {
+        end=atomic_get(&p->end[2]);
+        if (p->nr==atomic_get(&p->nw)) {
+            if (end) break;
+            arc_pipe_wait(&k);
+            continue;
+        }
+        rec=p->rec+p->nr%PIPEREC;
+        arc_procout_prof(out,&rec->sol,rec->rb);
+        k=0;
+        atomic_set(&p->nr,p->nr+1);
+    }
+    arc_procout_end(out);
+    return NULL;
+}
+/* pipelined process positioning -----------------------------------------------
+* epochs are processed in 4 stages connected by bounded lock-free single-
+* producer single-consumer queues: (1) input and alignment of rover/base
+* epochs, (2) satellite orbits/clocks and station terms of base station,
+* (3) filter and ambiguity resolution and (4) solution output. stage 3 runs
+* in the calling thread, the others in own threads. stage 2 of next epochs
+* overlaps stage 3 of current epoch. stages 2 and 3 share navs read-only, each
+* with own ephemeris evaluation state (see arc_ephc_bind())
+* return : status (1:ok,0:error)
+*-----------------------------------------------------------------------------*/
+static int arc_procpos_pipe(rtk_t *rtk, fls_t *fls, procout_t *out)
+{
+    pipe_t p={0};
+    pthread_t thread[3];
+    pipeslot_t *s;
+    int i,k=0,run[3]={0},end;
+
+    p.popt=out->popt;
+    p.slot=(pipeslot_t *)malloc(sizeof(pipeslot_t)*PIPESLOT);
+    p.rec=(piperec_t *)malloc(sizeof(piperec_t)*PIPEREC);
+    if (!p.slot||!p.rec) {
+        free(p.slot); free(p.rec);
+        return 0;
+    }
+    out->pipe=&p;
+
+    /* input stage is started last to fall back to serial processing */
+    run[2]=!pthread_create(thread+2,NULL,arc_pipe_out,out);
+    run[1]=run[2]&&!pthread_create(thread+1,NULL,arc_pipe_sat,&p);
+    run[0]=run[1]&&!pthread_create(thread  ,NULL,arc_pipe_in ,&p);
+
+    if (!run[0]) { /* thread creation failed */
+        atomic_set(&p.end[0],1);
+        atomic_set(&p.end[2],1);
+        for (i=1;i<3;i++) if (run[i]) pthread_join(thread[i],NULL);
+        out->pipe=NULL;
+        free(p.slot); free(p.rec);
+        return 0;
+    }
+    while (1) {
+        end=atomic_get(&p.end[1]);
+        if (p.n3==atomic_get(&p.n2)) {
+            if (end) break;
+            arc_pipe_wait(&k);
+            continue;
+        }
+        s=p.slot+p.n3%PIPESLOT;
+        rtk->epc=&s->ctx;
+        arc_procrtk(rtk,s->obs,s->n,fls,out);
+        rtk->epc=NULL;
+        k=0;
+        atomic_set(&p.solq,(int)rtk->sol.stat);
+        atomic_set(&p.n3,p.n3+1);
+    }
+    if (out->mode==2) {
+        sol_t sol={{0}};
+        double rb[3];
+        while (arc_fls_get(fls,&sol,rb,1)) arc_procout_put(out,&sol,rb);
+    }
+    atomic_set(&p.end[2],1);
+
+    for (i=0;i<3;i++) pthread_join(thread[i],NULL);
+    out->pipe=NULL;
+    free(p.slot); free(p.rec);
+    return 1;
+}
+#else
+static int arc_procpos_pipe(rtk_t *rtk, fls_t *fls, procout_t *out)
+{
+    return 0;
+}
+#endif
 /* process positioning -------------------------------------------------------*/
 FILE *fp=fopen("/home/sujinglan/arc_rtk/arc_test/result/gps-pos","w");
 static void arc_procpos(FILE* fp,const prcopt_t *popt, const solopt_t *sopt,
                         int mode)
 {
-    static const int count=20;
-    gtime_t time={0};
+    procout_t out={0};
     sol_t sol={{0}};
     rtk_t rtk;
     obsd_t obs[MAXOBS*2]; /* for rover and base */
-    double rb[3]={0},dt,pgBar,pos[3];
-    int i,nobs,n,pri[]={0,1,2,3,4,5,1,6},nu=0,nr=0,c=0,solstatic;
-    char prn[8]={0},str[128]="",time_str_[126]="",stats[16]="";
+    double rb[3];
+    int n;
 
     arc_log(ARC_INFO,"arc_procpos : mode=%d\n",mode);
     arc_info(15,4,"relative position start");
 
-    solstatic=sopt->solstatic&&(popt->mode==PMODE_STATIC);
+    out.fp=fp; out.popt=popt; out.sopt=sopt; out.mode=mode;
+    out.solstatic=sopt->solstatic&&(popt->mode==PMODE_STATIC);
 
 #if USERTKLIB
     rtkinit(&rtk,popt);
 #else
     arc_rtkinit(&rtk,popt);
 #endif
+    out.prof=rtk.prof;
+    rtk.fls=mode==2?fls:NULL; /* time update hooks of fixed-lag smoother */
 
-    while ((nobs=arc_inputobs(obs,rtk.sol.stat,popt,&nu,&nr))>=0) {
-        /*abort */
-        if (aborts) break;
+    if (!popt->pipeline||!arc_procpos_pipe(&rtk,fls,&out)) {
 
-        /* exclude satellites */
-        for (i=n=0;i<nobs;i++) {
-            if ((satsys(obs[i].sat,NULL)&popt->navsys)&&
-                popt->exsats[obs[i].sat-1]!=1) obs[n++]=obs[i];
-            if (satsys(obs[i].sat,NULL)==SYS_CMP
-                &&popt->exsats[obs[i].sat-1]==1) {  /* just for debug */
-                satno2id(obs[i].sat,prn);
-                arc_log(ARC_WARNING,"arc_procpos : "
-                        "excluded bds geo satellite %s,sat no is %d",prn,obs[i].sat);
-            }
+        /* serial processing of epochs */
+        while ((n=arc_procin(obs,rtk.sol.stat,popt))>=0) {
+            if (n>0) arc_procrtk(&rtk,obs,n,fls,&out);
         }
-        if (n<=0) continue; /* no observations */
-
-        /* carrier-phase bias correction */
-        if (navs.nf>0) {
-            arc_corr_phase_bias_fcb(obs,n,&navs);
+        if (mode==2) {
+            while (arc_fls_get(fls,&sol,rb,1)) arc_procout_prof(&out,&sol,rb);
         }
-
+        arc_procout_end(&out);
+    }
 #if USERTKLIB
-        if (!arc_srtkpos2(&rtk,obs,n,&navs)) continue;
+    rtkfree(&rtk);
 #else
-        arc_srtkpos(&rtk,obs,n,&navs);
+    arc_rtkfree(&rtk);
 #endif
+    arc_info(100,4,"relative position is end,now ploting results...");
+}
+/* static normal equation of time chunks -------------------------------------*/
+typedef struct {
+    obsd_t *obs;                /* observation data of epoch (rover+base) */
+    int n;                      /* number of observation data */
+} neqep_t;
+
+typedef struct {
+    const prcopt_t *popt;       /* processing options */
+    const neqep_t *ep;          /* epochs */
+    const int *ic;              /* first epoch index of chunks (nc+1) */
+    int nc,w,nw;                /* number of chunks, worker index, number of workers */
+    const double *x0;           /* linearization point of rover position */
+    neq_t **neq;                /* normal equation of chunks (nc) */
+    int *ns;                    /* valid satellites of last epoch of chunks (nc) */
+} neqjob_t;
+
+static void arc_procneq_chunks(const neqjob_t *job)
+{
+    prcopt_t opt=*job->popt;
+    rtk_t rtk;
+    int c,k;
 
-        /* previous epoch */
-        time=rtk.sol.time;
+    opt.outsingle=0; /* no epoch solution */
 
-        /* calculate the time that has elapsed */
-        if (time.time) {
-            dt=fabs(timediff(time,popt->ts));
-            pgBar=dt/fabs(timediff(popt->te,popt->ts))*(85.0)+15.0;
-            if (c++>=count) {
-                strcpy(time_str_,time_str(time,2));
-                strcpy(stats,rtk.sol.stat==SOLQ_FIX?": FIX":
-                             rtk.sol.stat==SOLQ_FLOAT?": FLOAT":
-                             rtk.sol.stat==SOLQ_DGPS?": DGPS":
-                             rtk.sol.stat==SOLQ_SINGLE?": SINGLE":
-                             rtk.sol.stat==SOLQ_DR?": DR":
-                             rtk.sol.stat==SOLQ_HALFFIX?": HALFFIX":
-                             rtk.sol.stat==SOLQ_INHERITFIX?": INHERIXFIX":": NONE");
-                sprintf(str,"%s%s",time_str_,stats);
-                arc_info(int(pgBar),3,str);
-                c=0; /* reset log-informations counts */
-            }
+    for (c=job->w;c<job->nc;c+=job->nw) {
+        arc_rtkinit(&rtk,&opt);
+        if (!(rtk.neq=arc_neq_new(rtk.nx,rtk.na,job->x0))) {
+            arc_rtkfree(&rtk);
+            continue;
         }
-        if (mode==0) { /* forward/backward */
-            if (!solstatic) {
-                outsol(fp,&rtk.sol,rtk.rb,sopt);
-            }
-            else if (time.time==0||pri[rtk.sol.stat]<=pri[sol.stat]) {
-                sol=rtk.sol;
-                for (i=0;i<3;i++) rb[i]=rtk.rb[i];
-                if (time.time==0||timediff(rtk.sol.time,time)<0.0) {
-                    time=rtk.sol.time;
-                }
-            }
+        k=c>0?job->ic[c]-NEQWARMUP:job->ic[c];
+        for (k=k<0?0:k;k<job->ic[c+1];k++) {
+            rtk.neq->warm=k<job->ic[c]; /* previous chunk epochs */
+            arc_srtkpos(&rtk,job->ep[k].obs,job->ep[k].n,&navs);
         }
-        else if (!revs) { /* combined-forward */
-            if (isolf>=nepoch) return;
-            solf[isolf]=rtk.sol;
-            for (i=0;i<3;i++) rbf[i+isolf*3]=rtk.rb[i];
-            isolf++;
+        rtk.neq->warm=0;
+        job->neq[c]=rtk.neq; job->ns[c]=rtk.sol.ns;
+        rtk.neq=NULL;
+        arc_rtkfree(&rtk);
+    }
+}
+#ifndef WIN32
+static void *arc_procneq_thread(void *arg)
+{
+    arc_procneq_chunks((neqjob_t *)arg);
+    return NULL;
+}
+#endif
+/* process positioning by static normal equation ------------------------------
+* all epochs are read first and split into time chunks of the solution
+* interval (one chunk per thread if no interval). chunks are accumulated in
+* parallel and merged in time order, a solution is output for each chunk.
+* workers share navs read-only, each rtk_t keeps its own ephemeris state.
+*-----------------------------------------------------------------------------*/
+static void arc_procpos_neq(FILE *fp, const prcopt_t *popt, const solopt_t *sopt)
+{
+    neqjob_t job[NEQMAXTHRD];
+    neqep_t *ep=NULL,*p;
+    neq_t **neq,*sum=NULL;
+    sol_t sol={{0}};
+    obsd_t obs[MAXOBS*2];
+    double x0[3]={0};
+    int i,n,k,c,nobs,nu,nr,nep=0,nmax=0,nc,nw,*ic,*ns;
+    char msg[128]="";
+#ifndef WIN32
+    pthread_t thread[NEQMAXTHRD];
+    int run[NEQMAXTHRD]={0};
+#endif
+
+    arc_log(ARC_INFO,"arc_procpos_neq :\n");
+    arc_info(15,4,"static normal equation start");
+
+    /* input all epochs */
+    while ((nobs=arc_inputobs(obs,SOLQ_NONE,popt,&nu,&nr))>=0) {
+        if (aborts) break;
+
+        for (i=n=0;i<nobs;i++) {
+            if ((satsys(obs[i].sat,NULL)&popt->navsys)&&
+                popt->exsats[obs[i].sat-1]!=1) obs[n++]=obs[i];
         }
-        else { /* combined-backward */
-            if (isolb>=nepoch) return;
-            solb[isolb]=rtk.sol;
-            for (i=0;i<3;i++) rbb[i+isolb*3]=rtk.rb[i];
-            isolb++;
+        if (n<=0) continue;
+
+        if (navs.nf>0) arc_corr_phase_bias_fcb(obs,n,&navs);
+
+        if (nep>=nmax) {
+            nmax=nmax<=0?1024:nmax*2;
+            if (!(p=(neqep_t *)realloc(ep,sizeof(neqep_t)*nmax))) break;
+            ep=p;
         }
+        if (!(ep[nep].obs=(obsd_t *)malloc(sizeof(obsd_t)*n))) break;
+        memcpy(ep[nep].obs,obs,sizeof(obsd_t)*n);
+        ep[nep++].n=n;
     }
-    if (mode==0&&solstatic&&time.time!=0.0) {
-        sol.time=time;
-        outsol(fp,&sol,rb,sopt);
+    /* linearization point of rover position by single point positioning */
+    for (k=0;k<nep&&!aborts;k++) {
+        for (nu=0;nu<ep[k].n&&ep[k].obs[nu].rcv==1;nu++) ;
+        if (arc_pntpos(ep[k].obs,nu,&navs,popt,&sol,NULL,NULL,msg)) {
+            for (i=0;i<3;i++) x0[i]=sol.rr[i];
+            break;
+        }
     }
-#if USERTKLIB
-    rtkfree(&rtk);
+    if (k<nep&&!aborts) {
+        /* time chunks */
+        nw=popt->neq_nthread<1?1:(popt->neq_nthread>NEQMAXTHRD?NEQMAXTHRD:popt->neq_nthread);
+#ifdef WIN32
+        nw=1;
+#endif
+        ic=arc_imat(nep+1,1);
+        if (popt->neq_ckpt>0.0) {
+            for (i=nc=0;i<nep;i++) {
+                if (i==0||floor(timediff(ep[i].obs[0].time,ep[0].obs[0].time)/popt->neq_ckpt)!=
+                          floor(timediff(ep[i-1].obs[0].time,ep[0].obs[0].time)/popt->neq_ckpt)) {
+                    ic[nc++]=i;
+                }
+            }
+        }
+        else for (nc=0;nc<nw&&nc<nep;nc++) ic[nc]=nep*nc/(nw<nep?nw:nep);
+        ic[nc]=nep;
+        if (nw>nc) nw=nc;
+
+        neq=(neq_t **)calloc(nc,sizeof(neq_t *)); ns=arc_imat(nc,1);
+        for (i=0;i<nw;i++) {
+            job[i].popt=popt; job[i].ep=ep; job[i].ic=ic; job[i].nc=nc;
+            job[i].w=i; job[i].nw=nw; job[i].x0=x0; job[i].neq=neq; job[i].ns=ns;
+        }
+#ifndef WIN32
+        for (i=1;i<nw;i++) run[i]=!pthread_create(thread+i,NULL,arc_procneq_thread,job+i);
+        arc_procneq_chunks(job);
+        for (i=1;i<nw;i++) {
+            if (run[i]) pthread_join(thread[i],NULL);
+            else arc_procneq_chunks(job+i); /* thread creation failed */
+        }
 #else
-    arc_rtkfree(&rtk);
+        arc_procneq_chunks(job);
 #endif
+        /* merge chunks in time order and solve */
+        for (c=0;c<nc;c++) {
+            if (!neq[c]) continue;
+            if (!sum) {sum=neq[c]; neq[c]=NULL;}
+            else if (arc_neq_merge(sum,neq[c])) {
+                arc_log(ARC_WARNING,"arc_procpos_neq : merge error chunk=%d\n",c);
+                continue;
+            }
+            if (popt->neq_ckpt<=0.0&&c<nc-1) continue;
+
+            if (arc_neq_solve(sum,popt,&sol)!=SOLQ_NONE) {
+                sol.ns=(unsigned char)ns[c];
+                arc_outsol(fp,&sol,popt->rb,sopt);
+            }
+            arc_info((int)(15.0+85.0*(c+1)/nc),3,time_str(sol.time,0));
+        }
+        for (c=0;c<nc;c++) arc_neq_free(neq[c]);
+        arc_neq_free(sum);
+        free(neq); free(ns); free(ic);
+    }
+    else arc_log(ARC_WARNING,"arc_procpos_neq : no rover position\n");
+
+    for (k=0;k<nep;k++) free(ep[k].obs);
+    free(ep);
     arc_info(100,4,"relative position is end,now ploting results...");
 }
 /* validation of combined solutions ------------------------------------------*/
@@ -521,7 +973,7 @@ static void arc_combres(FILE *fp,const prcopt_t *popt, const solopt_t *sopt)
             sols.qr[5]=(float)Qs[2];
         }
         if (!solstatic) {
-            outsol(fp,&sols,rbs,sopt);
+            arc_outsol(fp,&sols,rbs,sopt);
         }
         else if (time.time==0||pri[sols.stat]<=pri[sol.stat]) {
             sol=sols;
@@ -533,7 +985,7 @@ static void arc_combres(FILE *fp,const prcopt_t *popt, const solopt_t *sopt)
     }
     if (solstatic&&time.time!=0.0) {
         sol.time=time;
-        outsol(fp,&sol,rb,sopt);
+        arc_outsol(fp,&sol,rb,sopt);
     }
 }
 /* read prec ephemeris, sbas data, lex data, tec grid and open rtcm ----------*/
@@ -560,6 +1012,9 @@ static void arc_readpreceph(char **infile, int n, const prcopt_t *prcopt,
         if (strstr(infile[i],"%r")||strstr(infile[i],"%b")) continue;
         arc_readrnxc(infile[i],nav);
     }
+    /* precise ephemeris coefficients */
+    if (nav->ne>0) arc_pephc_init(nav);
+
     /* read satellite fcb files */
     for (i=0;i<n;i++) {
         if (strstr(infile[i],"%r")||strstr(infile[i],"%b")) continue;
@@ -583,6 +1038,7 @@ static void arc_freepreceph(nav_t *nav)
 
     arc_log(ARC_INFO, "arc_freepreceph:\n");
 
+    arc_pephc_free(nav);
     free(nav->peph); nav->peph=NULL; nav->ne=nav->nemax=0;
     free(nav->pclk); nav->pclk=NULL; nav->nc=nav->ncmax=0;
     free(nav->fcb ); nav->fcb =NULL; nav->nf=nav->nfmax=0;
@@ -651,39 +1107,32 @@ static void arc_freeobsnav(obs_t *obs, nav_t *nav)
     free(nav->geph); nav->geph=NULL; nav->ng=nav->ngmax=0;
     free(nav->seph); nav->seph=NULL; nav->ns=nav->nsmax=0;
 }
-/* average of single position ------------------------------------------------*/
+/* average of single position ------------------------------------------------
+* 1 hz epochs of receiver are positioned by batch single point positioning
+*-----------------------------------------------------------------------------*/
 static int arc_avepos(double *ra, int rcv, const obs_t *obs, const nav_t *nav,
                       const prcopt_t *opt)
 {
-    obsd_t data[MAXOBS]={0};
     gtime_t ts={0};
-    sol_t sol={{0}};
-    int i,j,n=0,m,iobs;
-    char msg[4096]="";
+    int i,n=0,m,iobs,*is,*ns;
 
     arc_log(ARC_INFO,"arc_avepos: rcv=%d obs.n=%d\n",rcv,obs->n);
 
     for (i=0;i<3;i++) ra[i]=0.0;
 
-    for (iobs=0;(m=arc_nextobsf(obs,&iobs,rcv))>0;iobs+=m) {
-
-        for (i=j=0;i<m&&i<MAXOBS;i++) {
-            data[j]=obs->data[iobs+i];
-            if ((satsys(data[j].sat,NULL)&opt->navsys)&&
-                opt->exsats[data[j].sat-1]!=1) j++;
-        }
-        if (j<=0||!screent(data[0].time,ts,ts,1.0)) continue; /* only 1 hz */
-
-        if (!arc_pntpos(data,j,nav,opt,&sol,NULL,NULL,msg)) continue;
+    is=arc_imat(obs->n+1,1); ns=arc_imat(obs->n+1,1);
 
-        for (i=0;i<3;i++) ra[i]+=sol.rr[i];
-        n++;
+    for (iobs=0;(m=arc_nextobsf(obs,&iobs,rcv))>0;iobs+=m) {
+        if (!screent(obs->data[iobs].time,ts,ts,1.0)) continue; /* only 1 hz */
+        is[n]=iobs; ns[n++]=m;
     }
+    n=arc_pntposs(obs->data,is,ns,n,nav,opt,opt->spp_nthread,NULL,ra,NULL);
+    free(is); free(ns);
+
     if (n<=0) {
         arc_log(ARC_WARNING,"arc_avepos : no average of base station position\n");
         return 0;
     }
-    for (i=0;i<3;i++) ra[i]/=n;
     return 1;
 }
 /* antenna phase center position ---------------------------------------------*/
@@ -765,8 +1214,8 @@ static void arc_closeses(nav_t *nav, pcvs_t *pcvs, pcvs_t *pcvr)
     arc_log(ARC_INFO,"arc_closeses:\n");
 
     /* free antenna parameters */
-    if (pcvs->pcv) free(pcvs->pcv); pcvs->pcv=NULL; pcvs->n=pcvs->nmax=0;
-    if (pcvs->pcv) free(pcvr->pcv); pcvr->pcv=NULL; pcvr->n=pcvr->nmax=0;
+    arc_freepcv(pcvs);
+    arc_freepcv(pcvr);
 
     /* free erp data */
     if (nav->erp.data) free(nav->erp.data);
@@ -913,24 +1362,39 @@ static int outhead(const char *outfile, char **infile, int n,
     if (*outfile) {
         createdir(outfile);
 
-        if (!(fp=fopen(outfile,"w"))) {
+        if (!(fp=fopen(outfile,sopt->posf==SOLF_BIN?"wb":"w"))) {
             arc_log(ARC_ERROR,"error : open output file %s",outfile);
             return 0;
         }
     }
     /* output header */
-    outheader(fp,infile,n,popt,sopt);
+    if (sopt->posf==SOLF_BIN) outsolbhead(fp);
+    else outheader(fp,infile,n,popt,sopt);
 
     if (*outfile) fclose(fp);
 
     return 1;
 }
 /* open output file for append -----------------------------------------------*/
-static FILE *openfile(const char *outfile)
+static FILE *openfile(const char *outfile, const solopt_t *sopt)
 {
+    FILE *fp;
+
     arc_log(ARC_INFO,"openfile: outfile=%s\n",outfile);
 
-    return !*outfile?stderr:fopen(outfile,"a");
+    fp=!*outfile?stderr:fopen(outfile,sopt->posf==SOLF_BIN?"ab":"a");
+
+    /* binary solution writer */
+    if (fp&&sopt->posf==SOLF_BIN) solw=solw_open(fp);
+    return fp;
+}
+/* close output file ---------------------------------------------------------*/
+static void closefile(FILE *fp)
+{
+    arc_log(ARC_INFO,"closefile:\n");
+
+    solw_close(solw); solw=NULL;
+    fclose(fp);
 }
 /* execute processing session ------------------------------------------------*/
 static int arc_execses(gtime_t ts, gtime_t te, double ti, const prcopt_t *popt,
@@ -986,13 +1450,14 @@ static int arc_execses(gtime_t ts, gtime_t te, double ti, const prcopt_t *popt,
     /* open solution statistics */
     if (flag&&sopt->sstat>0) {
         strcpy(statfile,outfile);
-        strcat(statfile,".stat");
+        strcat(statfile,sopt->sstatf?".sbin":".stat");
 #if USERTKLIB
         rtkclosestat2();
         rtkopenstat2(statfile,sopt->sstat);
 #else
         rtkclosestat();
-        rtkopenstat(statfile,sopt->sstat);
+        if (sopt->sstatf) rtkopenstatb(statfile,sopt->sstat);
+        else rtkopenstat(statfile,sopt->sstat);
 #endif
     }
     /* write header to output file */
@@ -1004,18 +1469,34 @@ static int arc_execses(gtime_t ts, gtime_t te, double ti, const prcopt_t *popt,
     }
     iobsu=iobsr=isbs=revs=aborts=0;
 
-    if (popt_.mode==PMODE_SINGLE||popt_.soltype==0) {
-        if ((fp=openfile(outfile))) {
+    if (popt_.mode==PMODE_STATIC&&popt_.neq_static&&!popt_.use_dd_sol) {
+        if ((fp=openfile(outfile,sopt))) {
+            arc_procpos_neq(fp,&popt_,sopt); /* static normal equation */
+            closefile(fp);
+        }
+    }
+    else if (popt_.mode==PMODE_SINGLE||popt_.soltype==0) {
+        if ((fp=openfile(outfile,sopt))) {
             arc_procpos(fp,&popt_,sopt,0); /* forward */
-            fclose(fp);
+            closefile(fp);
         }
     }
     else if (popt_.soltype==1) {
-        if ((fp=openfile(outfile))) {
+        if ((fp=openfile(outfile,sopt))) {
             revs=1; iobsu=iobsr=obss.n-1;
             arc_procpos(fp,&popt_,sopt,0); /* backward */
-            fclose(fp);
+            closefile(fp);
+        }
+    }
+    else if (popt_.soltype==3) {
+        if (!(fls=arc_fls_new(&popt_))) {
+            arc_info(100,2,"fixed-lag smoother needs dynamics in kinematic mode");
+        }
+        else if ((fp=openfile(outfile,sopt))) {
+            arc_procpos(fp,&popt_,sopt,2); /* fixed-lag smoother */
+            closefile(fp);
         }
+        arc_fls_free(fls); fls=NULL;
     }
     else { /* combined */
         solf=(sol_t *)malloc(sizeof(sol_t)*nepoch);
@@ -1030,9 +1511,9 @@ static int arc_execses(gtime_t ts, gtime_t te, double ti, const prcopt_t *popt,
             arc_procpos(NULL,&popt_,sopt,1); /* backward */
 
             /* combine forward/backward solutions */
-            if (!aborts&&(fp=openfile(outfile))) {
+            if (!aborts&&(fp=openfile(outfile,sopt))) {
                 arc_combres(fp,&popt_,sopt);
-                fclose(fp);
+                closefile(fp);
             }
         }
         else arc_log(ARC_ERROR,"error : memory allocation \n");
@@ -0,0 +1,584 @@
+/*********************************************************************************
+ *  ARC-SRTK - Single Frequency RTK Pisitioning Library
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************************/
+
+/**
+ * @file arc_rtsvr.cc
+ * @brief real-time positioning server and rinex replay source
+ *
+ * the server reads rinex observation or rtcm 3 streams of rover and base by
+ * one input thread each into epoch ring buffers. the processing thread takes
+ * the oldest rover epoch, waits shortly for the base epoch of the same time
+ * and selects the nearest base epoch within the age of differential limit
+ * (prcopt maxtdiff), runs arc_srtkpos() and writes the solution to the
+ * output stream. navigation data are given to the server, ephemerides of
+ * rtcm 3 streams are added by the processing thread.
+ *
+ * the replay source writes a rinex observation or rtcm 3 file to a stream
+ * epoch by epoch at the epoch times (scaled by speed), so the server can be
+ * load tested with a local tcp socket or pipe.
+ */
+#include "arc.h"
+
+#define RTSVR_SYNCWAIT  10          /* default wait of base epoch (ms) */
+#define RTSVR_CYCLE     50          /* max wait of processing thread (ms) */
+#define REPLAY_CONNWAIT 100         /* wait for connection of replay stream (ms) */
+#define REPLAY_MAXEP    (1<<20)     /* max bytes of replayed epoch */
+
+#ifndef WIN32
+/* monotonic time (s) --------------------------------------------------------*/
+static double arc_rtsvr_tick(void)
+{
+    struct timespec tp;
+    clock_gettime(CLOCK_MONOTONIC,&tp);
+    return tp.tv_sec+tp.tv_nsec*1E-9;
+}
+/* push observation epoch to input buffer ------------------------------------*/
+static void arc_rtsvr_push(rtsvr_t *svr, int index, const obsd_t *obs, int n)
+{
+    rtsvrep_t *ep;
+    int i;
+
+    lock(&svr->lock);
+    if (svr->n[index]>=RTSVRNBUF) { /* drop oldest epoch */
+        svr->head[index]=(svr->head[index]+1)%RTSVRNBUF;
+        svr->n[index]--;
+        svr->nover[index]++;
+    }
+    ep=svr->buf[index]+(svr->head[index]+svr->n[index])%RTSVRNBUF;
+    ep->tick=arc_rtsvr_tick();
+    for (i=ep->n=0;i<n&&i<MAXOBS;i++) {
+        ep->obs[ep->n]=obs[i];
+        ep->obs[ep->n++].rcv=(unsigned char)(index+1);
+    }
+    svr->n[index]++;
+    svr->nrecv[index]++;
+    pthread_cond_signal(&svr->cond);
+    unlock(&svr->lock);
+}
+/* set base station position of stream ---------------------------------------
+* the position is queued and applied by the processing thread, which reads
+* rtk.opt.rb without lock
+*-----------------------------------------------------------------------------*/
+static void arc_rtsvr_setbase(rtsvr_t *svr, const double *pos)
+{
+    int i;
+
+    if (arc_norm(pos,3)<=0.0) return;
+    lock(&svr->lock);
+    for (i=0;i<3;i++) svr->rbq[i]=pos[i];
+    svr->nrb=1;
+    unlock(&svr->lock);
+}
+/* input thread of rinex observation stream ----------------------------------*/
+static void arc_rtsvr_inrnx(rtsvr_t *svr, int index)
+{
+    rnxctr_t rnx;
+    FILE *fp;
+    int stat;
+
+    if (!arc_init_rnxctr(&rnx)) return;
+    strcpy(rnx.opt,svr->popt.rnxopt[index]);
+
+    if (!(fp=arc_strfopen(svr->str+index))) {
+        arc_free_rnxctr(&rnx);
+        return;
+    }
+    if (arc_open_rnxctr(&rnx,fp)) {
+
+        /* base station position in rinex header */
+        if (index==1&&svr->popt.refpos==POSOPT_RINEX) {
+            arc_rtsvr_setbase(svr,rnx.sta.pos);
+        }
+        while (svr->state&&(stat=arc_input_rnxctr(&rnx,fp))>-2) {
+            if (stat>0) arc_rtsvr_push(svr,index,rnx.obs.data,rnx.obs.n);
+        }
+    }
+    fclose(fp);
+    arc_free_rnxctr(&rnx);
+}
+/* input thread of rtcm 3 stream ---------------------------------------------*/
+static void arc_rtsvr_inrtcm(rtsvr_t *svr, int index)
+{
+    rtcm_t *rtcm;
+    unsigned char buff[4096];
+    int i,n,stat;
+
+    if (!(rtcm=(rtcm_t *)malloc(sizeof(rtcm_t)))||!arc_init_rtcm(rtcm)) {
+        free(rtcm);
+        return;
+    }
+    strcpy(rtcm->opt,svr->popt.rnxopt[index]);
+    if (svr->popt.ts.time) rtcm->time=svr->popt.ts;
+
+    while (svr->state&&(n=arc_strread(svr->str+index,buff,sizeof(buff),
+                                      RTSVR_CYCLE))>=0) {
+        for (i=0;i<n;i++) {
+            if ((stat=arc_input_rtcm3(rtcm,buff[i]))==1) {
+                arc_rtsvr_push(svr,index,rtcm->obs.data,rtcm->obs.n);
+            }
+            else if (stat==2) { /* used by processing thread */
+                lock(&svr->lock);
+                if (svr->neph<RTSVRNEPH) {
+                    svr->ephq[svr->neph++]=rtcm->nav.eph[rtcm->ephsat-1];
+                }
+                unlock(&svr->lock);
+            }
+            else if (stat==5&&index==1&&svr->popt.refpos==POSOPT_RTCM) {
+                arc_rtsvr_setbase(svr,rtcm->sta.pos);
+            }
+        }
+    }
+    arc_free_rtcm(rtcm);
+    free(rtcm);
+}
+/* input thread of rover/base stream -----------------------------------------*/
+static void arc_rtsvr_input(rtsvr_t *svr, int index)
+{
+    arc_log(ARC_INFO,"arc_rtsvr_input: index=%d fmt=%d\n",index,svr->fmt[index]);
+
+    if (svr->fmt[index]==STRFMT_RTCM3) arc_rtsvr_inrtcm(svr,index);
+    else arc_rtsvr_inrnx(svr,index);
+}
+static void *arc_rtsvr_rover(void *arg)
+{
+    arc_rtsvr_input((rtsvr_t *)arg,0);
+    return NULL;
+}
+static void *arc_rtsvr_base(void *arg)
+{
+    arc_rtsvr_input((rtsvr_t *)arg,1);
+    return NULL;
+}
+/* select base epoch of rover epoch ------------------------------------------
+* return : index of base epoch in buffer (-1: none), *ready: base epoch at or
+*          after rover epoch is available
+*----------------------------------------------------------------------------*/
+static int arc_rtsvr_selbase(const rtsvr_t *svr, gtime_t time, int *ready)
+{
+    const rtsvrep_t *ep;
+    double dt,dtmin=svr->popt.maxtdiff;
+    int i,j,k=-1;
+
+    *ready=0;
+    for (i=0;i<svr->n[1];i++) {
+        ep=svr->buf[1]+(j=(svr->head[1]+i)%RTSVRNBUF);
+        if (ep->n<=0) continue;
+        dt=timediff(ep->obs[0].time,time);
+        if (dt>=-DTTOL) *ready=1;
+        if (fabs(dt)<=dtmin) {dtmin=fabs(dt); k=j;}
+    }
+    return k;
+}
+/* update ephemeris of server navigation data -------------------------------*/
+static void arc_rtsvr_upeph(rtsvr_t *svr, const eph_t *eph)
+{
+    nav_t *nav=&svr->nav;
+    eph_t *nav_eph;
+    int i;
+
+    for (i=nav->n-1;i>=0;i--) {
+        if (nav->eph[i].sat==eph->sat&&nav->eph[i].iode==eph->iode&&
+            timediff(nav->eph[i].toe,eph->toe)==0.0) return;
+    }
+    if (nav->n>=nav->nmax) {
+        nav->nmax=nav->nmax<=0?MAXSAT:nav->nmax*2;
+        if (!(nav_eph=(eph_t *)realloc(nav->eph,sizeof(eph_t)*nav->nmax))) {
+            arc_log(ARC_ERROR,"arc_rtsvr_upeph: malloc error n=%d\n",nav->nmax);
+            nav->nmax=nav->n;
+            return;
+        }
+        nav->eph=nav_eph;
+    }
+    nav->eph[nav->n++]=*eph;
+    for (i=0;i<NFREQ;i++) {
+        nav->lam[eph->sat-1][i]=arc_satwavelen(eph->sat,i,nav);
+    }
+}
+/* processing thread ---------------------------------------------------------*/
+static void *arc_rtsvr_proc(void *arg)
+{
+    rtsvr_t *svr=(rtsvr_t *)arg;
+    obsd_t obs[MAXOBS*2];
+    eph_t eph[RTSVRNEPH];
+    rtsvrep_t *ep,*eb;
+    unsigned char buff[1024];
+    struct timespec ts;
+    double tick,tout,lat,wait;
+    int i,k,n,nb,ready;
+
+    arc_log(ARC_INFO,"arc_rtsvr_proc:\n");
+
+    while (svr->state) {
+        lock(&svr->lock);
+
+        /* received ephemerides */
+        if ((n=svr->neph)>0) {
+            memcpy(eph,svr->ephq,sizeof(eph_t)*n);
+            svr->neph=0;
+            unlock(&svr->lock);
+            for (i=0;i<n;i++) arc_rtsvr_upeph(svr,eph+i);
+            lock(&svr->lock);
+        }
+        /* received base station position */
+        if (svr->nrb>0) {
+            for (i=0;i<3;i++) svr->rtk.opt.rb[i]=svr->rbq[i];
+            svr->nrb=0;
+        }
+
+        if (svr->n[0]<=0) {
+            clock_gettime(CLOCK_REALTIME,&ts);
+            ts.tv_nsec+=RTSVR_CYCLE*1000000L;
+            if (ts.tv_nsec>=1000000000L) {ts.tv_sec++; ts.tv_nsec-=1000000000L;}
+            pthread_cond_timedwait(&svr->cond,&svr->lock,&ts);
+            unlock(&svr->lock);
+            continue;
+        }
+        ep=svr->buf[0]+svr->head[0];
+        k=arc_rtsvr_selbase(svr,ep->obs[0].time,&ready);
+
+        /* wait for base epoch of same time */
+        if (!ready&&(wait=svr->syncwait*1E-3-(arc_rtsvr_tick()-ep->tick))>0.0) {
+            clock_gettime(CLOCK_REALTIME,&ts);
+            ts.tv_nsec+=(long)(wait*1E9);
+            while (ts.tv_nsec>=1000000000L) {ts.tv_sec++; ts.tv_nsec-=1000000000L;}
+            pthread_cond_timedwait(&svr->cond,&svr->lock,&ts);
+            unlock(&svr->lock);
+            continue;
+        }
+        for (i=n=0;i<ep->n;i++) obs[n++]=ep->obs[i];
+        tick=ep->tick;
+        nb=0;
+        if (k>=0) {
+            eb=svr->buf[1]+k;
+            for (i=0;i<eb->n;i++) obs[n++]=eb->obs[i];
+            if (eb->tick>tick) tick=eb->tick;
+            nb=1;
+
+            /* discard base epochs before selected one */
+            while (svr->head[1]!=k) {
+                svr->head[1]=(svr->head[1]+1)%RTSVRNBUF;
+                svr->n[1]--;
+            }
+        }
+        svr->head[0]=(svr->head[0]+1)%RTSVRNBUF;
+        svr->n[0]--;
+        unlock(&svr->lock);
+
+        /* rtk positioning */
+        arc_srtkpos(&svr->rtk,obs,n,&svr->nav);
+        tout=arc_rtsvr_tick();
+
+        if (svr->rtk.sol.stat!=SOLQ_NONE&&
+            (n=outsols(buff,&svr->rtk.sol,svr->rtk.rb,&svr->sopt))>0) {
+            arc_strwrite(svr->str+2,buff,n);
+        }
+        lat=arc_rtsvr_tick()-tick;
+        arc_prof_add(svr->rtk.prof,PROF_OUTSOL,tick+lat-tout);
+
+        lock(&svr->lock);
+        svr->nproc++;
+        svr->nbase+=nb;
+        if (svr->rtk.sol.stat!=SOLQ_NONE) svr->nsol++;
+        svr->latsum+=lat;
+        if (lat>svr->latmax) svr->latmax=lat;
+        i=(int)(lat*1E4);
+        svr->lath[i<RTSVRNLAT?i:RTSVRNLAT]++;
+        unlock(&svr->lock);
+    }
+    return NULL;
+}
+/* wait for replay time of epoch --------------------------------------------*/
+static void arc_replay_wait(replay_t *rp, gtime_t time, gtime_t *t0, double *tick0)
+{
+    double wait;
+
+    if (rp->speed<=0.0) return;
+    if (!t0->time) {
+        *t0=time; *tick0=arc_rtsvr_tick();
+    }
+    wait=timediff(time,*t0)/rp->speed-(arc_rtsvr_tick()-*tick0);
+    if (wait>0.0) sleepms((int)(wait*1E3));
+}
+/* replay rinex observation file ---------------------------------------------*/
+static void arc_replay_rnx(replay_t *rp, unsigned char *buff)
+{
+    rnxctr_t rnx;
+    gtime_t t0={0};
+    double tick0=0.0;
+    long p0,p1;
+    int stat;
+
+    if (!arc_init_rnxctr(&rnx)) return;
+
+    if (!arc_open_rnxctr(&rnx,rp->fp)) {
+        arc_free_rnxctr(&rnx);
+        return;
+    }
+    /* wait for reader of stream */
+    while (rp->state==1&&!arc_strwait(&rp->str,REPLAY_CONNWAIT)) ;
+
+    /* header */
+    p1=ftell(rp->fp);
+    rewind(rp->fp);
+    if (fread(buff,1,p1,rp->fp)==(size_t)p1) arc_strwrite(&rp->str,buff,(int)p1);
+
+    while (rp->state==1) {
+        p0=ftell(rp->fp);
+        if ((stat=arc_input_rnxctr(&rnx,rp->fp))<-1) break;
+        p1=ftell(rp->fp);
+
+        if (stat>0) arc_replay_wait(rp,rnx.time,&t0,&tick0);
+        if (p1-p0>REPLAY_MAXEP) continue;
+
+        fseek(rp->fp,p0,SEEK_SET);
+        if (fread(buff,1,p1-p0,rp->fp)!=(size_t)(p1-p0)) break;
+        arc_strwrite(&rp->str,buff,(int)(p1-p0));
+        if (stat>0) rp->nep++;
+    }
+    arc_free_rnxctr(&rnx);
+}
+/* replay rtcm 3 file --------------------------------------------------------*/
+static void arc_replay_rtcm(replay_t *rp, unsigned char *buff)
+{
+    rtcm_t *rtcm;
+    gtime_t t0={0};
+    double tick0=0.0;
+    int c,n=0;
+
+    if (!(rtcm=(rtcm_t *)malloc(sizeof(rtcm_t)))||!arc_init_rtcm(rtcm)) {
+        free(rtcm);
+        return;
+    }
+    /* wait for reader of stream */
+    while (rp->state==1&&!arc_strwait(&rp->str,REPLAY_CONNWAIT)) ;
+
+    /* messages up to end of each epoch */
+    while (rp->state==1&&(c=fgetc(rp->fp))!=EOF) {
+        buff[n++]=(unsigned char)c;
+        if (arc_input_rtcm3(rtcm,(unsigned char)c)!=1&&n<REPLAY_MAXEP) continue;
+
+        if (rtcm->obsflag) {
+            arc_replay_wait(rp,rtcm->time,&t0,&tick0);
+            rp->nep++;
+        }
+        arc_strwrite(&rp->str,buff,n);
+        n=0;
+    }
+    if (n>0) arc_strwrite(&rp->str,buff,n);
+
+    arc_free_rtcm(rtcm);
+    free(rtcm);
+}
+/* replay thread -------------------------------------------------------------*/
+static void *arc_replay_thread(void *arg)
+{
+    replay_t *rp=(replay_t *)arg;
+    unsigned char *buff;
+
+    arc_log(ARC_INFO,"arc_replay_thread: fmt=%d\n",rp->fmt);
+
+    if ((buff=(unsigned char *)malloc(REPLAY_MAXEP))) {
+        if (rp->fmt==STRFMT_RTCM3) arc_replay_rtcm(rp,buff);
+        else arc_replay_rnx(rp,buff);
+        free(buff);
+    }
+    rp->state=2;
+    return NULL;
+}
+#endif /* WIN32 */
+
+/* start real-time positioning server ------------------------------------------
+* args   : rtsvr_t *svr     IO  real-time server (allocated by caller)
+*          prcopt_t *popt   I   processing options
+*          solopt_t *sopt   I   solution options
+*          nav_t  *nav      I   navigation data (NULL: no data)
+*          int    *strs     I   stream types (0:rover,1:base,2:solution)
+*          int    *fmts     I   stream formats STRFMT_??? (0:rover,1:base)
+*          char   **paths   I   stream paths (0:rover,1:base,2:solution)
+* return : status (1:ok,0:error)
+* notes  : rover and base streams are rinex observation or rtcm 3 streams.
+*          ephemerides of rtcm 3 streams are added to a copy of nav. other
+*          data of nav are shared and have to be kept until the server stops.
+*          solutions are written by outsols() in sopt format. base epochs are
+*          waited for after rover epoch for svr->syncwait ms (0: default) and
+*          used if the age of differential is within popt->maxtdiff
+*-----------------------------------------------------------------------------*/
+extern int arc_rtsvr_start(rtsvr_t *svr, const prcopt_t *popt, const solopt_t *sopt,
+                           const nav_t *nav, const int *strs, const int *fmts,
+                           char **paths)
+{
+#ifndef WIN32
+    int i,j,syncwait=svr->syncwait;
+
+    arc_log(ARC_INFO,"arc_rtsvr_start:\n");
+
+    memset(svr,0,sizeof(rtsvr_t));
+    svr->popt=*popt;
+    svr->sopt=*sopt;
+    svr->syncwait=syncwait>0?syncwait:RTSVR_SYNCWAIT;
+    for (i=0;i<2;i++) svr->fmt[i]=fmts?fmts[i]:STRFMT_RINEX;
+
+    /* navigation data with own ephemeris buffer */
+    if (nav) svr->nav=*nav;
+    svr->nav.n=svr->nav.nmax=0;
+    svr->nav.eph=NULL;
+    if (nav&&nav->n>0) {
+        if (!(svr->nav.eph=(eph_t *)malloc(sizeof(eph_t)*nav->n))) return 0;
+        memcpy(svr->nav.eph,nav->eph,sizeof(eph_t)*nav->n);
+        svr->nav.n=svr->nav.nmax=nav->n;
+    }
+    for (i=0;i<MAXSAT;i++) for (j=0;j<NFREQ;j++) {
+        if (svr->nav.lam[i][j]==0.0) svr->nav.lam[i][j]=arc_satwavelen(i+1,j,&svr->nav);
+    }
+    for (i=0;i<3;i++) {
+        if (!arc_stropen(svr->str+i,strs[i],i<2?STR_MODE_R:STR_MODE_W,paths[i])) {
+            while (--i>=0) arc_strclose(svr->str+i);
+            free(svr->nav.eph);
+            return 0;
+        }
+    }
+    for (i=0;i<2;i++) {
+        if (!(svr->buf[i]=(rtsvrep_t *)calloc(RTSVRNBUF,sizeof(rtsvrep_t)))) {
+            free(svr->buf[0]);
+            for (i=0;i<3;i++) arc_strclose(svr->str+i);
+            free(svr->nav.eph);
+            return 0;
+        }
+    }
+    arc_rtkinit(&svr->rtk,&svr->popt);
+    initlock(&svr->lock);
+    pthread_cond_init(&svr->cond,NULL);
+
+    if (svr->sopt.outhead) {
+        unsigned char buff[1024];
+        int n=outsolheads(buff,&svr->sopt);
+        arc_strwrite(svr->str+2,buff,n);
+    }
+    svr->state=1;
+    if (pthread_create(svr->thread  ,NULL,arc_rtsvr_rover,svr)||
+        pthread_create(svr->thread+1,NULL,arc_rtsvr_base ,svr)||
+        pthread_create(svr->thread+2,NULL,arc_rtsvr_proc ,svr)) {
+        arc_log(ARC_ERROR,"arc_rtsvr_start: thread create error\n");
+        svr->state=0;
+        return 0;
+    }
+    return 1;
+#else
+    arc_log(ARC_ERROR,"arc_rtsvr_start: not supported\n");
+    return 0;
+#endif
+}
+/* stop real-time positioning server -----------------------------------------*/
+extern void arc_rtsvr_stop(rtsvr_t *svr)
+{
+#ifndef WIN32
+    int i;
+
+    arc_log(ARC_INFO,"arc_rtsvr_stop:\n");
+
+    if (!svr->state) return;
+
+    svr->state=0;
+    for (i=0;i<2;i++) svr->str[i].stop=1;
+    pthread_cond_broadcast(&svr->cond);
+    for (i=0;i<3;i++) pthread_join(svr->thread[i],NULL);
+    for (i=0;i<3;i++) arc_strclose(svr->str+i);
+    for (i=0;i<2;i++) {free(svr->buf[i]); svr->buf[i]=NULL;}
+
+    pthread_cond_destroy(&svr->cond);
+    pthread_mutex_destroy(&svr->lock);
+    arc_rtkfree(&svr->rtk);
+    free(svr->nav.eph); svr->nav.eph=NULL; svr->nav.n=svr->nav.nmax=0;
+#endif
+}
+/* latency percentile of real-time server --------------------------------------
+* args   : rtsvr_t *svr     I   real-time server
+*          double p         I   percentile (0-1)
+* return : latency of epochs (s) (resolution 0.1 ms)
+*-----------------------------------------------------------------------------*/
+extern double arc_rtsvr_latency(rtsvr_t *svr, double p)
+{
+    unsigned int n=0,m;
+    int i;
+    double lat;
+
+    lock(&svr->lock);
+    m=(unsigned int)ceil(p*svr->nproc);
+    for (i=0;i<=RTSVRNLAT;i++) {
+        if ((n+=svr->lath[i])>=m&&n>0) break;
+    }
+    lat=i>=RTSVRNLAT||(i+1)*1E-4>svr->latmax?svr->latmax:(i+1)*1E-4;
+    unlock(&svr->lock);
+    return lat;
+}
+/* start replay source ---------------------------------------------------------
+* args   : replay_t *rp     IO  replay source (allocated by caller)
+*          char   *file     I   rinex observation or rtcm 3 file
+*          int    fmt       I   file format (STRFMT_???)
+*          int    type      I   stream type of output (STR_???)
+*          char   *path     I   stream path of output
+*          double speed     I   replay speed (x real time) (0:no wait)
+* return : status (1:ok,0:error)
+* notes  : the replay waits for a reader of tcp stream, then writes the rinex
+*          header and the epochs or the rtcm 3 messages up to the end of each
+*          epoch. rp->state is 2 at end of file
+*-----------------------------------------------------------------------------*/
+extern int arc_replay_start(replay_t *rp, const char *file, int fmt, int type,
+                            const char *path, double speed)
+{
+#ifndef WIN32
+    arc_log(ARC_INFO,"arc_replay_start: file=%s path=%s speed=%.1f\n",file,path,
+            speed);
+
+    memset(rp,0,sizeof(replay_t));
+    rp->speed=speed;
+    rp->fmt=fmt;
+
+    if (!(rp->fp=fopen(file,"rb"))) {
+        arc_log(ARC_WARNING,"arc_replay_start: file open error %s\n",file);
+        return 0;
+    }
+    if (!arc_stropen(&rp->str,type,STR_MODE_W,path)) {
+        fclose(rp->fp);
+        return 0;
+    }
+    rp->state=1;
+    if (pthread_create(&rp->thread,NULL,arc_replay_thread,rp)) {
+        arc_strclose(&rp->str);
+        fclose(rp->fp);
+        rp->state=0;
+        return 0;
+    }
+    return 1;
+#else
+    arc_log(ARC_ERROR,"arc_replay_start: not supported\n");
+    return 0;
+#endif
+}
+/* stop rinex replay source --------------------------------------------------*/
+extern void arc_replay_stop(replay_t *rp)
+{
+#ifndef WIN32
+    arc_log(ARC_INFO,"arc_replay_stop:\n");
+
+    if (!rp->state) return;
+    if (rp->state==1) rp->state=3; /* stop request */
+    pthread_join(rp->thread,NULL);
+    arc_strclose(&rp->str);
+    fclose(rp->fp);
+    rp->state=0;
+#endif
+}
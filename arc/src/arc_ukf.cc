@@ -513,6 +513,293 @@ extern int arc_ukf_filter_update(ukf_t *filter, double *y, double *u,
     return 1;
     /* finished with kalman iteration ! */
 }
+/* square-root ukf -------------------------------------------------------------
+* square-root unscented kalman filter measurement update restricted to a set of
+* active states. the covariance of the active states is carried by its lower
+* cholesky factor S (P=S*S'), which is updated by QR decomposition and rank-one
+* cholesky up/downdates instead of a new decomposition of P [1]. inactive states
+* are not perturbed by the sigma points and keep their values and covariance
+* (as arc_filter()).
+*
+* [1] R.van der Merwe and E.A.Wan, The square-root unscented kalman filter for
+*     state and parameter-estimation, ICASSP 2001
+*-----------------------------------------------------------------------------*/
+#define SRUKF_MAXTHREAD     16              /* max threads of measurement function */
+
+typedef struct {                            /* sigma point measurement job */
+    srukf_function hfun;                    /* measurement function */
+    void *ctx;                              /* context of measurement function */
+    const double *X;                        /* sigma points (n x np) */
+    double *Y;                              /* sigma point measurements (m x np) */
+    int *stat;                              /* status of measurement function (np) */
+    int n,m;                                /* number of states and measurements */
+    int i0,i1;                              /* sigma point range [i0,i1) */
+} srukf_job_t;
+
+/* cholesky factor of active states covariance ---------------------------------
+* args   : double *P        I   covariance matrix of states (n x n)
+*          int    n         I   number of states
+*          int    *ix       I   active states index (na) (NULL: all states)
+*          int    na        I   number of active states
+*          double *S        O   lower cholesky factor (na x na)
+* return : status (0:ok,-1:not positive definite)
+* notes  : matirix stored by column-major order (fortran convention)
+*-----------------------------------------------------------------------------*/
+extern int arc_srukf_factor(const double *P, int n, const int *ix, int na, double *S)
+{
+    double s;
+    int i,j,k,ii,jj;
+
+    for (j=0;j<na;j++) {
+        jj=ix?ix[j]:j;
+        for (i=0;i<j;i++) S[i+j*na]=0.0;
+        for (i=j;i<na;i++) {
+            ii=ix?ix[i]:i;
+            s=P[ii+jj*n];
+            for (k=0;k<j;k++) s-=S[i+k*na]*S[j+k*na];
+            if (i==j) {
+                if (s<=0.0) return -1;
+                S[j+j*na]=sqrt(s);
+            }
+            else S[i+j*na]=s/S[j+j*na];
+        }
+    }
+    return 0;
+}
+/* rank-one update of cholesky factor (S*S'+sign*u*u') ------------------------*/
+static int arc_srukf_cholupdate(double *S, int n, double *u, int sign)
+{
+    double r,c,s;
+    int i,k;
+
+    for (k=0;k<n;k++) {
+        r=S[k+k*n]*S[k+k*n]+sign*u[k]*u[k];
+        if (r<=0.0||S[k+k*n]==0.0) return -1;
+        r=sqrt(r);
+        c=r/S[k+k*n]; s=u[k]/S[k+k*n];
+        S[k+k*n]=r;
+        for (i=k+1;i<n;i++) {
+            S[i+k*n]=(S[i+k*n]+sign*s*u[i])/c;
+            u[i]=c*u[i]-s*S[i+k*n];
+        }
+    }
+    return 0;
+}
+/* lower cholesky factor of A'*A by householder QR of A (r x c, r>=c) ---------*/
+static int arc_srukf_qr(double *A, int r, int c, double *L)
+{
+    double norm,alpha,vv,t,*d=arc_mat(c,1);
+    int i,j,k,info=0;
+
+    for (k=0;k<c;k++) {
+        for (i=k,norm=0.0;i<r;i++) norm+=A[i+k*r]*A[i+k*r];
+        if ((norm=sqrt(norm))<=0.0) {info=-1; break;}
+        alpha=A[k+k*r]>0.0?-norm:norm;
+        A[k+k*r]-=alpha; d[k]=alpha;
+        for (i=k,vv=0.0;i<r;i++) vv+=A[i+k*r]*A[i+k*r];
+
+        for (j=k+1;j<c;j++) { /* apply reflection to remaining columns */
+            for (i=k,t=0.0;i<r;i++) t+=A[i+k*r]*A[i+j*r];
+            t*=2.0/vv;
+            for (i=k;i<r;i++) A[i+j*r]-=t*A[i+k*r];
+        }
+    }
+    if (!info) {
+        for (k=0;k<c;k++) { /* L=R' with positive diagonal */
+            for (j=0;j<k;j++) L[j+k*c]=0.0;
+            L[k+k*c]=fabs(d[k]);
+            for (j=k+1;j<c;j++) L[j+k*c]=d[k]<0.0?-A[k+j*r]:A[k+j*r];
+        }
+    }
+    free(d);
+    return info;
+}
+/* evaluate measurement function for a range of sigma points ------------------*/
+static void arc_srukf_evalrange(srukf_job_t *job)
+{
+    int i;
+    for (i=job->i0;i<job->i1;i++) {
+        job->stat[i]=job->hfun(job->X+i*job->n,job->n,job->Y+i*job->m,job->m,
+                               job->ctx);
+    }
+}
+#ifndef WIN32
+static void *arc_srukf_thread(void *arg)
+{
+    arc_srukf_evalrange((srukf_job_t *)arg);
+    return NULL;
+}
+#endif
+/* evaluate measurement function for all sigma points -------------------------
+* the sigma points are split into nthread contiguous blocks, block 0 is
+* evaluated by the calling thread. the measurement function must not modify
+* shared data.
+*-----------------------------------------------------------------------------*/
+static int arc_srukf_eval(srukf_function hfun, void *ctx, const double *X, int n,
+                          int np, double *Y, int m, int nthread)
+{
+    srukf_job_t job[SRUKF_MAXTHREAD];
+    int i,stat=1,*s=arc_imat(np,1);
+#ifndef WIN32
+    pthread_t thread[SRUKF_MAXTHREAD];
+    int run[SRUKF_MAXTHREAD]={0};
+#else
+    nthread=1;
+#endif
+    if (nthread<1) nthread=1;
+    if (nthread>SRUKF_MAXTHREAD) nthread=SRUKF_MAXTHREAD;
+    if (nthread>np) nthread=np;
+
+    for (i=0;i<nthread;i++) {
+        job[i].hfun=hfun; job[i].ctx=ctx; job[i].X=X; job[i].Y=Y;
+        job[i].stat=s; job[i].n=n; job[i].m=m;
+        job[i].i0=np*i/nthread; job[i].i1=np*(i+1)/nthread;
+    }
+#ifndef WIN32
+    for (i=1;i<nthread;i++) {
+        run[i]=!pthread_create(thread+i,NULL,arc_srukf_thread,job+i);
+    }
+    arc_srukf_evalrange(job);
+    for (i=1;i<nthread;i++) {
+        if (run[i]) pthread_join(thread[i],NULL);
+        else arc_srukf_evalrange(job+i); /* thread creation failed */
+    }
+#else
+    arc_srukf_evalrange(job);
+#endif
+    for (i=0;i<np;i++) if (!s[i]) stat=0;
+    free(s);
+    return stat;
+}
+/* square-root ukf measurement update -------------------------------------------
+* args   : double *x        IO  states vector (n x 1)
+*          double *P        IO  covariance matrix of states (n x n)
+*          int    n         I   number of states
+*          int    *ix       I   active states index (na)
+*          int    na        I   number of active states
+*          double *S        IO  lower cholesky factor of active states covariance
+*                               (na x na) (see arc_srukf_factor())
+*          double *z        I   measurements (m x 1)
+*          double *R        I   covariance matrix of measurement error (m x m)
+*          int    m         I   number of measurements
+*          srukf_function hfun I measurement function
+*                               hfun(x,n,h,m,ctx): h=h(x) (1:ok,0:error)
+*          void   *ctx      I   context of measurement function
+*          double alpha,kappa,beta I sigma point spread/scaling/distribution
+*          int    nthread   I   number of threads evaluating hfun
+* return : status (0:ok,-1:factorization error,-2:measurement function error)
+* notes  : matirix stored by column-major order (fortran convention)
+*          only x[ix[]] and P[ix[],ix[]] are updated, x,P,S are unchanged on error
+*-----------------------------------------------------------------------------*/
+extern int arc_srukf_update(double *x, double *P, int n, const int *ix, int na,
+                            double *S, const double *z, const double *R, int m,
+                            srukf_function hfun, void *ctx, double alpha,
+                            double kappa, double beta, int nthread)
+{
+    double lam,gamma,wm0,wc0,w,*X,*Y,*ym,*dy,*A,*Lr,*Sy,*Pxy,*K,*U,*u,*dx,*S0,t;
+    int i,j,k,np=2*na+1,info=0;
+
+    arc_log(ARC_INFO,"arc_srukf_update : n=%d na=%d m=%d\n",n,na,m);
+
+    if (na<=0||m<=0) return -1;
+    if (alpha<=0.0) alpha=1E-3;
+
+    /* weights */
+    lam=alpha*alpha*(na+kappa)-na;
+    gamma=sqrt(na+lam);
+    wm0=lam/(na+lam);
+    wc0=wm0+1.0-alpha*alpha+beta;
+    w=0.5/(na+lam);
+
+    X=arc_mat(n,np); Y=arc_mat(m,np); ym=arc_mat(m,1); dy=arc_mat(m,1);
+    A=arc_mat(2*na+m,m); Lr=arc_mat(m,m); Sy=arc_mat(m,m);
+    Pxy=arc_mat(na,m); K=arc_mat(na,m); U=arc_mat(na,m); u=arc_mat(na,1);
+    dx=arc_mat(na,1); S0=arc_mat(na,na);
+    arc_matcpy(S0,S,na,na);
+
+    /* sigma points over active states, inactive states are carried as x */
+    for (i=0;i<np;i++) arc_matcpy(X+i*n,x,n,1);
+    for (k=0;k<na;k++) {
+        for (i=k;i<na;i++) {
+            X[ix[i]+(k+1   )*n]+=gamma*S[i+k*na];
+            X[ix[i]+(k+1+na)*n]-=gamma*S[i+k*na];
+        }
+    }
+    /* propagate measurement */
+    if (!arc_srukf_eval(hfun,ctx,X,n,np,Y,m,nthread)) {
+        arc_log(ARC_WARNING,"arc_srukf_update : measurement function error\n");
+        info=-2;
+    }
+    if (!info) {
+        /* measurement prediction (relative to central point for precision) */
+        for (j=0;j<m;j++) {
+            for (i=1,t=0.0;i<np;i++) t+=Y[j+i*m]-Y[j];
+            ym[j]=Y[j]+w*t;
+        }
+        /* Sy=qr([sqrt(w)*(Y(1:2na)-ym),chol(R)])' */
+        if (arc_srukf_factor(R,m,NULL,m,Lr)) info=-1;
+    }
+    if (!info) {
+        for (i=1;i<np;i++) for (j=0;j<m;j++) {
+            A[(i-1)+j*(2*na+m)]=sqrt(w)*(Y[j+i*m]-ym[j]);
+        }
+        for (k=0;k<m;k++) for (j=0;j<m;j++) {
+            A[(2*na+k)+j*(2*na+m)]=Lr[j+k*m];
+        }
+        if (arc_srukf_qr(A,2*na+m,m,Sy)) info=-1;
+    }
+    if (!info) {
+        /* rank-one update by central point */
+        for (j=0;j<m;j++) dy[j]=sqrt(fabs(wc0))*(Y[j]-ym[j]);
+        if (arc_srukf_cholupdate(Sy,m,dy,wc0<0.0?-1:1)) info=-1;
+    }
+    if (!info) {
+        /* Pxy=w*gamma*sum(S(:,k)*(Y(k+1)-Y(k+1+na))') */
+        for (j=0;j<m;j++) for (i=0;i<na;i++) {
+            for (k=0,t=0.0;k<=i;k++) {
+                t+=S[i+k*na]*(Y[j+(k+1)*m]-Y[j+(k+1+na)*m]);
+            }
+            Pxy[i+j*na]=w*gamma*t;
+        }
+        /* K=Pxy/Sy'/Sy */
+        for (i=0;i<na;i++) {
+            for (j=0;j<m;j++) { /* Sy*a=Pxy(i,:)' */
+                for (k=0,t=Pxy[i+j*na];k<j;k++) t-=Sy[j+k*m]*K[i+k*na];
+                K[i+j*na]=t/Sy[j+j*m];
+            }
+            for (j=m-1;j>=0;j--) { /* Sy'*k=a */
+                for (k=j+1,t=K[i+j*na];k<m;k++) t-=Sy[k+j*m]*K[i+k*na];
+                K[i+j*na]=t/Sy[j+j*m];
+            }
+        }
+        /* dx=K*(z-ym) */
+        for (j=0;j<m;j++) dy[j]=z[j]-ym[j];
+        for (i=0;i<na;i++) {
+            for (j=0,dx[i]=0.0;j<m;j++) dx[i]+=K[i+j*na]*dy[j];
+        }
+        /* S=cholupdate(S,K*Sy,-1) */
+        arc_matmul("NN",na,m,m,1.0,K,Sy,0.0,U);
+        for (j=0;j<m&&!info;j++) {
+            arc_matcpy(u,U+j*na,na,1);
+            if (arc_srukf_cholupdate(S,na,u,-1)) info=-1;
+        }
+    }
+    if (!info) {
+        /* x(ix)=x(ix)+dx, P(ix,ix)=S*S' */
+        for (i=0;i<na;i++) x[ix[i]]+=dx[i];
+        for (i=0;i<na;i++) for (j=0;j<=i;j++) {
+            for (k=0,t=0.0;k<=j;k++) t+=S[i+k*na]*S[j+k*na];
+            P[ix[i]+ix[j]*n]=P[ix[j]+ix[i]*n]=t;
+        }
+    }
+    else {
+        if (info==-1) arc_log(ARC_WARNING,"arc_srukf_update : cholesky factor update error\n");
+        arc_matcpy(S,S0,na,na); /* states and factor unchanged on error */
+    }
+    free(X); free(Y); free(ym); free(dy); free(A); free(Lr); free(Sy);
+    free(Pxy); free(K); free(U); free(u); free(dx); free(S0);
+    return info;
+}
 /* ukf_filter_delete -----------------------------------------------*/
 extern void arc_ukf_filter_delete(ukf_t *filter)
 {
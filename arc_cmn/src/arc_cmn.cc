@@ -39,6 +39,13 @@
 #define SQR(x)      ((x)*(x))
 #define EPS           0.000001
 #define ITERS         60
+#define GEOCTX_DT     60.0          /* interval of geophysical context knots (s) */
+#define MAPT_DEL      (90.0/(MAXMAPT-1)) /* elevation interval of mapping function table (deg) */
+#define MAPT_ELMIN    (3.0*D2R)     /* min elevation of mapping function table (rad) */
+#define MAPT_TTOL     3600.0        /* max time difference to table time (s) */
+#define MAPT_PTOL     (0.01*D2R)    /* max latitude/longitude difference to table position (rad) */
+#define MAPT_HTOL     50.0          /* max height difference to table position (m) */
+#define MAPT_HSTEP    50.0          /* height step of height derivatives of table (m) */
 
 /* function prototypes -------------------------------------------------------*/
 #ifdef IERS_MODEL
@@ -914,6 +921,129 @@ extern int arc_filter_active(double *x, double *P, const double *H, const double
     free(ix); free(x_); free(xp_); free(P_); free(Pp_); free(H_); free(D_);
     return info;
 }
+/* cholesky factorization of symmetric positive definite matrix ---------------
+* A=L*L', L is stored in lower triangle of A (upper triangle is not referenced)
+*-----------------------------------------------------------------------------*/
+static int arc_cholf(double *A, int n)
+{
+    double s;
+    int i,j,k;
+
+    for (j=0;j<n;j++) {
+        for (s=A[j+j*n],k=0;k<j;k++) s-=A[j+k*n]*A[j+k*n];
+        if (s<=0.0) return -1;
+        A[j+j*n]=sqrt(s);
+        for (i=j+1;i<n;i++) {
+            for (s=A[i+j*n],k=0;k<j;k++) s-=A[i+k*n]*A[j+k*n];
+            A[i+j*n]=s/A[j+j*n];
+        }
+    }
+    return 0;
+}
+/* IGG-III equivalent weight of normalized innovation -------------------------*/
+static double arc_igg3(double e, double k0, double k1)
+{
+    e=fabs(e);
+    if (e<=k0) return 1.0;
+    if (e>=k1||k1<=k0) return 0.0;
+    return k0/e*SQR((k1-e)/(k1-k0));
+}
+/* kalman filter with weighted innovations -------------------------------------
+* kalman filter state update with equivalent weights of normalized innovations
+* as follows:
+*
+*   Q=H'*P*H+R=L*L', e_i=v_i/sqrt(Q_ii), G=P*H*L'^-1
+*   xp=x+G*L^-1*D*v, Pp=P-G*G'
+*
+* args   : double *x        IO  states vector (n x 1)
+*          double *P        IO  covariance matrix of states (n x n)
+*          double *H        I   transpose of design matrix (n x m)
+*          double *v        I   innovation (measurement - model) (m x 1)
+*          double *R        I   covariance matrix of measurement error (m x m)
+*          int    n,m       I   number of states and measurements
+*          int    *active   I   index of states to update (NULL: x[i]!=0.0 and
+*                               P[i+i*n]>0.0)
+*          int    na        I   number of active states
+*          innov_t *inn     IO  innovation weighting (NULL: no weighting)
+* return : status (0:ok,<0:error)
+* notes  : D is diagonal. robust mode uses IGG-III weights of |e_i| with
+*          thresholds k0,k1, adaptive mode uses D=lam*I with
+*          lam=max(1,(v'*v/2-tr(H'*diag(qd)*H)-tr(R))/tr(H'*P*H)).
+*          Q is factored once for all modes, with D=I the update is the same
+*          as arc_filter()
+*          matirix stored by column-major order (fortran convention)
+*-----------------------------------------------------------------------------*/
+extern int arc_filter_inno(double *x, double *P, const double *H, const double *v,
+                           const double *R, int n, int m, const int *active,
+                           int na, innov_t *inn)
+{
+    double *x_,*P_,*H_,*F,*L,*G,*e,*d,*w,s,a,lam=1.0,trm=0.0,trr=0.0,trq=0.0,trc=0.0;
+    int i,j,k,l,*ix,mode=inn?inn->mode:INNOV_NONE;
+
+    ix=arc_imat(n,1);
+    if (active) for (k=0;k<na;k++) ix[k]=active[k];
+    else for (i=k=0;i<n;i++) if (x[i]!=0.0&&P[i+i*n]>0.0) ix[k++]=i;
+
+    x_=arc_mat(k,1); P_=arc_mat(k,k); H_=arc_mat(k,m); F=arc_mat(k,m);
+    G=arc_mat(k,m); L=arc_mat(m,m); e=arc_mat(m,1); d=arc_mat(m,1);
+    w=arc_mat(m,1);
+    for (i=0;i<k;i++) {
+        x_[i]=x[ix[i]];
+        for (j=0;j<k;j++) P_[i+j*k]=P[ix[i]+ix[j]*n];
+        for (j=0;j<m;j++) H_[i+j*k]=H[ix[i]+j*n];
+    }
+    arc_matcpy(L,R,m,m);
+    arc_matmul("NN",k,m,k,1.0,P_,H_,0.0,F);     /* F=P*H */
+    arc_matmul("TN",m,m,k,1.0,H_,F,1.0,L);      /* Q=H'*P*H+R */
+    for (i=0;i<m;i++) {
+        trr+=R[i+i*m]; trm+=L[i+i*m]-R[i+i*m];
+        e[i]=L[i+i*m]>0.0?v[i]/sqrt(L[i+i*m]):0.0;
+    }
+    if (arc_cholf(L,m)) {
+        free(ix); free(x_); free(P_); free(H_); free(F);
+        free(G); free(L); free(e); free(d); free(w);
+        return -1;
+    }
+    for (j=0;j<m;j++) {                         /* G=F*L'^-1 */
+        for (i=0;i<k;i++) G[i+j*k]=F[i+j*k];
+        for (l=0;l<j;l++) {
+            if ((a=L[j+l*m])==0.0) continue;
+            for (i=0;i<k;i++) G[i+j*k]-=G[i+l*k]*a;
+        }
+        for (i=0;i<k;i++) G[i+j*k]/=L[j+j*m];
+    }
+    if (mode==INNOV_ADAPT) {
+        for (i=0;i<m;i++) trc+=0.5*SQR(v[i]);
+        for (i=0;i<k;i++) {
+            if (!inn->qd) break;
+            for (s=0.0,j=0;j<m;j++) s+=SQR(H_[i+j*k]);
+            trq+=inn->qd[ix[i]]*s;
+        }
+        if (trm>0.0&&(s=(trc-trq-trr)/trm)>1.0) lam=s;
+        inn->lam=lam;
+    }
+    for (i=0;i<m;i++) {
+        if      (mode==INNOV_ROBUST) d[i]=arc_igg3(e[i],inn->k0,inn->k1);
+        else if (mode==INNOV_ADAPT ) d[i]=lam;
+        else d[i]=1.0;
+    }
+    for (i=0;i<m;i++) {                         /* w=L^-1*D*v */
+        for (s=d[i]*v[i],j=0;j<i;j++) s-=L[i+j*m]*w[j];
+        w[i]=s/L[i+i*m];
+    }
+    arc_matmul("NN",k,1,m,1.0,G,w,1.0,x_);      /* xp=x+G*w */
+    arc_matmul("NT",k,k,m,-1.0,G,G,1.0,P_);     /* Pp=P-G*G' */
+    for (i=0;i<k;i++) {
+        x[ix[i]]=x_[i];
+        for (j=0;j<k;j++) P[ix[i]+ix[j]*n]=P_[i+j*k];
+    }
+    if (inn&&inn->e) arc_matcpy(inn->e,e,m,1);
+    if (inn&&inn->d) arc_matcpy(inn->d,d,m,1);
+
+    free(ix); free(x_); free(P_); free(H_); free(F);
+    free(G); free(L); free(e); free(d); free(w);
+    return 0;
+}
 /* smoother --------------------------------------------------------------------
 * combine forward and backward filters by fixed-interval smoother as follows:
 *
@@ -1407,10 +1537,11 @@ extern void time2str(gtime_t t, char *s, int n)
 *          int    n         I   number of decimals
 * return : time string
 * notes  : not reentrant, do not use multiple in a function
+*          the buffer is local to the calling thread
 *-----------------------------------------------------------------------------*/
 extern char *time_str(gtime_t t, int n)
 {
-    static char buff[64];
+    static THREADLOCAL char buff[64];
     time2str(t,buff,n);
     return buff;
 }
@@ -1761,38 +1892,16 @@ static void nut_iau1980(double t, const double *f, double *dpsi, double *deps)
     *dpsi*=1E-4*AS2R; /* 0.1 mas -> rad */
     *deps*=1E-4*AS2R;
 }
-/* eci to ecef transformation matrix -------------------------------------------
-* compute eci to ecef transformation matrix
-* args   : gtime_t tutc     I   time in utc
-*          double *erpv     I   erp values {xp,yp,ut1_utc,lod} (rad,rad,s,s/d)
-*          double *U        O   eci to ecef transformation matrix (3 x 3)
-*          double *gmst     IO  greenwich mean sidereal time (rad)
-*                               (NULL: no output)
-* return : none
-* note   : see ref [3] chap 5
-*          not thread-safe
-*-----------------------------------------------------------------------------*/
-extern void eci2ecef(gtime_t tutc, const double *erpv, double *U, double *gmst)
+/* eci to ecef transformation matrix without cache -------------------------*/
+static void eci2ecef_(gtime_t tutc, const double *erpv, double *U, double *gmst)
 {
     const double ep2000[]={2000,1,1,12,0,0};
-    static gtime_t tutc_;
-    static double U_[9],gmst_;
     gtime_t tgps;
-    double eps,ze,th,z,t,t2,t3,dpsi,deps,gast,f[5];
+    double eps,ze,th,z,t,t2,t3,dpsi,deps,gast,gmst_,f[5];
     double R1[9],R2[9],R3[9],R[9],W[9],N[9],P[9],NP[9];
-    int i;
 
-    arc_log(4, "eci2ecef: tutc=%s\n", time_str(tutc, 3));
-    
-    if (fabs(timediff(tutc,tutc_))<0.01) { /* read cache */
-        for (i=0;i<9;i++) U[i]=U_[i];
-        if (gmst) *gmst=gmst_; 
-        return;
-    }
-    tutc_=tutc;
-    
     /* terrestrial time */
-    tgps=utc2gpst(tutc_);
+    tgps=utc2gpst(tutc);
     t=(timediff(tgps,epoch2time(ep2000))+19.0+32.184)/86400.0/36525.0;
     t2=t*t; t3=t2*t;
     
@@ -1815,7 +1924,7 @@ extern void eci2ecef(gtime_t tutc, const double *erpv, double *U, double *gmst)
     arc_matmul("NN", 3, 3, 3, 1.0, R, R3, 0.0, N); /* N=Rx(-eps)*Rz(-dspi)*Rx(eps) */
     
     /* greenwich aparent sidereal time (rad) */
-    gmst_=utc2gmst(tutc_,erpv[2]);
+    gmst_=utc2gmst(tutc,erpv[2]);
     gast=gmst_+dpsi*cos(eps);
     gast+=(0.00264*sin(f[4])+0.000063*sin(2.0*f[4]))*AS2R;
     
@@ -1824,9 +1933,8 @@ extern void eci2ecef(gtime_t tutc, const double *erpv, double *U, double *gmst)
     arc_matmul("NN", 3, 3, 3, 1.0, R1, R2, 0.0, W);
     arc_matmul("NN", 3, 3, 3, 1.0, W, R3, 0.0, R); /* W=Ry(-xp)*Rx(-yp) */
     arc_matmul("NN", 3, 3, 3, 1.0, N, P, 0.0, NP);
-    arc_matmul("NN", 3, 3, 3, 1.0, R, NP, 0.0, U_); /* U=W*Rz(gast)*N*P */
+    arc_matmul("NN", 3, 3, 3, 1.0, R, NP, 0.0, U); /* U=W*Rz(gast)*N*P */
     
-    for (i=0;i<9;i++) U[i]=U_[i];
     if (gmst) *gmst=gmst_;
 
     arc_log(5, "gmst=%.12f gast=%.12f\n", gmst_, gast);
@@ -1839,6 +1947,36 @@ extern void eci2ecef(gtime_t tutc, const double *erpv, double *U, double *gmst)
     arc_log(5, "U=\n");
     arc_tracemat(5, U, 3, 3, 15, 12);
 }
+/* eci to ecef transformation matrix -------------------------------------------
+* compute eci to ecef transformation matrix
+* args   : gtime_t tutc     I   time in utc
+*          double *erpv     I   erp values {xp,yp,ut1_utc,lod} (rad,rad,s,s/d)
+*          double *U        O   eci to ecef transformation matrix (3 x 3)
+*          double *gmst     IO  greenwich mean sidereal time (rad)
+*                               (NULL: no output)
+* return : none
+* note   : see ref [3] chap 5
+*          not thread-safe
+*-----------------------------------------------------------------------------*/
+extern void eci2ecef(gtime_t tutc, const double *erpv, double *U, double *gmst)
+{
+    static gtime_t tutc_;
+    static double U_[9],gmst_;
+    int i;
+
+    arc_log(4, "eci2ecef: tutc=%s\n", time_str(tutc, 3));
+    
+    if (fabs(timediff(tutc,tutc_))<0.01) { /* read cache */
+        for (i=0;i<9;i++) U[i]=U_[i];
+        if (gmst) *gmst=gmst_; 
+        return;
+    }
+    tutc_=tutc;
+    eci2ecef_(tutc,erpv,U_,&gmst_);
+    
+    for (i=0;i<9;i++) U[i]=U_[i];
+    if (gmst) *gmst=gmst_;
+}
 /* decode antenna parameter field --------------------------------------------*/
 static int arc_decodef(char *p, int n, double *v)
 {
@@ -1981,6 +2119,64 @@ static int readantex(const char *file, pcvs_t *pcvs)
     
     return 1;
 }
+/* hash of antenna type without radome --------------------------------------*/
+static unsigned int arc_hashpcv(const char *type)
+{
+    unsigned int h=5381;
+
+    for (;*type==' ';type++) ;
+    for (;*type&&*type!=' ';type++) h=h*33+(unsigned char)*type;
+    return h;
+}
+/* compare antenna type without radome ---------------------------------------*/
+static int arc_cmppcv(const char *type1, const char *type2)
+{
+    for (;*type1==' ';type1++) ;
+    for (;*type2==' ';type2++) ;
+    for (;*type1&&*type1!=' ';type1++,type2++) if (*type1!=*type2) return 1;
+    return *type2&&*type2!=' ';
+}
+/* build hash index of antenna parameters ------------------------------------*/
+static int arc_indexpcv(pcvs_t *pcvs)
+{
+    int i,j,*last;
+
+    free(pcvs->htype); free(pcvs->hsat); free(pcvs->next);
+    pcvs->htype=pcvs->hsat=pcvs->next=NULL; pcvs->nh=0;
+
+    for (pcvs->nh=16;pcvs->nh<2*pcvs->n;pcvs->nh*=2) ;
+
+    if (!(pcvs->htype=(int *)malloc(sizeof(int)*pcvs->nh))||
+        !(pcvs->hsat=(int *)malloc(sizeof(int)*MAXSAT))||
+        !(pcvs->next=(int *)malloc(sizeof(int)*(pcvs->n+1)))||
+        !(last=(int *)malloc(sizeof(int)*(pcvs->nh+MAXSAT)))) {
+        arc_log(ARC_WARNING,"indexpcv: memory allocation error\n");
+        free(pcvs->htype); free(pcvs->hsat); free(pcvs->next);
+        pcvs->htype=pcvs->hsat=pcvs->next=NULL; pcvs->nh=0;
+        return 0;
+    }
+    for (i=0;i<pcvs->nh;i++) pcvs->htype[i]=-1;
+    for (i=0;i<MAXSAT ;i++) pcvs->hsat [i]=-1;
+    for (i=0;i<pcvs->nh+MAXSAT;i++) last[i]=-1;
+
+    /* chains keep the order of data in file */
+    for (i=0;i<pcvs->n;i++) {
+        pcvs->next[i]=-1;
+        if (pcvs->pcv[i].sat>0&&pcvs->pcv[i].sat<=MAXSAT) {
+            j=pcvs->nh+pcvs->pcv[i].sat-1;
+            if (last[j]<0) pcvs->hsat[pcvs->pcv[i].sat-1]=i;
+        }
+        else if (!pcvs->pcv[i].sat) {
+            j=(int)(arc_hashpcv(pcvs->pcv[i].type)&(pcvs->nh-1));
+            if (last[j]<0) pcvs->htype[j]=i;
+        }
+        else continue;
+        if (last[j]>=0) pcvs->next[last[j]]=i;
+        last[j]=i;
+    }
+    free(last);
+    return 1;
+}
 /* read antenna parameters ------------------------------------------------------
 * read antenna parameters
 * args   : char   *file       I   antenna parameter file (antex)
@@ -1990,6 +2186,8 @@ static int readantex(const char *file, pcvs_t *pcvs)
 *          file except for antex is recognized ngs antenna parameters
 *          see reference [3]
 *          only support non-azimuth-depedent parameters
+*          hash index of antenna types and satellites is built for
+*          arc_searchpcv(). free parameters by arc_freepcv()
 *-----------------------------------------------------------------------------*/
 extern int arc_readpcv(const char *file, pcvs_t *pcvs)
 {
@@ -2014,8 +2212,20 @@ extern int arc_readpcv(const char *file, pcvs_t *pcvs)
                 pcv->sat, pcv->type, pcv->code, pcv->off[0][0], pcv->off[0][1],
                 pcv->off[0][2], pcv->off[1][0], pcv->off[1][1], pcv->off[1][2]);
     }
+    arc_indexpcv(pcvs);
     return stat;
 }
+/* free antenna parameters -----------------------------------------------------
+* free antenna parameters and hash index
+* args   : pcvs_t *pcvs       IO  antenna parameters
+* return : none
+*-----------------------------------------------------------------------------*/
+extern void arc_freepcv(pcvs_t *pcvs)
+{
+    free(pcvs->pcv); pcvs->pcv=NULL; pcvs->n=pcvs->nmax=0;
+    free(pcvs->htype); free(pcvs->hsat); free(pcvs->next);
+    pcvs->htype=pcvs->hsat=pcvs->next=NULL; pcvs->nh=0;
+}
 /* search antenna parameter ----------------------------------------------------
 * read satellite antenna phase center position
 * args   : int    sat         I   satellite number (0: receiver antenna)
@@ -2023,16 +2233,28 @@ extern int arc_readpcv(const char *file, pcvs_t *pcvs)
 *          gtime_t time       I   time to search parameters
 *          pcvs_t *pcvs       IO  antenna parameters
 * return : antenna parameter (NULL: no antenna)
+* notes  : with hash index, receiver antenna of same type without radome is
+*          searched at first, then all receiver antennas as substring
 *-----------------------------------------------------------------------------*/
 extern pcv_t *arc_searchpcv(int sat, const char *type, gtime_t time,
                             const pcvs_t *pcvs)
 {
     pcv_t *pcv;
     char buff[MAXANT],*types[2],*p;
-    int i,j,n=0;
+    int i,j,k,n=0;
 
     arc_log(ARC_INFO, "searchpcv: sat=%2d type=%s\n", sat, type);
     
+    if (sat&&pcvs->hsat) { /* search satellite antenna by index */
+        if (sat<=0||MAXSAT<sat) return NULL;
+        for (i=pcvs->hsat[sat-1];i>=0;i=pcvs->next[i]) {
+            pcv=pcvs->pcv+i;
+            if (pcv->ts.time!=0&&timediff(pcv->ts,time)>0.0) continue;
+            if (pcv->te.time!=0&&timediff(pcv->te,time)<0.0) continue;
+            return pcv;
+        }
+        return NULL;
+    }
     if (sat) { /* search satellite antenna */
         for (i=0;i<pcvs->n;i++) {
             pcv=pcvs->pcv+i;
@@ -2047,6 +2269,23 @@ extern pcv_t *arc_searchpcv(int sat, const char *type, gtime_t time,
         for (p=strtok(buff," ");p&&n<2;p=strtok(NULL," ")) types[n++]=p;
         if (n<=0) return NULL;
         
+        /* search receiver antenna of same type by index */
+        if (pcvs->htype) {
+            k=(int)(arc_hashpcv(types[0])&(pcvs->nh-1));
+            for (i=pcvs->htype[k];i>=0;i=pcvs->next[i]) {
+                pcv=pcvs->pcv+i;
+                if (arc_cmppcv(types[0],pcv->type)) continue;
+                for (j=1;j<n;j++) if (!strstr(pcv->type,types[j])) break;
+                if (j>=n) return pcv;
+            }
+            for (i=pcvs->htype[k];i>=0;i=pcvs->next[i]) {
+                pcv=pcvs->pcv+i;
+                if (arc_cmppcv(types[0],pcv->type)) continue;
+
+                arc_log(2, "pcv without radome is used type=%s\n", type);
+                return pcv;
+            }
+        }
         /* search receiver antenna with radome at first */
         for (i=0;i<pcvs->n;i++) {
             pcv=pcvs->pcv+i;
@@ -3311,6 +3550,56 @@ extern void arc_antmodel(const pcv_t *pcv, const double *del, const double *azel
     }
     arc_log(ARC_INFO, "antmodel: dant=%6.3f %6.3f\n",dant[0],dant[1]);
 }
+/* set receiver antenna pcv table ---------------------------------------------
+* set phase center offset plus antenna delta and differences of variation
+* args   : pcvt_t *pcvt     O   receiver antenna pcv table
+*          pcv_t  *pcv      I   antenna phase center parameters
+*          double *del      I   antenna delta e/n/u (m)
+* return : none
+*-----------------------------------------------------------------------------*/
+extern void arc_pcvt_init(pcvt_t *pcvt, const pcv_t *pcv, const double *del)
+{
+    int i,j;
+
+    for (i=0;i<NFREQ;i++) {
+        for (j=0;j<3;j++) pcvt->off[i][j]=pcv->off[i][j]+del[j];
+        for (j=0;j<19;j++) {
+            pcvt->var [i][j]=pcv->var[i][j];
+            pcvt->dvar[i][j]=j<18?pcv->var[i][j+1]-pcv->var[i][j]:0.0;
+        }
+    }
+    pcvt->stat=1;
+}
+/* receiver antenna model by pcv table -----------------------------------------
+* compute antenna offset by receiver antenna pcv table
+* args   : pcvt_t *pcvt     I   receiver antenna pcv table
+*          double *azel     I   azimuth/elevation for receiver {az,el} (rad)
+*          int     opt      I   option (0:only offset,1:offset+pcv)
+*          double *dant     O   range offsets for each frequency (m)
+* return : none
+* notes  : same as arc_antmodel() with interpolation index and weight shared
+*          by all frequencies
+*-----------------------------------------------------------------------------*/
+extern void arc_antmodel_t(const pcvt_t *pcvt, const double *azel, int opt,
+                           double *dant)
+{
+    double e[3],cosel=cos(azel[1]),a=0.0;
+    int i,k=0;
+
+    e[0]=sin(azel[0])*cosel;
+    e[1]=cos(azel[0])*cosel;
+    e[2]=sin(azel[1]);
+
+    if (opt) {
+        a=(90.0-azel[1]*R2D)/5.0;
+        if (a<0.0) a=0.0; else if (a>=18.0) a=18.0;
+        k=(int)a; a-=k;
+    }
+    for (i=0;i<NFREQ;i++) {
+        dant[i]=-(pcvt->off[i][0]*e[0]+pcvt->off[i][1]*e[1]+pcvt->off[i][2]*e[2]);
+        if (opt) dant[i]+=pcvt->var[i][k]+pcvt->dvar[i][k]*a;
+    }
+}
 /* satellite antenna model ------------------------------------------------------
 * compute satellite antenna phase center parameters
 * args   : pcv_t *pcv       I   antenna phase center parameters
@@ -3397,14 +3686,98 @@ extern void arc_sunmoonpos(gtime_t tutc, const double *erpv, double *rsun,
     /* sun and moon position in eci */
     sunmoonpos_eci(tut,rsun?rs:NULL,rmoon?rm:NULL);
     
-    /* eci to ecef transformation matrix */
-    eci2ecef(tutc,erpv,U,&gmst_);
+    /* eci to ecef transformation matrix (no shared cache for threads) */
+    eci2ecef_(tutc,erpv,U,&gmst_);
     
     /* sun and moon postion in ecef */
     if (rsun ) arc_matmul("NN", 3, 1, 3, 1.0, U, rs, 0.0, rsun);
     if (rmoon) arc_matmul("NN", 3, 1, 3, 1.0, U, rm, 0.0, rmoon);
     if (gmst ) *gmst=gmst_;
 }
+/* sun and moon position at geophysical context knot ------------------------*/
+static void arc_geoctx_knot(gtime_t tutc, const erp_t *erp, double *rsun,
+                            double *rmoon)
+{
+    double rs[3],rm[3],U[9],erpv[5]={0};
+
+    if (erp) geterp(erp,utc2gpst(tutc),erpv);
+
+    sunmoonpos_eci(timeadd(tutc,erpv[2]),rs,rm);
+    eci2ecef_(tutc,erpv,U,NULL);
+    arc_matmul("NN", 3, 1, 3, 1.0, U, rs, 0.0, rsun);
+    arc_matmul("NN", 3, 1, 3, 1.0, U, rm, 0.0, rmoon);
+}
+/* interpolate sun and moon position of geophysical context ------------------*/
+static void arc_geoctx_interp(const geoctx_t *ctx, gtime_t tutc, double *rsun,
+                              double *rmoon)
+{
+    double s=timediff(tutc,ctx->tk)/GEOCTX_DT,w[3];
+    int i;
+
+    w[0]=0.5*s*(s-1.0); w[1]=1.0-s*s; w[2]=0.5*s*(s+1.0);
+
+    for (i=0;i<3;i++) {
+        if (rsun ) rsun [i]=w[0]*ctx->ksun [i]+w[1]*ctx->ksun [3+i]+w[2]*ctx->ksun [6+i];
+        if (rmoon) rmoon[i]=w[0]*ctx->kmoon[i]+w[1]*ctx->kmoon[3+i]+w[2]*ctx->kmoon[6+i];
+    }
+}
+/* update geophysical context --------------------------------------------------
+* update erp values, sun/moon position and gmst of an epoch in geophysical
+* context, which is shared by tide, phase windup and eclipse models
+* args   : geoctx_t *ctx    IO  geophysical context ({0}: initial)
+*          gtime_t  tutc    I   time in utc
+*          erp_t    *erp    I   earth rotation parameters (NULL: not used)
+* return : none
+* notes  : sun/moon position are interpolated by 2nd-order polynomial from
+*          knots at tk-dt,tk,tk+dt (tk: nearest GEOCTX_DT boundary), knots
+*          are shifted for next boundaries so precession/nutation is evaluated
+*          once per GEOCTX_DT for continuous data
+*          error of interpolated sun/moon position is about 1 km/3 m
+*          (direction error < 1E-8 rad)
+*          eci to ecef transformation is not cached so context is thread-safe
+*-----------------------------------------------------------------------------*/
+extern void arc_geoctx_update(geoctx_t *ctx, gtime_t tutc, const erp_t *erp)
+{
+    gtime_t tk;
+    double ksun[9],kmoon[9];
+    int i,j,k,n;
+
+    if (ctx->time.time&&timediff(tutc,ctx->time)==0.0) return;
+
+    arc_log(ARC_INFO, "geoctx_update: tutc=%s\n", time_str(tutc, 3));
+
+    /* center knot at nearest boundary */
+    tk.time=(time_t)(floor((tutc.time+tutc.sec)/GEOCTX_DT+0.5)*GEOCTX_DT);
+    tk.sec=0.0;
+
+    if (!ctx->tk.time||timediff(tk,ctx->tk)!=0.0) {
+        n=ctx->tk.time?(int)floor(timediff(tk,ctx->tk)/GEOCTX_DT+0.5):3;
+
+        for (k=0;k<3;k++) {
+            j=k+n; /* index of knot in old knots */
+            if (0<=j&&j<3) {
+                for (i=0;i<3;i++) {
+                    ksun[i+k*3]=ctx->ksun[i+j*3]; kmoon[i+k*3]=ctx->kmoon[i+j*3];
+                }
+            }
+            else {
+                arc_geoctx_knot(timeadd(tk,(k-1)*GEOCTX_DT),erp,ksun+k*3,
+                                kmoon+k*3);
+            }
+        }
+        for (i=0;i<9;i++) {
+            ctx->ksun[i]=ksun[i]; ctx->kmoon[i]=kmoon[i];
+        }
+        ctx->tk=tk;
+    }
+    ctx->time=tutc;
+    ctx->erp=erp?1:0;
+    for (i=0;i<5;i++) ctx->erpv[i]=0.0;
+    if (erp) geterp(erp,utc2gpst(tutc),ctx->erpv);
+
+    arc_geoctx_interp(ctx,tutc,ctx->rsun,ctx->rmoon);
+    ctx->gmst=utc2gmst(tutc,ctx->erpv[2]);
+}
 /* carrier smoothing -----------------------------------------------------------
 * carrier smoothing by Hatch filter
 * args   : obs_t  *obs      IO  raw observation data/smoothed observation data
@@ -3602,48 +3975,20 @@ static void arc_tide_pole(gtime_t tut, const double *pos, const double *erpv,
 
     arc_log(ARC_INFO, "tide_pole : denu=%.3f %.3f %.3f\n", denu[0], denu[1], denu[2]);
 }
-/* tidal displacement ----------------------------------------------------------
-* displacements by earth tides
-* args   : gtime_t tutc     I   time in utc
-*          double *rr       I   site position (ecef) (m)
-*          int    opt       I   options (or of the followings)
-*                                 1: solid earth tide
-*                                 2: ocean tide loading
-*                                 4: pole tide
-*                                 8: elimate permanent deformation
-*          double *erp      I   earth rotation parameters (NULL: not used)
-*          double *odisp    I   ocean loading parameters  (NULL: not used)
-*                                 odisp[0+i*6]: consituent i amplitude radial(m)
-*                                 odisp[1+i*6]: consituent i amplitude west  (m)
-*                                 odisp[2+i*6]: consituent i amplitude south (m)
-*                                 odisp[3+i*6]: consituent i phase radial  (deg)
-*                                 odisp[4+i*6]: consituent i phase west    (deg)
-*                                 odisp[5+i*6]: consituent i phase south   (deg)
-*                                (i=0:M2,1:S2,2:N2,3:K2,4:K1,5:O1,6:P1,7:Q1,
-*                                   8:Mf,9:Mm,10:Ssa)
-*          double *dr       O   displacement by earth tides (ecef) (m)
-* return : none
-* notes  : see ref [1], [2] chap 7
-*          see ref [4] 5.2.1, 5.2.2, 5.2.3
-*          ver.2.4.0 does not use ocean loading and pole tide corrections
-*-----------------------------------------------------------------------------*/
-extern void arc_tidedisp(gtime_t tutc, const double *rr, int opt, const erp_t *erp,
-                         const double *odisp, double *dr)
+/* tidal displacement by sun/moon position ----------------------------------*/
+static void arc_tidedisp_(gtime_t tutc, const double *rr, int opt,
+                          const double *erpv, const double *rs, const double *rm,
+                          double gmst, const double *odisp, double *dr)
 {
     gtime_t tut;
-    double pos[2],E[9],drt[3],denu[3],rs[3],rm[3],gmst,erpv[5]={0};
+    double pos[2],E[9],drt[3],denu[3];
     int i;
 #ifdef IERS_MODEL
     double ep[6],fhr;
     int year,mon,day;
 #endif
 
-    arc_log(ARC_INFO, "tidedisp: tutc=%s\n", time_str(tutc, 0));
-    
-    if (erp) {
-        geterp(erp,utc2gpst(tutc),erpv);
-    }
-    tut=timeadd(tutc,erpv[2]);
+    tut=timeadd(tutc,erpv?erpv[2]:0.0);
     
     dr[0]=dr[1]=dr[2]=0.0;
     
@@ -3655,9 +4000,6 @@ extern void arc_tidedisp(gtime_t tutc, const double *rr, int opt, const erp_t *e
     
     if (opt&1) { /* solid earth tides */
         
-        /* sun and moon position in ecef */
-        arc_sunmoonpos(tutc, erpv, rs, rm, &gmst);
-        
 #ifdef IERS_MODEL
         time2epoch(tutc,ep);
         year=(int)ep[0];
@@ -3666,7 +4008,7 @@ extern void arc_tidedisp(gtime_t tutc, const double *rr, int opt, const erp_t *e
         fhr =ep[3]+ep[4]/60.0+ep[5]/3600.0;
         
         /* call DEHANTTIDEINEL */
-        dehanttideinel_((double *)rr,&year,&mon,&day,&fhr,rs,rm,drt);
+        dehanttideinel_((double *)rr,&year,&mon,&day,&fhr,(double *)rs,(double *)rm,drt);
 #else
         arc_tide_solid(rs,rm,pos,E,gmst,opt,drt);
 #endif
@@ -3677,13 +4019,91 @@ extern void arc_tidedisp(gtime_t tutc, const double *rr, int opt, const erp_t *e
         arc_matmul("TN", 3, 1, 3, 1.0, E, denu, 0.0, drt);
         for (i=0;i<3;i++) dr[i]+=drt[i];
     }
-    if ((opt&4)&&erp) { /* pole tide */
+    if ((opt&4)&&erpv) { /* pole tide */
         arc_tide_pole(tut,pos,erpv,denu);
         arc_matmul("TN", 3, 1, 3, 1.0, E, denu, 0.0, drt);
         for (i=0;i<3;i++) dr[i]+=drt[i];
     }
+}
+/* tidal displacement ----------------------------------------------------------
+* displacements by earth tides
+* args   : gtime_t tutc     I   time in utc
+*          double *rr       I   site position (ecef) (m)
+*          int    opt       I   options (or of the followings)
+*                                 1: solid earth tide
+*                                 2: ocean tide loading
+*                                 4: pole tide
+*                                 8: elimate permanent deformation
+*          double *erp      I   earth rotation parameters (NULL: not used)
+*          double *odisp    I   ocean loading parameters  (NULL: not used)
+*                                 odisp[0+i*6]: consituent i amplitude radial(m)
+*                                 odisp[1+i*6]: consituent i amplitude west  (m)
+*                                 odisp[2+i*6]: consituent i amplitude south (m)
+*                                 odisp[3+i*6]: consituent i phase radial  (deg)
+*                                 odisp[4+i*6]: consituent i phase west    (deg)
+*                                 odisp[5+i*6]: consituent i phase south   (deg)
+*                                (i=0:M2,1:S2,2:N2,3:K2,4:K1,5:O1,6:P1,7:Q1,
+*                                   8:Mf,9:Mm,10:Ssa)
+*          double *dr       O   displacement by earth tides (ecef) (m)
+* return : none
+* notes  : see ref [1], [2] chap 7
+*          see ref [4] 5.2.1, 5.2.2, 5.2.3
+*          ver.2.4.0 does not use ocean loading and pole tide corrections
+*-----------------------------------------------------------------------------*/
+extern void arc_tidedisp(gtime_t tutc, const double *rr, int opt, const erp_t *erp,
+                         const double *odisp, double *dr)
+{
+    double rs[3]={0},rm[3]={0},gmst=0.0,erpv[5]={0};
+
+    arc_log(ARC_INFO, "tidedisp: tutc=%s\n", time_str(tutc, 0));
+    
+    if (erp) {
+        geterp(erp,utc2gpst(tutc),erpv);
+    }
+    /* sun and moon position in ecef */
+    if (opt&1) arc_sunmoonpos(tutc, erpv, rs, rm, &gmst);
+
+    arc_tidedisp_(tutc,rr,opt,erp?erpv:NULL,rs,rm,gmst,odisp,dr);
+
     arc_log(ARC_INFO, "tidedisp: dr=%.3f %.3f %.3f\n", dr[0], dr[1], dr[2]);
 }
+/* tidal displacement by geophysical context -----------------------------------
+* displacements by earth tides with erp values and sun/moon position of
+* geophysical context instead of evaluating them again
+* args   : geoctx_t *ctx    I   geophysical context (arc_geoctx_update())
+*          other arguments are same as arc_tidedisp()
+* return : none
+* notes  : sun/moon position are interpolated from context knots if tutc
+*          differs from time of context (evaluated if tutc is out of knots)
+*-----------------------------------------------------------------------------*/
+extern void arc_tidedisp_ctx(const geoctx_t *ctx, gtime_t tutc, const double *rr,
+                             int opt, const double *odisp, double *dr)
+{
+    double rs[3],rm[3],rs0[3],rm0[3],U[9],gmst;
+    int i;
+
+    arc_log(ARC_INFO, "tidedisp_ctx: tutc=%s\n", time_str(tutc, 0));
+
+    if (timediff(tutc,ctx->time)==0.0) {
+        for (i=0;i<3;i++) {
+            rs[i]=ctx->rsun[i]; rm[i]=ctx->rmoon[i];
+        }
+        gmst=ctx->gmst;
+    }
+    else if (fabs(timediff(tutc,ctx->tk))<=1.5*GEOCTX_DT) {
+        arc_geoctx_interp(ctx,tutc,rs,rm);
+        gmst=utc2gmst(tutc,ctx->erpv[2]);
+    }
+    else { /* out of knots */
+        sunmoonpos_eci(timeadd(tutc,ctx->erpv[2]),rs0,rm0);
+        eci2ecef_(tutc,ctx->erpv,U,&gmst);
+        arc_matmul("NN", 3, 1, 3, 1.0, U, rs0, 0.0, rs);
+        arc_matmul("NN", 3, 1, 3, 1.0, U, rm0, 0.0, rm);
+    }
+    arc_tidedisp_(tutc,rr,opt,ctx->erp?ctx->erpv:NULL,rs,rm,gmst,odisp,dr);
+
+    arc_log(ARC_INFO, "tidedisp_ctx: dr=%.3f %.3f %.3f\n", dr[0], dr[1], dr[2]);
+}
 /* get tick time ---------------------------------------------------------------
 * get current tick in ms
 * args   : none
@@ -4241,6 +4661,102 @@ extern double arc_tropmapf_UNSW931(gtime_t time, const double *pos, const double
     if (mapfw) *mapfw=mw;
     return mh;
 }
+/* initialize mapping function table ------------------------------------------
+* tabulate troposphere mapping function on elevation grid of a station
+* args   : mapt_t   *mapt   IO  mapping function table
+*          mapfunc_t func   I   mapping function (arc_tropmapf,arc_tropmapf_???)
+*          gtime_t  time    I   time
+*          double   *pos    I   receiver position {lat,lon,h} (rad,m)
+* return : none
+* notes  : m(el)*sin(el) is tabulated at MAPT_DEL intervals, it is smooth down
+*          to the horizon unlike m(el). latitude, height and day-of-year terms
+*          of the function are evaluated only here. 1st and 2nd height
+*          derivatives are tabulated by central differences over MAPT_HSTEP
+*          (the height terms of NMF and GMF are linear in height).
+*-----------------------------------------------------------------------------*/
+extern void arc_mapt_init(mapt_t *mapt, mapfunc_t func, gtime_t time,
+                          const double *pos)
+{
+    double azel[2]={0},posh[3],mh[3],mw[3],sinel;
+    int i,j;
+
+    arc_log(ARC_INFO, "mapt_init: time=%s pos=%10.6f %11.6f %6.1f\n",
+            time_str(time,0),pos[0]*R2D,pos[1]*R2D,pos[2]);
+
+    mapt->func=func;
+    mapt->time=time;
+    for (i=0;i<3;i++) mapt->pos[i]=posh[i]=pos[i];
+
+    for (i=0;i<MAXMAPT;i++) {
+        azel[1]=i*MAPT_DEL*D2R;
+        if (i==0) {
+            mapt->gh[i]=mapt->gw[i]=0.0;
+            mapt->dh[i][0]=mapt->dh[i][1]=mapt->dw[i][0]=mapt->dw[i][1]=0.0;
+            continue;
+        }
+        sinel=i==MAXMAPT-1?1.0:sin(azel[1]);
+        for (j=0;j<3;j++) { /* h-MAPT_HSTEP,h,h+MAPT_HSTEP */
+            posh[2]=pos[2]+(j-1)*MAPT_HSTEP;
+            mh[j]=func(time,posh,azel,mw+j)*sinel; mw[j]*=sinel;
+        }
+        mapt->gh[i]=mh[1];
+        mapt->gw[i]=mw[1];
+        mapt->dh[i][0]=(mh[2]-mh[0])/(2.0*MAPT_HSTEP);
+        mapt->dw[i][0]=(mw[2]-mw[0])/(2.0*MAPT_HSTEP);
+        mapt->dh[i][1]=(mh[2]-2.0*mh[1]+mh[0])/SQR(MAPT_HSTEP);
+        mapt->dw[i][1]=(mw[2]-2.0*mw[1]+mw[0])/SQR(MAPT_HSTEP);
+    }
+}
+/* troposphere mapping function by table ---------------------------------------
+* compute troposphere mapping function by cubic interpolation of table
+* args   : mapt_t   *mapt   IO  mapping function table (func set)
+*          gtime_t  time    I   time
+*          double   *pos    I   receiver position {lat,lon,h} (rad,m)
+*          double   *azel   I   azimuth/elevation angle {az,el} (rad)
+*          double   *mapfw  IO  wet mapping function (NULL: not output)
+* return : dry mapping function
+* notes  : table is built again if time or position moves out of MAPT_TTOL,
+*          MAPT_PTOL or MAPT_HTOL, heights within MAPT_HTOL are corrected by
+*          the tabulated height derivatives. mapt->func is evaluated directly
+*          below MAPT_ELMIN.
+*          with MAXMAPT=361 the interpolation error of arc_tropmapf and
+*          arc_tropmapf_??? is below 7E-6 above 5 deg elevation (0.02 mm of
+*          slant delay for 2.3 m zenith delay), below 0.03 mm including the
+*          table tolerances. a moving receiver rebuilds the table about every
+*          km of horizontal or 50 m of vertical motion.
+*-----------------------------------------------------------------------------*/
+extern double arc_mapt(mapt_t *mapt, gtime_t time, const double *pos,
+                       const double *azel, double *mapfw)
+{
+    double el=azel[1],a,t,w[4],gh=0.0,gw=0.0,dh,sinel;
+    int i,j;
+
+    if (el<MAPT_ELMIN) return mapt->func(time,pos,azel,mapfw);
+
+    if (!mapt->time.time||fabs(timediff(time,mapt->time))>MAPT_TTOL||
+        fabs(pos[0]-mapt->pos[0])>MAPT_PTOL||fabs(pos[1]-mapt->pos[1])>MAPT_PTOL||
+        fabs(pos[2]-mapt->pos[2])>MAPT_HTOL) {
+        arc_mapt_init(mapt,mapt->func,time,pos);
+    }
+    /* 4-point lagrange interpolation at el between grid i and i+1 */
+    a=el*R2D/MAPT_DEL;
+    i=(int)a;
+    if (i<1) i=1; else if (i>MAXMAPT-3) i=MAXMAPT-3;
+    t=a-i;
+    w[0]=-t*(t-1.0)*(t-2.0)/6.0;
+    w[1]=(t+1.0)*(t-1.0)*(t-2.0)/2.0;
+    w[2]=-(t+1.0)*t*(t-2.0)/2.0;
+    w[3]=(t+1.0)*t*(t-1.0)/6.0;
+
+    dh=pos[2]-mapt->pos[2];
+    for (j=0;j<4;j++) {
+        gh+=w[j]*(mapt->gh[i-1+j]+(mapt->dh[i-1+j][0]+mapt->dh[i-1+j][1]*dh/2.0)*dh);
+        gw+=w[j]*(mapt->gw[i-1+j]+(mapt->dw[i-1+j][0]+mapt->dw[i-1+j][1]*dh/2.0)*dh);
+    }
+    sinel=sin(el);
+    if (mapfw) *mapfw=gw/sinel;
+    return gh/sinel;
+}
 /* complementaty error function (ref [1] p.227-229) --------------------------*/
 static double arc_q_gamma(double a, double x, double log_gamma_a);
 static double arc_p_gamma(double a, double x, double log_gamma_a)
@@ -4656,7 +5172,7 @@ extern double sbstropcorr(gtime_t time, const double *pos, const double *azel,
                           double *var,double *zwd)
 {
     const double k1=77.604,k2=382000.0,rd=287.054,gm=9.784,g=9.80665;
-    static double pos_[3]={0},zh=0.0,zw=0.0;
+    static THREADLOCAL double pos_[3]={0},zh=0.0,zw=0.0; /* cache of calling thread */
     int i;
     double c,met[10],sinel=sin(azel[1]),h=pos[2],m;
 
@@ -3,6 +3,7 @@
 
 /* constants/macros ----------------------------------------------------------*/
 #define LOOPMAX     10000           /* maximum count of search loop */
+#define LOOPCHK     63              /* deadline check interval of search loop (mask) */
 
 #define SGN(x)      ((x)<=0.0?-1.0:1.0)
 #define ROUND(x)    (floor((x)+0.5))
@@ -11,6 +12,9 @@
 #define MAX(x,y)    ((x)>(y)?(x):(y))
 #define MIN(x,y)    ((x)<=(y)?(x):(y))
 
+static THREADLOCAL unsigned int nodes=0; /* search nodes of calling thread */
+static THREADLOCAL double deadline=0.0;  /* search deadline of calling thread (s) */
+
 /* LD factorization (Q=L'*diag(D)*L) -----------------------------------------*/
 static int LD(int n, const double *Q, double *L, double *D)
 {
@@ -80,7 +84,7 @@ static void reduction(int n, double *L, double *D, double *Z)
 static int search(int n, int m, const double *L, const double *D,
                   const double *zs, double *zn, double *s)
 {
-    int i,j,k,c,nn=0,imax=0;
+    int i,j,k,c,nn=0,imax=0,stop=0;
     double newdist,maxdist=1E99,y;
     double *S=arc_zeros(n,n),*dist=arc_mat(n,1),
             *zb=arc_mat(n,1),*z=arc_mat(n,1),*step=arc_mat(n,1);
@@ -89,6 +93,9 @@ static int search(int n, int m, const double *L, const double *D,
     zb[k]=zs[k];
     z[k]=ROUND(zb[k]); y=zb[k]-z[k]; step[k]=SGN(y);
     for (c=0;c<LOOPMAX;c++) {
+        if (deadline>0.0&&!(c&LOOPCHK)&&arc_prof_tic()>=deadline) {
+            stop=1; break; /* out of time budget */
+        }
         newdist=dist[k]+y*y/D[k];
         if (newdist<maxdist) {
             if (k!=0) {
@@ -131,7 +138,12 @@ static int search(int n, int m, const double *L, const double *D,
         }
     }
     free(S); free(dist); free(zb); free(z); free(step);
+    nodes+=(unsigned int)c;
 
+    if (stop) {
+        arc_log(ARC_WARNING,"search : deadline exceeded (nodes=%d)\n",c);
+        return LAMBDA_TIMEOUT;
+    }
     if (c>=LOOPMAX) {
         fprintf(stderr,"%s : search loop count overflow\n",__FILE__);
         return -1;
@@ -247,6 +259,30 @@ extern int lambda_search(int n, int m, const double *a, const double *Q,
     free(L); free(D);
     return info;
 }
+/* mlambda search deadline ----------------------------------------------------
+* set deadline of mlambda searches of the calling thread. a search running at
+* the deadline is stopped and returns LAMBDA_TIMEOUT
+* args   : double tick   I  deadline by arc_prof_tic() (s) (0:no deadline)
+* return : previous deadline (s) (0:no deadline)
+*-----------------------------------------------------------------------------*/
+extern double arc_lambda_deadline(double tick)
+{
+    double prev=deadline;
+    deadline=tick;
+    return prev;
+}
+/* mlambda search nodes --------------------------------------------------------
+* nodes visited by mlambda searches of the calling thread
+* args   : int    reset  I  reset counter after read (0:no,1:yes)
+* return : number of search nodes
+*-----------------------------------------------------------------------------*/
+extern unsigned int arc_lambda_nodes(int reset)
+{
+    unsigned int n=nodes;
+
+    if (reset) nodes=0;
+    return n;
+}
 static int arc_exctract_L(const double *L,int k,double *LL,int m,int n)
 {
     int i,j;
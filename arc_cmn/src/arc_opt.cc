@@ -16,13 +16,13 @@ static char exsats_[1024];
 #define SWTOPT  "0:off,1:on"
 #define MODOPT  "0:single,1:dgps,2:kinematic,3:static,4:movingbase,5:fixed,6:ppp-kine,7:ppp-static"
 #define FRQOPT  "1:l1,2:l1+l2,3:l1+l2+l5,4:l1+l2+l5+l6,5:l1+l2+l5+l6+l7"
-#define TYPOPT  "0:forward,1:backward,2:combined"
+#define TYPOPT  "0:forward,1:backward,2:combined,3:fixed-lag"
 #define IONOPT  "0:off,1:brdc,2:sbas,3:dual-freq,4:est-stec,5:ionex-tec,6:qzs-brdc,7:qzs-lex,8:vtec_sf,9:vtec_ef,10:gtec"
 #define TRPOPT  "0:off,1:saas,2:sbas,3:est-ztd,4:est-ztdgrad"
 #define EPHOPT  "0:brdc,1:precise,2:brdc+sbas,3:brdc+ssrapc,4:brdc+ssrcom"
 #define NAVOPT  "1:gps+2:sbas+4:glo+8:gal+16:qzs+32:comp"
 #define GAROPT  "0:off,1:on,2:autocal"
-#define SOLOPT  "0:llh,1:xyz,2:enu,3:nmea"
+#define SOLOPT  "0:llh,1:xyz,2:enu,3:nmea,6:binary"
 #define TSYOPT  "0:gpst,1:utc,2:jst"
 #define TFTOPT  "0:tow,1:hms"
 #define DFTOPT  "0:deg,1:dms"
@@ -79,6 +79,7 @@ opt_t sysopts[]={
         {"out-nmeaintv1",   1,  (void *)&solopt_.nmeaintv[0],"s"    },
         {"out-nmeaintv2",   1,  (void *)&solopt_.nmeaintv[1],"s"    },
         {"out-outstat",     0,  (void *)&solopt_.sstat,      STSOPT },
+        {"out-statformat",  3,  (void *)&solopt_.sstatf,     "0:text,1:binary"},
 
         {"stats-eratio1",   1,  (void *)&prcopt_.eratio[0],  ""     },
         {"stats-eratio2",   1,  (void *)&prcopt_.eratio[1],  ""     },
@@ -179,6 +180,25 @@ opt_t sysopts[]={
         {"lambda-difference-test",        1, (void *)&prcopt_.lambda_diff, ""},
         {"lambda-project-thres",          1, (void *)&prcopt_.lambda_project_thres, ""},
         {"phase-windup-model",            0, (void *)&prcopt_.posopt[2],""},
+        {"amb-fix-mode",                  0, (void *)&prcopt_.amb_fix_mode,"1:lambda,2:boots,3:ffratio,4:part,5:ensemble"},
+        {"amb-ensemble-threads",          0, (void *)&prcopt_.amb_ens_nthread,""},
+        {"amb-ensemble-budget",           1, (void *)&prcopt_.amb_ens_budget,"ms"},
+        {"amb-ensemble-cands",            0, (void *)&prcopt_.amb_ens_cand,"1:lambda,2:inherit,4:group,8:boots"},
+        {"amb-budget",                    1, (void *)&prcopt_.amb_budget,"ms"},
+        {"amb-budget-ps",                 1, (void *)&prcopt_.amb_bootps,""},
+        {"ukf-threads",                   0, (void *)&prcopt_.ukf_nthread,""},
+        {"ceres",                         0, (void *)&prcopt_.ceres,"0:off,1:on"},
+        {"ceres-windows",                 0, (void *)&prcopt_.ceres_windows,""},
+        {"ceres-prior",                   0, (void *)&prcopt_.ceres_prior,"0:off,1:on"},
+        {"static-neq",                    0, (void *)&prcopt_.neq_static,"0:off,1:on"},
+        {"static-neq-interval",           1, (void *)&prcopt_.neq_ckpt,"s"},
+        {"static-neq-threads",            0, (void *)&prcopt_.neq_nthread,""},
+        {"trop-mapf-table",               0, (void *)&prcopt_.tropmapt,"0:off,1:on"},
+        {"glo-orbit-dense",               0, (void *)&prcopt_.glodense,"0:off,1:on"},
+        {"spp-threads",                   0, (void *)&prcopt_.spp_nthread,""},
+        {"smoother-lag",                  1, (void *)&prcopt_.fls_lag,"s"},
+        {"pipeline",                      0, (void *)&prcopt_.pipeline,"0:off,1:on"},
+        {"pf-threads",                    0, (void *)&prcopt_.pf_nthread,""},
         {"inherit-impact-factor",         1, (void *)&prcopt_.inherit_IF,""},
 
         {"",0,NULL,""} /* terminator */
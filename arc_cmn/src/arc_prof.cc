@@ -0,0 +1,296 @@
+/*********************************************************************************
+ *  ARC-SRTK - Single Frequency RTK Pisitioning Library
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************************/
+
+/**
+ * @file arc_prof.cc
+ * @brief per-stage latency profiler of rtk positioning
+ *
+ * stage times of arc_srtkpos are accumulated per epoch and aggregated into
+ * log-linear histograms of nanoseconds (16 sub-bins per power of two, the
+ * relative error of a quantile is less than 1/16). per-epoch counters of
+ * satellites, states, ambiguities and lambda search nodes use the same
+ * histograms of raw counts. the slowest epochs are kept with their stage
+ * times and counters to correlate latency with the satellite geometry.
+ *
+ * the profiler of rtk control is allocated only if the library is built
+ * with ARC_PROF defined, otherwise the stage timers PROF_SCOPE and
+ * PROF_TIC/PROF_TOC are compiled out and all functions of a NULL profiler
+ * are no operation.
+ */
+#include "arc.h"
+#ifndef WIN32
+#include <time.h>
+#endif
+
+#define PROFNLIN    32              /* values of linear bins */
+#define PROFNSUB    16              /* sub-bins of power of two */
+
+static const char *prof_stage[PROF_NSTAGE]={
+    "satpos","zdres-b","zdres-r","udstate","ddres","filter","resamb","valpos",
+    "solstat","outsol","epoch"
+};
+static const char *prof_count[PROF_NCOUNT]={"nsat","nx","namb","nodes"};
+
+/* histogram bin of value ----------------------------------------------------*/
+static int prof_bin(unsigned long long v)
+{
+    int k=0;
+
+    if (v<PROFNLIN) return (int)v;
+    while ((v>>k)>=PROFNLIN) k++;
+    k=k*PROFNSUB+(int)(v>>k);
+    return k<PROFNBIN?k:PROFNBIN-1;
+}
+/* lower and upper bound of histogram bin ------------------------------------*/
+static void prof_bound(int b, double *lo, double *hi)
+{
+    int k=b/PROFNSUB-1,m=b-k*PROFNSUB;
+
+    if (b<PROFNLIN) {*lo=b; *hi=b+1; return;}
+    *lo=ldexp((double)m,k); *hi=ldexp((double)m+1.0,k);
+}
+/* add sample to histogram ---------------------------------------------------*/
+static void prof_hadd(profh_t *h, double v)
+{
+    if (v<0.0) v=0.0;
+    h->bin[prof_bin((unsigned long long)(v+0.5))]++;
+    h->n++;
+    h->sum+=v;
+    if (v>h->max) h->max=v;
+}
+/* quantile of histogram -----------------------------------------------------*/
+static double prof_hquant(const profh_t *h, double p)
+{
+    double lo,hi,c=0.0,r;
+    int i;
+
+    if (h->n==0) return 0.0;
+    if (p>=1.0) return h->max;
+    r=p*h->n;
+    for (i=0;i<PROFNBIN;i++) {
+        if (!h->bin[i]||c+h->bin[i]<r) {c+=h->bin[i]; continue;}
+        prof_bound(i,&lo,&hi);
+        lo+=(hi-lo)*(r-c)/h->bin[i]; /* interpolate in bin */
+        return lo<h->max?lo:h->max;
+    }
+    return h->max;
+}
+/* new profiler ----------------------------------------------------------------
+* allocate and clear per-stage latency profiler
+* args   : none
+* return : profiler (NULL:error)
+*-----------------------------------------------------------------------------*/
+extern prof_t *arc_prof_new(void)
+{
+    prof_t *prof;
+
+    if (!(prof=(prof_t *)calloc(1,sizeof(prof_t)))) {
+        arc_log(ARC_ERROR,"arc_prof_new : memory allocation error\n");
+        return NULL;
+    }
+    return prof;
+}
+/* free profiler -------------------------------------------------------------*/
+extern void arc_prof_free(prof_t *prof)
+{
+    free(prof);
+}
+/* monotonic time --------------------------------------------------------------
+* args   : none
+* return : monotonic time (s)
+*-----------------------------------------------------------------------------*/
+extern double arc_prof_tic(void)
+{
+#ifdef WIN32
+    LARGE_INTEGER f,c;
+    QueryPerformanceFrequency(&f);
+    QueryPerformanceCounter(&c);
+    return (double)c.QuadPart/f.QuadPart;
+#else
+    struct timespec tp;
+    clock_gettime(CLOCK_MONOTONIC,&tp);
+    return tp.tv_sec+tp.tv_nsec*1E-9;
+#endif
+}
+/* begin epoch of profiler ---------------------------------------------------*/
+extern void arc_prof_begin(prof_t *prof)
+{
+    profep_t ep0={{0}};
+
+    if (!prof) return;
+    prof->ep=ep0;
+    prof->act=0;
+    arc_lambda_nodes(1);
+    prof->tick=arc_prof_tic();
+}
+/* enter stage of current epoch ------------------------------------------------
+* args   : prof_t   *prof   IO  profiler (NULL:no operation)
+*          int      stage   I   stage (PROF_???)
+* return : start time of stage (s) (<0:not timed)
+* notes  : a stage entered again before it is left (nested calls of the same
+*          stage) is not timed twice. a stage called several times in an epoch
+*          is summed up
+*-----------------------------------------------------------------------------*/
+extern double arc_prof_enter(prof_t *prof, int stage)
+{
+    if (!prof||stage<0||stage>=PROF_NSTAGE||(prof->act&(1u<<stage))) return -1.0;
+    prof->act|=1u<<stage;
+    return arc_prof_tic();
+}
+/* leave stage of current epoch ----------------------------------------------*/
+extern void arc_prof_leave(prof_t *prof, int stage, double tick)
+{
+    if (!prof||tick<0.0) return;
+    prof->act&=~(1u<<stage);
+    prof->ep.t[stage]+=arc_prof_tic()-tick;
+}
+/* add stage sample out of epoch -----------------------------------------------
+* add elapsed time of a stage called outside of arc_srtkpos (solution output)
+* directly to the histogram of the stage
+*-----------------------------------------------------------------------------*/
+extern void arc_prof_add(prof_t *prof, int stage, double t)
+{
+    if (!prof||stage<0||stage>=PROF_NSTAGE) return;
+    prof_hadd(prof->h+stage,t*1E9);
+}
+/* end epoch of profiler -------------------------------------------------------
+* aggregate stage times and counters of current epoch to histograms
+* args   : prof_t   *prof   IO  profiler (NULL:no operation)
+*          gtime_t  time    I   epoch time
+*          int      ns      I   number of valid satellites
+*          int      nx      I   number of states
+* return : none
+* notes  : ambiguities of the epoch are set to prof->ep.nb by ambiguity
+*          resolution, lambda search nodes are read from arc_lambda_nodes()
+*-----------------------------------------------------------------------------*/
+extern void arc_prof_end(prof_t *prof, gtime_t time, int ns, int nx)
+{
+    profep_t *ep;
+    int i;
+
+    if (!prof) return;
+    ep=&prof->ep;
+    ep->t[PROF_EPOCH]=arc_prof_tic()-prof->tick;
+    ep->time=time; ep->ns=ns; ep->nx=nx; ep->node=arc_lambda_nodes(1);
+
+    for (i=0;i<PROF_NSTAGE;i++) {
+        if (i==PROF_OUTSOL) continue; /* output out of epoch */
+        if (ep->t[i]>0.0||i==PROF_EPOCH) prof_hadd(prof->h+i,ep->t[i]*1E9);
+    }
+    prof_hadd(prof->hc+PROF_NSAT,ns);
+    prof_hadd(prof->hc+PROF_NX  ,nx);
+    prof_hadd(prof->hc+PROF_NAMB,ep->nb);
+    prof_hadd(prof->hc+PROF_NODE,ep->node);
+
+    /* insert into slowest epochs */
+    for (i=prof->nslow;i>0;i--) {
+        if (prof->slow[i-1].t[PROF_EPOCH]>=ep->t[PROF_EPOCH]) break;
+        if (i<PROFNSLOW) prof->slow[i]=prof->slow[i-1];
+    }
+    if (i<PROFNSLOW) {
+        prof->slow[i]=*ep;
+        if (prof->nslow<PROFNSLOW) prof->nslow++;
+    }
+}
+/* quantile of stage time ------------------------------------------------------
+* args   : prof_t   *prof   I   profiler
+*          int      stage   I   stage (PROF_???)
+*          double   p       I   quantile (0-1) (1:max,<0:mean)
+* return : stage time (s) (0.0:no sample)
+*-----------------------------------------------------------------------------*/
+extern double arc_prof_stage(const prof_t *prof, int stage, double p)
+{
+    const profh_t *h;
+
+    if (!prof||stage<0||stage>=PROF_NSTAGE) return 0.0;
+    h=prof->h+stage;
+    if (p<0.0) return h->n?h->sum/h->n*1E-9:0.0;
+    return prof_hquant(h,p)*1E-9;
+}
+/* quantile of per-epoch counter -----------------------------------------------
+* args   : prof_t   *prof   I   profiler
+*          int      type    I   counter (PROF_NSAT,PROF_NX,PROF_NAMB,PROF_NODE)
+*          double   p       I   quantile (0-1) (1:max,<0:mean)
+* return : counter value
+*-----------------------------------------------------------------------------*/
+extern double arc_prof_count(const prof_t *prof, int type, double p)
+{
+    const profh_t *h;
+
+    if (!prof||type<0||type>=PROF_NCOUNT) return 0.0;
+    h=prof->hc+type;
+    if (p<0.0) return h->n?h->sum/h->n:0.0;
+    return prof_hquant(h,p);
+}
+/* slowest epochs --------------------------------------------------------------
+* args   : prof_t   *prof   I   profiler
+*          profep_t *ep     O   slowest epochs sorted by epoch time {ep[0],...}
+*          int      n       I   max number of epochs
+* return : number of epochs
+*-----------------------------------------------------------------------------*/
+extern int arc_prof_slow(const prof_t *prof, profep_t *ep, int n)
+{
+    int i;
+
+    if (!prof) return 0;
+    for (i=0;i<n&&i<prof->nslow;i++) ep[i]=prof->slow[i];
+    return i;
+}
+/* dump profiler ---------------------------------------------------------------
+* print histogram summaries of stages and counters and slowest epochs
+* args   : prof_t   *prof   I   profiler (NULL:no operation)
+*          FILE     *fp     I   output file
+* return : none
+*-----------------------------------------------------------------------------*/
+extern void arc_prof_dump(const prof_t *prof, FILE *fp)
+{
+    const profh_t *h;
+    const profep_t *ep;
+    double tot;
+    int i,j;
+
+    if (!prof||!fp||prof->h[PROF_EPOCH].n==0) return;
+
+    tot=prof->h[PROF_EPOCH].sum;
+    fprintf(fp,"%% stage latency of %u epochs (us)\n",prof->h[PROF_EPOCH].n);
+    fprintf(fp,"%% %-8s %8s %9s %9s %9s %9s %6s\n","stage","n","mean","p50",
+            "p99","max","%");
+    for (i=0;i<PROF_NSTAGE;i++) {
+        if (!(h=prof->h+i)->n) continue;
+        fprintf(fp,"  %-8s %8u %9.1f %9.1f %9.1f %9.1f %6.1f\n",prof_stage[i],
+                h->n,h->sum/h->n*1E-3,prof_hquant(h,0.5)*1E-3,
+                prof_hquant(h,0.99)*1E-3,h->max*1E-3,
+                tot>0.0?h->sum/tot*100.0:0.0);
+    }
+    fprintf(fp,"%% %-8s %8s %9s %9s %9s %9s\n","counter","n","mean","p50",
+            "p99","max");
+    for (i=0;i<PROF_NCOUNT;i++) {
+        if (!(h=prof->hc+i)->n) continue;
+        fprintf(fp,"  %-8s %8u %9.1f %9.0f %9.0f %9.0f\n",prof_count[i],h->n,
+                h->sum/h->n,prof_hquant(h,0.5),prof_hquant(h,0.99),h->max);
+    }
+    fprintf(fp,"%% slowest epochs (us)\n");
+    for (i=0;i<prof->nslow;i++) {
+        ep=prof->slow+i;
+        fprintf(fp,"  %s epoch=%.1f nsat=%d nx=%d namb=%d nodes=%u :",
+                time_str(ep->time,1),ep->t[PROF_EPOCH]*1E6,ep->ns,ep->nx,
+                ep->nb,ep->node);
+        for (j=0;j<PROF_EPOCH;j++) {
+            if (ep->t[j]>0.0) fprintf(fp," %s=%.1f",prof_stage[j],ep->t[j]*1E6);
+        }
+        fprintf(fp,"\n");
+    }
+}
@@ -0,0 +1,660 @@
+/*********************************************************************************
+ *  ARC-SRTK - Single Frequency RTK Pisitioning Library
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************************/
+
+/**
+ * @file arc_rtcm.cc
+ * @brief rtcm 3 message decoder
+ *
+ * decodes rtcm 3 frames of a byte stream directly to observation data,
+ * broadcast ephemerides and station parameters. supported messages are
+ * 1005/1006 (station coordinates), 1019 (GPS ephemeris), 1042 (BeiDou
+ * ephemeris) and MSM4/5/7 of GPS (1074/1075/1077) and BeiDou
+ * (1124/1125/1127). the frame check uses a table driven crc-24q and the
+ * frame sync is resumed at the next preamble in the buffer after a crc
+ * error, so no byte of the stream is read twice.
+ *
+ * references:
+ *     [1] RTCM Standard 10403.3, Differential GNSS (Global Navigation
+ *         Satellite Systems) Services - Version 3, October 7, 2016
+ *     [2] RTKLIB 2.4.3, rtcm3.c
+ */
+#include "arc.h"
+
+#define RTCM3PREAMB 0xD3            /* rtcm ver.3 frame preamble */
+#define RANGE_MS    (CLIGHT*0.001)  /* range in 1 ms */
+
+#define P2_10       0.0009765625          /* 2^-10 */
+#define P2_34       5.820766091346740E-11 /* 2^-34 */
+#define P2_46       1.421085471520200E-14 /* 2^-46 */
+#define P2_59       1.734723475976810E-18 /* 2^-59 */
+#define P2_66       1.355252715606880E-20 /* 2^-66 */
+
+typedef struct {                    /* msm header type */
+    int nsat,nsig;                  /* number of satellites/signals */
+    int sats[64];                   /* satellites (prn) */
+    int sigs[32];                   /* signals (id) */
+    unsigned char cellmask[64];     /* cell mask */
+} msmh_t;
+
+/* msm signal id to observation code (ref [1] table 3.5-91,108) --------------*/
+static const char *msm_sig_gps[32]={
+    ""  ,"1C","1P","1W",""  ,""  ,""  ,"2C","2P","2W",""  ,""  ,""  ,""  ,"2S",
+    "2L","2X",""  ,""  ,""  ,""  ,"5I","5Q","5X",""  ,""  ,""  ,""  ,""  ,"1S",
+    "1L","1X"
+};
+static const char *msm_sig_cmp[32]={ /* B1 as "1x" same as rinex reader */
+    ""  ,"1I","1Q","1X",""  ,""  ,""  ,"6I","6Q","6X",""  ,""  ,""  ,"7I","7Q",
+    "7X",""  ,""  ,""  ,""  ,""  ,""  ,""  ,""  ,""  ,""  ,""  ,""  ,""  ,""  ,
+    ""  ,""
+};
+/* crc-24q table (polynomial 0x1864CFB) --------------------------------------*/
+static const unsigned int tbl_crc24q[]={
+    0x000000,0x864CFB,0x8AD50D,0x0C99F6,0x93E6E1,0x15AA1A,0x1933EC,0x9F7F17,
+    0xA18139,0x27CDC2,0x2B5434,0xAD18CF,0x3267D8,0xB42B23,0xB8B2D5,0x3EFE2E,
+    0xC54E89,0x430272,0x4F9B84,0xC9D77F,0x56A868,0xD0E493,0xDC7D65,0x5A319E,
+    0x64CFB0,0xE2834B,0xEE1ABD,0x685646,0xF72951,0x7165AA,0x7DFC5C,0xFBB0A7,
+    0x0CD1E9,0x8A9D12,0x8604E4,0x00481F,0x9F3708,0x197BF3,0x15E205,0x93AEFE,
+    0xAD50D0,0x2B1C2B,0x2785DD,0xA1C926,0x3EB631,0xB8FACA,0xB4633C,0x322FC7,
+    0xC99F60,0x4FD39B,0x434A6D,0xC50696,0x5A7981,0xDC357A,0xD0AC8C,0x56E077,
+    0x681E59,0xEE52A2,0xE2CB54,0x6487AF,0xFBF8B8,0x7DB443,0x712DB5,0xF7614E,
+    0x19A3D2,0x9FEF29,0x9376DF,0x153A24,0x8A4533,0x0C09C8,0x00903E,0x86DCC5,
+    0xB822EB,0x3E6E10,0x32F7E6,0xB4BB1D,0x2BC40A,0xAD88F1,0xA11107,0x275DFC,
+    0xDCED5B,0x5AA1A0,0x563856,0xD074AD,0x4F0BBA,0xC94741,0xC5DEB7,0x43924C,
+    0x7D6C62,0xFB2099,0xF7B96F,0x71F594,0xEE8A83,0x68C678,0x645F8E,0xE21375,
+    0x15723B,0x933EC0,0x9FA736,0x19EBCD,0x8694DA,0x00D821,0x0C41D7,0x8A0D2C,
+    0xB4F302,0x32BFF9,0x3E260F,0xB86AF4,0x2715E3,0xA15918,0xADC0EE,0x2B8C15,
+    0xD03CB2,0x567049,0x5AE9BF,0xDCA544,0x43DA53,0xC596A8,0xC90F5E,0x4F43A5,
+    0x71BD8B,0xF7F170,0xFB6886,0x7D247D,0xE25B6A,0x641791,0x688E67,0xEEC29C,
+    0x3347A4,0xB50B5F,0xB992A9,0x3FDE52,0xA0A145,0x26EDBE,0x2A7448,0xAC38B3,
+    0x92C69D,0x148A66,0x181390,0x9E5F6B,0x01207C,0x876C87,0x8BF571,0x0DB98A,
+    0xF6092D,0x7045D6,0x7CDC20,0xFA90DB,0x65EFCC,0xE3A337,0xEF3AC1,0x69763A,
+    0x578814,0xD1C4EF,0xDD5D19,0x5B11E2,0xC46EF5,0x42220E,0x4EBBF8,0xC8F703,
+    0x3F964D,0xB9DAB6,0xB54340,0x330FBB,0xAC70AC,0x2A3C57,0x26A5A1,0xA0E95A,
+    0x9E1774,0x185B8F,0x14C279,0x928E82,0x0DF195,0x8BBD6E,0x872498,0x016863,
+    0xFAD8C4,0x7C943F,0x700DC9,0xF64132,0x693E25,0xEF72DE,0xE3EB28,0x65A7D3,
+    0x5B59FD,0xDD1506,0xD18CF0,0x57C00B,0xC8BF1C,0x4EF3E7,0x426A11,0xC426EA,
+    0x2AE476,0xACA88D,0xA0317B,0x267D80,0xB90297,0x3F4E6C,0x33D79A,0xB59B61,
+    0x8B654F,0x0D29B4,0x01B042,0x87FCB9,0x1883AE,0x9ECF55,0x9256A3,0x141A58,
+    0xEFAAFF,0x69E604,0x657FF2,0xE33309,0x7C4C1E,0xFA00E5,0xF69913,0x70D5E8,
+    0x4E2BC6,0xC8673D,0xC4FECB,0x42B230,0xDDCD27,0x5B81DC,0x57182A,0xD154D1,
+    0x26359F,0xA07964,0xACE092,0x2AAC69,0xB5D37E,0x339F85,0x3F0673,0xB94A88,
+    0x87B4A6,0x01F85D,0x0D61AB,0x8B2D50,0x145247,0x921EBC,0x9E874A,0x18CBB1,
+    0xE37B16,0x6537ED,0x69AE1B,0xEFE2E0,0x709DF7,0xF6D10C,0xFA48FA,0x7C0401,
+    0x42FA2F,0xC4B6D4,0xC82F22,0x4E63D9,0xD11CCE,0x575035,0x5BC9C3,0xDD8538
+};
+/* crc-24q parity --------------------------------------------------------------
+* compute crc-24q parity for rtcm3
+* args   : unsigned char *buff I data
+*          int    len    I      data length (bytes)
+* return : crc-24q parity
+*-----------------------------------------------------------------------------*/
+extern unsigned int arc_crc24q(const unsigned char *buff, int len)
+{
+    unsigned int crc=0;
+    int i;
+
+    for (i=0;i<len;i++) crc=((crc<<8)&0xFFFFFF)^tbl_crc24q[(crc>>16)^buff[i]];
+    return crc;
+}
+/* get sign-magnitude 38 bits ------------------------------------------------*/
+static double getbits_38(const unsigned char *buff, int pos)
+{
+    return (double)getbits(buff,pos,32)*64.0+getbitu(buff,pos+32,6);
+}
+/* adjust time of week of message --------------------------------------------*/
+static void adjweek_rtcm(rtcm_t *rtcm, double tow)
+{
+    double tow_p;
+    int week;
+
+    if (rtcm->time.time==0) {
+        rtcm->time=rtcm->ephsat?rtcm->nav.eph[rtcm->ephsat-1].toe:utc2gpst(timeget());
+    }
+    tow_p=time2gpst(rtcm->time,&week);
+    if      (tow<tow_p-302400.0) tow+=604800.0;
+    else if (tow>tow_p+302400.0) tow-=604800.0;
+    rtcm->time=gpst2time(week,tow);
+}
+/* adjust gps week (10 bits) -------------------------------------------------*/
+static int adjgpsweek_rtcm(const rtcm_t *rtcm, int week)
+{
+    int w;
+
+    if (rtcm->time.time==0) return adjgpsweek(week);
+    (void)time2gpst(rtcm->time,&w);
+    return week+(w-week+512)/1024*1024;
+}
+/* check message length ------------------------------------------------------*/
+static int testlen(const rtcm_t *rtcm, int nbit, int type)
+{
+    if (nbit<=rtcm->len*8) return 1;
+    arc_log(ARC_WARNING,"rtcm3 %d length error: len=%d\n",type,rtcm->len);
+    return 0;
+}
+/* decode type 1005/1006: stationary rtk reference station arp -----------------
+* notes  : 1006 adds antenna height
+*-----------------------------------------------------------------------------*/
+static int decode_type1005(rtcm_t *rtcm, int type)
+{
+    double rr[3],hgt=0.0;
+    int i=24+12,j,staid,itrf;
+
+    if (!testlen(rtcm,i+140+(type==1006?16:0),type)) return -1;
+
+    staid=getbitu(rtcm->buff,i,12); i+=12;
+    itrf =getbitu(rtcm->buff,i, 6); i+= 6+4;
+    rr[0]=getbits_38(rtcm->buff,i); i+=38+2;
+    rr[1]=getbits_38(rtcm->buff,i); i+=38+2;
+    rr[2]=getbits_38(rtcm->buff,i); i+=38;
+    if (type==1006) {
+        hgt=getbitu(rtcm->buff,i,16)*0.0001; i+=16;
+    }
+    rtcm->staid=staid;
+    rtcm->sta.deltype=0; /* xyz */
+    for (j=0;j<3;j++) {
+        rtcm->sta.pos[j]=rr[j]*0.0001;
+        rtcm->sta.del[j]=0.0;
+    }
+    rtcm->sta.hgt=hgt;
+    rtcm->sta.itrf=itrf;
+    return 5;
+}
+/* save ephemeris ------------------------------------------------------------*/
+static int save_eph(rtcm_t *rtcm, const eph_t *eph)
+{
+    eph_t *e=rtcm->nav.eph+eph->sat-1;
+
+    if (e->sat==eph->sat&&e->iode==eph->iode&&
+        timediff(e->toe,eph->toe)==0.0) return 0; /* unchanged */
+    *e=*eph;
+    rtcm->ephsat=eph->sat;
+    return 2;
+}
+/* decode type 1019: gps ephemerides -----------------------------------------*/
+static int decode_type1019(rtcm_t *rtcm)
+{
+    eph_t eph={0};
+    double toc,sqrtA;
+    int i=24+12,prn,sat,week;
+
+    if (!testlen(rtcm,i+476,1019)) return -1;
+
+    prn       =getbitu(rtcm->buff,i, 6);              i+= 6;
+    week      =getbitu(rtcm->buff,i,10);              i+=10;
+    eph.sva   =getbitu(rtcm->buff,i, 4);              i+= 4;
+    eph.code  =getbitu(rtcm->buff,i, 2);              i+= 2;
+    eph.idot  =getbits(rtcm->buff,i,14)*P2_43*SC2RAD; i+=14;
+    eph.iode  =getbitu(rtcm->buff,i, 8);              i+= 8;
+    toc       =getbitu(rtcm->buff,i,16)*16.0;         i+=16;
+    eph.f2    =getbits(rtcm->buff,i, 8)*P2_55;        i+= 8;
+    eph.f1    =getbits(rtcm->buff,i,16)*P2_43;        i+=16;
+    eph.f0    =getbits(rtcm->buff,i,22)*P2_31;        i+=22;
+    eph.iodc  =getbitu(rtcm->buff,i,10);              i+=10;
+    eph.crs   =getbits(rtcm->buff,i,16)*P2_5;         i+=16;
+    eph.deln  =getbits(rtcm->buff,i,16)*P2_43*SC2RAD; i+=16;
+    eph.M0    =getbits(rtcm->buff,i,32)*P2_31*SC2RAD; i+=32;
+    eph.cuc   =getbits(rtcm->buff,i,16)*P2_29;        i+=16;
+    eph.e     =getbitu(rtcm->buff,i,32)*P2_33;        i+=32;
+    eph.cus   =getbits(rtcm->buff,i,16)*P2_29;        i+=16;
+    sqrtA     =getbitu(rtcm->buff,i,32)*P2_19;        i+=32;
+    eph.toes  =getbitu(rtcm->buff,i,16)*16.0;         i+=16;
+    eph.cic   =getbits(rtcm->buff,i,16)*P2_29;        i+=16;
+    eph.OMG0  =getbits(rtcm->buff,i,32)*P2_31*SC2RAD; i+=32;
+    eph.cis   =getbits(rtcm->buff,i,16)*P2_29;        i+=16;
+    eph.i0    =getbits(rtcm->buff,i,32)*P2_31*SC2RAD; i+=32;
+    eph.crc   =getbits(rtcm->buff,i,16)*P2_5;         i+=16;
+    eph.omg   =getbits(rtcm->buff,i,32)*P2_31*SC2RAD; i+=32;
+    eph.OMGd  =getbits(rtcm->buff,i,24)*P2_43*SC2RAD; i+=24;
+    eph.tgd[0]=getbits(rtcm->buff,i, 8)*P2_31;        i+= 8;
+    eph.svh   =getbitu(rtcm->buff,i, 6);              i+= 6;
+    eph.flag  =getbitu(rtcm->buff,i, 1);              i+= 1;
+    eph.fit   =getbitu(rtcm->buff,i, 1)?0.0:4.0; /* 0:4hr,1:>4hr */
+
+    if (!(sat=satno(SYS_GPS,prn))) {
+        arc_log(ARC_WARNING,"rtcm3 1019 satellite number error: prn=%d\n",prn);
+        return -1;
+    }
+    eph.sat=sat;
+    eph.week=adjgpsweek_rtcm(rtcm,week);
+    eph.toe=gpst2time(eph.week,eph.toes);
+    eph.toc=gpst2time(eph.week,toc);
+    eph.ttr=rtcm->time.time?rtcm->time:eph.toe;
+    eph.A=sqrtA*sqrtA;
+    return save_eph(rtcm,&eph);
+}
+/* decode type 1042: beidou ephemerides --------------------------------------*/
+static int decode_type1042(rtcm_t *rtcm)
+{
+    eph_t eph={0};
+    double toc,sqrtA;
+    int i=24+12,prn,sat;
+
+    if (!testlen(rtcm,i+499,1042)) return -1;
+
+    prn       =getbitu(rtcm->buff,i, 6);              i+= 6;
+    eph.week  =getbitu(rtcm->buff,i,13);              i+=13;
+    eph.sva   =getbitu(rtcm->buff,i, 4);              i+= 4;
+    eph.idot  =getbits(rtcm->buff,i,14)*P2_43*SC2RAD; i+=14;
+    eph.iode  =getbitu(rtcm->buff,i, 5);              i+= 5; /* AODE */
+    toc       =getbitu(rtcm->buff,i,17)*8.0;          i+=17;
+    eph.f2    =getbits(rtcm->buff,i,11)*P2_66;        i+=11;
+    eph.f1    =getbits(rtcm->buff,i,22)*P2_50;        i+=22;
+    eph.f0    =getbits(rtcm->buff,i,24)*P2_33;        i+=24;
+    eph.iodc  =getbitu(rtcm->buff,i, 5);              i+= 5; /* AODC */
+    eph.crs   =getbits(rtcm->buff,i,18)*P2_6;         i+=18;
+    eph.deln  =getbits(rtcm->buff,i,16)*P2_43*SC2RAD; i+=16;
+    eph.M0    =getbits(rtcm->buff,i,32)*P2_31*SC2RAD; i+=32;
+    eph.cuc   =getbits(rtcm->buff,i,18)*P2_31;        i+=18;
+    eph.e     =getbitu(rtcm->buff,i,32)*P2_33;        i+=32;
+    eph.cus   =getbits(rtcm->buff,i,18)*P2_31;        i+=18;
+    sqrtA     =getbitu(rtcm->buff,i,32)*P2_19;        i+=32;
+    eph.toes  =getbitu(rtcm->buff,i,17)*8.0;          i+=17;
+    eph.cic   =getbits(rtcm->buff,i,18)*P2_31;        i+=18;
+    eph.OMG0  =getbits(rtcm->buff,i,32)*P2_31*SC2RAD; i+=32;
+    eph.cis   =getbits(rtcm->buff,i,18)*P2_31;        i+=18;
+    eph.i0    =getbits(rtcm->buff,i,32)*P2_31*SC2RAD; i+=32;
+    eph.crc   =getbits(rtcm->buff,i,18)*P2_6;         i+=18;
+    eph.omg   =getbits(rtcm->buff,i,32)*P2_31*SC2RAD; i+=32;
+    eph.OMGd  =getbits(rtcm->buff,i,24)*P2_43*SC2RAD; i+=24;
+    eph.tgd[0]=getbits(rtcm->buff,i,10)*1E-10;        i+=10; /* TGD1 B1/B3 */
+    eph.tgd[1]=getbits(rtcm->buff,i,10)*1E-10;        i+=10; /* TGD2 B2/B3 */
+    eph.svh   =getbitu(rtcm->buff,i, 1);              i+= 1;
+
+    if (!(sat=satno(SYS_CMP,prn))) {
+        arc_log(ARC_WARNING,"rtcm3 1042 satellite number error: prn=%d\n",prn);
+        return -1;
+    }
+    eph.sat=sat;
+    eph.toe=bdt2gpst(bdt2time(eph.week,eph.toes)); /* bdt -> gpst */
+    eph.toc=bdt2gpst(bdt2time(eph.week,toc));      /* bdt -> gpst */
+    eph.ttr=rtcm->time.time?rtcm->time:eph.toe;
+    eph.A=sqrtA*sqrtA;
+    return save_eph(rtcm,&eph);
+}
+/* msm lock time indicator to lock time (ms) ---------------------------------*/
+static int msm_lock(int lock)
+{
+    return lock<=0?0:32<<(lock-1);
+}
+/* msm extended lock time indicator to lock time (ms) ------------------------*/
+static int msm_lock_ex(int lock)
+{
+    int k;
+
+    if (lock<64) return lock;
+    if (lock>=704) return 67108864;
+    k=lock/32-1;
+    return (lock-32*k)<<k;
+}
+/* decode msm header -----------------------------------------------------------
+* return : number of cells (-1: error), *hsize: header size (bits)
+*-----------------------------------------------------------------------------*/
+static int decode_msm_head(rtcm_t *rtcm, int sys, int type, int *sync,
+                           msmh_t *h, int *hsize)
+{
+    double tow;
+    int i=24+12,j,ncell=0;
+
+    memset(h,0,sizeof(msmh_t));
+
+    if (!testlen(rtcm,i+157,type)) return -1;
+
+    rtcm->staid=getbitu(rtcm->buff,i,12);       i+=12;
+    tow        =getbitu(rtcm->buff,i,30)*0.001; i+=30;
+    *sync      =getbitu(rtcm->buff,i, 1);       i+= 1;
+    rtcm->seqno=getbitu(rtcm->buff,i, 3);       i+= 3; /* iods */
+    i+=7+2+2+1+3; /* time_s,clk_str,clk_ext,smooth,tint_s */
+
+    for (j=1;j<=64;j++,i++) if (getbitu(rtcm->buff,i,1)) h->sats[h->nsat++]=j;
+    for (j=1;j<=32;j++,i++) if (getbitu(rtcm->buff,i,1)) h->sigs[h->nsig++]=j;
+
+    if (h->nsat*h->nsig>64) {
+        arc_log(ARC_WARNING,"rtcm3 %d number of sats and sigs error: nsat=%d nsig=%d\n",
+                type,h->nsat,h->nsig);
+        return -1;
+    }
+    if (!testlen(rtcm,i+h->nsat*h->nsig,type)) return -1;
+
+    for (j=0;j<h->nsat*h->nsig;j++,i++) {
+        if ((h->cellmask[j]=(unsigned char)getbitu(rtcm->buff,i,1))) ncell++;
+    }
+    *hsize=i;
+
+    /* bdt -> gpst */
+    if (sys==SYS_CMP) tow+=14.0;
+    adjweek_rtcm(rtcm,tow);
+
+    /* new epoch */
+    if (rtcm->obsflag||(rtcm->obs.n>0&&
+        fabs(timediff(rtcm->obs.data[0].time,rtcm->time))>1E-9)) {
+        rtcm->obs.n=rtcm->obsflag=0;
+    }
+    return ncell;
+}
+/* observation data index of satellite ---------------------------------------*/
+static int obsindex(obs_t *obs, gtime_t time, int sat)
+{
+    obsd_t *d;
+    int i,j;
+
+    for (i=0;i<obs->n;i++) {
+        if (obs->data[i].sat==sat) return i;
+    }
+    if (i>=MAXOBS) return -1;
+
+    d=obs->data+i;
+    d->time=time;
+    d->sat=(unsigned char)sat;
+    d->rcv=0;
+    for (j=0;j<NFREQ+NEXOBS;j++) {
+        d->L[j]=d->P[j]=0.0;
+        d->D[j]=0.0f;
+        d->SNR[j]=d->LLI[j]=d->code[j]=0;
+    }
+    obs->n++;
+    return i;
+}
+/* save msm observation data -------------------------------------------------*/
+static void save_msm_obs(rtcm_t *rtcm, int sys, const msmh_t *h, const double *r,
+                         const double *rr, const double *pr, const double *cp,
+                         const double *rrf, const double *cnr, const int *lock,
+                         const int *half)
+{
+    const char **sigtbl=sys==SYS_CMP?msm_sig_cmp:msm_sig_gps;
+    unsigned char code[32];
+    obsd_t *d;
+    double lam;
+    int i,j,k,f,sat,fn,idx[32],pri[32],use[32],index;
+
+    /* signal to obs code and frequency index */
+    for (i=0;i<h->nsig;i++) {
+        code[i]=obs2code(sigtbl[h->sigs[i]-1],&fn);
+        idx[i]=-1; pri[i]=0;
+        if (code[i]==CODE_NONE) continue;
+        if (sys==SYS_CMP) { /* same as rinex reader */
+            if      (fn==5) fn=2; /* B2 */
+            else if (fn==4) fn=3; /* B3 */
+        }
+        if (fn<1||fn>NFREQ) continue;
+        idx[i]=fn-1;
+        pri[i]=getcodepri(sys,code[i],rtcm->opt);
+    }
+    /* highest priority signal of each frequency */
+    for (i=0;i<h->nsig;i++) {
+        use[i]=idx[i]>=0&&pri[i]>0;
+        for (j=0;j<h->nsig&&use[i];j++) {
+            if (j==i||idx[j]!=idx[i]) continue;
+            if (pri[j]>pri[i]||(pri[j]==pri[i]&&j<i)) use[i]=0;
+        }
+    }
+    for (i=j=0;i<h->nsat;i++) {
+        sat=satno(sys,h->sats[i]);
+
+        for (k=0;k<h->nsig;k++) {
+            if (!h->cellmask[k+i*h->nsig]) continue;
+
+            if (sat&&use[k]&&r[i]!=0.0&&(index=obsindex(&rtcm->obs,rtcm->time,sat))>=0) {
+                d=rtcm->obs.data+index;
+                f=idx[k];
+                lam=arc_satwavelen(sat,f,&rtcm->nav);
+
+                if (pr[j]>-1E12) d->P[f]=r[i]+pr[j];
+                if (cp[j]>-1E12&&lam>0.0) d->L[f]=(r[i]+cp[j])/lam;
+                if (rr[i]>-1E12&&rrf[j]>-1E12&&lam>0.0) {
+                    d->D[f]=(float)(-(rr[i]+rrf[j])/lam);
+                }
+                d->LLI[f]=(lock[j]==0||lock[j]<rtcm->lltime[sat-1][f]?1:0)|
+                          (half[j]?2:0);
+                d->SNR[f]=(unsigned char)(cnr[j]*4.0+0.5);
+                d->code[f]=code[k];
+                rtcm->lltime[sat-1][f]=lock[j];
+            }
+            j++;
+        }
+    }
+}
+/* decode msm 4/5/7 ----------------------------------------------------------*/
+static int decode_msm(rtcm_t *rtcm, int sys, int msm, int type)
+{
+    msmh_t h;
+    double r[64],rr[64],pr[64],cp[64],rrf[64],cnr[64];
+    int i,j,v,sync,ncell,lock[64],half[64];
+
+    if ((ncell=decode_msm_head(rtcm,sys,type,&sync,&h,&i))<0) return -1;
+
+    if (!testlen(rtcm,i+h.nsat*(msm==4?18:36)+ncell*(msm==4?48:msm==5?63:80),
+                 type)) {
+        return -1;
+    }
+    for (j=0;j<h.nsat;j++) {
+        r[j]=0.0; rr[j]=-1E16;
+    }
+    for (j=0;j<ncell;j++) {
+        pr[j]=cp[j]=rrf[j]=-1E16;
+    }
+    /* satellite data */
+    for (j=0;j<h.nsat;j++) { /* rough range integer ms */
+        v=getbitu(rtcm->buff,i,8); i+=8;
+        if (v!=255) r[j]=v*RANGE_MS;
+    }
+    if (msm!=4) i+=4*h.nsat; /* extended satellite info */
+    for (j=0;j<h.nsat;j++) { /* rough range modulo 1 ms */
+        v=getbitu(rtcm->buff,i,10); i+=10;
+        if (r[j]!=0.0) r[j]+=v*P2_10*RANGE_MS;
+    }
+    if (msm!=4) {
+        for (j=0;j<h.nsat;j++) { /* rough phase range rate */
+            v=getbits(rtcm->buff,i,14); i+=14;
+            if (v!=-8192) rr[j]=v*1.0;
+        }
+    }
+    /* signal data */
+    for (j=0;j<ncell;j++) { /* fine pseudorange */
+        if (msm==7) {
+            v=getbits(rtcm->buff,i,20); i+=20;
+            if (v!=-524288) pr[j]=v*P2_29*RANGE_MS;
+        }
+        else {
+            v=getbits(rtcm->buff,i,15); i+=15;
+            if (v!=-16384) pr[j]=v*P2_24*RANGE_MS;
+        }
+    }
+    for (j=0;j<ncell;j++) { /* fine phase range */
+        if (msm==7) {
+            v=getbits(rtcm->buff,i,24); i+=24;
+            if (v!=-8388608) cp[j]=v*P2_31*RANGE_MS;
+        }
+        else {
+            v=getbits(rtcm->buff,i,22); i+=22;
+            if (v!=-2097152) cp[j]=v*P2_29*RANGE_MS;
+        }
+    }
+    for (j=0;j<ncell;j++) { /* lock time */
+        if (msm==7) {
+            lock[j]=msm_lock_ex(getbitu(rtcm->buff,i,10)); i+=10;
+        }
+        else {
+            lock[j]=msm_lock(getbitu(rtcm->buff,i,4)); i+=4;
+        }
+    }
+    for (j=0;j<ncell;j++) { /* half-cycle ambiguity */
+        half[j]=getbitu(rtcm->buff,i,1); i+=1;
+    }
+    for (j=0;j<ncell;j++) { /* cnr */
+        if (msm==7) {
+            cnr[j]=getbitu(rtcm->buff,i,10)*0.0625; i+=10;
+        }
+        else {
+            cnr[j]=getbitu(rtcm->buff,i,6)*1.0; i+=6;
+        }
+    }
+    if (msm!=4) {
+        for (j=0;j<ncell;j++) { /* fine phase range rate */
+            v=getbits(rtcm->buff,i,15); i+=15;
+            if (v!=-16384) rrf[j]=v*0.0001;
+        }
+    }
+    save_msm_obs(rtcm,sys,&h,r,rr,pr,cp,rrf,cnr,lock,half);
+
+    rtcm->obsflag=!sync;
+    return sync?0:1;
+}
+/* decode rtcm ver.3 message -------------------------------------------------*/
+static int decode_rtcm3(rtcm_t *rtcm)
+{
+    int ret=0,type=getbitu(rtcm->buff,24,12);
+
+    arc_log(ARC_INFO,"decode_rtcm3: len=%3d type=%d\n",rtcm->len,type);
+
+    switch (type) {
+        case 1005: ret=decode_type1005(rtcm,type);    break;
+        case 1006: ret=decode_type1005(rtcm,type);    break;
+        case 1019: ret=decode_type1019(rtcm);         break;
+        case 1042: ret=decode_type1042(rtcm);         break;
+        case 1074: ret=decode_msm(rtcm,SYS_GPS,4,type); break;
+        case 1075: ret=decode_msm(rtcm,SYS_GPS,5,type); break;
+        case 1077: ret=decode_msm(rtcm,SYS_GPS,7,type); break;
+        case 1124: ret=decode_msm(rtcm,SYS_CMP,4,type); break;
+        case 1125: ret=decode_msm(rtcm,SYS_CMP,5,type); break;
+        case 1127: ret=decode_msm(rtcm,SYS_CMP,7,type); break;
+    }
+    if (ret>=0) {
+        if (1000<type&&type<1400) rtcm->nmsg3[type-1000]++;
+        else rtcm->nmsg3[0]++;
+    }
+    return ret;
+}
+/* resynchronize frame -------------------------------------------------------
+* drop the buffer up to the next preamble at or after off. the bytes after
+* it are kept since a valid frame may start inside a corrupted one
+*----------------------------------------------------------------------------*/
+static void rtcm3_resync(rtcm_t *rtcm, int off)
+{
+    int i;
+
+    for (i=off;i<rtcm->nbyte;i++) {
+        if (rtcm->buff[i]==RTCM3PREAMB) break;
+    }
+    memmove(rtcm->buff,rtcm->buff+i,rtcm->nbyte-i);
+    rtcm->nbyte-=i;
+    rtcm->len=0;
+}
+/* check and decode frame in buffer ------------------------------------------*/
+static int rtcm3_frame(rtcm_t *rtcm)
+{
+    int n,ret;
+
+    while (rtcm->nbyte>=3) {
+        if (rtcm->len<=0) {
+            if (getbitu(rtcm->buff,8,6)) { /* reserved bits */
+                rtcm3_resync(rtcm,1);
+                continue;
+            }
+            rtcm->len=getbitu(rtcm->buff,14,10)+3; /* length without parity */
+        }
+        if (rtcm->nbyte<rtcm->len+3) return 0;
+
+        /* check parity */
+        if (arc_crc24q(rtcm->buff,rtcm->len)!=getbitu(rtcm->buff,rtcm->len*8,24)) {
+            arc_log(ARC_WARNING,"rtcm3 parity error: len=%d\n",rtcm->len);
+            rtcm->nerr++;
+            rtcm3_resync(rtcm,1);
+            continue;
+        }
+        ret=decode_rtcm3(rtcm);
+
+        /* keep bytes after frame */
+        n=rtcm->len+3;
+        memmove(rtcm->buff,rtcm->buff+n,rtcm->nbyte-n);
+        rtcm->nbyte-=n;
+        rtcm->len=0;
+        if (rtcm->nbyte>0) rtcm3_resync(rtcm,0);
+        return ret;
+    }
+    return 0;
+}
+/* initialize rtcm control -----------------------------------------------------
+* initialize rtcm control struct and reallocate memory for observation and
+* ephemeris buffer in rtcm control struct
+* args   : rtcm_t *rtcm     IO  rtcm control struct
+* return : status (1:ok,0:memory allocation error)
+*-----------------------------------------------------------------------------*/
+extern int arc_init_rtcm(rtcm_t *rtcm)
+{
+    arc_log(ARC_INFO,"arc_init_rtcm:\n");
+
+    memset(rtcm,0,sizeof(rtcm_t));
+
+    if (!(rtcm->obs.data=(obsd_t *)calloc(MAXOBS,sizeof(obsd_t)))||
+        !(rtcm->nav.eph =(eph_t  *)calloc(MAXSAT,sizeof(eph_t )))) {
+        arc_free_rtcm(rtcm);
+        return 0;
+    }
+    rtcm->obs.nmax=MAXOBS;
+    rtcm->nav.n=rtcm->nav.nmax=MAXSAT;
+    return 1;
+}
+/* free rtcm control -----------------------------------------------------------
+* free observation and ephemeris buffer in rtcm control struct
+* args   : rtcm_t *rtcm     IO  rtcm control struct
+* return : none
+*-----------------------------------------------------------------------------*/
+extern void arc_free_rtcm(rtcm_t *rtcm)
+{
+    arc_log(ARC_INFO,"arc_free_rtcm:\n");
+
+    free(rtcm->obs.data); rtcm->obs.data=NULL; rtcm->obs.n=rtcm->obs.nmax=0;
+    free(rtcm->nav.eph ); rtcm->nav.eph =NULL; rtcm->nav.n=rtcm->nav.nmax=0;
+}
+/* input rtcm 3 message from stream --------------------------------------------
+* fetch next rtcm 3 message and input a message from byte stream
+* args   : rtcm_t *rtcm     IO  rtcm control struct
+*          unsigned char data I stream data (1 byte)
+* return : status (-1: error message, 0: no message, 1: input observation data,
+*                  2: input ephemeris, 5: input station pos/ant parameters)
+* notes  : rtcm->time should be set to the approximate time of the stream
+*          before input, otherwise toe of the first ephemeris or the current
+*          time is used to resolve the week of messages. observation data of an epoch are output after
+*          the msm message of the epoch without multiple message bit.
+*          the ephemeris of the satellite rtcm->ephsat is in
+*          rtcm->nav.eph[rtcm->ephsat-1]
+*-----------------------------------------------------------------------------*/
+extern int arc_input_rtcm3(rtcm_t *rtcm, unsigned char data)
+{
+    if (rtcm->nbyte>=(int)sizeof(rtcm->buff)) rtcm3_resync(rtcm,1);
+
+    if (rtcm->nbyte==0&&data!=RTCM3PREAMB) return 0; /* synchronize frame */
+
+    rtcm->buff[rtcm->nbyte++]=data;
+
+    return rtcm3_frame(rtcm);
+}
+/* input rtcm 3 message from file ----------------------------------------------
+* fetch next rtcm 3 message and input a messsage from file
+* args   : rtcm_t *rtcm     IO  rtcm control struct
+*          FILE  *fp        I   file pointer
+* return : status (-2: end of file, other is same as arc_input_rtcm3())
+*-----------------------------------------------------------------------------*/
+extern int arc_input_rtcm3f(rtcm_t *rtcm, FILE *fp)
+{
+    int i,data=0,ret;
+
+    for (i=0;i<4096;i++) {
+        if ((data=fgetc(fp))==EOF) return -2;
+        if ((ret=arc_input_rtcm3(rtcm,(unsigned char)data))) return ret;
+    }
+    return 0; /* return at every 4k bytes */
+}
@@ -32,6 +32,15 @@
 
 #define MAXFIELD   64           /* max number of fields in a record */
 
+#define SOLBSYNC   "ARCSOLB1"   /* sync of binary solution file */
+#define SOLBPRE1   0xB5         /* preamble of binary solution record */
+#define SOLBPRE2   0x62
+#define SSTATSYNC  "ARCSTAT1"   /* sync of binary solution statistics file */
+#define SSTATPRE2  0x63         /* preamble of binary solution statistics block */
+#define SSTATHLEN  16           /* length of block header (bytes) */
+#define SSTATVER   1            /* format version of epochs (1:ar degrade flag) */
+#define SSTATEMAX  (64+SSTATNX*10+MAXSAT*NFREQ*(12+SSTATNS*10)) /* max epoch bytes */
+
 static const int solq_nmea[]={  /* nmea quality flags to rtklib sol quality */
         /* nmea 0183 v.2.3 quality flags: */
         /*  0=invalid, 1=gps fix (sps), 2=dgps fix, 3=pps fix, 4=rtk, 5=float rtk */
@@ -478,4 +487,672 @@ extern void outsolex(FILE *fp, const sol_t *sol, const ssat_t *ssat,
     if ((n=outsolexs(buff,sol,ssat,opt))>0) {
         fwrite(buff,n,1,fp);
     }
-}
\ No newline at end of file
+}
+/* binary solution record ------------------------------------------------------
+* encode solution to binary solution record (little endian)
+* args   : unsigned char *buff O output buffer {SOLBLEN}
+*          sol_t  *sol      I   solution
+*          double *rb       I   base station position {x,y,z} (ecef) (m)
+*                               (NULL: no base station)
+* return : number of output bytes
+* notes  : record layout (offset: type field)
+*            0: u1 preamble (0xB5), 1: u1 preamble (0x62), 2: u1 stat,
+*            3: u1 type, 4: u1 ns, 5-7: reserved,
+*            8: i8 time (ns from 1970/1/1 GPST),
+*           16: r8 rr[6], 64: r8 rb[3], 88: r4 qr[6],
+*          112: r4 age, 116: r4 ratio, 120: r4 thres, 124: u4 reserved
+*-----------------------------------------------------------------------------*/
+extern int outsolbs(unsigned char *buff, const sol_t *sol, const double *rb)
+{
+    long long t;
+    double rb_[3]={0};
+    int i;
+
+    t=(long long)sol->time.time*1000000000+(long long)floor(sol->time.sec*1E9+0.5);
+    if (rb) for (i=0;i<3;i++) rb_[i]=rb[i];
+
+    memset(buff,0,SOLBLEN);
+    buff[0]=SOLBPRE1; buff[1]=SOLBPRE2;
+    buff[2]=sol->stat; buff[3]=sol->type; buff[4]=sol->ns;
+    memcpy(buff+  8,&t,8);
+    memcpy(buff+ 16,sol->rr,48);
+    memcpy(buff+ 64,rb_,24);
+    memcpy(buff+ 88,sol->qr,24);
+    memcpy(buff+112,&sol->age,4);
+    memcpy(buff+116,&sol->ratio,4);
+    memcpy(buff+120,&sol->thres,4);
+    return SOLBLEN;
+}
+/* decode binary solution record -----------------------------------------------
+* args   : unsigned char *buff I binary solution record {SOLBLEN}
+*          sol_t  *sol      O   solution
+*          double *rb       O   base station position {x,y,z} (ecef) (m)
+* return : status (1:ok,0:invalid record)
+*-----------------------------------------------------------------------------*/
+extern int inputsolb(const unsigned char *buff, sol_t *sol, double *rb)
+{
+    long long t;
+
+    if (buff[0]!=SOLBPRE1||buff[1]!=SOLBPRE2) return 0;
+
+    memset(sol,0,sizeof(sol_t));
+    sol->stat=buff[2]; sol->type=buff[3]; sol->ns=buff[4];
+    memcpy(&t,buff+8,8);
+    sol->time.time=(time_t)(t/1000000000);
+    sol->time.sec=(t%1000000000)*1E-9;
+    if (sol->time.sec<0.0) {sol->time.time--; sol->time.sec+=1.0;}
+    memcpy(sol->rr  ,buff+ 16,48);
+    memcpy(rb       ,buff+ 64,24);
+    memcpy(sol->qr  ,buff+ 88,24);
+    memcpy(&sol->age  ,buff+112,4);
+    memcpy(&sol->ratio,buff+116,4);
+    memcpy(&sol->thres,buff+120,4);
+    return 1;
+}
+/* output binary solution file header ----------------------------------------*/
+extern void outsolbhead(FILE *fp)
+{
+    arc_log(ARC_INFO,"outsolbhead:\n");
+
+    fwrite(SOLBSYNC,8,1,fp);
+}
+/* read binary solution file header ------------------------------------------*/
+extern int readsolbhead(FILE *fp)
+{
+    char buff[8];
+
+    arc_log(ARC_INFO,"readsolbhead:\n");
+
+    return fread(buff,8,1,fp)==1&&!strncmp(buff,SOLBSYNC,8);
+}
+/* read binary solution record -------------------------------------------------
+* args   : FILE   *fp       I   binary solution file pointer
+*          sol_t  *sol      O   solution
+*          double *rb       O   base station position {x,y,z} (ecef) (m)
+* return : status (1:ok,0:end of file)
+* notes  : invalid records are skipped by searching preambles
+*-----------------------------------------------------------------------------*/
+extern int readsolb(FILE *fp, sol_t *sol, double *rb)
+{
+    unsigned char buff[SOLBLEN];
+    int c;
+
+    while (fread(buff,SOLBLEN,1,fp)==1) {
+        if (inputsolb(buff,sol,rb)) return 1;
+
+        /* resync to next preamble */
+        arc_log(ARC_WARNING,"readsolb: invalid record\n");
+        fseek(fp,1-SOLBLEN,SEEK_CUR);
+        while ((c=fgetc(fp))!=EOF) {
+            if (c!=SOLBPRE1) continue;
+            fseek(fp,-1,SEEK_CUR);
+            break;
+        }
+    }
+    return 0;
+}
+/* write buffered bytes of binary solution writer ---------------------------*/
+static int solw_flush(solw_t *w)
+{
+    unsigned int head,tail=w->tail,n;
+
+    head=atomic_get(&w->head);
+    if (head==tail) return 0;
+
+    /* contiguous bytes to the end of ring buffer */
+    n=head-tail;
+    if (tail%SOLWBUFF+n>SOLWBUFF) n=SOLWBUFF-tail%SOLWBUFF;
+    fwrite(w->buff+tail%SOLWBUFF,n,1,w->fp);
+
+    atomic_set(&w->tail,tail+n);
+    return (int)n;
+}
+#ifndef WIN32
+/* binary solution writer thread ---------------------------------------------*/
+static void *solw_thread(void *arg)
+{
+    solw_t *w=(solw_t *)arg;
+
+    while (atomic_get(&w->state)) {
+        if (!solw_flush(w)) sleepms(1);
+    }
+    while (solw_flush(w)) ;
+    fflush(w->fp);
+    return NULL;
+}
+#endif
+/* open binary solution writer -------------------------------------------------
+* open binary solution writer with a writer thread
+* args   : FILE   *fp       I   output file pointer
+* return : binary solution writer (NULL: error)
+* notes  : data are pushed to a single-producer single-consumer ring buffer
+*          by solw_write() and written to fp by the writer thread. the ring
+*          buffer is lock-free, the processing thread waits only if it is
+*          full. solw_close() writes remaining data and does not close fp.
+*          without threads (WIN32) data are written by solw_write()
+*-----------------------------------------------------------------------------*/
+extern solw_t *solw_open(FILE *fp)
+{
+    solw_t *w;
+
+    arc_log(ARC_INFO,"solw_open:\n");
+
+    if (!fp||!(w=(solw_t *)calloc(1,sizeof(solw_t)))) return NULL;
+
+    if (!(w->buff=(unsigned char *)malloc(SOLWBUFF))) {
+        free(w);
+        return NULL;
+    }
+    w->fp=fp;
+    w->state=1;
+#ifndef WIN32
+    w->run=!pthread_create(&w->thread,NULL,solw_thread,w);
+#endif
+    return w;
+}
+/* write data to binary solution writer ----------------------------------------
+* args   : solw_t *w        IO  binary solution writer
+*          unsigned char *buff I data
+*          int    n         I   data length (bytes)
+* return : none
+*-----------------------------------------------------------------------------*/
+extern void solw_write(solw_t *w, const unsigned char *buff, int n)
+{
+    unsigned int head=w->head,m;
+
+    if (!w->run) { /* no writer thread */
+        fwrite(buff,n,1,w->fp);
+        return;
+    }
+    while (n>0) {
+        m=SOLWBUFF-(head-atomic_get(&w->tail));
+        if (m==0) {
+            sleepms(1); /* ring buffer full */
+            continue;
+        }
+        if (m>(unsigned int)n) m=n;
+        if (head%SOLWBUFF+m>SOLWBUFF) m=SOLWBUFF-head%SOLWBUFF;
+        memcpy(w->buff+head%SOLWBUFF,buff,m);
+        buff+=m; n-=m; head+=m;
+
+        atomic_set(&w->head,head);
+    }
+}
+/* push solution to binary solution writer -------------------------------------
+* args   : solw_t *w        IO  binary solution writer
+*          sol_t  *sol      I   solution
+*          double *rb       I   base station position {x,y,z} (ecef) (m)
+* return : none
+*-----------------------------------------------------------------------------*/
+extern void solw_push(solw_t *w, const sol_t *sol, const double *rb)
+{
+    unsigned char buff[SOLBLEN];
+
+    solw_write(w,buff,outsolbs(buff,sol,rb));
+}
+/* close binary solution writer ----------------------------------------------*/
+extern void solw_close(solw_t *w)
+{
+    arc_log(ARC_INFO,"solw_close:\n");
+
+    if (!w) return;
+#ifndef WIN32
+    if (w->run) {
+        atomic_set(&w->state,0);
+        pthread_join(w->thread,NULL);
+    }
+#endif
+    free(w->buff);
+    free(w);
+}
+/* resolutions of quantized states of binary solution statistics ------------*/
+static double sstat_resx(int i)
+{
+    if (i< 6) return 1E-4; /* pos,posa (m) */
+    if (i<18) return (i/3)%2?1E-5:1E-4; /* vel,acc,vela,acca (m/s|m/s^2) */
+    if (i<22) return 1E-3; /* dtr (ns) */
+    return 1E-4;           /* trp,hwb (m) */
+}
+static const double sstat_ress[SSTATNS]={ /* satellite states */
+    0.1*D2R,0.1*D2R,1E-4,1E-4,1,1,1,1,1,1,1E-4,1E-4
+};
+/* quantize states -----------------------------------------------------------*/
+static void state2q(const solstate_t *state, long long *q)
+{
+    double x[SSTATNX];
+    int i,j;
+
+    for (i=0;i<3;i++) {
+        x[i   ]=state->pos [i]; x[i+ 3]=state->posa[i];
+        x[i+ 6]=state->vel [i]; x[i+ 9]=state->acc [i];
+        x[i+12]=state->vela[i]; x[i+15]=state->acca[i];
+    }
+    for (i=0;i<4;i++) x[18+i]=state->dtr[i];
+    for (i=0;i<2;i++) for (j=0;j<2;j++) x[22+i*2+j]=state->trp[i][j];
+    for (i=0;i<NFREQ;i++) for (j=0;j<2;j++) x[26+i*2+j]=state->hwb[i][j];
+    for (i=0;i<SSTATNX;i++) q[i]=(long long)floor(x[i]/sstat_resx(i)+0.5);
+}
+static void q2state(const long long *q, solstate_t *state)
+{
+    double x[SSTATNX];
+    int i,j;
+
+    for (i=0;i<SSTATNX;i++) x[i]=q[i]*sstat_resx(i);
+    for (i=0;i<3;i++) {
+        state->pos [i]=x[i   ]; state->posa[i]=x[i+ 3];
+        state->vel [i]=(float)x[i+ 6]; state->acc [i]=(float)x[i+ 9];
+        state->vela[i]=(float)x[i+12]; state->acca[i]=(float)x[i+15];
+    }
+    for (i=0;i<4;i++) state->dtr[i]=x[18+i];
+    for (i=0;i<2;i++) for (j=0;j<2;j++) state->trp[i][j]=(float)x[22+i*2+j];
+    for (i=0;i<NFREQ;i++) for (j=0;j<2;j++) state->hwb[i][j]=(float)x[26+i*2+j];
+}
+/* quantize satellite states -------------------------------------------------*/
+static void sat2q(const solstat_t *sat, long long *q)
+{
+    double x[SSTATNS];
+    int i;
+
+    x[0]=sat->az; x[1]=sat->el; x[2]=sat->resp; x[3]=sat->resc;
+    x[4]=sat->flag; x[5]=sat->snr; x[6]=sat->lock; x[7]=sat->outc;
+    x[8]=sat->slipc; x[9]=sat->rejc; x[10]=sat->ion[0]; x[11]=sat->ion[1];
+    for (i=0;i<SSTATNS;i++) q[i]=(long long)floor(x[i]/sstat_ress[i]+0.5);
+}
+static void q2sat(const long long *q, solstat_t *sat)
+{
+    sat->az   =(float)(q[0]*sstat_ress[0]);
+    sat->el   =(float)(q[1]*sstat_ress[1]);
+    sat->resp =(float)(q[2]*sstat_ress[2]);
+    sat->resc =(float)(q[3]*sstat_ress[3]);
+    sat->flag =(unsigned char)q[4];
+    sat->snr  =(unsigned char)q[5];
+    sat->lock =(int)q[6];
+    sat->outc =(unsigned int)q[7];
+    sat->slipc=(unsigned int)q[8];
+    sat->rejc =(unsigned int)q[9];
+    sat->ion[0]=(float)(q[10]*sstat_ress[10]);
+    sat->ion[1]=(float)(q[11]*sstat_ress[11]);
+}
+/* zigzag variable length integer --------------------------------------------*/
+static unsigned char *setvli(unsigned char *p, long long v)
+{
+    unsigned long long u=((unsigned long long)v<<1)^(unsigned long long)(v>>63);
+
+    while (u>=0x80) {
+        *p++=(unsigned char)(u|0x80);
+        u>>=7;
+    }
+    *p++=(unsigned char)u;
+    return p;
+}
+static const unsigned char *getvli(const unsigned char *p, const unsigned char *q,
+                                   long long *v)
+{
+    unsigned long long u=0;
+    int i;
+
+    for (i=0;p<q&&i<64;i+=7) {
+        u|=(unsigned long long)(*p&0x7F)<<i;
+        if (!(*p++&0x80)) {
+            *v=(long long)(u>>1)^-(long long)(u&1);
+            return p;
+        }
+    }
+    return NULL;
+}
+/* fletcher-32 checksum ------------------------------------------------------*/
+static unsigned int sstat_sum(const unsigned char *buff, int n)
+{
+    unsigned int a=0xFFFF,b=0xFFFF;
+    int i,m;
+
+    while (n>0) {
+        for (i=0,m=n>359?359:n;i<m;i++) {a+=buff[i]; b+=a;}
+        buff+=m; n-=m;
+        a=(a&0xFFFF)+(a>>16);
+        b=(b&0xFFFF)+(b>>16);
+    }
+    a=(a&0xFFFF)+(a>>16);
+    b=(b&0xFFFF)+(b>>16);
+    return (b<<16)|a;
+}
+/* reset delta states of block -----------------------------------------------*/
+static void sstat_reset(sstat_t *s)
+{
+    s->nb=s->ne=s->ib=0;
+    s->t=0;
+    memset(s->x,0,sizeof(s->x));
+    memset(s->s,0,sizeof(long long)*SSTATNS*NFREQ*MAXSAT);
+}
+/* write block of binary solution statistics ---------------------------------*/
+static void sstat_flush(sstat_t *s)
+{
+    unsigned char head[SSTATHLEN]={SOLBPRE1,SSTATPRE2};
+    unsigned int sum;
+
+    if (s->ne<=0) return;
+
+    sum=sstat_sum(s->buff,s->nb);
+    memcpy(head+ 4,&s->nb,4);
+    memcpy(head+ 8,&s->ne,4);
+    memcpy(head+12,&sum,4);
+    solw_write(s->w,head,SSTATHLEN);
+    solw_write(s->w,s->buff,s->nb);
+    sstat_reset(s);
+}
+/* new binary solution statistics stream -------------------------------------*/
+static sstat_t *sstat_new(FILE *fp)
+{
+    sstat_t *s;
+
+    if (!fp||!(s=(sstat_t *)calloc(1,sizeof(sstat_t)))) return NULL;
+
+    if (!(s->buff=(unsigned char *)malloc(SSTATBLK+SSTATEMAX))||
+        !(s->s=(long long *)malloc(sizeof(long long)*SSTATNS*NFREQ*MAXSAT))) {
+        free(s->buff); free(s);
+        return NULL;
+    }
+    s->fp=fp;
+    sstat_reset(s);
+    return s;
+}
+/* open binary solution statistics stream for writing --------------------------
+* args   : FILE   *fp       I   output file pointer
+*          int    level     I   statistics level (1:states,2:residuals)
+* return : binary solution statistics stream (NULL: error)
+* notes  : epochs are delta-encoded against the previous epoch as zigzag
+*          variable length integers of states quantized to the resolutions
+*          of text statistics, satellites against the previous epoch of the
+*          same satellite and frequency. epochs are collected in blocks of
+*          about SSTATBLK bytes, deltas restart at each block and blocks are
+*          written by a solution writer thread (see solw_open()).
+*          file layout: "ARCSTAT1",u1 level,u1 version,2 reserved, blocks
+*          block layout: u1 0xB5,u1 0x63,2 reserved,u4 length,u4 epochs,
+*                        u4 fletcher-32 checksum of epochs, epochs
+*-----------------------------------------------------------------------------*/
+extern sstat_t *sstat_openw(FILE *fp, int level)
+{
+    unsigned char head[12]={0};
+    sstat_t *s;
+
+    arc_log(ARC_INFO,"sstat_openw: level=%d\n",level);
+
+    if (!(s=sstat_new(fp))) return NULL;
+
+    if (!(s->w=solw_open(fp))) {
+        sstat_close(s);
+        return NULL;
+    }
+    s->level=level;
+    memcpy(head,SSTATSYNC,8); head[8]=(unsigned char)level; head[9]=SSTATVER;
+    solw_write(s->w,head,12);
+    return s;
+}
+/* open binary solution statistics stream for reading --------------------------
+* args   : FILE   *fp       I   input file pointer
+* return : binary solution statistics stream (NULL: error)
+*-----------------------------------------------------------------------------*/
+extern sstat_t *sstat_openr(FILE *fp)
+{
+    unsigned char head[12];
+    sstat_t *s;
+
+    arc_log(ARC_INFO,"sstat_openr:\n");
+
+    if (!fp||fread(head,12,1,fp)!=1||strncmp((char *)head,SSTATSYNC,8)) {
+        return NULL;
+    }
+    if (!(s=sstat_new(fp))) return NULL;
+    s->level=head[8];
+    s->ver=head[9];
+    return s;
+}
+/* write epoch to binary solution statistics -----------------------------------
+* args   : sstat_t *s       IO  binary solution statistics stream
+*          solstate_t *state I  solution states
+*          solstat_t *sat   I   satellite states (frq: 1:L1,2:L2,...)
+*          int    n         I   number of satellite states
+* return : none
+*-----------------------------------------------------------------------------*/
+extern void sstat_write(sstat_t *s, const solstate_t *state, const solstat_t *sat,
+                        int n)
+{
+    long long t,q[SSTATNX],*d;
+    unsigned char *p=s->buff+s->nb;
+    int i,j,m;
+
+    t=(long long)state->time.time*1000000000+
+      (long long)floor(state->time.sec*1E9+0.5);
+    p=setvli(p,t-s->t); s->t=t;
+    *p++=state->stat; *p++=state->ion; *p++=state->ntrp; *p++=state->nf;
+    *p++=state->ardeg;
+
+    state2q(state,q);
+    for (i=0;i<SSTATNX;i++) {
+        p=setvli(p,q[i]-s->x[i]);
+        s->x[i]=q[i];
+    }
+    for (i=m=0;i<n;i++) {
+        if (sat[i].sat>=1&&sat[i].sat<=MAXSAT&&sat[i].frq>=1&&sat[i].frq<=NFREQ) m++;
+    }
+    p=setvli(p,m);
+
+    for (i=0;i<n;i++) {
+        if (sat[i].sat<1||sat[i].sat>MAXSAT||sat[i].frq<1||sat[i].frq>NFREQ) continue;
+        p=setvli(p,sat[i].sat);
+        *p++=sat[i].frq;
+        d=s->s+((sat[i].sat-1)*NFREQ+sat[i].frq-1)*SSTATNS;
+        sat2q(sat+i,q);
+        for (j=0;j<SSTATNS;j++) {
+            p=setvli(p,q[j]-d[j]);
+            d[j]=q[j];
+        }
+    }
+    s->nb=(int)(p-s->buff);
+    s->ne++;
+
+    if (s->nb>=SSTATBLK) sstat_flush(s);
+}
+/* read block of binary solution statistics ---------------------------------*/
+static int sstat_readblk(sstat_t *s)
+{
+    unsigned char head[SSTATHLEN];
+    unsigned int nb,ne,sum;
+    long pos;
+    int c;
+
+    sstat_reset(s);
+
+    while ((pos=ftell(s->fp))>=0&&fread(head,SSTATHLEN,1,s->fp)==1) {
+        memcpy(&nb ,head+ 4,4);
+        memcpy(&ne ,head+ 8,4);
+        memcpy(&sum,head+12,4);
+
+        if (head[0]==SOLBPRE1&&head[1]==SSTATPRE2&&nb<=SSTATBLK+SSTATEMAX&&
+            fread(s->buff,nb,1,s->fp)==1&&sstat_sum(s->buff,nb)==sum) {
+            s->nb=(int)nb;
+            return 1;
+        }
+        /* resync to next preamble */
+        arc_log(ARC_WARNING,"sstat_read: invalid block\n");
+        fseek(s->fp,pos+1,SEEK_SET);
+        while ((c=fgetc(s->fp))!=EOF) {
+            if (c!=SOLBPRE1) continue;
+            fseek(s->fp,-1,SEEK_CUR);
+            break;
+        }
+    }
+    return 0;
+}
+/* read epoch from binary solution statistics ----------------------------------
+* args   : sstat_t *s       IO  binary solution statistics stream
+*          solstate_t *state O  solution states
+*          solstat_t *sat   O   satellite states
+*          int    nmax      I   max number of satellite states
+* return : number of satellite states (-1: end of stream)
+*-----------------------------------------------------------------------------*/
+extern int sstat_read(sstat_t *s, solstate_t *state, solstat_t *sat, int nmax)
+{
+    const unsigned char *p,*q;
+    long long v,qs[SSTATNS],*d;
+    int i,j,n,m,no,frq;
+
+    while (s->ib>=s->nb) {
+        if (!sstat_readblk(s)) return -1;
+    }
+    p=s->buff+s->ib; q=s->buff+s->nb;
+
+    memset(state,0,sizeof(solstate_t));
+    if (!(p=getvli(p,q,&v))||q-p<4+(s->ver>=1)) goto error;
+    s->t+=v;
+    state->time.time=(time_t)(s->t/1000000000);
+    state->time.sec=(s->t%1000000000)*1E-9;
+    state->stat=*p++; state->ion=*p++; state->ntrp=*p++; state->nf=*p++;
+    if (s->ver>=1) state->ardeg=*p++;
+
+    for (i=0;i<SSTATNX;i++) {
+        if (!(p=getvli(p,q,&v))) goto error;
+        s->x[i]+=v;
+    }
+    q2state(s->x,state);
+
+    if (!(p=getvli(p,q,&v))) goto error;
+    for (i=n=0,m=(int)v;i<m;i++) {
+        if (!(p=getvli(p,q,&v))||p>=q) goto error;
+        no=(int)v; frq=*p++;
+        if (no<1||no>MAXSAT||frq<1||frq>NFREQ) goto error;
+        d=s->s+((no-1)*NFREQ+frq-1)*SSTATNS;
+        for (j=0;j<SSTATNS;j++) {
+            if (!(p=getvli(p,q,&v))) goto error;
+            d[j]+=v; qs[j]=d[j];
+        }
+        if (n>=nmax) continue;
+        memset(sat+n,0,sizeof(solstat_t));
+        sat[n].time=state->time;
+        sat[n].sat=(unsigned char)no;
+        sat[n].frq=(unsigned char)frq;
+        q2sat(qs,sat+n++);
+    }
+    s->ib=(int)(p-s->buff);
+    return n;
+
+error:
+    arc_log(ARC_WARNING,"sstat_read: invalid epoch\n");
+    s->ib=s->nb; /* skip rest of block */
+    return sstat_read(s,state,sat,nmax);
+}
+/* close binary solution statistics stream -----------------------------------*/
+extern void sstat_close(sstat_t *s)
+{
+    arc_log(ARC_INFO,"sstat_close:\n");
+
+    if (!s) return;
+    if (s->w) {
+        sstat_flush(s);
+        solw_close(s->w);
+    }
+    free(s->buff); free(s->s);
+    free(s);
+}
+/* read binary solution statistics file ----------------------------------------
+* read satellite states of binary solution statistics file
+* args   : char   *file     I   binary solution statistics file
+*          solstatbuf_t *statbuf O satellite states buffer
+* return : status (1:ok,0:no data or error)
+*-----------------------------------------------------------------------------*/
+extern int readsolstatb(const char *file, solstatbuf_t *statbuf)
+{
+    solstate_t state;
+    solstat_t *sat,*data;
+    sstat_t *s;
+    FILE *fp;
+    int i,n;
+
+    arc_log(ARC_INFO,"readsolstatb: file=%s\n",file);
+
+    statbuf->n=statbuf->nmax=0; statbuf->data=NULL;
+
+    if (!(fp=fopen(file,"rb"))) {
+        arc_log(ARC_WARNING,"readsolstatb: file open error %s\n",file);
+        return 0;
+    }
+    if (!(s=sstat_openr(fp))||
+        !(sat=(solstat_t *)malloc(sizeof(solstat_t)*MAXSAT*NFREQ))) {
+        sstat_close(s); fclose(fp);
+        return 0;
+    }
+    while ((n=sstat_read(s,&state,sat,MAXSAT*NFREQ))>=0) {
+        if (statbuf->n+n>statbuf->nmax) {
+            statbuf->nmax=statbuf->nmax<=0?8192:statbuf->nmax*2;
+            if (statbuf->nmax<statbuf->n+n) statbuf->nmax=statbuf->n+n;
+            if (!(data=(solstat_t *)realloc(statbuf->data,
+                                            sizeof(solstat_t)*statbuf->nmax))) {
+                arc_log(ARC_ERROR,"readsolstatb: memory allocation error\n");
+                break;
+            }
+            statbuf->data=data;
+        }
+        for (i=0;i<n;i++) statbuf->data[statbuf->n++]=sat[i];
+    }
+    free(sat);
+    sstat_close(s);
+    fclose(fp);
+    return statbuf->n>0;
+}
+/* output solution statistics as text ------------------------------------------
+* output epoch of binary solution statistics in the form of text statistics
+* args   : FILE   *fp       I   output file pointer
+*          solstate_t *state I  solution states
+*          solstat_t *sat   I   satellite states
+*          int    n         I   number of satellite states
+*          int    level     I   statistics level (1:states,2:residuals)
+* return : none
+*-----------------------------------------------------------------------------*/
+extern void outsstat(FILE *fp, const solstate_t *state, const solstat_t *sat,
+                     int n, int level)
+{
+    double tow;
+    int i,week;
+    char id[32];
+
+    tow=time2gpst(state->time,&week);
+
+    fprintf(fp,"$POS,%d,%.3f,%d,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n",week,tow,
+            state->stat,state->pos[0],state->pos[1],state->pos[2],
+            state->posa[0],state->posa[1],state->posa[2]);
+    fprintf(fp,"$VELACC,%d,%.3f,%d,%.4f,%.4f,%.4f,%.5f,%.5f,%.5f,%.4f,%.4f,%.4f,%.5f,%.5f,%.5f\n",
+            week,tow,state->stat,state->vel[0],state->vel[1],state->vel[2],
+            state->acc[0],state->acc[1],state->acc[2],state->vela[0],
+            state->vela[1],state->vela[2],state->acca[0],state->acca[1],
+            state->acca[2]);
+    fprintf(fp,"$CLK,%d,%.3f,%d,%d,%.3f,%.3f,%.3f,%.3f\n",week,tow,state->stat,1,
+            state->dtr[0],state->dtr[1],state->dtr[2],state->dtr[3]);
+    if (state->ardeg) {
+        fprintf(fp,"$ARDEG,%d,%.3f,%d,%d\n",week,tow,state->stat,state->ardeg);
+    }
+    for (i=0;i<n&&state->ion;i++) {
+        if (sat[i].frq!=1) continue;
+        satno2id(sat[i].sat,id);
+        fprintf(fp,"$ION,%d,%.3f,%d,%s,%.1f,%.1f,%.4f,%.4f\n",week,tow,
+                state->stat,id,sat[i].az*R2D,sat[i].el*R2D,sat[i].ion[0],
+                sat[i].ion[1]);
+    }
+    for (i=0;i<state->ntrp&&i<2;i++) {
+        fprintf(fp,"$TROP,%d,%.3f,%d,%d,%.4f,%.4f\n",week,tow,state->stat,i+1,
+                state->trp[i][0],state->trp[i][1]);
+    }
+    for (i=0;i<state->nf&&i<NFREQ;i++) {
+        fprintf(fp,"$HWBIAS,%d,%.3f,%d,%d,%.4f,%.4f\n",week,tow,state->stat,i+1,
+                state->hwb[i][0],state->hwb[i][1]);
+    }
+    if (level<=1) return;
+
+    for (i=0;i<n;i++) {
+        satno2id(sat[i].sat,id);
+        fprintf(fp,"$SAT,%d,%.3f,%s,%d,%.1f,%.1f,%.4f,%.4f,%d,%.0f,%d,%d,%d,%d,%d,%d\n",
+                week,tow,id,sat[i].frq,sat[i].az*R2D,sat[i].el*R2D,sat[i].resp,
+                sat[i].resc,(sat[i].flag>>5)&1,sat[i].snr*0.25,sat[i].flag&7,
+                (sat[i].flag>>3)&3,sat[i].lock,sat[i].outc,sat[i].slipc,
+                sat[i].rejc);
+    }
+}
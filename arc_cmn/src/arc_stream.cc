@@ -0,0 +1,345 @@
+/*********************************************************************************
+ *  ARC-SRTK - Single Frequency RTK Pisitioning Library
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************************/
+
+/**
+ * @brief ARC-SRTK data streams
+ *
+ * byte streams of real-time positioning: file (read as tail of a growing
+ * file), named pipe, tcp server and tcp client. reads wait for data with a
+ * timeout and never end by themselves: end of file is waited for growth,
+ * a closed tcp connection is accepted or connected again. a stream can be
+ * read as FILE pointer by arc_strfopen() to use the rinex readers.
+ *
+ * stream path : file/pipe: file path
+ *               tcp server: :port
+ *               tcp client: host:port
+ */
+#include "arc.h"
+#ifndef WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+
+#define STR_TAILWAIT    10          /* wait for growth of file (ms) */
+#define STR_RECONN      1000        /* interval of tcp reconnection (ms) */
+#define STR_POLLWAIT    100         /* wait of blocking read (ms) */
+
+#ifndef WIN32
+/* set tcp options of connected socket ---------------------------------------*/
+static void str_setsock(int fd)
+{
+    int on=1;
+    setsockopt(fd,IPPROTO_TCP,TCP_NODELAY,(const char *)&on,sizeof(on));
+}
+/* close stream descriptor ---------------------------------------------------*/
+static void str_closefd(int *fd)
+{
+    if (*fd>=0) close(*fd);
+    *fd=-1;
+}
+/* open tcp server socket ----------------------------------------------------*/
+static int str_opensvr(stream_t *s)
+{
+    struct sockaddr_in addr;
+    int on=1;
+
+    if ((s->sfd=socket(AF_INET,SOCK_STREAM,0))<0) return 0;
+
+    setsockopt(s->sfd,SOL_SOCKET,SO_REUSEADDR,(const char *)&on,sizeof(on));
+    memset(&addr,0,sizeof(addr));
+    addr.sin_family=AF_INET;
+    addr.sin_port=htons((unsigned short)s->port);
+    addr.sin_addr.s_addr=htonl(INADDR_ANY);
+
+    if (bind(s->sfd,(struct sockaddr *)&addr,sizeof(addr))<0||listen(s->sfd,1)<0) {
+        arc_log(ARC_WARNING,"str_opensvr: bind/listen error port=%d\n",s->port);
+        str_closefd(&s->sfd);
+        return 0;
+    }
+    return 1;
+}
+/* accept client of tcp server -----------------------------------------------*/
+static int str_accept(stream_t *s, int timeout)
+{
+    struct pollfd p={s->sfd,POLLIN,0};
+    int fd;
+
+    if (poll(&p,1,timeout)<=0||(fd=accept(s->sfd,NULL,NULL))<0) return 0;
+
+    str_closefd(&s->fd); /* one client */
+    str_setsock(fd);
+    s->fd=fd;
+    arc_log(ARC_INFO,"str_accept: port=%d\n",s->port);
+    return 1;
+}
+/* connect tcp client --------------------------------------------------------*/
+static int str_connect(stream_t *s)
+{
+    struct addrinfo hint,*ai;
+    char port[16];
+    unsigned int tick=tickget();
+    int fd;
+
+    if (s->tcon&&(int)(tick-s->tcon)<STR_RECONN) return 0;
+    s->tcon=tick;
+
+    memset(&hint,0,sizeof(hint));
+    hint.ai_family=AF_INET;
+    hint.ai_socktype=SOCK_STREAM;
+    sprintf(port,"%d",s->port);
+    if (getaddrinfo(*s->host?s->host:"127.0.0.1",port,&hint,&ai)) return 0;
+
+    if ((fd=socket(ai->ai_family,ai->ai_socktype,0))<0) {
+        freeaddrinfo(ai);
+        return 0;
+    }
+    if (connect(fd,ai->ai_addr,ai->ai_addrlen)<0) {
+        close(fd); freeaddrinfo(ai);
+        return 0;
+    }
+    freeaddrinfo(ai);
+    str_setsock(fd);
+    s->fd=fd;
+    arc_log(ARC_INFO,"str_connect: %s:%d\n",s->host,s->port);
+    return 1;
+}
+/* wait for connection of tcp stream -----------------------------------------*/
+static int str_waitconn(stream_t *s, int timeout)
+{
+    if (s->fd>=0) return 1;
+
+    if (s->type==STR_TCPSVR) return str_accept(s,timeout);
+
+    if (!str_connect(s)) {
+        sleepms(timeout<STR_TAILWAIT?timeout:STR_TAILWAIT);
+        return 0;
+    }
+    return 1;
+}
+/* cookie read function of stream file pointer -------------------------------*/
+static ssize_t str_cookie_read(void *cookie, char *buff, size_t n)
+{
+    stream_t *s=(stream_t *)cookie;
+    int nr;
+
+    while (!s->stop) {
+        if ((nr=arc_strread(s,(unsigned char *)buff,(int)n,STR_POLLWAIT))>0) return nr;
+        if (nr<0) break;
+    }
+    return 0;
+}
+#endif /* WIN32 */
+
+/* open stream -----------------------------------------------------------------
+* args   : stream_t *s      O   stream
+*          int    type      I   stream type (STR_???)
+*          int    mode      I   stream mode (STR_MODE_R or STR_MODE_W)
+*          char   *path     I   stream path (see above)
+* return : status (1:ok,0:error)
+* notes  : tcp connections are accepted or connected by read and write
+*-----------------------------------------------------------------------------*/
+extern int arc_stropen(stream_t *s, int type, int mode, const char *path)
+{
+#ifndef WIN32
+    const char *p;
+
+    arc_log(ARC_INFO,"arc_stropen: type=%d mode=%d path=%s\n",type,mode,path);
+
+    memset(s,0,sizeof(stream_t));
+    s->type=type; s->mode=mode;
+    s->fd=s->sfd=-1;
+    strncpy(s->path,path,MAXSTRPATH-1);
+
+    switch (type) {
+        case STR_FILE:
+            if (mode&STR_MODE_W) s->fd=open(path,O_WRONLY|O_CREAT|O_TRUNC,0644);
+            else s->fd=open(path,O_RDONLY);
+            break;
+        case STR_PIPE:
+            if (mkfifo(path,0644)<0&&errno!=EEXIST) break;
+
+            /* no wait of writer/reader on open */
+            s->fd=open(path,(mode&STR_MODE_W)?O_RDWR:O_RDONLY|O_NONBLOCK);
+            break;
+        case STR_TCPSVR:
+        case STR_TCPCLI:
+            if (!(p=strrchr(path,':'))||(s->port=atoi(p+1))<=0) break;
+            strncpy(s->host,path,p-path<255?p-path:255);
+            if (type==STR_TCPSVR&&!str_opensvr(s)) break;
+            s->state=1;
+            return 1;
+    }
+    if (s->fd<0) {
+        arc_log(ARC_WARNING,"arc_stropen: stream open error %s\n",path);
+        s->state=-1;
+        return 0;
+    }
+    s->state=1;
+    return 1;
+#else
+    arc_log(ARC_ERROR,"arc_stropen: not supported\n");
+    return 0;
+#endif
+}
+/* close stream --------------------------------------------------------------*/
+extern void arc_strclose(stream_t *s)
+{
+    arc_log(ARC_INFO,"arc_strclose: type=%d\n",s->type);
+#ifndef WIN32
+    str_closefd(&s->fd);
+    str_closefd(&s->sfd);
+#endif
+    s->state=0;
+}
+/* read stream -----------------------------------------------------------------
+* args   : stream_t *s      IO  stream
+*          unsigned char *buff O read data
+*          int    n         I   max bytes of data
+*          int    timeout   I   max wait for data (ms)
+* return : bytes of read data (0:no data,-1:error)
+*-----------------------------------------------------------------------------*/
+extern int arc_strread(stream_t *s, unsigned char *buff, int n, int timeout)
+{
+#ifndef WIN32
+    struct pollfd p;
+    int nr;
+
+    if (s->state<=0) return -1;
+
+    if ((s->type==STR_TCPSVR||s->type==STR_TCPCLI)&&!str_waitconn(s,timeout)) {
+        return 0;
+    }
+    p.fd=s->fd; p.events=POLLIN; p.revents=0;
+    if (poll(&p,1,timeout)<=0) return 0;
+
+    if ((nr=(int)read(s->fd,buff,n))>0) {
+        s->inb+=nr;
+        return nr;
+    }
+    if (nr<0&&(errno==EAGAIN||errno==EINTR)) return 0;
+
+    switch (s->type) {
+        case STR_FILE:
+        case STR_PIPE: /* wait for growth of file or writer of pipe */
+            if (nr<0) return -1;
+            sleepms(timeout<STR_TAILWAIT?timeout:STR_TAILWAIT);
+            return 0;
+        default: /* connection closed */
+            arc_log(ARC_INFO,"arc_strread: disconnected %s\n",s->path);
+            str_closefd(&s->fd);
+            return 0;
+    }
+#else
+    return -1;
+#endif
+}
+/* write stream ----------------------------------------------------------------
+* args   : stream_t *s      IO  stream
+*          unsigned char *buff I write data
+*          int    n         I   bytes of data
+* return : bytes of written data (0:no connection,-1:error)
+* notes  : data are discarded while no tcp connection
+*-----------------------------------------------------------------------------*/
+extern int arc_strwrite(stream_t *s, const unsigned char *buff, int n)
+{
+#ifndef WIN32
+    int nw,m=0;
+
+    if (s->state<=0) return -1;
+
+    if ((s->type==STR_TCPSVR||s->type==STR_TCPCLI)&&!str_waitconn(s,0)) {
+        return 0;
+    }
+    while (m<n) {
+        if (s->type==STR_TCPSVR||s->type==STR_TCPCLI) {
+            nw=(int)send(s->fd,buff+m,n-m,MSG_NOSIGNAL);
+        }
+        else nw=(int)write(s->fd,buff+m,n-m);
+
+        if (nw<0&&errno==EINTR) continue;
+        if (nw<=0) {
+            if (s->type!=STR_TCPSVR&&s->type!=STR_TCPCLI) return -1;
+            arc_log(ARC_INFO,"arc_strwrite: disconnected %s\n",s->path);
+            str_closefd(&s->fd);
+            return 0;
+        }
+        m+=nw;
+    }
+    s->outb+=m;
+    return m;
+#else
+    return -1;
+#endif
+}
+/* wait for connection of stream -----------------------------------------------
+* args   : stream_t *s      IO  stream
+*          int    timeout   I   max wait (ms)
+* return : status (1:connected or not tcp stream,0:no connection)
+*-----------------------------------------------------------------------------*/
+extern int arc_strwait(stream_t *s, int timeout)
+{
+#ifndef WIN32
+    if (s->state<=0) return 0;
+    if (s->type!=STR_TCPSVR&&s->type!=STR_TCPCLI) return 1;
+    return str_waitconn(s,timeout);
+#else
+    return 0;
+#endif
+}
+/* open file pointer of input stream -------------------------------------------
+* args   : stream_t *s      IO  input stream
+* return : file pointer (NULL:error)
+* notes  : reads of the file pointer block until data or stop request of the
+*          stream (s->stop), then end of file
+*-----------------------------------------------------------------------------*/
+extern FILE *arc_strfopen(stream_t *s)
+{
+#if !defined(WIN32)&&defined(__GLIBC__)
+    cookie_io_functions_t func={str_cookie_read,NULL,NULL,NULL};
+
+    return fopencookie(s,"r",func);
+#else
+    arc_log(ARC_ERROR,"arc_strfopen: not supported\n");
+    return NULL;
+#endif
+}
+/* stream type and path of stream specification --------------------------------
+* args   : char   *spec     I   stream specification
+*                               (file://path,pipe://path,tcpsvr://:port,
+*                                tcpcli://host:port, path: file)
+*          char   *path     O   stream path
+* return : stream type (STR_???)
+*-----------------------------------------------------------------------------*/
+extern int arc_strtype(const char *spec, char *path)
+{
+    static const char *pre[]={"file://","pipe://","tcpsvr://","tcpcli://"};
+    int i;
+
+    for (i=0;i<4;i++) {
+        if (strncmp(spec,pre[i],strlen(pre[i]))) continue;
+        strcpy(path,spec+strlen(pre[i]));
+        return STR_FILE+i;
+    }
+    strcpy(path,spec);
+    return *spec?STR_FILE:STR_NONE;
+}
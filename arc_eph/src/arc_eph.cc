@@ -48,6 +48,8 @@
 #define EXTERR_CLK  1E-3          /* extrapolation error for clock (m/s) */
 #define EXTERR_EPH  5E-7          /* extrapolation error for ephem (m/s^2) */
 
+static THREADLOCAL ephc_t *ephc=NULL; /* ephemeris evaluation state of calling thread */
+
 /* variance by ura ephemeris (ref [1] 20.3.3.3.1.1) --------------------------*/
 static double var_uraeph(int ura)
 {
@@ -299,6 +301,71 @@ extern void arc_geph2pos(gtime_t time, const geph_t *geph, double *rs, double *d
     
     *var=SQR(ERREPH_GLO);
 }
+/* glonass position by orbit integration cache --------------------------------
+* same as arc_geph2pos() but integration starts at the knot before time.
+* knots are integrated from the last one of the same direction, so the cost
+* is in proportion to the time since last call for monotonic time. with
+* dense output, position is cubic hermite interpolation of two knots. the
+* caches are kept in the ephemeris evaluation state of the calling thread
+*-----------------------------------------------------------------------------*/
+static void geph2posc(gtime_t time, const geph_t *geph, ephc_t *ec,
+                      double *rs, double *dts, double *var)
+{
+    gloc_t *c;
+    double t,r,x[6],*x0,*x1,h,a,b;
+    int i,j,k,m,prn,dir;
+
+    t=timediff(time,geph->toe);
+    m=(int)(fabs(t)/TSTEP);
+
+    if (satsys(geph->sat,&prn)!=SYS_GLO||prn<MINPRNGLO||MAXPRNGLO<prn||
+        m+1>=MAXGLOKNOT||
+        (!ec->glo&&!(ec->glo=(gloc_t *)calloc(NSATGLO>0?NSATGLO:1,sizeof(gloc_t))))) {
+        arc_geph2pos(time,geph,rs,dts,var);
+        return;
+    }
+    c=ec->glo+prn-MINPRNGLO;
+    dir=t<0.0?1:0;
+
+    arc_log(ARC_INFO,"geph2posc: time=%s sat=%2d knot=%d\n",time_str(time,3),
+            geph->sat,dir?-m:m);
+
+    /* new ephemeris */
+    if (c->toe.time!=geph->toe.time||c->toe.sec!=geph->toe.sec||
+        c->pos[0]!=geph->pos[0]||c->pos[1]!=geph->pos[1]||c->pos[2]!=geph->pos[2]) {
+        c->toe=geph->toe;
+        for (i=0;i<3;i++) {
+            c->pos[i]=geph->pos[i];
+            c->x[0][0][i]=c->x[1][0][i]=geph->pos[i];
+            c->x[0][0][i+3]=c->x[1][0][i+3]=geph->vel[i];
+        }
+        c->n[0]=c->n[1]=1;
+    }
+    /* integrate knots up to the next one of time */
+    for (k=c->n[dir];k<=m+1;k++) {
+        for (j=0;j<6;j++) c->x[dir][k][j]=c->x[dir][k-1][j];
+        glorbit(dir?-TSTEP:TSTEP,c->x[dir][k],geph->acc);
+    }
+    if (c->n[dir]<m+2) c->n[dir]=m+2;
+
+    *dts=-geph->taun+geph->gamn*t;
+    *var=SQR(ERREPH_GLO);
+
+    r=dir?t+m*TSTEP:t-m*TSTEP;
+
+    if (ec->dense) {
+        x0=c->x[dir][m]; x1=c->x[dir][m+1];
+        h=dir?-TSTEP:TSTEP; a=r/h; b=a*a*(3.0-2.0*a);
+        for (i=0;i<3;i++) {
+            rs[i]=x0[i]*(1.0-b)+x1[i]*b+
+                  h*a*(1.0-a)*((1.0-a)*x0[i+3]-a*x1[i+3]);
+        }
+        return;
+    }
+    for (i=0;i<6;i++) x[i]=c->x[dir][m][i];
+    if (fabs(r)>1E-9) glorbit(r,x,geph->acc);
+    for (i=0;i<3;i++) rs[i]=x[i];
+}
 /* sbas ephemeris to satellite clock bias --------------------------------------
 * compute satellite clock bias with sbas ephemeris
 * args   : gtime_t time     I   time by satellite clock (gpst)
@@ -435,6 +502,10 @@ static int ephclk(gtime_t time, gtime_t teph, int sat, const nav_t *nav,
         if (!(eph=seleph(teph,sat,-1,nav))) return 0;
         *dts= arc_eph2clk(time, eph);
     }
+    else if (sys==SYS_GLO) {
+        if (!(geph=selgeph(teph,sat,-1,nav))) return 0;
+        *dts= arc_geph2clk(time, geph);
+    }
     else return 0;
     
     return 1;
@@ -463,6 +534,21 @@ static int ephpos(gtime_t time, gtime_t teph, int sat, const nav_t *nav,
         arc_eph2pos(time, eph, rst, dtst, var);
         *svh=eph->svh;
     }
+    else if (sys==SYS_GLO) {
+        if (!(geph=selgeph(teph,sat,iode,nav))) return 0;
+
+        if (ephc) {
+            geph2posc(time,geph,ephc,rs,dts,var);
+            time=timeadd(time,tt);
+            geph2posc(time,geph,ephc,rst,dtst,var);
+        }
+        else {
+            arc_geph2pos(time,geph,rs,dts,var);
+            time=timeadd(time,tt);
+            arc_geph2pos(time,geph,rst,dtst,var);
+        }
+        *svh=geph->svh;
+    }
     else return 0;
     
     /* satellite velocity and clock drift by differential approx */
@@ -515,12 +601,72 @@ static double interppol(const double *x, double *y, int n)
     }
     return y[0];
 }
+/* search precise ephemeris or clock epoch ------------------------------------
+* search index of epoch before time (t[index]<time<=t[index+1]) with cursor
+* of last index searched (NULL: no cursor)
+*-----------------------------------------------------------------------------*/
+static int searchpeph(gtime_t time, const nav_t *nav, int clk, int *cur)
+{
+    int i,j,k,n=clk?nav->nc:nav->ne;
+
+#define TPEPH(i) (clk?nav->pclk[i].time:nav->peph[i].time)
+    /* same or next epoch of cursor for monotonic time */
+    if (cur&&*cur>=0&&*cur+1<n) {
+        for (i=*cur;i<=*cur+1&&i+1<n;i++) {
+            if (timediff(TPEPH(i+1),time)<0.0) continue;
+            if (i>0&&timediff(TPEPH(i),time)>=0.0) break;
+            return *cur=i;
+        }
+    }
+    /* binary search */
+    for (i=0,j=n-1;i<j;) {
+        k=(i+j)/2;
+        if (timediff(TPEPH(k),time)<0.0) i=k+1; else j=k;
+    }
+#undef TPEPH
+    i=i<=0?0:i-1;
+    if (cur) *cur=i;
+    return i;
+}
+/* satellite clock by precise ephemeris --------------------------------------*/
+static double sp3clk(gtime_t time, int sat, const nav_t *nav, int index,
+                     double *dts)
+{
+    double t[2],c[2],std=0.0;
+    int i;
+
+    /* linear interpolation for clock */
+    t[0]=timediff(time,nav->peph[index  ].time);
+    t[1]=timediff(time,nav->peph[index+1].time);
+    c[0]=nav->peph[index  ].pos[sat-1][3];
+    c[1]=nav->peph[index+1].pos[sat-1][3];
+    
+    if (t[0]<=0.0) {
+        if ((dts[0]=c[0])!=0.0) {
+            std=nav->peph[index].std[sat-1][3]*CLIGHT-EXTERR_CLK*t[0];
+        }
+    }
+    else if (t[1]>=0.0) {
+        if ((dts[0]=c[1])!=0.0) {
+            std=nav->peph[index+1].std[sat-1][3]*CLIGHT+EXTERR_CLK*t[1];
+        }
+    }
+    else if (c[0]!=0.0&&c[1]!=0.0) {
+        dts[0]=(c[1]*t[0]-c[0]*t[1])/(t[0]-t[1]);
+        i=t[0]<-t[1]?0:1;
+        std=nav->peph[index+i].std[sat-1][3]+EXTERR_CLK*fabs(t[i]);
+    }
+    else {
+        dts[0]=0.0;
+    }
+    return std;
+}
 /* satellite position by precise ephemeris -----------------------------------*/
 static int pephpos(gtime_t time, int sat, const nav_t *nav, double *rs,
                    double *dts, double *vare, double *varc)
 {
-    double t[NMAX+1],p[3][NMAX+1],c[2],*pos,std=0.0,s[3],sinl,cosl;
-    int i,j,k,index;
+    double t[NMAX+1],p[3][NMAX+1],*pos,std=0.0,s[3],sinl,cosl;
+    int i,j,index;
 
     arc_log(ARC_INFO, "pephpos : time=%s sat=%2d\n", time_str(time, 3), sat);
     
@@ -532,12 +678,7 @@ static int pephpos(gtime_t time, int sat, const nav_t *nav, double *rs,
         arc_log(3, "no prec ephem %s sat=%2d\n", time_str(time, 0), sat);
         return 0;
     }
-    /* binary search */
-    for (i=0,j=nav->ne-1;i<j;) {
-        k=(i+j)/2;
-        if (timediff(nav->peph[k].time,time)<0.0) i=k+1; else j=k;
-    }
-    index=i<=0?0:i-1;
+    index=searchpeph(time,nav,0,NULL);
     
     /* polynomial interpolation for orbit */
     i=index-(NMAX+1)/2;
@@ -576,39 +717,16 @@ static int pephpos(gtime_t time, int sat, const nav_t *nav, double *rs,
         else if (t[NMAX]<0.0) std+=EXTERR_EPH*SQR(t[NMAX])/2.0;
         *vare=SQR(std);
     }
-    /* linear interpolation for clock */
-    t[0]=timediff(time,nav->peph[index  ].time);
-    t[1]=timediff(time,nav->peph[index+1].time);
-    c[0]=nav->peph[index  ].pos[sat-1][3];
-    c[1]=nav->peph[index+1].pos[sat-1][3];
-    
-    if (t[0]<=0.0) {
-        if ((dts[0]=c[0])!=0.0) {
-            std=nav->peph[index].std[sat-1][3]*CLIGHT-EXTERR_CLK*t[0];
-        }
-    }
-    else if (t[1]>=0.0) {
-        if ((dts[0]=c[1])!=0.0) {
-            std=nav->peph[index+1].std[sat-1][3]*CLIGHT+EXTERR_CLK*t[1];
-        }
-    }
-    else if (c[0]!=0.0&&c[1]!=0.0) {
-        dts[0]=(c[1]*t[0]-c[0]*t[1])/(t[0]-t[1]);
-        i=t[0]<-t[1]?0:1;
-        std=nav->peph[index+i].std[sat-1][3]+EXTERR_CLK*fabs(t[i]);
-    }
-    else {
-        dts[0]=0.0;
-    }
+    std=sp3clk(time,sat,nav,index,dts);
     if (varc) *varc=SQR(std);
     return 1;
 }
 /* satellite clock by precise clock ------------------------------------------*/
 static int pephclk(gtime_t time, int sat, const nav_t *nav, double *dts,
-                   double *varc)
+                   double *varc, int *cur)
 {
     double t[2],c[2],std;
-    int i,j,k,index;
+    int i,index;
 
     arc_log(ARC_INFO, "pephclk : time=%s sat=%2d\n", time_str(time, 3), sat);
     
@@ -618,12 +736,7 @@ static int pephclk(gtime_t time, int sat, const nav_t *nav, double *dts,
         arc_log(3, "no prec clock %s sat=%2d\n", time_str(time, 0), sat);
         return 1;
     }
-    /* binary search */
-    for (i=0,j=nav->nc-1;i<j;) {
-        k=(i+j)/2;
-        if (timediff(nav->pclk[k].time,time)<0.0) i=k+1; else j=k;
-    }
-    index=i<=0?0:i-1;
+    index=searchpeph(time,nav,1,cur);
     
     /* linear interpolation for clock */
     t[0]=timediff(time,nav->pclk[index  ].time);
@@ -658,6 +771,7 @@ static int pephclk(gtime_t time, int sat, const nav_t *nav, double *dts,
 *          int    n         I   number of observation data
 *          nav_t  *nav      I   navigation data
 *          int    ephopt    I   ephemeris option (EPHOPT_???)
+*          double *rsun     I   sun position of epoch (ecef) (m) (NULL: compute)
 *          double *rs       O   satellite positions and velocities (ecef)
 *          double *dts      O   satellite clocks
 *          double *var      O   sat position and clock error variances (m^2)
@@ -676,11 +790,12 @@ static int pephclk(gtime_t time, int sat, const nav_t *nav, double *dts,
 *          signal transmission time
 *-----------------------------------------------------------------------------*/
 extern void arc_satposs(gtime_t teph, const obsd_t *obs, int n, const nav_t *nav,
-                        int ephopt, double *rs, double *dts, double *var, int *svh)
+                        int ephopt, const double *rsun, double *rs, double *dts,
+                        double *var, int *svh)
 {
     gtime_t time[2*MAXOBS]={{0}};
     double dt,pr;
-    int i,j;
+    int i,j,sat[2*MAXOBS]={0},stat[2*MAXOBS];
 
     arc_log(ARC_INFO,"satposs : teph=%s n=%d ephopt=%d\n",time_str(teph,3),n,ephopt);
     
@@ -706,6 +821,11 @@ extern void arc_satposs(gtime_t teph, const obsd_t *obs, int n, const nav_t *nav
         }
         time[i]=timeadd(time[i],-dt);
         
+        /* precise ephemeris of all satellites at once */
+        if (ephopt==EPHOPT_PREC) {
+            sat[i]=obs[i].sat;
+            continue;
+        }
         /* satellite position and clock at transmission time */
         if (!arc_satpos(time[i],teph,obs[i].sat,ephopt,nav,rs+i*6,dts+i*2,var+i,
                         svh+i)) {
@@ -719,37 +839,41 @@ extern void arc_satposs(gtime_t teph, const obsd_t *obs, int n, const nav_t *nav
             *var=SQR(STD_BRDCCLK);
         }
     }
+    if (ephopt==EPHOPT_PREC) {
+        arc_peph2poss(time,sat,n<2*MAXOBS?n:2*MAXOBS,nav,1,rsun,rs,dts,var,stat);
+    }
+    for (i=0;i<n&&i<2*MAXOBS&&ephopt==EPHOPT_PREC;i++) {
+        if (!sat[i]) continue;
+        if (!stat[i]) {
+            for (j=0;j<6;j++) rs [j+i*6]=0.0;
+            for (j=0;j<2;j++) dts[j+i*2]=0.0;
+            svh[i]=-1;
+            arc_log(ARC_INFO,"no ephemeris %s sat=%2d\n",time_str(time[i],3),obs[i].sat);
+            continue;
+        }
+        /* if no precise clock available, use broadcast clock instead */
+        if (dts[i*2]==0.0) {
+            if (!ephclk(time[i],teph,obs[i].sat,nav,dts+i*2)) continue;
+            dts[1+i*2]=0.0;
+            var[i]=SQR(STD_BRDCCLK);
+        }
+    }
     for (i=0;i<n&&i<2*MAXOBS;i++) {
         arc_log(ARC_INFO,"%s sat=%2d rs=%13.3f %13.3f %13.3f dts=%12.3f var=%7.3f svh=%02X\n",
                 time_str(time[i],6),obs[i].sat,rs[i*6],rs[1+i*6],rs[2+i*6],
                 dts[i*2]*1E9,var[i],svh[i]);
     }
 }
-/* satellite antenna phase center offset ---------------------------------------
-* compute satellite antenna phase center offset in ecef
-* args   : gtime_t time       I   time (gpst)
-*          double *rs         I   satellite position and velocity (ecef)
-*                                 {x,y,z,vx,vy,vz} (m|m/s)
-*          int    sat         I   satellite number
-*          nav_t  *nav        I   navigation data
-*          double *dant       I   satellite antenna phase center offset (ecef)
-*                                 {dx,dy,dz} (m) (iono-free LC value)
-* return : none
-*-----------------------------------------------------------------------------*/
-extern void arc_satantoff(gtime_t time, const double *rs, int sat, const nav_t *nav,
-                          double *dant)
+/* satellite antenna phase center offset by sun position --------------------*/
+static void satantoff(const double *rs, int sat, const nav_t *nav,
+                      const double *rsun, double *dant)
 {
     const double *lam=nav->lam[sat-1];
     const pcv_t *pcv=nav->pcvs+sat-1;
-    double ex[3],ey[3],ez[3],es[3],r[3],rsun[3],gmst,erpv[5]={0};
+    double ex[3],ey[3],ez[3],es[3],r[3];
     double gamma,C1,C2,dant1,dant2;
     int i,j=0,k=1;
 
-    arc_log(ARC_INFO, "satantoff: time=%s sat=%2d\n", time_str(time, 3), sat);
-    
-    /* sun position in ecef */
-    arc_sunmoonpos(gpst2utc(time), erpv, rsun, NULL, &gmst);
-    
     /* unit vectors of satellite fixed coordinates */
     for (i=0;i<3;i++) r[i]=-rs[i];
     if (!arc_normv3(r, ez)) return;
@@ -774,6 +898,34 @@ extern void arc_satantoff(gtime_t time, const double *rs, int sat, const nav_t *
         dant[i]=C1*dant1+C2*dant2;
     }
 }
+/* satellite antenna phase center offset ---------------------------------------
+* compute satellite antenna phase center offset in ecef
+* args   : gtime_t time       I   time (gpst)
+*          double *rs         I   satellite position and velocity (ecef)
+*                                 {x,y,z,vx,vy,vz} (m|m/s)
+*          int    sat         I   satellite number
+*          nav_t  *nav        I   navigation data
+*          double *rsun       I   sun position of epoch (ecef) (m) (NULL: compute)
+*          double *dant       I   satellite antenna phase center offset (ecef)
+*                                 {dx,dy,dz} (m) (iono-free LC value)
+* return : none
+* notes  : rsun is the sun position of the geophysical context of the epoch
+*          (geoctx_t) so the sun/nutation series is not evaluated per satellite
+*-----------------------------------------------------------------------------*/
+extern void arc_satantoff(gtime_t time, const double *rs, int sat, const nav_t *nav,
+                          const double *rsun, double *dant)
+{
+    double sun[3],gmst,erpv[5]={0};
+
+    arc_log(ARC_INFO, "satantoff: time=%s sat=%2d\n", time_str(time, 3), sat);
+    
+    /* sun position in ecef */
+    if (!rsun) {
+        arc_sunmoonpos(gpst2utc(time), erpv, sun, NULL, &gmst);
+        rsun=sun;
+    }
+    satantoff(rs,sat,nav,rsun,dant);
+}
 /* satellite position/clock by precise ephemeris/clock -------------------------
 * compute satellite position/clock with precise ephemeris/clock
 * args   : gtime_t time       I   time (gpst)
@@ -792,8 +944,8 @@ extern void arc_satantoff(gtime_t time, const double *rs, int sat, const nav_t *
 *          nav->nc must be set by calling readsp3(), readrnx() or readrnxt()
 *          if precise clocks are not set, clocks in sp3 are used instead
 *-----------------------------------------------------------------------------*/
-extern int arc_peph2pos(gtime_t time, int sat, const nav_t *nav, int opt,
-                        double *rs, double *dts, double *var)
+static int peph2pos_(gtime_t time, int sat, const nav_t *nav, int opt,
+                     const double *rsun, double *rs, double *dts, double *var)
 {
     gtime_t time_tt;
     double rss[3],rst[3],dtss[1],dtst[1],dant[3]={0},vare=0.0,varc=0.0,tt=1E-3;
@@ -805,15 +957,15 @@ extern int arc_peph2pos(gtime_t time, int sat, const nav_t *nav, int opt,
     
     /* satellite position and clock bias */
     if (!pephpos(time,sat,nav,rss,dtss,&vare,&varc)||
-        !pephclk(time,sat,nav,dtss,&varc)) return 0;
+        !pephclk(time,sat,nav,dtss,&varc,NULL)) return 0;
     
     time_tt=timeadd(time,tt);
     if (!pephpos(time_tt,sat,nav,rst,dtst,NULL,NULL)||
-        !pephclk(time_tt,sat,nav,dtst,NULL)) return 0;
+        !pephclk(time_tt,sat,nav,dtst,NULL,NULL)) return 0;
     
     /* satellite antenna offset correction */
     if (opt) {
-        arc_satantoff(time, rss, sat, nav, dant);
+        arc_satantoff(time, rss, sat, nav, rsun, dant);
     }
     for (i=0;i<3;i++) {
         rs[i  ]=rss[i]+dant[i];
@@ -831,3 +983,257 @@ extern int arc_peph2pos(gtime_t time, int sat, const nav_t *nav, int opt,
     
     return 1;
 }
+extern int arc_peph2pos(gtime_t time, int sat, const nav_t *nav, int opt,
+                        double *rs, double *dts, double *var)
+{
+    return peph2pos_(time,sat,nav,opt,NULL,rs,dts,var);
+}
+/* free precise ephemeris coefficients -----------------------------------------
+* free precise ephemeris coefficients
+* args   : nav_t  *nav        IO  navigation data
+* return : none
+*-----------------------------------------------------------------------------*/
+extern void arc_pephc_free(nav_t *nav)
+{
+    int i;
+
+    if (!nav->pephc) return;
+    for (i=0;i<MAXSAT;i++) {
+        free(nav->pephc->coef[i]); free(nav->pephc->stat[i]);
+    }
+    free(nav->pephc); nav->pephc=NULL;
+}
+/* chebyshev coefficients of orbit in a segment ------------------------------*/
+static int pephc_seg(const nav_t *nav, int sat, int k, double *coef)
+{
+    double t[NMAX+1],p[3][NMAX+1],dt[NMAX+1],y[NMAX+1],f[3][NMAX+1];
+    double *pos,h,s,c;
+    int i,j,m,n=NMAX+1;
+
+    if ((h=timediff(nav->peph[k+1].time,nav->peph[k].time))<=0.0) return 0;
+
+    i=k-(NMAX+1)/2;
+    if (i<0) i=0; else if (i+NMAX>=nav->ne) i=nav->ne-NMAX-1;
+
+    /* orbit rotated to earth-fixed frame at start of segment */
+    for (j=0;j<n;j++) {
+        pos=nav->peph[i+j].pos[sat-1];
+        if (arc_norm(pos,3)<=0.0) return 0;
+        t[j]=timediff(nav->peph[i+j].time,nav->peph[k].time);
+        p[0][j]=cos(OMGE*t[j])*pos[0]-sin(OMGE*t[j])*pos[1];
+        p[1][j]=sin(OMGE*t[j])*pos[0]+cos(OMGE*t[j])*pos[1];
+        p[2][j]=pos[2];
+    }
+    /* polynomial interpolation at chebyshev nodes of segment */
+    for (m=0;m<n;m++) {
+        s=(cos(PI*(m+0.5)/n)+1.0)*h/2.0;
+        for (j=0;j<n;j++) dt[j]=t[j]-s;
+        for (i=0;i<3;i++) {
+            for (j=0;j<n;j++) y[j]=p[i][j];
+            f[i][m]=interppol(dt,y,n);
+        }
+    }
+    /* chebyshev coefficients (exact for the polynomial of order NMAX) */
+    for (i=0;i<3;i++) for (j=0;j<n;j++) {
+        for (m=0,c=0.0;m<n;m++) c+=f[i][m]*cos(PI*j*(m+0.5)/n);
+        coef[j+i*n]=(j?2.0:1.0)*c/n;
+    }
+    return 1;
+}
+/* set precise ephemeris coefficients ------------------------------------------
+* fit chebyshev coefficients of orbit for each satellite and segment between
+* precise ephemeris epochs
+* args   : nav_t  *nav        IO  navigation data
+* return : status (1:ok,0:no precise ephemeris or memory allocation error)
+* notes  : coefficients reproduce the polynomial interpolation of order NMAX
+*          by arc_peph2pos() in each segment. call again after nav->peph is
+*          changed and free them by arc_pephc_free()
+*-----------------------------------------------------------------------------*/
+extern int arc_pephc_init(nav_t *nav)
+{
+    pephc_t *pc;
+    int i,k,n=NMAX+1;
+
+    arc_log(ARC_INFO,"pephc_init: ne=%d\n",nav->ne);
+
+    arc_pephc_free(nav);
+
+    if (nav->ne<NMAX+1) return 0;
+
+    if (!(pc=(pephc_t *)calloc(1,sizeof(pephc_t)))) {
+        arc_log(ARC_WARNING,"pephc_init: memory allocation error\n");
+        return 0;
+    }
+    nav->pephc=pc;
+    pc->n=nav->ne-1;
+
+    for (i=0;i<MAXSAT;i++) {
+        for (k=0;k<nav->ne;k++) {
+            if (arc_norm(nav->peph[k].pos[i],3)>0.0) break;
+        }
+        if (k>=nav->ne) continue;
+
+        if (!(pc->coef[i]=(double *)malloc(sizeof(double)*n*3*pc->n))||
+            !(pc->stat[i]=(unsigned char *)malloc(pc->n))) {
+            arc_log(ARC_WARNING,"pephc_init: memory allocation error\n");
+            arc_pephc_free(nav);
+            return 0;
+        }
+        for (k=0;k<pc->n;k++) {
+            pc->stat[i][k]=(unsigned char)pephc_seg(nav,i+1,k,pc->coef[i]+k*n*3);
+        }
+    }
+    return 1;
+}
+/* ephemeris evaluation state -------------------------------------------------
+* initialize, free ephemeris evaluation state and bind it to calling thread
+* args   : ephc_t *c          IO  ephemeris evaluation state (NULL: unbind)
+*          int    dense       I   glonass orbit dense output between knots
+*                                 (0:off,1:on)
+* return : previous state bound to calling thread (NULL:none)
+* notes  : the state is owned by the caller (e.g. rtk_t) and keeps the cursors
+*          of precise ephemeris/clock and the glonass orbit integration caches
+*          of a thread, so nav_t is not modified. the caches are allocated at
+*          first use. functions called from threads without state search from
+*          the start and integrate glonass orbits from toe
+*-----------------------------------------------------------------------------*/
+extern void arc_ephc_init(ephc_t *c, int dense)
+{
+    c->cur=c->curc=-1;
+    c->dense=dense;
+    c->glo=NULL;
+}
+extern void arc_ephc_free(ephc_t *c)
+{
+    free(c->glo); c->glo=NULL;
+}
+extern ephc_t *arc_ephc_bind(ephc_t *c)
+{
+    ephc_t *prev=ephc;
+    ephc=c;
+    return prev;
+}
+/* satellite position and velocity by precise ephemeris coefficients ---------*/
+static int pephcpos(gtime_t time, int sat, const nav_t *nav, double *rs,
+                    double *dts, double *vare, double *varc)
+{
+    const double *c;
+    double u[3]={0},du[3]={0},T[2],U[2],Tn,Un,s,h,x,cosl,sinl,std[3];
+    int i,j,k,n=NMAX+1;
+
+    k=searchpeph(time,nav,0,ephc?&ephc->cur:NULL);
+
+    if (!nav->pephc->stat[sat-1]||!nav->pephc->stat[sat-1][k]) return 0;
+
+    /* chebyshev series and derivative (T'n=n*U(n-1)) */
+    s=timediff(time,nav->peph[k].time);
+    h=timediff(nav->peph[k+1].time,nav->peph[k].time);
+    x=2.0*s/h-1.0;
+    c=nav->pephc->coef[sat-1]+k*n*3;
+    T[0]=1.0; T[1]=x; U[0]=1.0; U[1]=2.0*x;
+    for (i=0;i<3;i++) u[i]=c[i*n]+c[1+i*n]*x;
+    for (i=0;i<3;i++) du[i]=c[1+i*n];
+    for (j=2;j<n;j++) {
+        Tn=2.0*x*T[1]-T[0]; T[0]=T[1]; T[1]=Tn;
+        for (i=0;i<3;i++) {
+            u [i]+=c[j+i*n]*Tn;
+            du[i]+=c[j+i*n]*j*U[1];
+        }
+        Un=2.0*x*U[1]-U[0]; U[0]=U[1]; U[1]=Un;
+    }
+    for (i=0;i<3;i++) du[i]*=2.0/h;
+
+    /* earth rotation since start of segment */
+    cosl=cos(OMGE*s);
+    sinl=sin(OMGE*s);
+    rs[0]= cosl*u[0]+sinl*u[1];
+    rs[1]=-sinl*u[0]+cosl*u[1];
+    rs[2]=u[2];
+    rs[3]= cosl*du[0]+sinl*du[1]+OMGE*rs[1];
+    rs[4]=-sinl*du[0]+cosl*du[1]-OMGE*rs[0];
+    rs[5]=du[2];
+
+    for (i=0;i<3;i++) std[i]=nav->peph[k].std[sat-1][i];
+    *vare=SQR(arc_norm(std,3));
+    *varc=SQR(sp3clk(time,sat,nav,k,dts));
+    return 1;
+}
+/* satellite positions/clocks by precise ephemeris/clock -----------------------
+* compute satellite positions/clocks of an epoch with precise ephemeris/clock
+* args   : gtime_t *time      I   times (gpst) {time[0],...,time[n-1]}
+*          int    *sat        I   satellite numbers (0: not computed)
+*          int    n           I   number of satellites
+*          nav_t  *nav        I   navigation data
+*          int    opt         I   sat postion option
+*                                 (0: center of mass, 1: antenna phase center)
+*          double *rsun       I   sun position of epoch (ecef) (m) (NULL: compute)
+*          double *rs         O   sat positions and velocities (ecef)
+*                                 {x,y,z,vx,vy,vz} (m|m/s) for each satellite
+*          double *dts        O   sat clocks {bias,drift} (s|s/s)
+*          double *var        O   sat position and clock error variances (m)
+*                                 (NULL: no output)
+*          int    *stat       O   status (1:ok,0:error or data outage)
+* return : number of satellites with status ok
+* notes  : same as arc_peph2pos() for each satellite except velocity by
+*          derivative of orbit polynomial. within precise ephemeris epochs
+*          the coefficients by arc_pephc_init() are used and cursors of last
+*          segments are kept in the state bound by arc_ephc_bind() for
+*          monotonic time. satellite antenna offsets use rsun or the sun
+*          position computed once per call
+*-----------------------------------------------------------------------------*/
+extern int arc_peph2poss(const gtime_t *time, const int *sat, int n,
+                         const nav_t *nav, int opt, const double *rsun,
+                         double *rs, double *dts, double *var, int *stat)
+{
+    gtime_t time_tt;
+    double dant[3],dtst[1],vare,varc,sun[3],gmst,erpv[5]={0},tt=1E-3;
+    int i,j,nok=0;
+
+    arc_log(ARC_INFO,"peph2poss: n=%d opt=%d\n",n,opt);
+
+    for (i=0;i<n;i++) {
+        stat[i]=0;
+        if (sat[i]<=0||MAXSAT<sat[i]) continue;
+
+        /* sun position for satellite antenna offsets */
+        if (opt&&!rsun) {
+            arc_sunmoonpos(gpst2utc(time[i]),erpv,sun,NULL,&gmst);
+            rsun=sun;
+        }
+        /* out of precise ephemeris epochs */
+        if (!nav->pephc||nav->pephc->n!=nav->ne-1||
+            timediff(time[i],nav->peph[0].time)<=0.0||
+            timediff(time[i],nav->peph[nav->ne-1].time)>0.0) {
+            if ((stat[i]=peph2pos_(time[i],sat[i],nav,opt,rsun,rs+i*6,dts+i*2,
+                                   var?var+i:NULL))) nok++;
+            continue;
+        }
+        if (!pephcpos(time[i],sat[i],nav,rs+i*6,dts+i*2,&vare,&varc)||
+            !pephclk(time[i],sat[i],nav,dts+i*2,&varc,ephc?&ephc->curc:NULL)) {
+            continue;
+        }
+        /* clock drift by differential approx */
+        time_tt=timeadd(time[i],tt);
+        j=searchpeph(time_tt,nav,0,ephc?&ephc->cur:NULL);
+        sp3clk(time_tt,sat[i],nav,j,dtst);
+        if (!pephclk(time_tt,sat[i],nav,dtst,NULL,ephc?&ephc->curc:NULL)) continue;
+
+        /* satellite antenna offset correction */
+        if (opt) {
+            dant[0]=dant[1]=dant[2]=0.0;
+            satantoff(rs+i*6,sat[i],nav,rsun,dant);
+            for (j=0;j<3;j++) rs[j+i*6]+=dant[j];
+        }
+        /* relativistic effect correction */
+        if (dts[i*2]!=0.0) {
+            dts[1+i*2]=(dtst[0]-dts[i*2])/tt;
+            dts[  i*2]-=2.0*arc_dot(rs+i*6,rs+3+i*6,3)/CLIGHT/CLIGHT;
+        }
+        else { /* no precise clock */
+            dts[i*2]=dts[1+i*2]=0.0;
+        }
+        if (var) var[i]=vare+varc;
+        stat[i]=1; nok++;
+    }
+    return nok;
+}
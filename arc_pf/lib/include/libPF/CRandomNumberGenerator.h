@@ -13,7 +13,9 @@ namespace libPF
  *
  * This class can generate randomly generated numbers from uniform and
  * gaussian distributions.
- * Note: this is a very simple PRNG, using the C-function rand().
+ * Note: this is a very simple PRNG, a 64 bit linear congruential generator
+ * with per-instance state, so each instance is an independent stream and
+ * instances with explicit seeds are reproducible.
  *
  * @author Stephan Wirth
  */
@@ -27,6 +29,18 @@ class CRandomNumberGenerator :
      */
     CRandomNumberGenerator();
 
+    /**
+     * Creates a generator with an explicit seed.
+     * @param seed seed of the random number stream
+     */
+    CRandomNumberGenerator(unsigned long long seed);
+
+    /**
+     * Restarts the random number stream.
+     * @param seed seed of the random number stream
+     */
+    void setSeed(unsigned long long seed);
+
     /**
      * Empty destructor.
      */
@@ -57,10 +71,15 @@ class CRandomNumberGenerator :
   protected:
 
     /**
-     * Initializes the seed by calling srand(time(0))
+     * Initializes the seed by time(0)
      */
     void init();
 
+    /**
+     * @return next 31 bit random integer of the stream
+     */
+    unsigned int next() const;
+
   private:
 
     /// stores if there is a buffered gaussian variable or not
@@ -70,6 +89,9 @@ class CRandomNumberGenerator :
     /// creates two variables, we return one and store the other here.
     mutable double m_GaussianBufferVariable;
 
+    /// state of the linear congruential generator
+    mutable unsigned long long m_State;
+
 };
 
 } // end of namespace
@@ -47,6 +47,15 @@ class ImportanceResampling : public ResamplingStrategy<StateType>{
      */
     void resample(const ParticleList& source, const ParticleList& destination) const;
 
+    /**
+     * Systematic resampling on the CDF of the source weights, the ancestor
+     * index of each new particle is written to @a ancestors in one pass.
+     * @param source the source list to draw new particles from.
+     * @param ancestors index of source particle for each new particle.
+     * @return true
+     */
+    bool resampleIndices(const ParticleList& source, std::vector<unsigned int>& ancestors) const;
+
     /**
      * Sets the Random Number Generator to use in resample() to
      * generate uniformly distributed random numbers.
@@ -76,15 +85,16 @@ ImportanceResampling<StateType>::~ImportanceResampling() {
 
 // resampling based on the cumulative distribution function (CDF)
 template <class StateType>
-void ImportanceResampling<StateType>::resample(const ParticleList& sourceList,
-                                               const ParticleList& destinationList) const {
+bool ImportanceResampling<StateType>::resampleIndices(const ParticleList& sourceList,
+                                                      std::vector<unsigned int>& ancestors) const {
 
+  ancestors.resize(sourceList.size());
   double inverseNum = 1.0f / sourceList.size();
   double start = m_RNG->getUniform() * inverseNum;  // random start in CDF
   double cumulativeWeight = 0.0f;
   unsigned int sourceIndex = 0;                     // index to draw from
   cumulativeWeight += sourceList[sourceIndex]->getWeight();
-  for (unsigned int destIndex = 0; destIndex < destinationList.size(); destIndex++) {
+  for (unsigned int destIndex = 0; destIndex < ancestors.size(); destIndex++) {
     double probSum = start + inverseNum * destIndex;     // amount of cumulative weight to reach
     while (probSum > cumulativeWeight) {                 // sum weights until
       sourceIndex++;
@@ -94,7 +104,18 @@ void ImportanceResampling<StateType>::resample(const ParticleList& sourceList,
       }
       cumulativeWeight += sourceList[sourceIndex]->getWeight(); // target sum reached
     }
-    *(destinationList[destIndex]) = *(sourceList[sourceIndex]);  // copy particle (via assignment operator)
+    ancestors[destIndex] = sourceIndex;
+  }
+  return true;
+}
+
+template <class StateType>
+void ImportanceResampling<StateType>::resample(const ParticleList& sourceList,
+                                               const ParticleList& destinationList) const {
+  std::vector<unsigned int> ancestors;
+  resampleIndices(sourceList, ancestors);
+  for (unsigned int destIndex = 0; destIndex < destinationList.size(); destIndex++) {
+    *(destinationList[destIndex]) = *(sourceList[ancestors[destIndex]]);  // copy particle (via assignment operator)
   }
 }
 
@@ -4,6 +4,8 @@
 #include <cmath>
 #include <algorithm>
 
+#include "libPF/RandomNumberGenerationStrategy.h"
+
 namespace libPF
 {
 
@@ -57,6 +59,23 @@ class MovementModel {
      */
     virtual void diffuse(StateType& state, double dt) const = 0;
 
+    /**
+     * diffuse() with a random number generator given by the caller. The
+     * parallel ParticleFilter passes one generator per worker here.
+     * The default implementation ignores @a rng and calls diffuse().
+     * @param state Reference to the state that has to be manipulated.
+     * @param dt time that has passed since the last filter update in seconds.
+     * @param rng random number generator of the calling worker.
+     */
+    virtual void diffuse(StateType& state, double dt,
+                         const RandomNumberGenerationStrategy* rng) const;
+
+    /**
+     * @return true if drift() and diffuse(state, dt, rng) may be called
+     *         concurrently for different states. Default is false.
+     */
+    virtual bool isThreadSafe() const;
+
   private:
 
 };
@@ -65,6 +84,17 @@ template <class StateType>
 MovementModel<StateType>::~MovementModel() {
 }
 
+template <class StateType>
+void MovementModel<StateType>::diffuse(StateType& state, double dt,
+                                       const RandomNumberGenerationStrategy* rng) const {
+    diffuse(state, dt);
+}
+
+template <class StateType>
+bool MovementModel<StateType>::isThreadSafe() const {
+    return false;
+}
+
 } // end of namespace
 #endif
 
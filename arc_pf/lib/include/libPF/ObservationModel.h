@@ -47,6 +47,12 @@ class ObservationModel {
      */
     virtual double measure(const StateType& state) const = 0;
 
+    /**
+     * @return true if measure() may be called concurrently for different
+     *         states. Default is false.
+     */
+    virtual bool isThreadSafe() const;
+
   private:
 
 };
@@ -55,6 +61,11 @@ template <class StateType>
 ObservationModel<StateType>::~ObservationModel() {
 }
 
+template <class StateType>
+bool ObservationModel<StateType>::isThreadSafe() const {
+    return false;
+}
+
 } // end of namespace
 #endif
 
@@ -0,0 +1,199 @@
+#ifndef PARALLELEXECUTION_H
+#define PARALLELEXECUTION_H
+
+#include <vector>
+#include <functional>
+#include <pthread.h>
+
+namespace libPF
+{
+
+/**
+ * @class ParallelExecution
+ *
+ * @brief Small persistent thread pool that partitions an index range.
+ *
+ * The range [0, n) is split into numThreads() contiguous blocks, block w is
+ * always processed by worker w (the calling thread is worker 0). So a worker
+ * sees the same particles in the same order for a fixed number of threads,
+ * which keeps per-worker random number streams reproducible.
+ * POSIX threads are used directly (std::mutex clashes with the lock() macro
+ * of rtklib.h).
+ *
+ * @see ParticleFilter
+ */
+class ParallelExecution {
+
+  public:
+
+    /**
+     * The function type of a parallel job.
+     * It is called as func(worker, begin, end) for each worker's block.
+     */
+    typedef std::function<void(unsigned int, unsigned int, unsigned int)> Job;
+
+    /**
+     * Creates the pool.
+     * @param numThreads number of workers including the calling thread,
+     *        0 and 1 mean serial execution.
+     */
+    ParallelExecution(unsigned int numThreads = 1);
+
+    /**
+     * Stops and joins all workers.
+     */
+    ~ParallelExecution();
+
+    /**
+     * @return number of workers including the calling thread
+     */
+    unsigned int numThreads() const;
+
+    /**
+     * @param n size of the index range
+     * @param worker index of worker
+     * @return first index of the block of @a worker
+     */
+    unsigned int blockBegin(unsigned int n, unsigned int worker) const;
+
+    /**
+     * Runs the job for all blocks of [0, n) and returns when all are done.
+     * @param n size of the index range
+     * @param job function called once per worker with its block
+     */
+    void run(unsigned int n, const Job& job);
+
+  private:
+
+    struct WorkerArg {
+        ParallelExecution* pool;
+        unsigned int worker;
+    };
+
+    static void* workerMain(void* arg);
+
+    void workerLoop(unsigned int worker);
+
+    // worker threads, worker 0 is the calling thread and has no entry here
+    std::vector<pthread_t> m_Threads;
+    std::vector<WorkerArg> m_Args;
+
+    pthread_mutex_t m_Mutex;
+    pthread_cond_t m_StartCondition;
+    pthread_cond_t m_DoneCondition;
+
+    // current job, its range size and the generation counter of jobs
+    const Job* m_Job;
+    unsigned int m_N;
+    unsigned long m_Generation;
+
+    // number of workers that have not finished the current job
+    unsigned int m_Pending;
+
+    bool m_Stop;
+};
+
+inline ParallelExecution::ParallelExecution(unsigned int numThreads) :
+    m_Job(0),
+    m_N(0),
+    m_Generation(0),
+    m_Pending(0),
+    m_Stop(false)
+{
+    pthread_mutex_init(&m_Mutex, NULL);
+    pthread_cond_init(&m_StartCondition, NULL);
+    pthread_cond_init(&m_DoneCondition, NULL);
+
+    if (numThreads <= 1) return;
+    m_Args.resize(numThreads - 1);
+    for (unsigned int i = 1; i < numThreads; i++) {
+        pthread_t thread;
+        m_Args[i - 1].pool = this;
+        m_Args[i - 1].worker = i;
+        if (pthread_create(&thread, NULL, &ParallelExecution::workerMain, &m_Args[i - 1])) {
+            break; // run with the threads created so far
+        }
+        m_Threads.push_back(thread);
+    }
+}
+
+inline ParallelExecution::~ParallelExecution() {
+    pthread_mutex_lock(&m_Mutex);
+    m_Stop = true;
+    pthread_cond_broadcast(&m_StartCondition);
+    pthread_mutex_unlock(&m_Mutex);
+    for (unsigned int i = 0; i < m_Threads.size(); i++) {
+        pthread_join(m_Threads[i], NULL);
+    }
+    pthread_cond_destroy(&m_StartCondition);
+    pthread_cond_destroy(&m_DoneCondition);
+    pthread_mutex_destroy(&m_Mutex);
+}
+
+inline unsigned int ParallelExecution::numThreads() const {
+    return m_Threads.size() + 1;
+}
+
+inline unsigned int ParallelExecution::blockBegin(unsigned int n, unsigned int worker) const {
+    return (unsigned int)((unsigned long long)n * worker / numThreads());
+}
+
+inline void ParallelExecution::run(unsigned int n, const Job& job) {
+    if (m_Threads.empty()) {
+        job(0, 0, n);
+        return;
+    }
+    pthread_mutex_lock(&m_Mutex);
+    m_Job = &job;
+    m_N = n;
+    m_Pending = m_Threads.size();
+    m_Generation++;
+    pthread_cond_broadcast(&m_StartCondition);
+    pthread_mutex_unlock(&m_Mutex);
+
+    job(0, 0, blockBegin(n, 1));
+
+    pthread_mutex_lock(&m_Mutex);
+    while (m_Pending > 0) {
+        pthread_cond_wait(&m_DoneCondition, &m_Mutex);
+    }
+    m_Job = 0;
+    pthread_mutex_unlock(&m_Mutex);
+}
+
+inline void* ParallelExecution::workerMain(void* arg) {
+    WorkerArg* workerArg = static_cast<WorkerArg*>(arg);
+    workerArg->pool->workerLoop(workerArg->worker);
+    return NULL;
+}
+
+inline void ParallelExecution::workerLoop(unsigned int worker) {
+    unsigned long generation = 0;
+    for (;;) {
+        const Job* job;
+        unsigned int n;
+
+        pthread_mutex_lock(&m_Mutex);
+        while (!m_Stop && m_Generation == generation) {
+            pthread_cond_wait(&m_StartCondition, &m_Mutex);
+        }
+        if (m_Stop) {
+            pthread_mutex_unlock(&m_Mutex);
+            return;
+        }
+        generation = m_Generation;
+        job = m_Job;
+        n = m_N;
+        pthread_mutex_unlock(&m_Mutex);
+
+        (*job)(worker, blockBegin(n, worker), blockBegin(n, worker + 1));
+
+        pthread_mutex_lock(&m_Mutex);
+        if (--m_Pending == 0) pthread_cond_signal(&m_DoneCondition);
+        pthread_mutex_unlock(&m_Mutex);
+    }
+}
+
+} // end of namespace
+
+#endif // PARALLELEXECUTION_H
@@ -12,6 +12,9 @@
 #include "libPF/CompareParticleWeights.h"
 #include "libPF/Particle.h"
 #include "libPF/StateDistribution.h"
+#include "libPF/ParallelExecution.h"
+#include "libPF/CRandomNumberGenerator.h"
+#include "libPF/CPhiloxRandomNumberGenerator.h"
 
 namespace libPF
 {
@@ -121,6 +124,13 @@ namespace libPF
  *   pf.drawAllFromDistribution(distribution);
  * @endcode
  *
+ * The drift, diffuse and measure steps and the weight reductions can run on
+ * a thread pool, see setNumThreads(). Particles are split into one contiguous
+ * block per worker and each worker draws from its own random number stream
+ * (see setSeed()), so results are reproducible for a fixed seed and number of
+ * threads. drift/diffuse and measure only run in parallel if the movement
+ * model and the observation model return true in isThreadSafe().
+ *
  * To traverse the particle list, you may use particleListBegin() and particleListEnd()
  * which return iterators to the beginning and to the end of the list respectively.
  *
@@ -332,9 +342,29 @@ class ParticleFilter {
      */
     StateType getBestXPercentEstimate(float x) const;
 
+    /**
+     * Sets the number of worker threads (including the calling thread).
+     * The random number streams of the workers are re-seeded.
+     * @param numThreads number of threads, 0 and 1 mean serial execution.
+     */
+    void setNumThreads(unsigned int numThreads);
+
+    /**
+     * @return the number of worker threads (including the calling thread)
+     */
+    unsigned int getNumThreads() const;
+
+    /**
+     * Seeds the random number streams of the workers, worker w uses a
+     * stream derived from @a seed and w. The default seed is time(0).
+     * @param seed seed of the particle filter
+     */
+    void setSeed(unsigned long long seed);
+
     /**
      * This method selects a new set of particles out of an old set according to their weight
-     * (importance resampling). The particles from the list m_CurrentList points to are used as source,
+     * (importance resampling). If the resampling strategy supports resampleIndices(), only the
+     * ancestor indices are drawn and the particles are gathered in one (parallel) pass. The particles from the list m_CurrentList points to are used as source,
      * m_LastList points to the destination list. The pointers m_CurrentList and m_LastList are switched.
      * The higher the weight of a particle, the more particles are drawn (copied) from this particle.
      * The weight remains untouched, because measure() will be called afterwards.
@@ -403,6 +433,13 @@ class ParticleFilter {
     // Stores the number of particles.
     unsigned int m_NumParticles;
 
+    // Stores the particles of both lists in one contiguous block,
+    // m_CurrentList and m_LastList point into it.
+    std::vector< Particle<StateType> > m_ParticlePool;
+
+    // Stores the ancestor index of each particle of the last resampling.
+    std::vector<unsigned int> m_Ancestors;
+
     // Holds a pointer to the observation strategy (used for weighting)
     ObservationModel<StateType>* m_ObservationModel;
 
@@ -415,6 +452,15 @@ class ParticleFilter {
     // The default resampling strategy.
     ImportanceResampling<StateType> m_DefaultResamplingStrategy;
 
+    // Stores the thread pool of drift, diffuse, measure and reductions.
+    ParallelExecution* m_Parallel;
+
+    // Stores one counter-based random number stream per worker (used in diffuse).
+    std::vector<CPhiloxRandomNumberGenerator*> m_WorkerRNG;
+
+    // Stores the seed of the worker random number streams.
+    unsigned long long m_Seed;
+
     // Stores the last filter time to have the right dt value for drift.
     clock_t m_LastDriftTime;
 
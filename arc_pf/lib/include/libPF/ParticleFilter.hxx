@@ -10,35 +10,39 @@ ParticleFilter<StateType>::ParticleFilter(unsigned int numParticles,
     m_ObservationModel(os),
     m_MovementModel(ms),
     m_ResamplingStrategy(&m_DefaultResamplingStrategy),
+    m_Parallel(new ParallelExecution(1)),
+    m_Seed((unsigned long long)time(0)),
     m_FirstRun(true),
     m_ResamplingMode(RESAMPLE_NEFF)
 {
 
   assert(numParticles > 0);
 
+  setSeed(m_Seed);
+
   // allocate memory for particle lists
   m_CurrentList.resize(numParticles);
   m_LastList.resize(numParticles);
 
   double initialWeight = 1.0 / numParticles;
+  // one contiguous block for both lists, never reallocated after this
+  m_ParticlePool.reserve(2 * numParticles);
+  for (unsigned int i = 0; i < 2 * numParticles; i++) {
+    m_ParticlePool.push_back(Particle<StateType>(StateType(), initialWeight));
+  }
   // fill particle lists
   for (unsigned int i = 0; i < numParticles; i++) {
-    m_CurrentList[i] = new Particle<StateType>(StateType(), initialWeight);
-    m_LastList[i] = new Particle<StateType>(StateType(), initialWeight);
+    m_CurrentList[i] = &m_ParticlePool[i];
+    m_LastList[i] = &m_ParticlePool[numParticles + i];
   }
 }
 template <class StateType>
 ParticleFilter<StateType>::~ParticleFilter() {
-    // release particles
-    ConstParticleIterator iter;
-    for (iter = m_CurrentList.begin(); iter != m_CurrentList.end(); ++iter)
-    {
-        delete *iter;
-    }
-    for (iter = m_LastList.begin(); iter != m_LastList.end(); ++iter)
-    {
-        delete *iter;
+    // particles are released with m_ParticlePool
+    for (unsigned int i = 0; i < m_WorkerRNG.size(); i++) {
+        delete m_WorkerRNG[i];
     }
+    delete m_Parallel;
 }
 
 
@@ -87,6 +91,33 @@ ResamplingMode ParticleFilter<StateType>::getResamplingMode() const {
     return m_ResamplingMode;
 }
 
+template <class StateType>
+void ParticleFilter<StateType>::setNumThreads(unsigned int numThreads) {
+    if (numThreads == 0) numThreads = 1;
+    if (numThreads == m_Parallel->numThreads()) return;
+    delete m_Parallel;
+    m_Parallel = new ParallelExecution(numThreads);
+    setSeed(m_Seed);
+}
+
+template <class StateType>
+unsigned int ParticleFilter<StateType>::getNumThreads() const {
+    return m_Parallel->numThreads();
+}
+
+template <class StateType>
+void ParticleFilter<StateType>::setSeed(unsigned long long seed) {
+    m_Seed = seed;
+    for (unsigned int i = 0; i < m_WorkerRNG.size(); i++) {
+        delete m_WorkerRNG[i];
+    }
+    m_WorkerRNG.resize(m_Parallel->numThreads());
+    for (unsigned int i = 0; i < m_WorkerRNG.size(); i++) {
+        // same key, stream number = worker index
+        m_WorkerRNG[i] = new CPhiloxRandomNumberGenerator(seed, i);
+    }
+}
+
 template <class StateType>
 void ParticleFilter<StateType>::setPriorState(const StateType& priorState) {
     ConstParticleIterator iter;
@@ -166,18 +197,29 @@ void ParticleFilter<StateType>::sort() {
 
 template <class StateType>
 void ParticleFilter<StateType>::normalize() {
+    std::vector<double> partialSum(m_Parallel->numThreads(), 0.0);
+    m_Parallel->run(m_NumParticles,
+        [this, &partialSum](unsigned int worker, unsigned int begin, unsigned int end) {
+            double sum = 0.0;
+            for (unsigned int i = begin; i < end; i++) {
+                sum += m_CurrentList[i]->getWeight();
+            }
+            partialSum[worker] = sum;
+        });
+    // sum up in worker order to be reproducible
     double weightSum = 0.0;
-    ConstParticleIterator iter;
-    for (iter = m_CurrentList.begin(); iter != m_CurrentList.end(); ++iter) {
-        weightSum += (*iter)->getWeight();
+    for (unsigned int i = 0; i < partialSum.size(); i++) {
+        weightSum += partialSum[i];
     }
     // only normalize if weightSum is big enough to devide
     if (weightSum > m_NumParticles * std::numeric_limits<double>::epsilon()) {
         double factor = 1.0 / weightSum;
-        for (iter = m_CurrentList.begin(); iter != m_CurrentList.end(); ++iter) {
-            double newWeight = (*iter)->getWeight() * factor;
-            (*iter)->setWeight(newWeight);
-        }
+        m_Parallel->run(m_NumParticles,
+            [this, factor](unsigned int, unsigned int begin, unsigned int end) {
+                for (unsigned int i = begin; i < end; i++) {
+                    m_CurrentList[i]->setWeight(m_CurrentList[i]->getWeight() * factor);
+                }
+            });
     }
     else {
         std::cerr << "WARNING: ParticleFilter::normalize(): "
@@ -189,13 +231,32 @@ template <class StateType>
 void ParticleFilter<StateType>::resample() {
   // swap lists
   m_CurrentList.swap(m_LastList);
-  // call resampling strategy
+  // call resampling strategy, index based strategies only draw the ancestors
+  // and the particles are gathered here in one pass
+  if (m_ResamplingStrategy->resampleIndices(m_LastList, m_Ancestors)) {
+    m_Parallel->run(m_NumParticles,
+        [this](unsigned int, unsigned int begin, unsigned int end) {
+          for (unsigned int i = begin; i < end; i++) {
+            *(m_CurrentList[i]) = *(m_LastList[m_Ancestors[i]]);
+          }
+        });
+    return;
+  }
   m_ResamplingStrategy->resample(m_LastList, m_CurrentList);
 }
 
 
 template <class StateType>
 void ParticleFilter<StateType>::drift(double dt) {
+  if (m_Parallel->numThreads() > 1 && m_MovementModel->isThreadSafe()) {
+    m_Parallel->run(m_NumParticles,
+        [this, dt](unsigned int, unsigned int begin, unsigned int end) {
+          for (unsigned int i = begin; i < end; i++) {
+            m_MovementModel->drift(m_CurrentList[i]->m_State, dt);
+          }
+        });
+    return;
+  }
   for (unsigned int i = 0; i < m_NumParticles; i++) {
     m_MovementModel->drift(m_CurrentList[i]->m_State, dt);
   }
@@ -203,17 +264,36 @@ void ParticleFilter<StateType>::drift(double dt) {
 
 template <class StateType>
 void ParticleFilter<StateType>::diffuse(double dt) {
+  if (m_Parallel->numThreads() > 1 && m_MovementModel->isThreadSafe()) {
+    m_Parallel->run(m_NumParticles,
+        [this, dt](unsigned int worker, unsigned int begin, unsigned int end) {
+          for (unsigned int i = begin; i < end; i++) {
+            m_MovementModel->diffuse(m_CurrentList[i]->m_State, dt, m_WorkerRNG[worker]);
+          }
+        });
+    return;
+  }
   for (unsigned int i = 0; i < m_NumParticles; i++) {
-    m_MovementModel->diffuse(m_CurrentList[i]->m_State, dt);
+    m_MovementModel->diffuse(m_CurrentList[i]->m_State, dt, m_WorkerRNG[0]);
   }
 }
 
 template <class StateType>
 void ParticleFilter<StateType>::measure() {
-  for (unsigned int i = 0; i < m_NumParticles; i++) {
-    // apply observation model
-    double weight = m_ObservationModel->measure(m_CurrentList[i]->getState());
-    m_CurrentList[i]->setWeight(weight);
+  if (m_Parallel->numThreads() > 1 && m_ObservationModel->isThreadSafe()) {
+    m_Parallel->run(m_NumParticles,
+        [this](unsigned int, unsigned int begin, unsigned int end) {
+          for (unsigned int i = begin; i < end; i++) {
+            m_CurrentList[i]->setWeight(m_ObservationModel->measure(m_CurrentList[i]->getState()));
+          }
+        });
+  }
+  else {
+    for (unsigned int i = 0; i < m_NumParticles; i++) {
+      // apply observation model
+      double weight = m_ObservationModel->measure(m_CurrentList[i]->getState());
+      m_CurrentList[i]->setWeight(weight);
+    }
   }
   // after measurement we have to re-sort and normalize the particles
   sort();
@@ -222,10 +302,19 @@ void ParticleFilter<StateType>::measure() {
 
 template <class StateType>
 unsigned int ParticleFilter<StateType>::getNumEffectiveParticles() const {
+  std::vector<double> partialSum(m_Parallel->numThreads(), 0.0);
+  m_Parallel->run(m_NumParticles,
+      [this, &partialSum](unsigned int worker, unsigned int begin, unsigned int end) {
+        double sum = 0.0;
+        for (unsigned int i = begin; i < end; i++) {
+          double weight = m_CurrentList[i]->getWeight();
+          sum += weight * weight;
+        }
+        partialSum[worker] = sum;
+      });
   double squareSum = 0;
-  for (unsigned int i = 0; i < m_NumParticles; i++) {
-    double weight = m_CurrentList[i]->getWeight();
-    squareSum += weight * weight;
+  for (unsigned int i = 0; i < partialSum.size(); i++) {
+    squareSum += partialSum[i];
   }
   return static_cast<int>(1.0f / squareSum);
 }
@@ -243,9 +332,22 @@ const StateType& ParticleFilter<StateType>::getBestState() const {
 
 template <class StateType>
 StateType ParticleFilter<StateType>::getMmseEstimate() const {
-  StateType estimate = m_CurrentList[0]->getState() * m_CurrentList[0]->getWeight();
-  for (unsigned int i = 1; i < m_NumParticles; i++) {
-    estimate += m_CurrentList[i]->getState() * m_CurrentList[i]->getWeight();
+  std::vector<StateType> partialEstimate(m_Parallel->numThreads());
+  std::vector<char> hasEstimate(m_Parallel->numThreads(), 0);
+  m_Parallel->run(m_NumParticles,
+      [this, &partialEstimate, &hasEstimate](unsigned int worker, unsigned int begin, unsigned int end) {
+        if (begin >= end) return;
+        StateType estimate = m_CurrentList[begin]->getState() * m_CurrentList[begin]->getWeight();
+        for (unsigned int i = begin + 1; i < end; i++) {
+          estimate += m_CurrentList[i]->getState() * m_CurrentList[i]->getWeight();
+        }
+        partialEstimate[worker] = estimate;
+        hasEstimate[worker] = 1;
+      });
+  // sum up in worker order to be reproducible, worker 0 always has particle 0
+  StateType estimate = partialEstimate[0];
+  for (unsigned int i = 1; i < partialEstimate.size(); i++) {
+    if (hasEstimate[i]) estimate += partialEstimate[i];
   }
   return estimate;
 }
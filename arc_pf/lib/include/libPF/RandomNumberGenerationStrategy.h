@@ -49,6 +49,31 @@ class RandomNumberGenerationStrategy {
      * @return random integer number between min and max, uniform distributed.
      */
     virtual double getRandInt(double min, double max) const =0;
+
+    /**
+     * Fills an array with uniform distributed random numbers between min and max.
+     * The default implementation calls getUniform() for each element.
+     * @param values array to fill
+     * @param n number of values
+     * @param min the minimum value
+     * @param max the maximum value
+     */
+    virtual void fillUniform(double* values, unsigned int n,
+                             double min = 0.0, double max = 1.0) const {
+        for (unsigned int i = 0; i < n; i++) values[i] = getUniform(min, max);
+    }
+
+    /**
+     * Fills an array with N(0, d*d)-distributed random numbers.
+     * The default implementation calls getGaussian() for each element.
+     * @param values array to fill
+     * @param n number of values
+     * @param standardDeviation Standard deviation d of the random numbers.
+     */
+    virtual void fillGaussian(double* values, unsigned int n,
+                              double standardDeviation) const {
+        for (unsigned int i = 0; i < n; i++) values[i] = getGaussian(standardDeviation);
+    }
 };
 
 } // end of namespace
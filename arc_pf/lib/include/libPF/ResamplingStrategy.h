@@ -47,12 +47,31 @@ class ResamplingStrategy {
      * @param destination the destination list where to put the copies.
      */
     virtual void resample(const ParticleList& source, const ParticleList& destination) const = 0;
+
+    /**
+     * Index based resampling. Instead of copying particles, the strategy only
+     * writes the index of the source particle (the ancestor) of each new
+     * particle to @a ancestors, and the caller gathers the particles in one pass.
+     * The default implementation returns false, then resample() is used.
+     * @param source the source list to draw new particles from.
+     * @param ancestors index of source particle for each new particle
+     *        (resized to the size of source).
+     * @return true if @a ancestors was filled.
+     */
+    virtual bool resampleIndices(const ParticleList& source,
+                                 std::vector<unsigned int>& ancestors) const;
 };
 
 template <class StateType>
 ResamplingStrategy<StateType>::~ResamplingStrategy() {
 }
 
+template <class StateType>
+bool ResamplingStrategy<StateType>::resampleIndices(const ParticleList& source,
+                                                    std::vector<unsigned int>& ancestors) const {
+    return false;
+}
+
 } // end of namespace
 #endif // RESAMPLINGSTRATEGY_H
 
@@ -0,0 +1,344 @@
+#include <cmath>
+
+#include "libPF/CPhiloxRandomNumberGenerator.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PHILOX_SSE2
+#endif
+
+using namespace libPF;
+
+namespace {
+
+const unsigned int PHILOX_M0 = 0xD2511F53u;
+const unsigned int PHILOX_M1 = 0xCD9E8D57u;
+const unsigned int PHILOX_W0 = 0x9E3779B9u;
+const unsigned int PHILOX_W1 = 0xBB67AE85u;
+const double TWO_PI = 6.283185307179586476925286766559;
+const double P2_53 = 1.0 / 9007199254740992.0;
+
+// number of values converted per batch in fillUniform()/fillGaussian()
+const unsigned int BATCH = 256;
+
+#ifdef PHILOX_SSE2
+
+// 32x32->64 bit products of four lanes, high and low words
+inline void mulhilo(__m128i a, __m128i m, __m128i* hi, __m128i* lo)
+{
+    const __m128i mask = _mm_set_epi32(0, -1, 0, -1);
+    __m128i even = _mm_mul_epu32(a, m);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), m);
+
+    *lo = _mm_or_si128(_mm_and_si128(even, mask), _mm_slli_epi64(odd, 32));
+    *hi = _mm_or_si128(_mm_srli_epi64(even, 32), _mm_andnot_si128(mask, odd));
+}
+
+// Philox4x32-10 of four consecutive counters, one counter per lane
+void philox4(const unsigned int counter[4], const unsigned int key[2], unsigned int out[16])
+{
+    unsigned int lo[4], hi[4];
+
+    for (int j = 0; j < 4; j++) {
+        lo[j] = counter[0] + j;
+        hi[j] = counter[1] + (lo[j] < counter[0]);
+    }
+    __m128i c0 = _mm_loadu_si128((const __m128i*)lo);
+    __m128i c1 = _mm_loadu_si128((const __m128i*)hi);
+    __m128i c2 = _mm_set1_epi32((int)counter[2]);
+    __m128i c3 = _mm_set1_epi32((int)counter[3]);
+    __m128i k0 = _mm_set1_epi32((int)key[0]);
+    __m128i k1 = _mm_set1_epi32((int)key[1]);
+    const __m128i m0 = _mm_set1_epi32((int)PHILOX_M0), m1 = _mm_set1_epi32((int)PHILOX_M1);
+    const __m128i w0 = _mm_set1_epi32((int)PHILOX_W0), w1 = _mm_set1_epi32((int)PHILOX_W1);
+    __m128i h0, l0, h1, l1;
+
+    for (int round = 0; round < 10; round++) {
+        mulhilo(c0, m0, &h0, &l0);
+        mulhilo(c2, m1, &h1, &l1);
+        c0 = _mm_xor_si128(_mm_xor_si128(h1, c1), k0);
+        c2 = _mm_xor_si128(_mm_xor_si128(h0, c3), k1);
+        c1 = l1;
+        c3 = l0;
+        k0 = _mm_add_epi32(k0, w0);
+        k1 = _mm_add_epi32(k1, w1);
+    }
+    // lanes to blocks in counter order
+    __m128i t0 = _mm_unpacklo_epi32(c0, c1), t1 = _mm_unpacklo_epi32(c2, c3);
+    __m128i t2 = _mm_unpackhi_epi32(c0, c1), t3 = _mm_unpackhi_epi32(c2, c3);
+    _mm_storeu_si128((__m128i*)out,        _mm_unpacklo_epi64(t0, t1));
+    _mm_storeu_si128((__m128i*)(out + 4),  _mm_unpackhi_epi64(t0, t1));
+    _mm_storeu_si128((__m128i*)(out + 8),  _mm_unpacklo_epi64(t2, t3));
+    _mm_storeu_si128((__m128i*)(out + 12), _mm_unpackhi_epi64(t2, t3));
+}
+
+// natural logarithm of two positive normal doubles (fdlibm e_log.c kernel)
+inline __m128d log_pd(__m128d x)
+{
+    const __m128i mant = _mm_set_epi32(0x000FFFFF, -1, 0x000FFFFF, -1);
+    const __m128i one = _mm_set_epi32(0x3FF00000, 0, 0x3FF00000, 0);
+    const __m128i p52 = _mm_set_epi32(0x43300000, 0, 0x43300000, 0);
+    const __m128d Lg1 = _mm_set1_pd(6.666666666666735130e-01);
+    const __m128d Lg2 = _mm_set1_pd(3.999999999940941908e-01);
+    const __m128d Lg3 = _mm_set1_pd(2.857142874366239149e-01);
+    const __m128d Lg4 = _mm_set1_pd(2.222219843214978396e-01);
+    const __m128d Lg5 = _mm_set1_pd(1.818357216161805012e-01);
+    const __m128d Lg6 = _mm_set1_pd(1.531383769920937332e-01);
+    const __m128d Lg7 = _mm_set1_pd(1.479819860511658591e-01);
+    const __m128d half = _mm_set1_pd(0.5), dOne = _mm_set1_pd(1.0), two = _mm_set1_pd(2.0);
+    __m128i bits = _mm_castpd_si128(x);
+
+    // x = m * 2^e with m in [sqrt(2)/2, sqrt(2))
+    __m128d m = _mm_castsi128_pd(_mm_or_si128(_mm_and_si128(bits, mant), one));
+    __m128d e = _mm_sub_pd(_mm_castsi128_pd(_mm_or_si128(_mm_srli_epi64(bits, 52), p52)),
+                           _mm_set1_pd(4503599627370496.0 + 1023.0));
+    __m128d big = _mm_cmpgt_pd(m, _mm_set1_pd(1.41421356237309504880));
+    m = _mm_or_pd(_mm_and_pd(big, _mm_mul_pd(m, half)), _mm_andnot_pd(big, m));
+    e = _mm_add_pd(e, _mm_and_pd(big, dOne));
+
+    __m128d f = _mm_sub_pd(m, dOne);
+    __m128d s = _mm_div_pd(f, _mm_add_pd(two, f));
+    __m128d z = _mm_mul_pd(s, s), w = _mm_mul_pd(z, z);
+    __m128d t1 = _mm_mul_pd(w, _mm_add_pd(Lg2, _mm_mul_pd(w, _mm_add_pd(Lg4, _mm_mul_pd(w, Lg6)))));
+    __m128d t2 = _mm_mul_pd(z, _mm_add_pd(Lg1, _mm_mul_pd(w, _mm_add_pd(Lg3,
+                 _mm_mul_pd(w, _mm_add_pd(Lg5, _mm_mul_pd(w, Lg7)))))));
+    __m128d R = _mm_add_pd(t2, t1);
+    __m128d hfsq = _mm_mul_pd(half, _mm_mul_pd(f, f));
+
+    // e*ln2_hi-((hfsq-(s*(hfsq+R)+e*ln2_lo))-f)
+    __m128d lo = _mm_add_pd(_mm_mul_pd(s, _mm_add_pd(hfsq, R)),
+                            _mm_mul_pd(e, _mm_set1_pd(1.90821492927058770002e-10)));
+    return _mm_sub_pd(_mm_mul_pd(e, _mm_set1_pd(6.93147180369123816490e-01)),
+                      _mm_sub_pd(_mm_sub_pd(hfsq, lo), f));
+}
+
+// sin and cos of 2*pi*u for two u in [0, 1) (fdlibm k_sin.c/k_cos.c kernels)
+inline void sincos2pi_pd(__m128d u, __m128d* sn, __m128d* cs)
+{
+    const __m128d S1 = _mm_set1_pd(-1.66666666666666324348e-01);
+    const __m128d S2 = _mm_set1_pd( 8.33333333332248946124e-03);
+    const __m128d S3 = _mm_set1_pd(-1.98412698298579493134e-04);
+    const __m128d S4 = _mm_set1_pd( 2.75573137070700676789e-06);
+    const __m128d S5 = _mm_set1_pd(-2.50507602534068634195e-08);
+    const __m128d S6 = _mm_set1_pd( 1.58969099521155010221e-10);
+    const __m128d C1 = _mm_set1_pd( 4.16666666666666019037e-02);
+    const __m128d C2 = _mm_set1_pd(-1.38888888888741095749e-03);
+    const __m128d C3 = _mm_set1_pd( 2.48015872894767294178e-05);
+    const __m128d C4 = _mm_set1_pd(-2.75573143513906633035e-07);
+    const __m128d C5 = _mm_set1_pd( 2.08757232129817482790e-09);
+    const __m128d C6 = _mm_set1_pd(-1.13596475577881948265e-11);
+    const __m128d dOne = _mm_set1_pd(1.0), sign = _mm_set1_pd(-0.0);
+    const __m128i i1 = _mm_set1_epi32(1), i2 = _mm_set1_epi32(2);
+
+    // 2*pi*u = n*pi/2 + r with |r| <= pi/4 (4*u-n is exact)
+    __m128d t = _mm_mul_pd(u, _mm_set1_pd(4.0));
+    __m128i n = _mm_cvtpd_epi32(t);
+    __m128d r = _mm_mul_pd(_mm_sub_pd(t, _mm_cvtepi32_pd(n)),
+                           _mm_set1_pd(1.57079632679489661923));
+    __m128d z = _mm_mul_pd(r, r);
+
+    __m128d ps = _mm_add_pd(S5, _mm_mul_pd(z, S6));
+    ps = _mm_add_pd(S4, _mm_mul_pd(z, ps));
+    ps = _mm_add_pd(S3, _mm_mul_pd(z, ps));
+    ps = _mm_add_pd(S2, _mm_mul_pd(z, ps));
+    ps = _mm_add_pd(S1, _mm_mul_pd(z, ps));
+    __m128d sr = _mm_add_pd(r, _mm_mul_pd(_mm_mul_pd(r, z), ps));
+
+    __m128d pc = _mm_add_pd(C5, _mm_mul_pd(z, C6));
+    pc = _mm_add_pd(C4, _mm_mul_pd(z, pc));
+    pc = _mm_add_pd(C3, _mm_mul_pd(z, pc));
+    pc = _mm_add_pd(C2, _mm_mul_pd(z, pc));
+    pc = _mm_add_pd(C1, _mm_mul_pd(z, pc));
+    __m128d hz = _mm_mul_pd(_mm_set1_pd(0.5), z);
+    __m128d w = _mm_sub_pd(dOne, hz);
+    __m128d cr = _mm_add_pd(w, _mm_add_pd(_mm_sub_pd(_mm_sub_pd(dOne, w), hz),
+                                          _mm_mul_pd(_mm_mul_pd(z, z), pc)));
+
+    // quadrant n: swap for odd n, cos negative for n=1,2 and sin for n=2,3
+    __m128i nn = _mm_shuffle_epi32(n, _MM_SHUFFLE(1, 1, 0, 0));
+    __m128d q1 = _mm_castsi128_pd(_mm_cmpeq_epi32(_mm_and_si128(nn, i1), i1));
+    __m128d q2 = _mm_castsi128_pd(_mm_cmpeq_epi32(_mm_and_si128(nn, i2), i2));
+    __m128d c = _mm_or_pd(_mm_and_pd(q1, sr), _mm_andnot_pd(q1, cr));
+    __m128d s = _mm_or_pd(_mm_and_pd(q1, cr), _mm_andnot_pd(q1, sr));
+    *cs = _mm_xor_pd(c, _mm_and_pd(_mm_xor_pd(q1, q2), sign));
+    *sn = _mm_xor_pd(s, _mm_and_pd(q2, sign));
+}
+
+#endif // PHILOX_SSE2
+
+}
+
+CPhiloxRandomNumberGenerator::CPhiloxRandomNumberGenerator(unsigned long long seed,
+                                                           unsigned long long stream)
+{
+    setSeed(seed, stream);
+}
+
+CPhiloxRandomNumberGenerator::~CPhiloxRandomNumberGenerator()
+{
+}
+
+void CPhiloxRandomNumberGenerator::setSeed(unsigned long long seed,
+                                           unsigned long long stream)
+{
+    m_Key[0] = (unsigned int)seed;
+    m_Key[1] = (unsigned int)(seed >> 32);
+    m_Counter[0] = m_Counter[1] = 0;
+    m_Counter[2] = (unsigned int)stream;
+    m_Counter[3] = (unsigned int)(stream >> 32);
+    m_BlockIndex = 4;
+    m_GaussianBufferFilled = false;
+    m_GaussianBufferVariable = 0.0;
+}
+
+void CPhiloxRandomNumberGenerator::philox(const unsigned int counter[4],
+                                          const unsigned int key[2],
+                                          unsigned int out[4])
+{
+    unsigned int c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+    unsigned int k0 = key[0], k1 = key[1];
+
+    for (int round = 0; round < 10; round++) {
+        unsigned long long p0 = (unsigned long long)PHILOX_M0 * c0;
+        unsigned long long p1 = (unsigned long long)PHILOX_M1 * c2;
+        unsigned int n0 = (unsigned int)(p1 >> 32) ^ c1 ^ k0;
+        unsigned int n2 = (unsigned int)(p0 >> 32) ^ c3 ^ k1;
+        c0 = n0;
+        c1 = (unsigned int)p1;
+        c2 = n2;
+        c3 = (unsigned int)p0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+}
+
+unsigned int CPhiloxRandomNumberGenerator::next32() const
+{
+    if (m_BlockIndex >= 4) {
+        philox(m_Counter, m_Key, m_Block);
+        if (++m_Counter[0] == 0) ++m_Counter[1];
+        m_BlockIndex = 0;
+    }
+    return m_Block[m_BlockIndex++];
+}
+
+void CPhiloxRandomNumberGenerator::fillBits(unsigned int* bits, unsigned int n) const
+{
+    unsigned int i = 0;
+
+    // rest of the current block first, so the sequence equals next32()
+    while (i < n && m_BlockIndex < 4) bits[i++] = m_Block[m_BlockIndex++];
+
+#ifdef PHILOX_SSE2
+    // four blocks per call of the lane-parallel block function
+    for (; n - i >= 16; i += 16) {
+        philox4(m_Counter, m_Key, bits + i);
+        if ((m_Counter[0] += 4) < 4) ++m_Counter[1];
+    }
+#endif
+    while (i < n) bits[i++] = next32();
+}
+
+double CPhiloxRandomNumberGenerator::next53() const
+{
+    unsigned int a = next32() >> 5, b = next32() >> 6;
+    return (a * 67108864.0 + b) * P2_53;
+}
+
+double CPhiloxRandomNumberGenerator::getUniform(double min, double max) const
+{
+    return min + (max - min) * next53();
+}
+
+double CPhiloxRandomNumberGenerator::getRandInt(double min, double max) const
+{
+    return double(int(min + (max - min) * next53()));
+}
+
+double CPhiloxRandomNumberGenerator::getGaussian(double standardDeviation) const
+{
+    if (standardDeviation < 0) {
+        standardDeviation = -standardDeviation;
+    }
+    if (m_GaussianBufferFilled) {
+        m_GaussianBufferFilled = false;
+        return standardDeviation * m_GaussianBufferVariable;
+    }
+    double u1 = 1.0 - next53(), u2 = next53(); // u1 in (0, 1]
+    double r = sqrt(-2.0 * log(u1));
+    m_GaussianBufferVariable = r * sin(TWO_PI * u2);
+    m_GaussianBufferFilled = true;
+    return standardDeviation * r * cos(TWO_PI * u2);
+}
+
+void CPhiloxRandomNumberGenerator::fillUniform(double* values, unsigned int n,
+                                               double min, double max) const
+{
+    unsigned int bits[2 * BATCH];
+    double range = max - min;
+
+    for (unsigned int i = 0; i < n; i += BATCH) {
+        unsigned int m = n - i < BATCH ? n - i : BATCH, j = 0;
+
+        fillBits(bits, 2 * m);
+
+        // 53-bit doubles from pairs of 32-bit words
+#ifdef PHILOX_SSE2
+        const __m128d vmin = _mm_set1_pd(min), vrange = _mm_set1_pd(range);
+        const __m128d p26 = _mm_set1_pd(67108864.0), p53 = _mm_set1_pd(P2_53);
+
+        for (; j + 2 <= m; j += 2) {
+            __m128i w = _mm_loadu_si128((const __m128i*)(bits + 2 * j));
+            __m128d a = _mm_cvtepi32_pd(_mm_shuffle_epi32(_mm_srli_epi32(w, 5), _MM_SHUFFLE(3, 1, 2, 0)));
+            __m128d b = _mm_cvtepi32_pd(_mm_shuffle_epi32(_mm_srli_epi32(w, 6), _MM_SHUFFLE(3, 1, 3, 1)));
+            __m128d u = _mm_mul_pd(_mm_add_pd(_mm_mul_pd(a, p26), b), p53);
+            _mm_storeu_pd(values + i + j, _mm_add_pd(vmin, _mm_mul_pd(vrange, u)));
+        }
+#endif
+        for (; j < m; j++) {
+            double u = ((bits[2 * j] >> 5) * 67108864.0 + (bits[2 * j + 1] >> 6)) * P2_53;
+            values[i + j] = min + range * u;
+        }
+    }
+}
+
+void CPhiloxRandomNumberGenerator::fillGaussian(double* values, unsigned int n,
+                                                double standardDeviation) const
+{
+    double u[2 * BATCH];
+
+    if (standardDeviation < 0) {
+        standardDeviation = -standardDeviation;
+    }
+    for (unsigned int i = 0; i < n; i += 2 * BATCH) {
+        unsigned int m = n - i < 2 * BATCH ? n - i : 2 * BATCH;
+        unsigned int pairs = (m + 1) / 2, j = 0;
+
+        fillUniform(u, 2 * pairs);
+
+        // Box-Muller on pairs (u1 in (0, 1])
+#ifdef PHILOX_SSE2
+        const __m128d dOne = _mm_set1_pd(1.0), scale = _mm_set1_pd(-2.0 * standardDeviation * standardDeviation);
+
+        if (pairs % 2) u[2 * pairs] = u[2 * pairs + 1] = 0.5; // pad to two pairs
+        for (; j < pairs; j += 2) {
+            __m128d v0 = _mm_loadu_pd(u + 2 * j), v1 = _mm_loadu_pd(u + 2 * j + 2);
+            __m128d r = _mm_sqrt_pd(_mm_mul_pd(scale, log_pd(_mm_sub_pd(dOne, _mm_unpacklo_pd(v0, v1)))));
+            __m128d s, c;
+            sincos2pi_pd(_mm_unpackhi_pd(v0, v1), &s, &c);
+            c = _mm_mul_pd(r, c);
+            s = _mm_mul_pd(r, s);
+            _mm_storeu_pd(u + 2 * j, _mm_unpacklo_pd(c, s));
+            _mm_storeu_pd(u + 2 * j + 2, _mm_unpackhi_pd(c, s));
+        }
+#endif
+        for (; j < pairs; j++) {
+            double r = standardDeviation * sqrt(-2.0 * log(1.0 - u[2 * j]));
+            double a = TWO_PI * u[2 * j + 1];
+            u[2 * j] = r * cos(a);
+            u[2 * j + 1] = r * sin(a);
+        }
+        for (j = 0; j < m; j++) values[i + j] = u[j];
+    }
+}
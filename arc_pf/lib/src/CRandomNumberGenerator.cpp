@@ -12,13 +12,32 @@ CRandomNumberGenerator::CRandomNumberGenerator()
     init();
 }
 
+CRandomNumberGenerator::CRandomNumberGenerator(unsigned long long seed)
+{
+    setSeed(seed);
+}
+
 CRandomNumberGenerator::~CRandomNumberGenerator()
 {
 }
 
 void CRandomNumberGenerator::init()
 {
-    srand(time(0));
+    setSeed((unsigned long long)time(0));
+}
+
+void CRandomNumberGenerator::setSeed(unsigned long long seed)
+{
+    m_State = seed;
+    m_GaussianBufferFilled = false;
+    m_GaussianBufferVariable = 0.0;
+    next(); // decorrelate small seeds
+}
+
+unsigned int CRandomNumberGenerator::next() const
+{
+    m_State = m_State * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (unsigned int)(m_State >> 33);
 }
 
 double CRandomNumberGenerator::getGaussian(double standardDeviation) const
@@ -53,9 +72,9 @@ double CRandomNumberGenerator::getGaussian(double standardDeviation) const
 double CRandomNumberGenerator::getUniform(double min, double max) const
 {
     double range = max - min;
-    return 1.0 * rand() / RAND_MAX * range + min;
+    return 1.0 * next() / 2147483647.0 * range + min;
 }
 double CRandomNumberGenerator::getRandInt(double min, double max) const {
   double range=max-min;
-  return double(int(1.0*rand()/RAND_MAX*range+min));
+  return double(int(1.0*next()/2147483647.0*range+min));
 }
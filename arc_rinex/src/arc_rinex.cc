@@ -1511,6 +1511,75 @@ extern int arc_readrnx(const char *file, int rcv, const char *opt, obs_t *obs,
     
     return arc_readrnxt(file, rcv, t, t, 0.0, opt, obs, nav, sta);
 }
+/* initialize rinex control ----------------------------------------------------
+* initialize rinex control struct for reading rinex observation stream
+* args   : rnxctr_t *rnx    IO  rinex control struct
+* return : status (1:ok,0:memory allocation error)
+*-----------------------------------------------------------------------------*/
+extern int arc_init_rnxctr(rnxctr_t *rnx)
+{
+    arc_log(ARC_INFO,"arc_init_rnxctr:\n");
+
+    memset(rnx,0,sizeof(rnxctr_t));
+
+    if (!(rnx->obs.data=(obsd_t *)malloc(sizeof(obsd_t)*MAXOBS))) return 0;
+    rnx->obs.nmax=MAXOBS;
+    init_sta(&rnx->sta);
+    return 1;
+}
+/* free rinex control --------------------------------------------------------*/
+extern void arc_free_rnxctr(rnxctr_t *rnx)
+{
+    arc_log(ARC_INFO,"arc_free_rnxctr:\n");
+
+    free(rnx->obs.data); rnx->obs.data=NULL; rnx->obs.n=rnx->obs.nmax=0;
+}
+/* open rinex observation stream -----------------------------------------------
+* read rinex header of observation stream
+* args   : rnxctr_t *rnx    IO  rinex control struct
+*          FILE   *fp       I   rinex observation stream
+* return : status (1:ok,0:no rinex observation header)
+*-----------------------------------------------------------------------------*/
+extern int arc_open_rnxctr(rnxctr_t *rnx, FILE *fp)
+{
+    arc_log(ARC_INFO,"arc_open_rnxctr:\n");
+
+    if (!readrnxh(fp,&rnx->ver,&rnx->type,&rnx->sys,&rnx->tsys,rnx->tobs,
+                  &rnx->nav,&rnx->sta)) {
+        arc_log(ARC_WARNING,"arc_open_rnxctr: rinex header error\n");
+        return 0;
+    }
+    if (rnx->type!='O') {
+        arc_log(ARC_WARNING,"arc_open_rnxctr: not observation type=%c\n",rnx->type);
+        return 0;
+    }
+    return 1;
+}
+/* input rinex observation stream ----------------------------------------------
+* read next epoch of rinex observation stream
+* args   : rnxctr_t *rnx    IO  rinex control struct
+*          FILE   *fp       I   rinex observation stream
+* return : status (-2:end of stream,0:no observation data,1:observation data)
+* notes  : observation data of epoch are set to rnx->obs (time in gpst)
+*-----------------------------------------------------------------------------*/
+extern int arc_input_rnxctr(rnxctr_t *rnx, FILE *fp)
+{
+    obsd_t *data=rnx->obs.data;
+    int i,n,flag=0;
+
+    if ((n=readrnxobsb(fp,rnx->opt,rnx->ver,rnx->tobs,&flag,data))<0) return -2;
+
+    for (i=0;i<n;i++) {
+        if (rnx->tsys==TSYS_UTC) data[i].time=utc2gpst(data[i].time);
+        saveslips(rnx->slips,data+i);
+        restslips(rnx->slips,data+i);
+    }
+    rnx->obs.n=n;
+    if (n<=0) return 0;
+
+    rnx->time=data[0].time;
+    return 1;
+}
 /* compare precise clock -----------------------------------------------------*/
 static int cmppclk(const void *p1, const void *p2)
 {
@@ -1855,7 +1924,7 @@ extern int arc_readsap(const char *file, gtime_t time, nav_t *nav)
         pcv= arc_searchpcv(i + 1, "", time, &pcvs);
         nav->pcvs[i]=pcv?*pcv:pcv0;
     }
-    free(pcvs.pcv);
+    arc_freepcv(&pcvs);
     return 1;
 }
 /* read dcb parameters file --------------------------------------------------*/
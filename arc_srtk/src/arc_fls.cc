@@ -0,0 +1,361 @@
+/*********************************************************************************
+ *  ARC-SRTK - Single Frequency RTK Pisitioning Library
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************************/
+
+/**
+ * @brief ARC-SRTK fixed-lag smoother
+ *
+ * rauch-tung-striebel smoother of the forward filter over a sliding lag.
+ * every epoch of the forward filter keeps a snapshot of the filtered states
+ * (all states active in the filter: position/velocity, ionosphere,
+ * troposphere and phase-biases) and covariance, the prediction of these
+ * states from the previous epoch and the smoother gain to the next epoch in
+ * a ring buffer. epochs older than the lag are smoothed in blocks by a
+ * backward pass over the linked epochs and the position/velocity of them is
+ * output, so memory and output delay are bounded by the lag and not by the
+ * session length.
+ *
+ * the prediction and the cross-covariance of the filtered states with the
+ * predicted states are taken from the time update of the filter itself:
+ * arc_udstate() calls arc_fls_udpos() for the transition of position and
+ * velocity, arc_initx() calls arc_fls_retire() for re-initialized states and
+ * arc_fls_pred() stores the predicted states before the measurement update.
+ * so the gain C=P*F'*Pp^-1 is the exact gain of the filter states, cross
+ * terms of position with the other states included. epochs are linked only
+ * if the filter propagated the states from the previous snapshot exactly
+ * once (rtk->ntu), position resets or missing filter updates cut the chain.
+ * fixed solutions are output as they are. kinematic mode without dynamics
+ * resets the position every epoch, so the smoother is refused there.
+ */
+#include "arc.h"
+
+#define FLS_LAG         60.0        /* default smoother lag (s) */
+#define FLS_NEP         64          /* initial number of epochs */
+#define FLS_BLK         0.25        /* smoothing block (ratio to lag) */
+#define FLS_MAXEP       3600        /* max number of epochs in lag */
+
+#define FLS_EP(s,i)     ((s)->ep+((s)->head+(i))%(s)->nmax)
+
+/* enlarge epoch buffer ------------------------------------------------------*/
+static int arc_fls_grow(fls_t *s)
+{
+    flsep_t *ep;
+    int i,nmax=s->nmax<=0?FLS_NEP:s->nmax*2;
+
+    if (!(ep=(flsep_t *)malloc(sizeof(flsep_t)*nmax))) return 0;
+    for (i=0;i<s->n;i++) ep[i]=*FLS_EP(s,i);
+    free(s->ep);
+    s->ep=ep; s->nmax=nmax; s->head=0;
+    return 1;
+}
+/* free states of epoch ------------------------------------------------------*/
+static void arc_fls_epfree(flsep_t *ep)
+{
+    free(ep->ix); free(ep->x); free(ep->C);
+    ep->ix=NULL; ep->x=ep->P=ep->xp=ep->Pp=ep->C=NULL;
+    ep->na=0;
+}
+/* number of filtered states of newest epoch ---------------------------------*/
+static int arc_fls_na(const fls_t *s)
+{
+    return s->n>0?FLS_EP(s,s->n-1)->na:0;
+}
+/* set filtered states of epoch ----------------------------------------------*/
+static int arc_fls_states(const fls_t *s, flsep_t *ep, const rtk_t *rtk)
+{
+    int i,j,na,nx=rtk->nx;
+
+    /* states active in the filter as arc_filter(), position always */
+    for (i=0;i<3;i++) {
+        if (rtk->x[i]==0.0||rtk->P[i+i*nx]<=0.0) return 0;
+    }
+    for (i=na=0;i<nx;i++) if (rtk->x[i]!=0.0&&rtk->P[i+i*nx]>0.0) na++;
+
+    ep->ix=arc_imat(na,1); ep->x=arc_mat(2*na*(na+1),1);
+    ep->P=ep->x+na; ep->xp=ep->P+na*na; ep->Pp=ep->xp+na;
+    ep->na=na;
+
+    for (i=na=0;i<nx;i++) if (rtk->x[i]!=0.0&&rtk->P[i+i*nx]>0.0) ep->ix[na++]=i;
+    for (i=0;i<na;i++) {
+        ep->x[i]=rtk->x[ep->ix[i]];
+        for (j=0;j<na;j++) ep->P[i+j*na]=rtk->P[ep->ix[i]+ep->ix[j]*nx];
+    }
+    return 1;
+}
+/* link epoch to previous epoch ----------------------------------------------*/
+static int arc_fls_link(const fls_t *s, flsep_t *prev, flsep_t *ep)
+{
+    double *Pi,*Pc;
+    int i,j,m=prev->na,na=ep->na,nx=s->nx;
+
+    /* xp, Pp of filter states of epoch */
+    for (i=0;i<na;i++) {
+        ep->xp[i]=s->xp[ep->ix[i]];
+        for (j=0;j<na;j++) ep->Pp[i+j*na]=s->Pp[ep->ix[i]+ep->ix[j]*nx];
+    }
+    Pi=arc_mat(na,na); Pc=arc_mat(m,na);
+    arc_matcpy(Pi,ep->Pp,na,na);
+    if (arc_matinv(Pi,na)) {
+        free(Pi); free(Pc);
+        return 0;
+    }
+    /* C=P*F'*Pp^-1 (P*F': cross-covariance by time update of filter) */
+    for (j=0;j<na;j++) for (i=0;i<m;i++) Pc[i+j*m]=s->Pc[i+ep->ix[j]*m];
+    free(prev->C);
+    prev->C=arc_mat(m,na);
+    arc_matmul("NN",m,na,na,1.0,Pc,Pi,0.0,prev->C);
+    free(Pi); free(Pc);
+    return 1;
+}
+/* start cross-covariance of time update from epoch --------------------------*/
+static void arc_fls_cross(fls_t *s, const flsep_t *ep, const rtk_t *rtk)
+{
+    int i,j,na=ep->na,nx=rtk->nx;
+
+    if (s->nx!=nx) {
+        free(s->Pc); free(s->xp); free(s->Pp);
+        s->Pc=arc_mat(nx,nx); s->xp=arc_mat(nx,1); s->Pp=arc_mat(nx,nx);
+        s->nx=nx;
+    }
+    /* cross-covariance of filtered states and filter states */
+    for (j=0;j<nx;j++) for (i=0;i<na;i++) {
+        s->Pc[i+j*na]=rtk->P[ep->ix[i]+j*nx];
+    }
+}
+/* new fixed-lag smoother ------------------------------------------------------
+* args   : prcopt_t *opt    I   processing options
+* return : fixed-lag smoother (NULL: error)
+* notes  : lag is opt->fls_lag (0: 60 s). except static mode, the smoother
+*          needs opt->dynamics on, otherwise NULL is returned. set the
+*          smoother to rtk->fls so the filter calls the time update hooks
+*-----------------------------------------------------------------------------*/
+extern fls_t *arc_fls_new(const prcopt_t *opt)
+{
+    fls_t *s;
+
+    /* position is reset every epoch, no epochs to link */
+    if (opt->mode!=PMODE_STATIC&&!opt->dynamics) {
+        arc_log(ARC_ERROR,"arc_fls_new: fixed-lag smoother needs dynamics in kinematic mode\n");
+        return NULL;
+    }
+    if (!(s=(fls_t *)calloc(1,sizeof(fls_t)))) return NULL;
+
+    s->np=opt->dynamics?6:3;
+    s->lag=opt->fls_lag>0.0?opt->fls_lag:FLS_LAG;
+
+    arc_log(ARC_INFO,"arc_fls_new: np=%d lag=%.1f\n",s->np,s->lag);
+
+    if (!arc_fls_grow(s)) {
+        free(s);
+        return NULL;
+    }
+    return s;
+}
+/* free fixed-lag smoother ---------------------------------------------------*/
+extern void arc_fls_free(fls_t *s)
+{
+    int i;
+
+    if (!s) return;
+    for (i=0;i<s->n;i++) arc_fls_epfree(FLS_EP(s,i));
+    free(s->ep);
+    free(s->Pc); free(s->xp); free(s->Pp);
+    free(s);
+}
+/* re-initialized filter state -------------------------------------------------
+* args   : fls_t  *s        IO  fixed-lag smoother
+*          int    i         I   index of state in rtk->x
+* return : none
+* notes  : called by arc_initx(). the new state is uncorrelated with the
+*          filtered states of the newest epoch
+*-----------------------------------------------------------------------------*/
+extern void arc_fls_retire(fls_t *s, int i)
+{
+    int j,na=arc_fls_na(s);
+
+    if (s->tu||i<0||i>=s->nx) return;
+    for (j=0;j<na;j++) s->Pc[j+i*na]=0.0;
+}
+/* time update of position/velocity --------------------------------------------
+* args   : fls_t  *s        IO  fixed-lag smoother
+*          double tt        I   time difference (s)
+* return : none
+* notes  : called by arc_udpos() with transition x=F*x (pos+=vel*tt).
+*          the cross-covariance is updated as Pc=Pc*F'
+*-----------------------------------------------------------------------------*/
+extern void arc_fls_udpos(fls_t *s, double tt)
+{
+    int i,j,na=arc_fls_na(s);
+
+    if (s->tu||s->nx<6) return;
+    for (j=0;j<3;j++) for (i=0;i<na;i++) {
+        s->Pc[i+j*na]+=tt*s->Pc[i+(j+3)*na];
+    }
+}
+/* predicted filter states -----------------------------------------------------
+* args   : fls_t  *s        IO  fixed-lag smoother
+*          rtk_t  *rtk      I   rtk control/result struct after time update
+* return : none
+* notes  : called by arc_udstate() before the measurement update
+*-----------------------------------------------------------------------------*/
+extern void arc_fls_pred(fls_t *s, const rtk_t *rtk)
+{
+    if (s->tu||s->nx!=rtk->nx||!rtk->x||!rtk->P) return;
+
+    arc_matcpy(s->xp,rtk->x,s->nx,1);
+    arc_matcpy(s->Pp,rtk->P,s->nx,s->nx);
+    s->tu=1;
+}
+/* add epoch to fixed-lag smoother ---------------------------------------------
+* args   : fls_t  *s        IO  fixed-lag smoother
+*          rtk_t  *rtk      I   rtk control/result struct after arc_srtkpos()
+* return : status (1:ok,0:error)
+* notes  : call every epoch of the forward filter, then get smoothed epochs
+*          by arc_fls_get()
+*-----------------------------------------------------------------------------*/
+extern int arc_fls_add(fls_t *s, const rtk_t *rtk)
+{
+    flsep_t *ep,*prev;
+    const sol_t *sol=&rtk->sol;
+    int i,np=s->np;
+
+    if (s->n>=s->nmax&&!arc_fls_grow(s)) {
+        arc_log(ARC_ERROR,"arc_fls_add: memory allocation error\n");
+        return 0;
+    }
+    prev=s->n>0?FLS_EP(s,s->n-1):NULL;
+    ep=FLS_EP(s,s->n);
+
+    ep->time=sol->time;
+    ep->stat=sol->stat; ep->ns=sol->ns;
+    ep->age=sol->age; ep->ratio=sol->ratio; ep->thres=sol->thres;
+    for (i=0;i<6;i++) {
+        ep->rr[i]=sol->rr[i]; ep->qr[i]=sol->qr[i];
+    }
+    for (i=0;i<3;i++) ep->rb[i]=rtk->rb[i];
+
+    ep->na=0; ep->ix=NULL;
+    ep->x=ep->P=ep->xp=ep->Pp=ep->C=NULL;
+    ep->flt=(sol->stat==SOLQ_FIX||sol->stat==SOLQ_FLOAT||sol->stat==SOLQ_HALFFIX||
+             sol->stat==SOLQ_INHERITFIX)&&rtk->x&&rtk->nx>=np&&
+            arc_fls_states(s,ep,rtk);
+    ep->link=ep->sm=0;
+
+    if (ep->flt) {
+        ep->link=prev&&prev->flt&&s->tu&&s->nx==rtk->nx&&rtk->ntu>0&&
+                 rtk->ntu==s->ntu+1&&arc_fls_link(s,prev,ep);
+    }
+    s->ntu=ep->flt?rtk->ntu:0;
+    s->n++;
+
+    /* time update from this epoch */
+    if (ep->flt) arc_fls_cross(s,ep,rtk);
+    s->tu=0;
+    return 1;
+}
+/* backward pass of fixed-lag smoother -----------------------------------------
+* smooth epochs older than the lag by a backward pass over the buffer:
+* xs=x+C*(xs'-xp'), Ps=P+C*(Ps'-Pp')*C'. the smoothed states of these epochs
+* replace the filtered states in place.
+*-----------------------------------------------------------------------------*/
+static void arc_fls_smooth(fls_t *s, int flush)
+{
+    flsep_t *ep,*next=NULL;
+    gtime_t tn=FLS_EP(s,s->n-1)->time;
+    double *xs,*Ps,*dx,*dP,*CP;
+    int i,j,m,k,n=1;
+
+    for (j=0;j<s->n;j++) if (FLS_EP(s,j)->na>n) n=FLS_EP(s,j)->na;
+    xs=arc_mat(n,1); Ps=arc_mat(n,n); dx=arc_mat(n,1); dP=arc_mat(n,n);
+    CP=arc_mat(n,n);
+
+    for (j=s->n-1;j>=0;j--) {
+        ep=FLS_EP(s,j);
+        if (ep->sm) break;
+        m=ep->na;
+
+        if (next&&next->link) {
+            k=next->na;
+            for (i=0;i<k;i++) dx[i]=xs[i]-next->xp[i];
+            for (i=0;i<k*k;i++) dP[i]=Ps[i]-next->Pp[i];
+            arc_matcpy(xs,ep->x,m,1);
+            arc_matcpy(Ps,ep->P,m,m);
+            arc_matmul("NN",m,1,k,1.0,ep->C,dx,1.0,xs);
+            arc_matmul("NN",m,k,k,1.0,ep->C,dP,0.0,CP);
+            arc_matmul("NT",m,m,k,1.0,CP,ep->C,1.0,Ps);
+        }
+        else if (ep->flt) {
+            arc_matcpy(xs,ep->x,m,1);
+            arc_matcpy(Ps,ep->P,m,m);
+        }
+        if (flush||timediff(tn,ep->time)>=s->lag) {
+            if (ep->flt) {
+                arc_matcpy(ep->x,xs,m,1);
+                arc_matcpy(ep->P,Ps,m,m);
+            }
+            ep->sm=1;
+        }
+        next=ep;
+    }
+    free(xs); free(Ps); free(dx); free(dP); free(CP);
+}
+/* get smoothed epoch from fixed-lag smoother ----------------------------------
+* args   : fls_t  *s        IO  fixed-lag smoother
+*          sol_t  *sol      O   smoothed solution of oldest epoch
+*          double *rb       O   base position (ecef) (m)
+*          int    flush     I   output without full lag (end of session)
+* return : status (1:ok,0:no epoch to output)
+* notes  : the backward pass runs when the oldest epoch is FLS_BLK*lag older
+*          than the lag and smooths all epochs older than the lag at once.
+*          so every output epoch is smoothed with at least the lag of later
+*          epochs and output delay is bounded by (1+FLS_BLK)*lag.
+*-----------------------------------------------------------------------------*/
+extern int arc_fls_get(fls_t *s, sol_t *sol, double *rb, int flush)
+{
+    flsep_t *ep;
+    int i,na,np=s->np;
+
+    if (s->n<=0) return 0;
+
+    ep=FLS_EP(s,0);
+
+    if (!ep->sm) {
+        if (!flush&&s->n<FLS_MAXEP&&timediff(FLS_EP(s,s->n-1)->time,ep->time)<
+            s->lag*(1.0+FLS_BLK)) return 0;
+        arc_fls_smooth(s,flush);
+    }
+    memset(sol,0,sizeof(sol_t));
+    sol->time=ep->time;
+    sol->stat=ep->stat; sol->ns=ep->ns;
+    sol->age=ep->age; sol->ratio=ep->ratio; sol->thres=ep->thres;
+    for (i=0;i<6;i++) {
+        sol->rr[i]=ep->rr[i]; sol->qr[i]=ep->qr[i];
+    }
+    for (i=0;i<3;i++) rb[i]=ep->rb[i];
+
+    /* fixed solutions are not smoothed */
+    if (ep->flt&&ep->stat!=SOLQ_FIX&&ep->stat!=SOLQ_INHERITFIX) {
+        na=ep->na;
+        for (i=0;i<na&&ep->ix[i]<np;i++) sol->rr[ep->ix[i]]=ep->x[i];
+        for (i=0;i<3;i++) sol->qr[i]=(float)ep->P[i+i*na];
+        sol->qr[3]=(float)ep->P[1];
+        sol->qr[4]=(float)ep->P[1+2*na];
+        sol->qr[5]=(float)ep->P[2];
+    }
+    arc_fls_epfree(ep);
+    s->head=(s->head+1)%s->nmax;
+    s->n--;
+    return 1;
+}
@@ -0,0 +1,419 @@
+/*********************************************************************************
+ *  ARC-SRTK - Single Frequency RTK Pisitioning Library
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************************/
+
+/**
+ * @brief ARC-SRTK static normal equation
+ *
+ * for static sessions the rover position is one parameter of the whole
+ * session. the double-differenced residuals of every epoch are linearized at
+ * a fixed position x0 and added to a normal equation of the position and the
+ * phase-bias "parameters". a parameter lives as long as its phase-bias state
+ * is not re-initialized (cycle slip, outage), then it is retired but kept in
+ * the normal equation. other epoch states (ionosphere, troposphere...) are
+ * eliminated epoch by epoch by schur complement with their predicted variance
+ * as prior, so no kalman filter update of the full states is needed.
+ *
+ * normal equations of consecutive time chunks can be merged. a chunk that
+ * starts with warm-up epochs (the last epochs of the previous chunk, not
+ * accumulated) continues the parameters of the previous chunk.
+ */
+#include "arc.h"
+
+#define SQR(x)          ((x)*(x))
+#define NEQ_NP          3           /* number of position parameters */
+#define NEQ_NSLOT       64          /* initial number of parameters */
+#define NEQ_MAXVARZ     100.0       /* max variance of double-difference ambiguity for AR (cycle^2) */
+
+#define NQ(q,i,j)       ((q)->N[(i)+(j)*(NEQ_NP+(q)->nsmax)])
+
+/* enlarge parameters --------------------------------------------------------*/
+static int arc_neq_grow(neq_t *q, int nsmax)
+{
+    double *N;
+    int i,j,n=NEQ_NP+q->ns,m=NEQ_NP+nsmax;
+
+    if (nsmax<=q->nsmax) return 1;
+    if (!(N=arc_zeros(m,m))) return 0;
+    if (q->N) for (i=0;i<n;i++) for (j=0;j<n;j++) N[i+j*m]=NQ(q,i,j);
+    free(q->N); q->N=N;
+    q->u   =(double*)realloc(q->u,   sizeof(double)*m);
+    q->sidx=(int   *)realloc(q->sidx,sizeof(int   )*nsmax);
+    q->sst =(int   *)realloc(q->sst, sizeof(int   )*nsmax);
+    q->head=(int   *)realloc(q->head,sizeof(int   )*nsmax);
+    q->nobs=(int   *)realloc(q->nobs,sizeof(int   )*nsmax);
+    q->sx0 =(double*)realloc(q->sx0, sizeof(double)*nsmax);
+    if (!q->u||!q->sidx||!q->sst||!q->head||!q->nobs||!q->sx0) return 0;
+    for (i=n;i<m;i++) q->u[i]=0.0;
+    q->nsmax=nsmax;
+    return 1;
+}
+/* new parameter of phase-bias state i ---------------------------------------*/
+static int arc_neq_newslot(neq_t *q, int i, double x, double var, int head)
+{
+    int j,s;
+
+    if (q->ns>=q->nsmax&&!arc_neq_grow(q,q->nsmax*2)) return -1;
+    s=q->ns++;
+    q->sidx[s]=q->sst[s]=i; q->head[s]=head; q->nobs[s]=0; q->sx0[s]=x;
+    for (j=0;j<NEQ_NP+q->ns;j++) NQ(q,NEQ_NP+s,j)=NQ(q,j,NEQ_NP+s)=0.0;
+    q->u[NEQ_NP+s]=0.0;
+    if (var>0.0) NQ(q,NEQ_NP+s,NEQ_NP+s)=1.0/var; /* initial variance as prior */
+    if (i>=0) q->slot[i-q->nr]=s;
+    return s;
+}
+/* new static normal equation ----------------------------------------------------
+* args   : int    nx        I   number of states
+*          int    nr        I   number of epoch states (states index < nr)
+*          double *x0       I   linearization point of rover position (ecef) (m)
+* return : static normal equation (NULL:error)
+*-----------------------------------------------------------------------------*/
+extern neq_t *arc_neq_new(int nx, int nr, const double *x0)
+{
+    neq_t *q;
+    int i;
+
+    arc_log(ARC_INFO,"arc_neq_new : nx=%d nr=%d\n",nx,nr);
+
+    if (nx<=nr||nr<NEQ_NP||!(q=(neq_t *)calloc(1,sizeof(neq_t)))) return NULL;
+    q->nx=nx; q->nr=nr;
+    for (i=0;i<3;i++) q->x0[i]=x0[i];
+    q->slot=arc_imat(nx-nr,1);
+    if (!q->slot||!arc_neq_grow(q,NEQ_NSLOT)) {
+        arc_neq_free(q);
+        return NULL;
+    }
+    for (i=0;i<nx-nr;i++) q->slot[i]=-1;
+    for (i=0;i<NEQ_NP;i++) q->u[i]=0.0;
+    return q;
+}
+/* free static normal equation -----------------------------------------------*/
+extern void arc_neq_free(neq_t *q)
+{
+    if (!q) return;
+    free(q->slot); free(q->sidx); free(q->sst); free(q->head); free(q->nobs);
+    free(q->sx0); free(q->N); free(q->u);
+    free(q);
+}
+/* retire parameter of re-initialized state i --------------------------------*/
+extern void arc_neq_retire(neq_t *q, int i)
+{
+    int s;
+
+    if (!q||i<q->nr||i>=q->nx||(s=q->slot[i-q->nr])<0) return;
+    q->sidx[s]=-1; q->slot[i-q->nr]=-1;
+}
+/* add epoch to static normal equation -------------------------------------------
+* args   : neq_t  *q        IO  static normal equation
+*          gtime_t time     I   epoch time
+*          double *x        I   predicted states, position is q->x0 (nx x 1)
+*          double *P        I   predicted covariance of states (nx x nx)
+*          double *v        I   double-differenced residuals at x (nv x 1)
+*          double *H        I   transpose of design matrix at x (nx x nv)
+*          double *R        I   covariance matrix of residuals (nv x nv)
+*          int    nv        I   number of residuals
+*          double varb      I   initial variance of phase-bias (cycle^2)
+* return : status (0:ok,-1:error)
+* notes  : epoch states are the states index in [3,nr) with x!=0 and P>0
+*-----------------------------------------------------------------------------*/
+extern int arc_neq_add(neq_t *q, gtime_t time, const double *x, const double *P,
+                       const double *v, const double *H, const double *R, int nv,
+                       double varb)
+{
+    double *W,*Jg,*Je,*r,*WJg,*WJe,*Agg,*ug,*Aee,*Aeg,*ue,*T;
+    int i,j,k,s,c,a,b,ng,ne,nx=q->nx,nr=q->nr,*ig,*ie,info=0;
+
+    arc_log(ARC_INFO,"arc_neq_add : nep=%d ns=%d nv=%d warm=%d\n",q->nep,q->ns,nv,q->warm);
+
+    /* retire parameters of removed phase-bias */
+    for (k=0;k<nx-nr;k++) if (q->slot[k]>=0&&x[k+nr]==0.0) arc_neq_retire(q,k+nr);
+
+    /* new parameters of phase-bias in residuals */
+    for (j=nr;j<nx;j++) {
+        if (q->slot[j-nr]>=0||x[j]==0.0) continue;
+        for (k=0;k<nv;k++) if (H[j+k*nx]!=0.0) break;
+        if (k<nv&&arc_neq_newslot(q,j,x[j],varb,q->warm>0)<0) return -1;
+    }
+    if (q->warm>0) {q->warm--; return 0;}
+
+    /* global parameters (position,phase-bias) and epoch states */
+    ig=arc_imat(nx,1); ie=arc_imat(nr,1);
+    for (i=ng=0;i<NEQ_NP;i++) ig[ng++]=i;
+    for (j=nr;j<nx;j++) {
+        if (q->slot[j-nr]<0) continue;
+        for (k=0;k<nv;k++) if (H[j+k*nx]!=0.0) break;
+        if (k<nv) ig[ng++]=j;
+    }
+    for (i=NEQ_NP,ne=0;i<nr;i++) if (x[i]!=0.0&&P[i+i*nx]>0.0) ie[ne++]=i;
+
+    W=arc_mat(nv,nv); Jg=arc_mat(nv,ng); r=arc_mat(nv,1);
+    WJg=arc_mat(nv,ng); Agg=arc_mat(ng,ng); ug=arc_mat(ng,1);
+    arc_matcpy(W,R,nv,nv);
+
+    /* residuals of phase-bias relative to reference value of parameters */
+    for (k=0;k<nv;k++) {
+        r[k]=v[k];
+        for (c=0;c<ng;c++) Jg[k+c*nv]=H[ig[c]+k*nx];
+        for (c=NEQ_NP;c<ng;c++) {
+            s=q->slot[ig[c]-nr];
+            r[k]+=H[ig[c]+k*nx]*(x[ig[c]]-q->sx0[s]);
+            if (H[ig[c]+k*nx]!=0.0) q->nobs[s]++;
+        }
+    }
+    if (!(info=arc_matinv(W,nv))) {
+        arc_matmul("NN",nv,ng,nv,1.0,W,Jg,0.0,WJg);
+        arc_matmul("TN",ng,ng,nv,1.0,Jg,WJg,0.0,Agg); /* Agg=Jg'*W*Jg */
+        arc_matmul("TN",ng,1, nv,1.0,WJg,r, 0.0,ug);  /* ug=Jg'*W*r */
+
+        if (ne>0) { /* eliminate epoch states: Agg-=Aeg'*Aee^-1*Aeg */
+            Je=arc_mat(nv,ne); WJe=arc_mat(nv,ne); Aee=arc_mat(ne,ne);
+            Aeg=arc_mat(ne,ng); ue=arc_mat(ne,1); T=arc_mat(ne,ng);
+            for (k=0;k<nv;k++) for (c=0;c<ne;c++) Je[k+c*nv]=H[ie[c]+k*nx];
+            for (i=0;i<ne;i++) for (j=0;j<ne;j++) Aee[i+j*ne]=P[ie[i]+ie[j]*nx];
+
+            if (!(info=arc_matinv(Aee,ne))) { /* prior of epoch states */
+                arc_matmul("NN",nv,ne,nv,1.0,W,Je,0.0,WJe);
+                arc_matmul("TN",ne,ne,nv,1.0,Je,WJe,1.0,Aee);
+                arc_matmul("TN",ne,ng,nv,1.0,WJe,Jg,0.0,Aeg);
+                arc_matmul("TN",ne,1, nv,1.0,WJe,r, 0.0,ue);
+                if (!(info=arc_matinv(Aee,ne))) {
+                    arc_matmul("NN",ne,ng,ne, 1.0,Aee,Aeg,0.0,T);
+                    arc_matmul("TN",ng,ng,ne,-1.0,Aeg,T,  1.0,Agg);
+                    arc_matmul("TN",ng,1, ne,-1.0,T,  ue, 1.0,ug);
+                }
+            }
+            free(Je); free(WJe); free(Aee); free(Aeg); free(ue); free(T);
+        }
+    }
+    if (!info) {
+        for (i=0;i<ng;i++) {
+            a=i<NEQ_NP?i:NEQ_NP+q->slot[ig[i]-nr];
+            q->u[a]+=ug[i];
+            for (j=0;j<ng;j++) {
+                b=j<NEQ_NP?j:NEQ_NP+q->slot[ig[j]-nr];
+                NQ(q,a,b)+=Agg[i+j*ng];
+            }
+        }
+        if (q->nep++==0) q->ts=time;
+        q->te=time; q->nv+=nv;
+    }
+    else arc_log(ARC_WARNING,"arc_neq_add : singular epoch normal equation\n");
+
+    free(ig); free(ie); free(W); free(Jg); free(r); free(WJg); free(Agg); free(ug);
+    return info?-1:0;
+}
+/* merge static normal equation of next time chunk -------------------------------
+* args   : neq_t  *q        IO  static normal equation
+*          neq_t  *src      I   static normal equation of next time chunk
+* return : status (0:ok,-1:error)
+* notes  : parameters of src started in warm-up epochs continue the parameters
+*          of q which are not retired. the linearization points of both must
+*          be the same.
+*-----------------------------------------------------------------------------*/
+extern int arc_neq_merge(neq_t *q, const neq_t *src)
+{
+    double *d;
+    int i,j,k,s,t,*map,n=NEQ_NP+src->ns,m=NEQ_NP+src->nsmax;
+
+    arc_log(ARC_INFO,"arc_neq_merge : ns=%d src ns=%d\n",q->ns,src->ns);
+
+    if (src->nx!=q->nx||src->nr!=q->nr) return -1;
+
+    map=arc_imat(n,1); d=arc_zeros(n,1);
+    for (i=0;i<NEQ_NP;i++) map[i]=i;
+
+    /* map parameters, continued ones shift to reference value of q */
+    for (s=0;s<src->ns;s++) {
+        map[NEQ_NP+s]=-1;
+        if (src->nobs[s]<=0) continue; /* prior only */
+        k=src->sst[s]-src->nr;
+        if (src->head[s]&&(t=q->slot[k])>=0) {
+            d[NEQ_NP+s]=q->sx0[t]-src->sx0[s];
+            q->nobs[t]+=src->nobs[s];
+            q->sidx[t]=-1; q->slot[k]=-1; /* continued once */
+            map[NEQ_NP+s]=NEQ_NP+t;
+            continue;
+        }
+        if ((t=arc_neq_newslot(q,-1,src->sx0[s],0.0,0))<0) {
+            free(map); free(d);
+            return -1;
+        }
+        q->sst[t]=src->sst[s]; q->nobs[t]=src->nobs[s];
+        map[NEQ_NP+s]=NEQ_NP+t;
+    }
+    /* parameters of q not continued by src are retired */
+    for (k=0;k<q->nx-q->nr;k++) {
+        if ((t=q->slot[k])>=0) {q->sidx[t]=-1; q->slot[k]=-1;}
+    }
+    for (s=0;s<src->ns;s++) {
+        if (map[NEQ_NP+s]<0||src->sidx[s]<0) continue;
+        t=map[NEQ_NP+s]-NEQ_NP;
+        q->sidx[t]=src->sidx[s];
+        q->slot[src->sidx[s]-q->nr]=t;
+    }
+    /* N+=Ns, u+=us-Ns*d */
+    for (i=0;i<n;i++) {
+        if (map[i]<0) continue;
+        q->u[map[i]]+=src->u[i];
+        for (j=0;j<n;j++) {
+            if (map[j]<0) continue;
+            NQ(q,map[i],map[j])+=src->N[i+j*m];
+            q->u[map[i]]-=src->N[i+j*m]*d[j];
+        }
+    }
+    if (src->nep>0) {
+        if (q->nep==0) q->ts=src->ts;
+        q->te=src->te;
+    }
+    q->nep+=src->nep; q->nv+=src->nv;
+    free(map); free(d);
+    return 0;
+}
+/* double-difference transformation of parameters for AR ---------------------
+* the reference parameter of each system/frequency is the one with most
+* residuals. parameters with less than minlock residuals are not fixed.
+*-----------------------------------------------------------------------------*/
+static int arc_neq_ddmat(const neq_t *q, const prcopt_t *opt, double *D, int n)
+{
+    int i,j,k,f,sat,sys,ref,nb=0,sysk[]={SYS_GPS,SYS_GLO,SYS_GAL,SYS_CMP,SYS_QZS};
+    int minobs=opt->minlock>1?opt->minlock:1;
+
+    for (k=0;k<(int)(sizeof(sysk)/sizeof(int));k++) {
+        if (sysk[k]==SYS_GLO&&!opt->glomodear) continue;
+        if (sysk[k]==SYS_CMP&&!opt->bdsmodear) continue;
+        if (sysk[k]==SYS_GPS&&!opt->gpsmodear) continue;
+
+        for (f=0;f<NFREQ;f++) {
+            for (i=0,ref=-1;i<q->ns;i++) {
+                sat=(q->sst[i]-q->nr)%MAXSAT+1;
+                sys=satsys(sat,NULL);
+                if ((q->sst[i]-q->nr)/MAXSAT!=f||!(sys&sysk[k])) continue;
+                if (q->nobs[i]<minobs) continue;
+                if (ref<0||q->nobs[i]>q->nobs[ref]) ref=i;
+            }
+            if (ref<0) continue;
+            for (i=0;i<q->ns;i++) {
+                sat=(q->sst[i]-q->nr)%MAXSAT+1;
+                sys=satsys(sat,NULL);
+                if (i==ref||(q->sst[i]-q->nr)/MAXSAT!=f||!(sys&sysk[k])) continue;
+                if (q->nobs[i]<minobs) continue;
+                for (j=0;j<n;j++) D[j+nb*n]=0.0;
+                D[NEQ_NP+i  +nb*n]= 1.0;
+                D[NEQ_NP+ref+nb*n]=-1.0;
+                nb++;
+            }
+        }
+    }
+    return nb;
+}
+/* solve static normal equation --------------------------------------------------
+* args   : neq_t    *q      I   static normal equation
+*          prcopt_t *opt    I   processing options
+*          sol_t    *sol    O   float or fixed solution of rover position
+* return : solution status (SOLQ_FIX,SOLQ_FLOAT,SOLQ_NONE:error)
+* notes  : double-difference ambiguities of all parameters are resolved by
+*          lambda and validated by ratio test (opt->thresar[0])
+*-----------------------------------------------------------------------------*/
+extern int arc_neq_solve(const neq_t *q, const prcopt_t *opt, sol_t *sol)
+{
+    double *Q,*dx,*D,*DQ,*Qz,*Qpz,*zf,*zi,*F,*dz,s[2],rr[3],Qp[9];
+    int i,j,k,n=NEQ_NP+q->ns,m=NEQ_NP+q->nsmax,nb,stat=SOLQ_NONE;
+
+    arc_log(ARC_INFO,"arc_neq_solve : nep=%d ns=%d nv=%d\n",q->nep,q->ns,q->nv);
+
+    if (q->nep<=0) return SOLQ_NONE;
+
+    Q=arc_mat(n,n); dx=arc_mat(n,1);
+    for (i=0;i<n;i++) for (j=0;j<n;j++) Q[i+j*n]=q->N[i+j*m];
+
+    if (arc_matinv(Q,n)) {
+        arc_log(ARC_WARNING,"arc_neq_solve : singular normal equation\n");
+        free(Q); free(dx);
+        return SOLQ_NONE;
+    }
+    arc_matmul("NN",n,1,n,1.0,Q,q->u,0.0,dx);
+
+    /* float solution */
+    for (i=0;i<3;i++) rr[i]=q->x0[i]+dx[i];
+    for (i=0;i<3;i++) for (j=0;j<3;j++) Qp[i+j*3]=Q[i+j*n];
+    stat=SOLQ_FLOAT;
+    sol->ratio=0.0f; sol->thres=(float)opt->thresar[0];
+
+    /* resolve double-difference ambiguities */
+    D=arc_mat(n,q->ns>0?q->ns:1);
+    if (opt->modear!=ARMODE_OFF&&(nb=arc_neq_ddmat(q,opt,D,n))>0) {
+        DQ=arc_mat(nb,n); Qz=arc_mat(nb,nb);
+        arc_matmul("TN",nb,n,n,1.0,D,Q,0.0,DQ);
+        arc_matmul("NN",nb,nb,n,1.0,DQ,D,0.0,Qz);
+
+        /* exclude ambiguities only connected by prior */
+        for (k=j=0;k<nb;k++) {
+            if (Qz[k+k*nb]>NEQ_MAXVARZ) continue;
+            if (j<k) for (i=0;i<n;i++) D[i+j*n]=D[i+k*n];
+            j++;
+        }
+        if ((nb=j)>0) {
+            zf=arc_mat(nb,1); zi=arc_mat(nb,1); F=arc_mat(nb,2); dz=arc_mat(nb,1);
+            Qpz=arc_mat(3,nb);
+            arc_matmul("TN",nb,n,n,1.0,D,Q,0.0,DQ);
+            arc_matmul("NN",nb,nb,n,1.0,DQ,D,0.0,Qz);
+            for (i=0;i<3;i++) for (k=0;k<nb;k++) Qpz[i+k*3]=DQ[k+i*nb]; /* Qpz=Q(pos,:)*D */
+
+            /* float ambiguities, integer part of reference values apart */
+            for (k=0;k<nb;k++) {
+                for (i=0,zi[k]=zf[k]=0.0;i<q->ns;i++) {
+                    if (D[NEQ_NP+i+k*n]==0.0) continue;
+                    zi[k]+=D[NEQ_NP+i+k*n]*q->sx0[i];
+                    zf[k]+=D[NEQ_NP+i+k*n]*dx[NEQ_NP+i];
+                }
+                zf[k]+=zi[k]-floor(zi[k]+0.5);
+                zi[k]=floor(zi[k]+0.5);
+            }
+            if (!arc_lambda(nb,2,zf,Qz,F,s,NULL,NULL)) {
+                sol->ratio=(float)(s[0]>0.0?s[1]/s[0]:0.0);
+                if (sol->ratio>999.9) sol->ratio=999.9f;
+
+                arc_log(ARC_INFO,"arc_neq_solve : nb=%d ratio=%.2f\n",nb,sol->ratio);
+
+                /* fixed solution: rr-=Qpz*Qz^-1*(zf-F), Qp-=Qpz*Qz^-1*Qpz' */
+                if (s[0]<=0.0||s[1]/s[0]>=opt->thresar[0]) {
+                    for (k=0;k<nb;k++) dz[k]=zf[k]-F[k];
+                    if (!arc_matinv(Qz,nb)) {
+                        arc_matmul("NN",nb,1,nb,1.0,Qz,dz,0.0,zf);
+                        arc_matmul("NN",3,1,nb,-1.0,Qpz,zf,1.0,rr);
+                        arc_matmul("NT",nb,3,nb,1.0,Qz,Qpz,0.0,DQ);
+                        arc_matmul("NN",3,3,nb,-1.0,Qpz,DQ,1.0,Qp);
+                        stat=SOLQ_FIX;
+                    }
+                }
+            }
+            free(zf); free(zi); free(F); free(dz); free(Qpz);
+        }
+        free(DQ); free(Qz);
+    }
+    sol->time=q->te;
+    sol->stat=(unsigned char)stat;
+    for (i=0;i<3;i++) {
+        sol->rr[i]=rr[i];
+        sol->rr[i+3]=0.0;
+        sol->qr[i]=(float)Qp[i+i*3];
+    }
+    sol->qr[3]=(float)Qp[1];
+    sol->qr[4]=(float)Qp[5];
+    sol->qr[5]=(float)Qp[2];
+
+    free(Q); free(dx); free(D);
+    return stat;
+}
@@ -32,6 +32,7 @@
 #define ERR_CBIAS   0.3         /* code bias error std (m) */
 #define REL_HUMI    0.7         /* relative humidity for saastamoinen model */
 #define MAXCLKVAR   10.0        /* rover station clock drift variance  */
+#define SPPMAXTHRD  64          /* max threads of batch point positioning */
 
 /* pseudorange measurement error variance ------------------------------------*/
 static double arc_varerr(const prcopt_t *opt, double el, int sys,int sat)
@@ -210,11 +211,11 @@ extern int arc_tropcorr(gtime_t time, const nav_t *nav, const double *pos,
     return 1;
 }
 /* pseudorange residuals -----------------------------------------------------*/
-static int arc_rescode(int iter, const obsd_t *obs, int n, const double *rs,
-                       const double *dts, const double *vare, const int *svh,
-                       const nav_t *nav, const double *x, const prcopt_t *opt,
-                       double *v, double *H, double *var, double *azel, int *vsat,
-                       double *resp, int *ns)
+static int arc_rescode(int iter, const obsd_t *obs, int n, int exc,
+                       const double *rs, const double *dts, const double *vare,
+                       const int *svh, const nav_t *nav, const double *x,
+                       const prcopt_t *opt, double *v, double *H, double *var,
+                       double *azel, int *vsat, double *resp, int *ns)
 {
     double r,dion,dtrp,vmeas,vion,vtrp,rr[3],pos[3],dtr,e[3],P,lam_L1;
     int i,j,nv=0,sys,mask[4]={0};
@@ -228,7 +229,7 @@ static int arc_rescode(int iter, const obsd_t *obs, int n, const double *rs,
     for (i=*ns=0;i<n&&i<MAXOBS;i++) {
         vsat[i]=0; azel[i*2]=azel[1+i*2]=resp[i]=0.0;
 
-        if (!(sys=satsys(obs[i].sat,NULL))) continue;
+        if (i==exc||!(sys=satsys(obs[i].sat,NULL))) continue;
 
         /* reject duplicated observation data */
         if (i<n-1&&i<MAXOBS-1&&obs[i].sat==obs[i+1].sat) {
@@ -322,130 +323,175 @@ static int arc_valsol(const double *azel, const int *vsat, int n,
     }
     return 1;
 }
-/* estimate receiver position ------------------------------------------------*/
-static int arc_estpos(const obsd_t *obs, int n, const double *rs, const double *dts,
-                      const double *vare, const int *svh, const nav_t *nav,
-                      const prcopt_t *opt, sol_t *sol, double *azel, int *vsat,
-                      double *resp, char *msg)
+/* least square iteration of receiver position ------------------------------
+* iterate receiver position x from initial value without observation exc
+* (-1:none). v, H and var are weighted residuals, design matrix and variances
+* of last iteration and Q is covariance of last iteration.
+* return 1:converged,-1:not converged (x of last iteration),0:error
+*-----------------------------------------------------------------------------*/
+static int arc_lsqpos(const obsd_t *obs, int n, int exc, const double *rs,
+                      const double *dts, const double *vare, const int *svh,
+                      const nav_t *nav, const prcopt_t *opt, double *x, double *v,
+                      double *H, double *var, double *Q, double *azel, int *vsat,
+                      double *resp, int *nv, int *ns, char *msg)
 {
-    double x[NX]={0},dx[NX],Q[NX*NX],*v,*H,*var,sig;
-    int i,j,k,info,stat,nv,ns;
-
-    arc_log(ARC_INFO,"estpos  : n=%d\n",n);
-
-    v=arc_mat(n+4,1); H=arc_mat(NX,n+4); var=arc_mat(n+4,1);
-
-    for (i=0;i<3;i++) x[i]=sol->rr[i];
+    double dx[NX],sig;
+    int i,j,k,info;
 
     for (i=0;i<MAXITR;i++) {
 
         /* pseudorange residuals */
-        nv=arc_rescode(i,obs,n,rs,dts,vare,svh,nav,x,opt,v,H,var,azel,vsat,resp,
-                       &ns);
-        if (nv<NX) {
-            sprintf(msg,"lack of valid sats ns=%d",nv);
-            break;
+        *nv=arc_rescode(i,obs,n,exc,rs,dts,vare,svh,nav,x,opt,v,H,var,azel,vsat,
+                        resp,ns);
+        if (*nv<NX) {
+            sprintf(msg,"lack of valid sats ns=%d",*nv);
+            return 0;
         }
         /* weight by variance */
-        for (j=0;j<nv;j++) {
+        for (j=0;j<*nv;j++) {
             sig=sqrt(var[j]);
             v[j]/=sig;
             for (k=0;k<NX;k++) H[k+j*NX]/=sig;
         }
         /* least square estimation */
-        if ((info= arc_lsq(H,v,NX,nv,dx,Q))) {
+        if ((info= arc_lsq(H,v,NX,*nv,dx,Q))) {
             sprintf(msg,"lsq error info=%d",info);
-            break;
+            return 0;
         }
         for (j=0;j<NX;j++) x[j]+=dx[j];
 
-        if (arc_norm(dx,NX)<1E-4) {
-            sol->type=0;
-            sol->time=timeadd(obs[0].time,-x[3]/CLIGHT);
-            sol->ns=(unsigned char)ns;
-            sol->age=0.0;
-
-            /* validate solution */
-            if (!(stat=arc_valsol(azel,vsat,n,opt,v,nv,NX,msg,sol))) {
-                sol->stat=SOLQ_NONE;
-                free(v); free(H); free(var);
-                return stat;
-            }
-            sol->dtr[0]=x[3]/CLIGHT; /* receiver clock bias (s) */
-            sol->dtr[1]=x[4]/CLIGHT; /* glo-gps time offset (s) */
-            sol->dtr[2]=x[5]/CLIGHT; /* gal-gps time offset (s) */
-            sol->dtr[3]=x[6]/CLIGHT; /* bds-gps time offset (s) */
-            for (j=0;j<6;j++) sol->rr[j]=j<3?x[j]:0.0;
-            for (j=0;j<3;j++) sol->qr[j]=(float)Q[j+j*NX];
-            sol->qr[3]=(float)Q[1];    /* cov xy */
-            sol->qr[4]=(float)Q[2+NX]; /* cov yz */
-            sol->qr[5]=(float)Q[2];    /* cov zx */
-            sol->stat=SOLQ_SINGLE;
-            free(v); free(H); free(var);
-            return stat;
-        }
+        if (arc_norm(dx,NX)<1E-4) return 1;
     }
-    if (i>=MAXITR) sprintf(msg,"iteration divergent i=%d",i);
+    sprintf(msg,"iteration divergent i=%d",i);
+    return -1;
+}
+/* estimate receiver position ------------------------------------------------*/
+static int arc_estpos(const obsd_t *obs, int n, int exc, const double *rs,
+                      const double *dts, const double *vare, const int *svh,
+                      const nav_t *nav, const prcopt_t *opt, sol_t *sol,
+                      double *azel, int *vsat, double *resp, char *msg)
+{
+    double x[NX]={0},Q[NX*NX],*v,*H,*var;
+    int j,stat,nv,ns;
+
+    arc_log(ARC_INFO,"estpos  : n=%d\n",n);
 
+    v=arc_mat(n+4,1); H=arc_mat(NX,n+4); var=arc_mat(n+4,1);
+
+    for (j=0;j<3;j++) x[j]=sol->rr[j];
+
+    if (arc_lsqpos(obs,n,exc,rs,dts,vare,svh,nav,opt,x,v,H,var,Q,azel,vsat,resp,
+                   &nv,&ns,msg)<=0) {
+        free(v); free(H); free(var);
+        return 0;
+    }
+    sol->type=0;
+    sol->time=timeadd(obs[0].time,-x[3]/CLIGHT);
+    sol->ns=(unsigned char)ns;
+    sol->age=0.0;
+
+    /* validate solution */
+    if (!(stat=arc_valsol(azel,vsat,n,opt,v,nv,NX,msg,sol))) {
+        sol->stat=SOLQ_NONE;
+        free(v); free(H); free(var);
+        return stat;
+    }
+    sol->dtr[0]=x[3]/CLIGHT; /* receiver clock bias (s) */
+    sol->dtr[1]=x[4]/CLIGHT; /* glo-gps time offset (s) */
+    sol->dtr[2]=x[5]/CLIGHT; /* gal-gps time offset (s) */
+    sol->dtr[3]=x[6]/CLIGHT; /* bds-gps time offset (s) */
+    for (j=0;j<6;j++) sol->rr[j]=j<3?x[j]:0.0;
+    for (j=0;j<3;j++) sol->qr[j]=(float)Q[j+j*NX];
+    sol->qr[3]=(float)Q[1];    /* cov xy */
+    sol->qr[4]=(float)Q[2+NX]; /* cov yz */
+    sol->qr[5]=(float)Q[2];    /* cov zx */
+    sol->stat=SOLQ_SINGLE;
     free(v); free(H); free(var);
-    return 0;
+    return stat;
 }
-/* raim fde (failure detection and exclution) -------------------------------*/
+/* raim fde (failure detection and exclution) ----------------------------------
+* leave-one-out residuals of all satellites are computed from one linearization
+* by all satellites: with weighted residuals e, covariance Q and redundancy
+* r(k)=1-h(k)'*Q*h(k), residuals without satellite k are
+* e(j)+h(j)'*Q*h(k)*e(k)/r(k) and square sum is e'*e-e(k)^2/r(k). exclusions
+* passing chi-square test are ordered by rms of residuals and only the
+* selected one is iterated to convergence and validated
+*-----------------------------------------------------------------------------*/
 static int arc_raim_fde(const obsd_t *obs, int n, const double *rs,
                         const double *dts, const double *vare, const int *svh,
                         const nav_t *nav, const prcopt_t *opt, sol_t *sol,
                         double *azel, int *vsat, double *resp, char *msg)
 {
-    obsd_t *obs_e;
     sol_t sol_e={{0}};
-    char tstr[32],name[16],msg_e[128];
-    double *rs_e,*dts_e,*vare_e,*azel_e,*resp_e,rms_e,rms=100.0;
-    int i,j,k,l,nvsat,stat=0,*svh_e,*vsat_e,sat=0;
+    char tstr[32],name[16],msg_e[128]="";
+    double x[NX]={0},Q[NX*NX],g[NX],*v,*H,*var,*rms,*azel_e,*resp_e;
+    double vv,r,f,hg,e;
+    int i,j,k,l,m,nv,ns,nvsat,stat=0,*row,*vsat_e;
 
     arc_log(ARC_INFO, "raim_fde: %s n=%2d\n", time_str(obs[0].time,0),n);
 
-    if (!(obs_e=(obsd_t *)malloc(sizeof(obsd_t)*n))) return 0;
-    rs_e=arc_mat(6,n); dts_e=arc_mat(2,n);vare_e=arc_mat(1,n); azel_e=arc_zeros(2,n);
-    svh_e=arc_imat(1,n); vsat_e= arc_imat(1,n); resp_e= arc_mat(1,n);
+    v=arc_mat(n+4,1); H=arc_mat(NX,n+4); var=arc_mat(n+4,1); rms=arc_mat(n,1);
+    azel_e=arc_zeros(2,n); resp_e=arc_mat(1,n); row=arc_imat(n,1);
+    vsat_e=arc_imat(n,1);
+
+    /* linearization by all satellites */
+    for (j=0;j<3;j++) x[j]=sol->rr[j];
+    if (!arc_lsqpos(obs,n,-1,rs,dts,vare,svh,nav,opt,x,v,H,var,Q,azel_e,vsat_e,
+                    resp_e,&nv,&ns,msg_e)) {
+        arc_log(ARC_ERROR, "raim_fde: %s\n", msg_e);
+        ns=0;
+    }
+    for (i=k=0;i<n&&k<ns;i++) if (vsat_e[i]) row[k++]=i;
+    vv=arc_dot(v,v,nv);
 
-    for (i=0;i<n;i++) {
+    /* leave-one-out residuals */
+    for (k=0;k<ns;k++) {
+        rms[k]=-1.0;
+        arc_matmul("NN",NX,1,NX,1.0,Q,H+k*NX,0.0,g);
+        if ((r=1.0-arc_dot(H+k*NX,g,NX))<1E-9) continue;
+        f=v[k]/r;
+        if (nv-1>NX&&vv-v[k]*f>chisqr[nv-1-NX-1]) continue;
+
+        for (j=nvsat=0,e=0.0;j<ns;j++) {
+            if (j==k) continue;
+            hg=arc_dot(H+j*NX,g,NX);
+            e+=SQR((v[j]+hg*f)*sqrt(var[j]));
+            nvsat++;
+        }
+        if (nvsat<5) continue;
+        rms[k]=sqrt(e/nvsat);
 
-        /* satellite exclution */
-        for (j=k=0;j<n;j++) {
-            if (j==i) continue;
-            obs_e[k]=obs[j];
-            arc_matcpy(rs_e+6*k,rs+6*j,6,1);
-            arc_matcpy(dts_e+2*k,dts+2*j,2,1);
-            vare_e[k]=vare[j];
-            svh_e[k++]=svh[j];
+        arc_log(ARC_INFO, "raim_fde: exsat=%2d rms=%8.3f w=%8.3f\n",
+                obs[row[k]].sat,rms[k],v[k]/sqrt(r));
+    }
+    /* iterate and validate exclusion of least rms */
+    for (l=0;l<ns&&!stat;l++) {
+        for (k=0,m=-1;k<ns;k++) {
+            if (rms[k]<0.0||rms[k]>100.0) continue;
+            if (m<0||rms[k]<rms[m]) m=k;
         }
-        /* estimate receiver position without a satellite */
-        if (!arc_estpos(obs_e,n-1,rs_e,dts_e,vare_e,svh_e,nav,opt,&sol_e,azel_e,
-                        vsat_e,resp_e,msg_e)) {
-            arc_log(ARC_ERROR, "raim_fde: exsat=%2d (%s)\n", obs[i].sat, msg);
+        if (m<0) break;
+        rms[m]=-1.0;
+        i=row[m];
+
+        for (j=0;j<3;j++) sol_e.rr[j]=x[j];
+        if (!arc_estpos(obs,n,i,rs,dts,vare,svh,nav,opt,&sol_e,azel_e,vsat_e,
+                        resp_e,msg_e)) {
+            arc_log(ARC_ERROR, "raim_fde: exsat=%2d (%s)\n", obs[i].sat, msg_e);
             continue;
         }
-        for (j=nvsat=0,rms_e=0.0;j<n-1;j++) {
-            if (!vsat_e[j]) continue;
-            rms_e+=SQR(resp_e[j]);
-            nvsat++;
-        }
+        for (j=nvsat=0;j<n;j++) if (vsat_e[j]) nvsat++;
         if (nvsat<5) {
             arc_log(ARC_ERROR, "raim_fde: exsat=%2d lack of satellites nvsat=%2d\n",
                     obs[i].sat,nvsat);
             continue;
         }
-        rms_e=sqrt(rms_e/nvsat);
-
-        arc_log(ARC_INFO, "raim_fde: exsat=%2d rms=%8.3f\n", obs[i].sat,rms_e);
-        if (rms_e>rms) continue;
-
         /* save result */
-        for (j=k=0;j<n;j++) {
+        for (j=0;j<n;j++) {
             if (j==i) continue;
-            arc_matcpy(azel+2*j,azel_e+2*k,2,1);
-            vsat[j]=vsat_e[k];
-            resp[j]=resp_e[k++];
+            arc_matcpy(azel+2*j,azel_e+2*j,2,1);
+            vsat[j]=vsat_e[j];
+            resp[j]=resp_e[j];
         }
         stat=1;
         sol->time=sol_e.time; /* solution time */
@@ -453,21 +499,17 @@ static int arc_raim_fde(const obsd_t *obs, int n, const double *rs,
         sol->dop =sol_e.dop;
         sol->ns  =sol_e.ns;
         sol->type=sol_e.type;
-        for (l=0;l<6;l++) sol->rr[l] =sol_e.rr[l]; /* reciver position and velecity */
-        for (l=0;l<6;l++) sol->dtr[l]=sol_e.dtr[l]; /* clock drift */
-        for (l=0;l<6;l++) sol->qr[l] =sol_e.qr[l];  /* position covariance */
-        sat=obs[i].sat;
-        rms=rms_e;
+        for (j=0;j<6;j++) sol->rr[j] =sol_e.rr[j]; /* reciver position and velecity */
+        for (j=0;j<6;j++) sol->dtr[j]=sol_e.dtr[j]; /* clock drift */
+        for (j=0;j<6;j++) sol->qr[j] =sol_e.qr[j];  /* position covariance */
         vsat[i]=0;
         strcpy(msg,msg_e);
-    }
-    if (stat) {
-        time2str(obs[0].time,tstr,2); satno2id(sat,name);
+
+        time2str(obs[0].time,tstr,2); satno2id(obs[i].sat,name);
         arc_log(ARC_WARNING, "%s: %s excluded by raim\n", tstr+11,name);
     }
-    free(obs_e);
-    free(rs_e ); free(dts_e ); free(vare_e); free(azel_e);
-    free(svh_e); free(vsat_e); free(resp_e);
+    free(v); free(H); free(var); free(rms);
+    free(azel_e); free(resp_e); free(row); free(vsat_e);
     return stat;
 }
 /* doppler residuals ---------------------------------------------------------*/
@@ -618,10 +660,10 @@ extern int arc_pntpos(const obsd_t *obs, int n, const nav_t *nav,
         opt_.tropopt=TROPOPT_SAAS;
     }
     /* satellite positons, velocities and clocks */
-    arc_satposs(sol->time,obs,n,nav,opt_.sateph,rs,dts,var,svh);
+    arc_satposs(sol->time,obs,n,nav,opt_.sateph,NULL,rs,dts,var,svh);
 
     /* estimate receiver position with pseudorange */
-    stat=arc_estpos(obs,n,rs,dts,var,svh,nav,&opt_,sol,azel_,vsat,resp,msg);
+    stat=arc_estpos(obs,n,-1,rs,dts,var,svh,nav,&opt_,sol,azel_,vsat,resp,msg);
 
     /* raim fde */
     if (!stat&&n>=6&&opt->posopt[4]) {
@@ -652,3 +694,133 @@ extern int arc_pntpos(const obsd_t *obs, int n, const nav_t *nav,
     free(rs); free(dts); free(var); free(azel_); free(resp);
     return stat;
 }
+/* batch point positioning job type ------------------------------------------*/
+typedef struct {
+    const obsd_t *obs;          /* observation data */
+    const int *iobs,*nobs;      /* index and number of observations of epochs */
+    const nav_t *nav;           /* navigation data */
+    const prcopt_t *opt;        /* processing options */
+    int is,ie;                  /* epoch range [is,ie) */
+    sol_t *sol;                 /* solutions of epochs (NULL: no output) */
+    int n;                      /* number of solutions */
+    double mean[3],M2[9];       /* mean and sum of squared deviations */
+} sppjob_t;
+
+/* point positioning of epoch range ------------------------------------------*/
+static void arc_pntposs_range(sppjob_t *job)
+{
+    const prcopt_t *opt=job->opt;
+    obsd_t data[MAXOBS];
+    ephc_t ephc,*prev;
+    sol_t sol={{0}};
+    double d[3];
+    int i,j,k,n;
+    char msg[128];
+
+    /* private cursors of precise ephemeris and caches of glonass orbits */
+    arc_ephc_init(&ephc,opt->glodense);
+    prev=arc_ephc_bind(&ephc);
+
+    for (k=job->is;k<job->ie;k++) {
+
+        for (i=n=0;i<job->nobs[k]&&i<MAXOBS;i++) {
+            data[n]=job->obs[job->iobs[k]+i];
+            if ((satsys(data[n].sat,NULL)&opt->navsys)&&
+                opt->exsats[data[n].sat-1]!=1) n++;
+        }
+        if (n<=0||!arc_pntpos(data,n,job->nav,opt,&sol,NULL,NULL,msg)) {
+            if (job->sol) {job->sol[k]=sol; job->sol[k].stat=SOLQ_NONE;}
+            continue;
+        }
+        if (job->sol) job->sol[k]=sol;
+
+        /* running mean and covariance of positions */
+        job->n++;
+        for (i=0;i<3;i++) {
+            d[i]=sol.rr[i]-job->mean[i];
+            job->mean[i]+=d[i]/job->n;
+        }
+        for (i=0;i<3;i++) for (j=0;j<3;j++) {
+            job->M2[i+j*3]+=d[i]*(sol.rr[j]-job->mean[j]);
+        }
+    }
+    arc_ephc_bind(prev);
+    arc_ephc_free(&ephc);
+}
+#ifndef WIN32
+static void *arc_pntposs_thread(void *arg)
+{
+    arc_pntposs_range((sppjob_t *)arg);
+    return NULL;
+}
+#endif
+/* batch single point positioning ----------------------------------------------
+* compute receiver positions of epochs by single point positioning in parallel
+* args   : obsd_t *obs      I   observation data
+*          int    *iobs     I   index of first observation of epochs {iobs[0],...}
+*          int    *nobs     I   number of observations of epochs {nobs[0],...}
+*          int    ne        I   number of epochs
+*          nav_t  *nav      I   navigation data
+*          prcopt_t *opt    I   processing options
+*          int    nthread   I   number of threads (0,1:serial)
+*          sol_t  *sol      O   solutions of epochs {sol[0],...} (NULL: no output)
+*          double *ra       O   mean of receiver positions (ecef) (NULL: no output)
+*          double *Qa       O   covariance of receiver positions (m^2) (3x3)
+*                               (NULL: no output)
+* return : number of valid solutions
+* notes  : epochs are split into contiguous ranges, one per thread. each thread
+*          starts with the first epoch of its range and iterates later epochs
+*          from the previous solution. observations of systems not in navsys or
+*          of excluded satellites are removed before positioning.
+*          each thread uses its own cursors of precise ephemeris and caches of
+*          glonass orbits
+*-----------------------------------------------------------------------------*/
+extern int arc_pntposs(const obsd_t *obs, const int *iobs, const int *nobs,
+                       int ne, const nav_t *nav, const prcopt_t *opt, int nthread,
+                       sol_t *sol, double *ra, double *Qa)
+{
+    sppjob_t job[SPPMAXTHRD]={{0}};
+    double d[3],mean[3]={0},M2[9]={0};
+    int i,j,k,n=0,nw;
+#ifndef WIN32
+    pthread_t thread[SPPMAXTHRD];
+    int run[SPPMAXTHRD]={0};
+#endif
+
+    arc_log(ARC_INFO,"pntposs : ne=%d nthread=%d\n",ne,nthread);
+
+    nw=nthread<1?1:(nthread>SPPMAXTHRD?SPPMAXTHRD:nthread);
+#ifdef WIN32
+    nw=1;
+#endif
+    if (nw>ne) nw=ne<1?1:ne;
+
+    for (i=0;i<nw;i++) {
+        job[i].obs=obs; job[i].iobs=iobs; job[i].nobs=nobs; job[i].nav=nav;
+        job[i].opt=opt; job[i].sol=sol;
+        job[i].is=(int)((long)ne*i/nw); job[i].ie=(int)((long)ne*(i+1)/nw);
+    }
+#ifndef WIN32
+    for (i=1;i<nw;i++) run[i]=!pthread_create(thread+i,NULL,arc_pntposs_thread,job+i);
+    arc_pntposs_range(job);
+    for (i=1;i<nw;i++) {
+        if (run[i]) pthread_join(thread[i],NULL);
+        else arc_pntposs_range(job+i); /* thread creation failed */
+    }
+#else
+    arc_pntposs_range(job);
+#endif
+    /* merge mean and covariance of ranges */
+    for (k=0;k<nw;k++) {
+        if (job[k].n<=0) continue;
+        for (i=0;i<3;i++) d[i]=job[k].mean[i]-mean[i];
+        for (i=0;i<3;i++) mean[i]+=d[i]*job[k].n/(n+job[k].n);
+        for (i=0;i<3;i++) for (j=0;j<3;j++) {
+            M2[i+j*3]+=job[k].M2[i+j*3]+d[i]*d[j]*n*job[k].n/(n+job[k].n);
+        }
+        n+=job[k].n;
+    }
+    if (ra) for (i=0;i<3;i++) ra[i]=mean[i];
+    if (Qa) for (i=0;i<9;i++) Qa[i]=n>1?M2[i]/(n-1):0.0;
+    return n;
+}
@@ -57,6 +57,8 @@ using namespace std;
 #define MAXDIFFAMB   300.0          /* max difference of precious epoch and current epoch for amb-fix */
 #define NEWSIZE      10
 #define MINTROP      10
+#define ZDCTX_TOL    1.0            /* max shift of linearization point to reuse models (m) */
+#define GEOCTX_TOL   60.0           /* max time difference to geophysical context of epoch (s) */
 
 /* number of parameters (pos,ionos,tropos,hw-bias,phase-bias,real,estimated) */
 #define NF(opt)     ((opt)->ionoopt==IONOOPT_IFLC?1:(opt)->nf)
@@ -84,13 +86,14 @@ using namespace std;
 ARC_DEFINE_EXCEPTION(Exception,std::runtime_error);
 
 /* global variables for debuger---------------------------------------------------------*/
-static int EPOCH=0;                                 /* epoch no. */
+static THREADLOCAL int EPOCH=0;                     /* epoch no. of calling thread */
 
 /* global variables ----------------------------------------------------------*/
 static int statlevel=0;                             /* rtk status output level (0:off) */
 static FILE *fp_stat=NULL;                          /* rtk status file pointer */
 static char file_stat[1024]="";                     /* rtk status file original path */
 static gtime_t time_stat={0};                       /* rtk status file time */
+static sstat_t *sstat_bin=NULL;                     /* rtk status binary stream */
 /* open solution status file ---------------------------------------------------
 * open solution status file and set output level
 * args   : char     *file   I   rtk status file
@@ -122,6 +125,11 @@ static gtime_t time_stat={0};                       /* rtk status file time */
 *          clk3     : receiver clock bias GAL-GPS (ns)
 *          clk4     : receiver clock bias BDS-GPS (ns)
 *
+*   $ARDEG,week,tow,stat,deg (only for degraded ambiguity resolution)
+*          week/tow : gps week no/time of week (s)
+*          stat     : solution status
+*          deg      : decision out of time budget (ARDEG_???)
+*
 *   $ION,week,tow,stat,sat,az,el,ion,ion-fixed
 *          week/tow : gps week no/time of week (s)
 *          stat     : solution status
@@ -180,6 +188,38 @@ extern int rtkopenstat(const char *file, int level)
     statlevel=level;
     return 1;
 }
+/* open binary solution status file --------------------------------------------
+* open binary solution status file and set output level
+* args   : char     *file   I   rtk status file
+*          int      level   I   rtk status level (0: off)
+* return : status (1:ok,0:error)
+* notes  : solution status is written by binary solution statistics stream
+*          (see sstat_openw()) and read by sstat_read() or readsolstatb()
+*-----------------------------------------------------------------------------*/
+extern int rtkopenstatb(const char *file, int level)
+{
+    gtime_t time=utc2gpst(timeget());
+    char path[1024];
+
+    arc_log(ARC_INFO,"rtkopenstatb: file=%s level=%d\n",file,level);
+
+    if (level<=0) return 0;
+
+    reppath(file,path,time,"","");
+
+    if (!(fp_stat=fopen(path,"wb"))) {
+        arc_log(ARC_WARNING,"rtkopenstatb: file open error path=%s\n",path);
+        return 0;
+    }
+    if (!(sstat_bin=sstat_openw(fp_stat,level))) {
+        fclose(fp_stat); fp_stat=NULL;
+        return 0;
+    }
+    strcpy(file_stat,file);
+    time_stat=time;
+    statlevel=level;
+    return 1;
+}
 /* close solution status file --------------------------------------------------
 * close solution status file
 * args   : none
@@ -189,6 +229,7 @@ extern void rtkclosestat(void)
 {
     arc_log(ARC_INFO,"rtkclosestat:\n");
 
+    sstat_close(sstat_bin); sstat_bin=NULL;
     if (fp_stat) fclose(fp_stat);
     fp_stat=NULL;
     file_stat[0]='\0';
@@ -244,6 +285,11 @@ extern int rtkoutstat(rtk_t *rtk, char *buff)
                week,tow,rtk->sol.stat,1,rtk->sol.dtr[0]*1E9,rtk->sol.dtr[1]*1E9,
                rtk->sol.dtr[2]*1E9,rtk->sol.dtr[3]*1E9);
 
+    /* ambiguity resolution degraded by time budget */
+    if (rtk->sol.ardeg) {
+        p+=sprintf(p,"$ARDEG,%d,%.3f,%d,%d\n",week,tow,rtk->sol.stat,
+                   rtk->sol.ardeg);
+    }
     /* ionospheric parameters */
     if (est&&rtk->opt.ionoopt==IONOOPT_EST) {
         for (i=0;i<MAXSAT;i++) {
@@ -292,6 +338,18 @@ static void swapsolstat(void)
     if (!reppath(file_stat,path,time,"","")) {
         return;
     }
+    if (sstat_bin) { /* binary stream */
+        sstat_close(sstat_bin); sstat_bin=NULL;
+        if (fp_stat) fclose(fp_stat);
+        if (!(fp_stat=fopen(path,"wb"))||!(sstat_bin=sstat_openw(fp_stat,statlevel))) {
+            arc_log(ARC_WARNING,"swapsolstat: file open error path=%s\n",path);
+            if (fp_stat) fclose(fp_stat);
+            fp_stat=NULL;
+            return;
+        }
+        arc_log(ARC_INFO,"swapsolstat: path=%s\n",path);
+        return;
+    }
     if (fp_stat) fclose(fp_stat);
 
     if (!(fp_stat=fopen(path,"w"))) {
@@ -300,6 +358,93 @@ static void swapsolstat(void)
     }
     arc_log(ARC_INFO,"swapsolstat: path=%s\n",path);
 }
+/* output solution status to binary stream -----------------------------------*/
+static void outsolstatb(rtk_t *rtk)
+{
+    solstate_t state={{0}};
+    solstat_t sat[MAXSAT*NFREQ];
+    ssat_t *ssat;
+    double pos[3],v[4][3]={{0}};
+    int i,j,k,n=0,est,nfreq,nf=NF(&rtk->opt);
+
+    if (rtk->sol.stat<=SOLQ_NONE) return;
+
+    est=rtk->opt.mode>=PMODE_DGPS;
+    nfreq=est?nf:1;
+
+    state.time=rtk->sol.time;
+    state.stat=rtk->sol.stat;
+    state.ardeg=rtk->sol.ardeg;
+
+    /* receiver position, velocity and acceleration */
+    for (i=0;i<3;i++) {
+        state.pos [i]=est?rtk->x[i]:rtk->sol.rr[i];
+        state.posa[i]=est&&i<rtk->na?rtk->xa[i]:0.0;
+    }
+    ecef2pos(rtk->sol.rr,pos);
+    if (est&&rtk->opt.dynamics) {
+        ecef2enu(pos,rtk->x+3,v[0]);
+        ecef2enu(pos,rtk->x+6,v[1]);
+        if (rtk->na>=6) ecef2enu(pos,rtk->xa+3,v[2]);
+        if (rtk->na>=9) ecef2enu(pos,rtk->xa+6,v[3]);
+    }
+    else ecef2enu(pos,rtk->sol.rr+3,v[0]);
+
+    for (i=0;i<3;i++) {
+        state.vel [i]=(float)v[0][i]; state.acc [i]=(float)v[1][i];
+        state.vela[i]=(float)v[2][i]; state.acca[i]=(float)v[3][i];
+    }
+
+    /* receiver clocks */
+    for (i=0;i<4;i++) state.dtr[i]=rtk->sol.dtr[i]*1E9;
+
+    /* tropospheric parameters */
+    if (est&&(rtk->opt.tropopt==TROPOPT_EST||rtk->opt.tropopt==TROPOPT_ESTG)) {
+        for (i=0;i<2;i++) {
+            j=IT(i,&rtk->opt);
+            state.trp[i][0]=(float)rtk->x[j];
+            state.trp[i][1]=(float)(j<rtk->na?rtk->xa[j]:0.0);
+        }
+        state.ntrp=2;
+    }
+    /* receiver h/w bias */
+    if (est&&rtk->opt.glomodear==2) {
+        for (i=0;i<nfreq&&i<NFREQ;i++) {
+            j=IL(i,&rtk->opt);
+            state.hwb[i][0]=(float)rtk->x[j];
+            state.hwb[i][1]=(float)(j<rtk->na?rtk->xa[j]:0.0);
+        }
+        state.nf=(unsigned char)nfreq;
+    }
+    state.ion=est&&rtk->opt.ionoopt==IONOOPT_EST;
+
+    /* residuals and status of satellites */
+    for (i=0;i<MAXSAT&&(statlevel>1||state.ion);i++) {
+        ssat=rtk->ssat+i;
+        if (!ssat->vs) continue;
+        k=state.ion?II(i+1,&rtk->opt):0;
+
+        for (j=0;j<nfreq&&j<NFREQ;j++) {
+            sat[n].sat=(unsigned char)(i+1);
+            sat[n].frq=(unsigned char)(j+1);
+            sat[n].az=(float)ssat->azel[0];
+            sat[n].el=(float)ssat->azel[1];
+            sat[n].resp=(float)ssat->resp[j];
+            sat[n].resc=(float)ssat->resc[j];
+            sat[n].flag=(unsigned char)(((ssat->vsat[j]&1)<<5)+
+                                        ((ssat->slip[j]&3)<<3)+(ssat->fix[j]&7));
+            sat[n].snr=ssat->snr[j];
+            sat[n].lock=ssat->lock[j];
+            sat[n].outc=ssat->outc[j];
+            sat[n].slipc=ssat->slipc[j];
+            sat[n].rejc=ssat->rejc[j];
+            sat[n].ion[0]=(float)(state.ion?rtk->x[k]:0.0);
+            sat[n].ion[1]=(float)(state.ion&&k<rtk->na?rtk->xa[k]:0.0);
+            n++;
+        }
+    }
+    sstat_write(sstat_bin,&state,sat,n);
+}
 /* output solution status ----------------------------------------------------*/
 static void outsolstat(rtk_t *rtk)
 {
@@ -307,6 +452,7 @@ static void outsolstat(rtk_t *rtk)
     double tow;
     char buff[MAXSOLMSG+1],id[32];
     int i,j,n,week,nfreq,nf=NF(&rtk->opt);
+    PROF_SCOPE(rtk->prof,PROF_SOLSTAT);
 
     if (statlevel<=0||!fp_stat||!rtk->sol.stat) return;
 
@@ -315,6 +461,10 @@ static void outsolstat(rtk_t *rtk)
     /* swap solution status file */
     swapsolstat();
 
+    if (sstat_bin) {
+        outsolstatb(rtk);
+        return;
+    }
     /* write solution status */
     n=rtkoutstat(rtk,buff); buff[n]='\0';
 
@@ -402,6 +552,9 @@ static void arc_initx(rtk_t *rtk,double xi,double var,int i)
     for (j=0;j<rtk->nx;j++) {
         rtk->P[i+j*rtk->nx]=rtk->P[j+i*rtk->nx]=i==j?var:0.0;
     }
+    /* re-initialized phase-bias starts a new parameter */
+    if (rtk->neq) arc_neq_retire(rtk->neq,i);
+    if (rtk->fls) arc_fls_retire(rtk->fls,i);
 }
 /*----------------------------------------------------------------------------*/
 static void arc_diff_pr_initx(double *x,double *P,double xi,double var,int i,
@@ -410,17 +563,17 @@ static void arc_diff_pr_initx(double *x,double *P,double xi,double var,int i,
     int j; x[i]=xi; for (j=0;j<nx;j++) P[i+j*nx]=P[j+i*nx]=i==j?var:0.0;
 }
 /* exclude meas of eclipsing satellite (block IIA) ---------------------------*/
-static void arc_testeclipse(const obsd_t *obs,int n,const nav_t *nav,double *rs)
+static void arc_testeclipse(const obsd_t *obs,int n,const nav_t *nav,
+                            const double *rsun,double *rs)
 {
-    double rsun[3],esun[3],r,ang,erpv[5]={0},cosa;
+    double esun[3],r,ang,cosa;
     int i,j;
     const char *type;
 
     arc_log(ARC_INFO,"testeclipse:\n");
 
     /* unit vector of sun direction (ecef) */
-    arc_sunmoonpos(gpst2utc(obs[0].time),erpv,rsun,NULL,NULL);
-    arc_normv3(rsun,esun);
+    if (!arc_normv3(rsun,esun)) return;
 
     for (i=0;i<n;i++) {
         type=nav->pcvs[obs[i].sat-1].type;
@@ -601,15 +754,13 @@ extern int arc_yaw_angle(int sat,const char *type,int opt,double beta,double mu,
     return 0;
 }
 /* satellite attitude model --------------------------------------------------*/
-static int arc_sat_yaw(gtime_t time,int sat,const char *type,int opt,
+static int arc_sat_yaw(const double *rsun,int sat,const char *type,int opt,
                        const double *rs,double *exs,double *eys)
 {
-    double rsun[3],ri[6],es[3],esun[3],n[3],p[3],en[3],ep[3],ex[3],E,beta,mu;
-    double yaw,cosy,siny,erpv[5]={0};
+    double ri[6],es[3],esun[3],n[3],p[3],en[3],ep[3],ex[3],E,beta,mu;
+    double yaw,cosy,siny;
     int i;
 
-    arc_sunmoonpos(gpst2utc(time), erpv, rsun, NULL, NULL);
-
     /* beta and orbit angle */
     arc_matcpy(ri,rs,6,1);
     ri[3]-=OMGE*ri[1];
@@ -638,7 +789,7 @@ static int arc_sat_yaw(gtime_t time,int sat,const char *type,int opt,
     return 1;
 }
 /* phase windup model --------------------------------------------------------*/
-static int arc_model_phw(gtime_t time,int sat,const char *type,int opt,
+static int arc_model_phw(const double *rsun,int sat,const char *type,int opt,
                          const double *rs,const double *rr,double *phw)
 {
     double exs[3],eys[3],ek[3],exr[3],eyr[3],eks[3],ekr[3],E[9];
@@ -648,7 +799,7 @@ static int arc_model_phw(gtime_t time,int sat,const char *type,int opt,
     if (opt<=0) return 1; /* no phase windup */
 
     /* satellite yaw attitude model */
-    if (!arc_sat_yaw(time,sat,type,opt,rs,exs,eys)) return 0;
+    if (!arc_sat_yaw(rsun,sat,type,opt,rs,exs,eys)) return 0;
 
     /* unit vector satellite to receiver */
     for (i=0;i<3;i++) r[i]=rr[i]-rs[i];
@@ -753,6 +904,7 @@ static void arc_udpos(rtk_t *rtk,double tt)
     /* fixed mode */
     if (rtk->opt.mode==PMODE_FIXED) {
         for (i=0;i<3;i++) arc_initx(rtk,rtk->opt.ru[i],1E-8,i);
+        rtk->ntu=0;
         return;
     }
     /* initialize position for first epoch */
@@ -765,6 +917,7 @@ static void arc_udpos(rtk_t *rtk,double tt)
         /* initial rover station clock drift */
         if (rtk->opt.est_doppler) arc_initx(rtk,rtk->sol.clk_dri,
                                             VAR_CLKDRI,IC(&rtk->opt));
+        rtk->ntu=0;
         return; /* initial compeleted */
     }
     /* dynamic mode for rover station */
@@ -787,7 +940,7 @@ static void arc_udpos(rtk_t *rtk,double tt)
     if (rtk->opt.est_doppler) rtk->ceres_active_x[ic]=1; /* clock drift */
 
     /* static mode */
-    if (rtk->opt.mode==PMODE_STATIC) return;
+    if (rtk->opt.mode==PMODE_STATIC) {rtk->ntu++; return;}
 
     /* reset rover station pistion and its variance */
     /* todo:using standard positioning to initial ukf prior states and its covariacne matrix,
@@ -795,6 +948,7 @@ static void arc_udpos(rtk_t *rtk,double tt)
 
     /* kinamic without dynamic mode */
     if (!rtk->opt.dynamics) { /* don't think about rover station velecity */
+        rtk->ntu=0; /* position re-initialized every epoch */
 
         if (rtk->opt.est_doppler) { /* clock drift initial */
             rtk->x[IC(&rtk->opt)]=rtk->sol.clk_dri;
@@ -835,6 +989,7 @@ static void arc_udpos(rtk_t *rtk,double tt)
         for (i=0;i<3;i++) arc_initx(rtk,rtk->sol.rr[i],VAR_POS,i);
         for (i=3;i<6;i++) arc_initx(rtk,rtk->sol.rr[i],VAR_VEL,i);
         arc_log(ARC_INFO,"reset rtk position due to large variance: var=%.3f\n",var);
+        rtk->ntu=0;
         return;
     }
     /* state transition of position/velocity/acceleration for dynamic mode */
@@ -855,6 +1010,7 @@ static void arc_udpos(rtk_t *rtk,double tt)
     arc_matcpy(rtk->x,xp,nx,1);
     arc_matmul("NN",nx,nx,nx,1.0,F,rtk->P,0.0,FP);
     arc_matmul("NT",nx,nx,nx,1.0,FP,F,0.0,rtk->P);
+    if (rtk->fls) arc_fls_udpos(rtk->fls,tt);
 
     arc_log(ARC_INFO,"arc_udpos : after state transition P = \n");
     arc_tracemat(ARC_MATPRINTF,rtk->P,nx,nx,10,4);
@@ -869,6 +1025,7 @@ static void arc_udpos(rtk_t *rtk,double tt)
     /* process noice of clock drift */
     if (rtk->opt.est_doppler) rtk->P[ic+ic*nx]+=SQR(rtk->opt.clk_dri_prn)*tt;
 
+    rtk->ntu++;
     free(F); free(FP); free(xp);
 }
 /* temporal update of ionospheric parameters ---------------------------------*/
@@ -904,14 +1061,13 @@ static void arc_udtrop(rtk_t *rtk,double tt,double bl)
 {
     double pos[3],azel[]={0.0,PI/2.0},zwd=INIT_ZWD,var;
     int i,j,k;
-    static int trpc=0;
 
     arc_log(ARC_INFO,"udtrop  : tt=%.1f\n",tt);
 
     for (i=0;i<2;i++) {
         j=IT(i,&rtk->opt);
 
-        if (rtk->x[j]<=0.0||trpc++>MINTROP) {
+        if (rtk->x[j]<=0.0||rtk->trpc++>MINTROP) {
 
             if (i==0) ecef2pos(rtk->sol.rr,pos);
             if (i==1) ecef2pos(rtk->opt.rb,pos);
@@ -921,7 +1077,7 @@ static void arc_udtrop(rtk_t *rtk,double tt,double bl)
             if (rtk->opt.tropopt>=TROPOPT_ESTG) {
                 for (k=0;k<2;k++) arc_initx(rtk,1E-6,VAR_GRA,++j);
             }
-            trpc=0; /* reset counts of trop-holding */
+            rtk->trpc=0; /* reset counts of trop-holding */
         }
         else {
             rtk->P[j+j*rtk->nx]+=SQR(rtk->opt.prn[2])*tt;
@@ -1477,6 +1633,7 @@ static void arc_udstate(rtk_t *rtk, const obsd_t *obs, const int *sat,
                         const double *rs,double*y,const double *azel)
 {
     double tt=fabs(rtk->tt),bl,dr[3];
+    PROF_SCOPE(rtk->prof,PROF_UDSTATE);
 
     arc_log(ARC_INFO,"arc_udstate : ns=%d\n",ns);
 
@@ -1498,6 +1655,8 @@ static void arc_udstate(rtk_t *rtk, const obsd_t *obs, const int *sat,
             arc_udbias(rtk,tt,obs,sat,iu,ir,ns,nav,rs);
         }
     }
+    /* predicted states for fixed-lag smoother */
+    if (rtk->fls) arc_fls_pred(rtk->fls,rtk);
 }
 /* undifferenced phase/code residual for satellite ---------------------------*/
 static void arc_zdres_sat(int base, double r, const obsd_t *obs, const nav_t *nav,
@@ -1526,15 +1685,198 @@ static void arc_zdres_sat(int base, double r, const obsd_t *obs, const nav_t *na
     /* record undifferenced residual numbers */
     if (nzd) *nzd+=2;
 }
-/* undifferenced phase/code residuals ----------------------------------------*/
+/* troposphere mapping function of rover or base station --------------------*/
+static double arc_mapf(rtk_t *rtk, int r, gtime_t time, const double *pos,
+                       const double *azel, double *mapfw)
+{
+    if (!rtk->opt.tropmapt) return arc_tropmapf(time,pos,azel,mapfw);
+
+    if (!rtk->mapt[r].func) rtk->mapt[r].func=arc_tropmapf;
+    return arc_mapt(&rtk->mapt[r],time,pos,azel,mapfw);
+}
+/* reset undifferenced residual context --------------------------------------
+* station terms (tide displacement, geodetic position, zenith hydrostatic
+* delay) are computed here, satellite terms are computed on first use
+*-----------------------------------------------------------------------------*/
+static void arc_zdctx_init(zdctx_t *ctx, int base, const obsd_t *obs, int n,
+                           const double *rr, const geoctx_t *geo,
+                           const prcopt_t *opt)
+{
+    double rr_[3],zazel[]={0.0,90.0*D2R};
+    int i;
+
+    arc_log(ARC_INFO,"arc_zdctx_init : base=%d n=%d\n",base,n);
+
+    ctx->time=obs[0].time; ctx->n=n;
+    for (i=0;i<3;i++) {
+        ctx->rr[i]=rr[i]; ctx->disp[i]=0.0;
+    }
+    /* earth tide correction */
+    if (opt->tidecorr) {
+        arc_tidedisp_ctx(geo,gpst2utc(obs[0].time),rr,opt->tidecorr,
+                         opt->odisp[base],ctx->disp);
+    }
+    for (i=0;i<3;i++) rr_[i]=rr[i]+ctx->disp[i];
+    ecef2pos(rr_,ctx->pos);
+
+    /* troposphere delay model (hydrostatic) */
+    ctx->zhd=arc_tropmodel(obs[0].time,ctx->pos,zazel,0.0);
+
+    for (i=0;i<n;i++) {
+        ctx->sat[i]=obs[i].sat; ctx->stat[i]=0;
+    }
+}
+/* test undifferenced residual context ----------------------------------------*/
+static int arc_zdctx_test(const zdctx_t *ctx, const obsd_t *obs, int n,
+                          const double *rr)
+{
+    double dr[3];
+    int i;
+
+    if (ctx->time.time==0||ctx->n!=n) return 0;
+    if (timediff(obs[0].time,ctx->time)!=0.0) return 0;
+
+    for (i=0;i<3;i++) dr[i]=rr[i]-ctx->rr[i];
+    if (arc_norm(dr,3)>ZDCTX_TOL) return 0;
+
+    for (i=0;i<n;i++) if (ctx->sat[i]!=obs[i].sat) return 0;
+    return 1;
+}
+/* satellite terms of undifferenced residual context --------------------------*/
+static void arc_zdctx_sat(zdctx_t *ctx, int i, const obsd_t *obs,
+                          const double *rs, const double *rr, const double *azel,
+                          const nav_t *nav, const prcopt_t *opt, int index,
+                          rtk_t *rtk)
+{
+    ctx->stat[i]=-1;
+
+    /* troposphere delay model (hydrostatic) */
+    ctx->trop[i]=arc_mapf(rtk,index,obs->time,ctx->pos,azel,NULL)*ctx->zhd;
+
+    /* ionospheric corrections */
+    if (!arc_ionocorr(obs->time,nav,obs->sat,ctx->pos,azel,IONOOPT_BRDC,
+                      ctx->dion+i,ctx->vion+i)) return;
+
+    /* receiver antenna phase center correction */
+    if (rtk->pcvt[index].stat) {
+        arc_antmodel_t(rtk->pcvt+index,azel,opt->posopt[1],ctx->dant+i*NFREQ);
+    }
+    else {
+        arc_antmodel(opt->pcvr+index,opt->antdel[index],azel,opt->posopt[1],
+                     ctx->dant+i*NFREQ);
+    }
+
+    /* phase windup model */
+    ctx->phw[i]=rtk->ssat[obs->sat-1].phw;
+    if (!arc_model_phw(rtk->geo.rsun,obs->sat,nav->pcvs[obs->sat-1].type,
+                       opt->posopt[2]?2:0,rs,rr,ctx->phw+i)) return;
+
+    ctx->stat[i]=1;
+}
+/* precompute epoch context ----------------------------------------------------
+* precompute satellite positions/clocks, geophysical context and station
+* terms of base station of an epoch. they do not depend on filter states
+* and can be computed ahead of arc_srtkpos() in another thread
+* args   : epctx_t  *ctx    IO  epoch context
+*          geoctx_t *geo    IO  geophysical context kept over epochs
+*          obsd_t   *obs    I   observation data of epoch (rover+base)
+*          int      n       I   number of observation data
+*          nav_t    *nav    I   navigation data
+*          prcopt_t *opt    I   processing options
+* return : none
+* notes  : arc_srtkpos() uses the context set to rtk->epc if time and
+*          satellites match the observation data, or recomputes the terms.
+*          station terms of base station are only computed for fixed base
+*          station position. satellite terms of base station residuals keep
+*          phase windup of previous epoch and are computed in arc_srtkpos()
+*-----------------------------------------------------------------------------*/
+extern void arc_epctx_init(epctx_t *ctx, geoctx_t *geo, const obsd_t *obs,
+                           int n, const nav_t *nav, const prcopt_t *opt)
+{
+    int i,nu,nr;
+
+    arc_log(ARC_INFO,"arc_epctx_init : n=%d\n",n);
+
+    ctx->time.time=0; ctx->zdb=0;
+    if (n<=0||n>MAXOBS*2) return;
+
+    for (nu=0;nu   <n&&obs[nu   ].rcv==1;nu++) ;
+    for (nr=0;nu+nr<n&&obs[nu+nr].rcv==2;nr++) ;
+
+    arc_geoctx_update(geo,gpst2utc(obs[0].time),&nav->erp);
+    ctx->geo=*geo;
+
+    arc_satposs(obs[0].time,obs,n,nav,opt->sateph,geo->rsun,ctx->rs,ctx->dts,
+                ctx->var,ctx->svh);
+
+    /* station terms of fixed base station */
+    if (nr>0&&nr<=MAXOBS&&opt->refpos<=POSOPT_RINEX&&opt->mode!=PMODE_SINGLE&&
+        opt->mode!=PMODE_MOVEB&&arc_norm(opt->rb,3)>0.0) {
+        arc_zdctx_init(&ctx->zdc,1,obs+nu,nr,opt->rb,geo,opt);
+        ctx->zdb=1;
+    }
+    for (i=0;i<n;i++) ctx->sat[i]=obs[i].sat;
+    ctx->n=n;
+    ctx->time=obs[0].time;
+}
+/* satellite positions/clocks of precomputed epoch context -------------------*/
+static int arc_epctx_sat(const epctx_t *ctx, const obsd_t *obs, int n,
+                         double *rs, double *dts, double *var, int *svh)
+{
+    int i;
+
+    if (!ctx||ctx->time.time==0||ctx->n!=n) return 0;
+    if (timediff(obs[0].time,ctx->time)!=0.0) return 0;
+
+    for (i=0;i<n;i++) if (ctx->sat[i]!=obs[i].sat) return 0;
+
+    memcpy(rs ,ctx->rs ,sizeof(double)*6*n);
+    memcpy(dts,ctx->dts,sizeof(double)*2*n);
+    memcpy(var,ctx->var,sizeof(double)*n);
+    memcpy(svh,ctx->svh,sizeof(int)*n);
+    return 1;
+}
+/* satellite positions/clocks and geophysical context of epoch ----------------
+* use precomputed epoch context rtk->epc if available. station terms of base
+* station of the context are taken if the base station context is not valid
+*-----------------------------------------------------------------------------*/
+static void arc_epsatposs(rtk_t *rtk, const obsd_t *obs, int nu, int nr,
+                          const nav_t *nav, double *rs, double *dts, double *var,
+                          int *svh)
+{
+    const epctx_t *ctx=rtk->epc;
+    gtime_t time=obs[0].time;
+    PROF_SCOPE(rtk->prof,PROF_SATPOS);
+
+    if (!arc_epctx_sat(ctx,obs,nu+nr,rs,dts,var,svh)) {
+        arc_geoctx_update(&rtk->geo,gpst2utc(time),&nav->erp);
+        arc_satposs(time,obs,nu+nr,nav,rtk->opt.sateph,rtk->geo.rsun,rs,dts,var,
+                    svh);
+        return;
+    }
+    rtk->geo=ctx->geo;
+
+    if (ctx->zdb&&!arc_zdctx_test(rtk->zdc+1,obs+nu,nr,rtk->rb)&&
+        arc_zdctx_test(&ctx->zdc,obs+nu,nr,rtk->rb)) {
+        rtk->zdc[1]=ctx->zdc;
+    }
+}
+/* undifferenced phase/code residuals ------------------------------------------
+* models of the station and of the satellites are kept in the epoch context
+* rtk->zdc[base] and reused by later calls of the same epoch as long as the
+* linearization point rr stays within ZDCTX_TOL of the point they were
+* computed at. only geometric ranges and azimuth/elevation angles are
+* recomputed on these calls
+*-----------------------------------------------------------------------------*/
 static int arc_zdres(int base, const obsd_t *obs, int n, const double *rs,
                      const double *dts,const int *svh, const nav_t *nav,
                      const double *rr,const prcopt_t *opt, int index, double *y,
                      double *e,double *azel,rtk_t* rtk,double *ukf_y)
 {
-    double r,rr_[3],pos[3],dant[NFREQ]={0},disp[3];
-    double zhd,zazel[]={0.0,90.0*D2R},dion,vion,*py=y,*pukfy=ukf_y;
+    zdctx_t *ctx=&rtk->zdc[base?1:0];
+    double r,rr_[3],*pos=ctx->pos,*py=y,*pukfy=ukf_y;
     int i=0,nf=1,nzd=0;
+    PROF_SCOPE(rtk->prof,base?PROF_ZDRESB:PROF_ZDRESR);
 
     arc_log(ARC_INFO,"arc_zdres   : n=%d\n",n);
 
@@ -1544,15 +1886,20 @@ static int arc_zdres(int base, const obsd_t *obs, int n, const double *rs,
 
     if (arc_norm(rr,3)<=0.0) return 0; /* no receiver position */
 
-    for (i=0;i<3;i++) rr_[i]=rr[i];
-
-    /* earth tide correction */
-    if (opt->tidecorr) {
-        arc_tidedisp(gpst2utc(obs[0].time),rr_,opt->tidecorr,&nav->erp,
-                     opt->odisp[base],disp);
-        for (i=0;i<3;i++) rr_[i]+=disp[i];
+    if (n>MAXOBS) {
+        arc_log(ARC_WARNING,"arc_zdres : too many observations n=%d\n",n);
+        return 0;
     }
-    ecef2pos(rr_,pos);
+    /* geophysical context not updated for this epoch */
+    if (!rtk->geo.time.time||
+        fabs(timediff(gpst2utc(obs[0].time),rtk->geo.time))>GEOCTX_TOL) {
+        arc_geoctx_update(&rtk->geo,gpst2utc(obs[0].time),&nav->erp);
+    }
+    /* station terms of new epoch or new linearization point */
+    if (!arc_zdctx_test(ctx,obs,n,rr)) {
+        arc_zdctx_init(ctx,base,obs,n,rr,&rtk->geo,opt);
+    }
+    for (i=0;i<3;i++) rr_[i]=rr[i]+ctx->disp[i];
 
     for (i=0;i<n;i++) { /* loop for numbers of observations */
         /* compute geometric-range and azimuth/elevation angle */
@@ -1565,28 +1912,23 @@ static int arc_zdres(int base, const obsd_t *obs, int n, const double *rs,
         /* satellite clock-bias */
         r+=-CLIGHT*dts[i*2];
 
-        /* troposphere delay model (hydrostatic) */
-        zhd=arc_tropmodel(obs[0].time,pos,zazel,0.0);
-        r+=arc_tropmapf(obs[i].time,pos,azel+i*2,NULL)*zhd;
+        /* troposphere, ionosphere, antenna and phase windup models */
+        if (!ctx->stat[i]) {
+            arc_zdctx_sat(ctx,i,obs+i,rs+i*6,rr,azel+i*2,nav,opt,index,rtk);
+        }
+        if (ctx->stat[i]<0) continue;
 
-        /* ionospheric corrections */
-        if (!arc_ionocorr(obs[i].time,nav,obs[i].sat,pos,azel+i*2,
-                          IONOOPT_BRDC,&dion,&vion)) continue;
-        /* receiver antenna phase center correction */
-        arc_antmodel(opt->pcvr+index,opt->antdel[index],azel+i*2,opt->posopt[1],dant);
+        r+=ctx->trop[i];
+        rtk->ssat[obs[i].sat-1].phw=ctx->phw[i];
 
-        /* phase windup model */
-        if (!arc_model_phw(rtk->sol.time,obs[i].sat,nav->pcvs[obs[i].sat-1].type,
-                           opt->posopt[2]?2:0,rs+i*6,rr,&rtk->ssat[obs[i].sat-1].phw)) {
-            continue;
-        }
         /* adjust measurements vector pointor */
         if (py!=NULL) py=y+i*nf*2;           /* for akf and ekf */
 
         if (pukfy!=NULL) pukfy=ukf_y+i*nf*2; /* for ukf */
 
         /* undifferenced phase/code residual for satellite */
-        arc_zdres_sat(base,r,obs+i,nav,azel+i*2,dant,dion,vion,opt,py,rtk,pukfy,&nzd);
+        arc_zdres_sat(base,r,obs+i,nav,azel+i*2,ctx->dant+i*NFREQ,ctx->dion[i],
+                      ctx->vion[i],opt,py,rtk,pukfy,&nzd);
     }
     arc_log(ARC_INFO,"arc_zdres : rr_=%.3f %.3f %.3f\n",rr_[0],rr_[1],rr_[2]);
     arc_log(ARC_INFO,"arc_zdres : pos=%.9f %.9f %.3f\n",pos[0]*R2D,pos[1]*R2D,pos[2]);
@@ -1627,7 +1969,7 @@ static void arc_ddcov(const int *nb,int n,const double *Ri,const double *Rj,
     arc_tracemat(ARC_MATPRINTF,R,nv,nv,8,6);
 }
 /* precise tropspheric model -------------------------------------------------*/
-static double arc_prectrop(gtime_t time, const double *pos, int r,
+static double arc_prectrop(rtk_t *rtk, gtime_t time, const double *pos, int r,
                            const double *azel, const prcopt_t *opt, const double *x,
                            double *dtdx)
 {
@@ -1635,7 +1977,7 @@ static double arc_prectrop(gtime_t time, const double *pos, int r,
     int i=IT(r,opt);
 
     /* wet mapping function */
-    arc_tropmapf(time,pos,azel,&m_w);
+    arc_mapf(rtk,r,time,pos,azel,&m_w);
 
     if (opt->tropopt>=TROPOPT_ESTG&&azel[1]>0.0) {
 
@@ -1651,121 +1993,6 @@ static double arc_prectrop(gtime_t time, const double *pos, int r,
     dtdx[0]=m_w;
     return m_w*x[i];
 }
-/* exctract actcive H of kalman filter----------------------------------------*/
-static int arc_kalman_exct_xHP(const rtk_t *rtk,const double *Hi,double *Ho,
-                               int nv,double *x,double *P)
-{
-    int i,j,k,nx=rtk->nx,*ix;
-
-    arc_log(ARC_INFO,"arc_kalman_exct_H:\n");
-
-    ix=arc_imat(nx,1); for (i=0,j=0;i<nx;i++) if (rtk->ceres_active_x[i]) ix[j++]=i;
-
-    arc_log(ARC_INFO,"active sates index =\n");
-    arc_tracemati(ARC_MATPRINTF,ix,1,j,2,0);
-
-    if (x) for (i=0;i<j;i++) x[i]=rtk->x[ix[i]];
-    if (P) for (i=0;i<j;i++) for (k=0;k<j;k++) P[i*j+k]=rtk->P[ix[i]*nx+ix[k]];
-
-    if (Ho) for (i=0;i<nv;i++) for (k=0;k<j;k++) Ho[i*j+k]=Hi[i*nx+ix[k]];
-
-    arc_log(ARC_INFO,"x=\n"); arc_tracemat(ARC_MATPRINTF,x,1,j,10,4);
-    arc_log(ARC_INFO,"P=\n"); arc_tracemat(ARC_MATPRINTF,P,j,j,10,4);
-    arc_log(ARC_INFO,"H=\n"); arc_tracemat(ARC_MATPRINTF,Ho,j,nv,10,4);
-
-    free(ix);
-    return j; /* numbers of active states */
-}
-/* normalization of innovation series of kalman filter------------------------*/
-static int arc_kalman_norm_inno(const rtk_t *rtk,const double *v,int nv,const double *H,
-                                const double *R,double*ve)
-{
-    int i,nx=rtk->nx,n,info=1;
-    double *He,*Pe,*HP,*Qe,*L=NULL;
-
-    arc_log(ARC_INFO,"arc_kalman_norm_inno :\n");
-
-    arc_log(ARC_INFO,"v=\n"); arc_tracemat(ARC_MATPRINTF,v,nv,1,10,4);
-
-    He=arc_zeros(nx,nv); Pe=arc_zeros(nx,nx);
-
-    n=arc_kalman_exct_xHP(rtk,H,He,nv,NULL,Pe);
-
-    HP=arc_mat(nv,n); Qe=arc_mat(nv,nv);
-    arc_matmul("TN",nv,n,n,1.0,He,Pe,0.0,HP);
-    arc_matcpy(Qe,R,nv,nv);
-    arc_matmul("NN",nv,nv,n,1.0,HP,He,1.0,Qe);
-
-    arc_log(ARC_INFO,"Qe=\n");
-    arc_tracemat(ARC_MATPRINTF,Qe,nv,nv,10,4);
-
-    if (!(info=arc_matinv(Qe,nv))) {
-
-        arc_log(ARC_INFO,"Qe-inv=\n");
-        arc_tracemat(ARC_MATPRINTF,Qe,nv,nv,10,4);
-
-        /* cholesky matrix decomposition */
-        L=arc_cholesky(Qe,nv);
-
-        arc_log(ARC_INFO,"L=\n");
-        arc_tracemat(ARC_MATPRINTF,L,nv,nv,10,4);
-
-        /* normalization */
-        if (L&&ve) arc_matmul("NN",nv,1,nv,1.0,L,v,0.0,ve);
-
-        arc_log(ARC_INFO,"ve=\n");
-        arc_tracemat(ARC_MATPRINTF,ve,1,nv,10,4);
-    }
-    if (L) free(L); free(He); free(Pe); free(Qe);
-    return info;
-}
-/* covariance matrix of normalization of innovation series of kalman filte----*/
-static void arc_kalman_norm_Qino(const double *v,int nv,double *Qv)
-{
-    arc_log(ARC_INFO,"arc_kalman_norm_Qino :\n");
-
-    int i;
-    double ave_v=0.0,*ve=arc_mat(nv,1);
-    for (i=0;i<nv;i++) ave_v+=v[i]; ave_v/=nv;
-
-    arc_log(ARC_INFO,"average of innovation series=%10.6lf\n",ave_v);
-
-    for (i=0;i<nv;i++) ve[i]=v[i]-ave_v;
-    if (Qv) arc_matmul("NT",nv,nv,1,1.0,ve,ve,0.0,Qv);
-
-    arc_log(ARC_INFO,"Qv=\n"); arc_tracemat(ARC_MATPRINTF,Qv,nv,nv,10,4);
-
-    free(ve);
-}
-/* kalman robust check function-----------------------------------------------*/
-static double arc_robust_chk(int nv,double alpha,double rk)
-{
-    arc_log(ARC_INFO,"arc_robust_chk : \n");
-
-    static const double rr=arc_re_chi2(nv,alpha);
-
-    if (alpha<=0.0) {
-        if (rk>chisqr[nv]) return SQRT(chisqr[nv]/rk); /* alpha=0.001 */
-    }
-    else {
-        if (rk>=rr) return 0.95;/* robust */
-    }
-    return 1.0;
-}
-/* kalman filter Phi matrix---------------------------------------------------*/
-static void arc_kalman_robust_phi(const rtk_t *rtk,const double *vn,int nv,
-                                  int nx,double *phi,const double *Qv)
-{
-    int i,n=nv;
-    double alpha=rtk->opt.kalman_robust_alpha;
-
-    arc_log(ARC_INFO,"arc_kalman_phi :\n");
-
-    for (i=0;i<nv;i++) phi[i+i*nv]=arc_robust_chk(n-1,alpha,fabs(Qv[i+i*nv]));
-
-    arc_log(ARC_INFO,"Phi=\n");
-    arc_tracemat(ARC_MATPRINTF,phi,nv,nv,10,4);
-}
 /* doppler partial derivatives by rover position------------------------------*/
 static void arc_doppler_dr(const double *rr,const double *rs,const double *e,
                            double *dr,int dynamic,int estclk,int ic)
@@ -1845,8 +2072,8 @@ static int arc_ddres_noamb(rtk_t *rtk,const nav_t *nav,double dt,const double *x
     /* compute factors of ionospheric and tropospheric delay */
     for (i=0;i<ns;i++) {
         if (opt->tropopt>=TROPOPT_EST) {
-            tropu[i]=arc_prectrop(rtk->sol.time,posu,0,azel+iu[i]*2,opt,x,dtdxu+i*3);
-            tropr[i]=arc_prectrop(rtk->sol.time,posr,1,azel+ir[i]*2,opt,x,dtdxr+i*3);
+            tropu[i]=arc_prectrop(rtk,rtk->sol.time,posu,0,azel+iu[i]*2,opt,x,dtdxu+i*3);
+            tropr[i]=arc_prectrop(rtk,rtk->sol.time,posr,1,azel+ir[i]*2,opt,x,dtdxr+i*3);
         }
     }
     /* double-differenced phase/code residuals */
@@ -1965,6 +2192,7 @@ static int arc_ddres(rtk_t *rtk,const nav_t *nav,double dt,const double *x,
     double bl,dr[3],posu[3],posr[3],didxi=0.0,didxj=0.0,*im;
     double *tropr,*tropu,*dtdxr,*dtdxu,*Ri,*Rj,lami,lamj,fi,fj,*Hi=NULL,*RR=NULL,R1,R2;
     int i,j,k,m,f,ff=0,nv=0,nb[NFREQ*4*2+2]={0},b=0,sysi,sysj,nf=1,nd=0;
+    PROF_SCOPE(rtk->prof,PROF_DDRES);
 
     arc_log(ARC_INFO,"arc_ddres   : dt=%.1f nx=%d ns=%d\n",dt,rtk->nx,ns);
 
@@ -1991,8 +2219,8 @@ static int arc_ddres(rtk_t *rtk,const nav_t *nav,double dt,const double *x,
             im[i]=(arc_ionmapf(posu,azel+iu[i]*2)+arc_ionmapf(posr,azel+ir[i]*2))/2.0;
         }
         if (opt->tropopt>=TROPOPT_EST) {
-            tropu[i]=arc_prectrop(rtk->sol.time,posu,0,azel+iu[i]*2,opt,x,dtdxu+i*3);
-            tropr[i]=arc_prectrop(rtk->sol.time,posr,1,azel+ir[i]*2,opt,x,dtdxr+i*3);
+            tropu[i]=arc_prectrop(rtk,rtk->sol.time,posu,0,azel+iu[i]*2,opt,x,dtdxu+i*3);
+            tropr[i]=arc_prectrop(rtk,rtk->sol.time,posr,1,azel+ir[i]*2,opt,x,dtdxr+i*3);
         }
     }
     for (m=0;m<4;m++) /* m=0:gps/qzs/sbs,1:glo,2:gal,3:bds */
@@ -2250,6 +2478,7 @@ static int arc_ddres_ddamb(rtk_t *rtk,const nav_t *nav,double dt,const double *x
     double *tropr,*tropu,*dtdxr,*dtdxu,*Ri,*Rj,fi,fj,lami,lamj,*Hi=NULL,*RR=NULL;
     int i,j,k,f,m,ff=0,nv=0,nb[NFREQ*4*2+2]={0},b=0,nf=1;
     int sat1,sat2,pi,pj,ib=-1,sysi,sysj,nd=0;
+    PROF_SCOPE(rtk->prof,PROF_DDRES);
 
     bl=arc_baseline(x,rtk->rb,dr);
     if (bl<=0.0) {
@@ -2271,8 +2500,8 @@ static int arc_ddres_ddamb(rtk_t *rtk,const nav_t *nav,double dt,const double *x
             im[i]=(arc_ionmapf(posu,azel+iu[i]*2)+arc_ionmapf(posr,azel+ir[i]*2))/2.0;
         }
         if (opt->tropopt>=TROPOPT_EST) {
-            tropu[i]=arc_prectrop(rtk->sol.time,posu,0,azel+iu[i]*2,opt,x,dtdxu+i*3);
-            tropr[i]=arc_prectrop(rtk->sol.time,posr,1,azel+ir[i]*2,opt,x,dtdxr+i*3);
+            tropu[i]=arc_prectrop(rtk,rtk->sol.time,posu,0,azel+iu[i]*2,opt,x,dtdxu+i*3);
+            tropr[i]=arc_prectrop(rtk,rtk->sol.time,posr,1,azel+ir[i]*2,opt,x,dtdxr+i*3);
         }
     }
     /* construct double-difference residuals */
@@ -2599,31 +2828,32 @@ static int arc_diff_pr_ddres(rtk_t *rtk,const nav_t *nav,double dt,const double
 static double arc_intpres(gtime_t time, const obsd_t *obs, int n, const nav_t *nav,
                           rtk_t *rtk, double *y)
 {
-    static obsd_t obsb[MAXOBS];
-    static double yb[MAXOBS*NFREQ*2],rs[MAXOBS*6],dts[MAXOBS*2],var[MAXOBS];
-    static double e[MAXOBS*3],azel[MAXOBS*2];
-    static int nb=0,svh[MAXOBS*2];
+    double yb[MAXOBS*NFREQ*2],rs[MAXOBS*6],dts[MAXOBS*2],var[MAXOBS];
+    double e[MAXOBS*3],azel[MAXOBS*2];
+    obsd_t *obsb=rtk->obsb;
+    int svh[MAXOBS*2];
     prcopt_t *opt=&rtk->opt;
     double tt=timediff(time,obs[0].time),ttb,*p,*q;
     int i,j,k,nf=1;
 
     arc_log(ARC_INFO,"arc_intpres : n=%d tt=%.1f\n",n,tt);
 
-    if (nb==0||fabs(tt)<DTTOL) {
-        nb=n; for (i=0;i<n;i++) obsb[i]=obs[i];
+    if (rtk->nobsb==0||fabs(tt)<DTTOL) {
+        rtk->nobsb=n<MAXOBS?n:MAXOBS;
+        for (i=0;i<rtk->nobsb;i++) obsb[i]=obs[i];
         return tt;
     }
     ttb=timediff(time,obsb[0].time);
     if (fabs(ttb)>opt->maxtdiff*2.0||ttb==tt) return tt;
 
-    arc_satposs(time,obsb,nb,nav,opt->sateph,rs,dts,var,svh);
+    arc_satposs(time,obsb,rtk->nobsb,nav,opt->sateph,NULL,rs,dts,var,svh);
 
-    if (!arc_zdres(1,obsb,nb,rs,dts,svh,nav,rtk->rb,opt,1,yb,e,azel,rtk,NULL)) {
+    if (!arc_zdres(1,obsb,rtk->nobsb,rs,dts,svh,nav,rtk->rb,opt,1,yb,e,azel,rtk,NULL)) {
         return tt;
     }
     for (i=0;i<n;i++) {
-        for (j=0;j<nb;j++) if (obsb[j].sat==obs[i].sat) break;
-        if (j>=nb) continue;
+        for (j=0;j<rtk->nobsb;j++) if (obsb[j].sat==obs[i].sat) break;
+        if (j>=rtk->nobsb) continue;
         for (k=0,p=y+i*nf*2,q=yb+j*nf*2;k<nf*2;k++,p++,q++) {
             if (*p==0.0||*q==0.0) *p=0.0;
             else *p=(ttb*(*p)-tt*(*q))/(ttb-tt);
@@ -2694,6 +2924,7 @@ static int arc_ddmat(rtk_t *rtk, double *D)
         }
     }
     rtk->amb_nb=nb; /* save numbers of double-difference ambiguity */
+    if (rtk->prof) rtk->prof->ep.nb=nb;
     if (D) {
         arc_log(ARC_INFO,"D=\n"); arc_tracemat(ARC_MATPRINTF,D,nx,na+nb,2,0);
     }
@@ -2869,12 +3100,53 @@ static int arc_amb_fix_sol(rtk_t *rtk,int nb,int na,double *Qb,const double *y,
     free(db); free(QQ);
     return info;
 }
+/* ambiguity resolution out of time budget of epoch --------------------------*/
+static int arc_ar_expired(const rtk_t *rtk)
+{
+    return rtk->ar_dl>0.0&&arc_prof_tic()>=rtk->ar_dl;
+}
+/* remaining time budget of ambiguity resolution (ms) (0:no limit) -----------*/
+static double arc_ar_budget(const rtk_t *rtk,double budget)
+{
+    double rem;
+
+    if (rtk->ar_dl<=0.0) return budget;
+    if ((rem=(rtk->ar_dl-arc_prof_tic())*1E3)<=0.0) rem=1E-3;
+    return budget>0.0&&budget<rem?budget:rem;
+}
+/* record degraded ambiguity resolution decision -----------------------------*/
+static void arc_ar_degrade(rtk_t *rtk,int deg,const char *func)
+{
+    rtk->sol.ardeg=(unsigned char)deg;
+
+    arc_log(ARC_WARNING,"%s : ambiguity resolution out of time budget (%s)\n",
+            func,deg==ARDEG_SKIP?"skip":deg==ARDEG_BOOT?"bootstrapping":
+            deg==ARDEG_INHERIT?"inherit":"float");
+}
+/* skip ambiguity resolution when time budget of epoch is exhausted ----------*/
+static int arc_ar_skip(rtk_t *rtk)
+{
+    int i;
+
+    if (!arc_ar_expired(rtk)) return 0;
+
+    rtk->sol.ratio=0.0;
+    rtk->sol.dop.dops[4]=-999.0;
+    rtk->sol.p_ar=(float)-999.0;
+    rtk->inherit_fix=AMB_INHERIT_FLOAT;
+    for (i=0;i<MAXSAT;i++) rtk->ssat[i].fix[0]=0;
+    for (i=0;i<rtk->sol.bias.nb;i++) rtk->sol.bias.amb[i].flag=AMB_FLOAT;
+
+    arc_ar_degrade(rtk,ARDEG_SKIP,"arc_relpos");
+    return 1;
+}
 /* boostraping resolve integer ambiguity--------------------------------------*/
 static int arc_resamb_BOOST(rtk_t *rtk,double *bias,double *xa)
 {
     prcopt_t *opt=&rtk->opt;
     int i,j,ny,nb,nx=rtk->nx,na=rtk->na;
     double *D,*y,*Qy,*b,*Qb,*Qab,Ps=0.0;
+    PROF_SCOPE(rtk->prof,PROF_RESAMB);
 
     arc_log(ARC_INFO,"arc_resamb_BOOST: nx=%d\n",nx);
 
@@ -3049,6 +3321,16 @@ static int arc_lambda_project_test(const rtk_t *rtk,const double *b,const double
 
     return fabs(r2/r1)<=rtk->opt.lambda_project_thres; /* test lambda project */
 }
+/* validate bootstrapping out of time budget by success rate -----------------
+* threshold is opt->amb_bootps (0:opt->thresar[1]), float solution is kept if
+* no threshold is set
+*-----------------------------------------------------------------------------*/
+static int arc_bootps_test(const prcopt_t *opt, double Ps)
+{
+    double thres=opt->amb_bootps>0.0?opt->amb_bootps:opt->thresar[1];
+
+    return thres>0.0&&Ps>=thres;
+}
 /* resolve integer ambiguity for direct double-difference ambiguity-----------*/
 static int arc_resamb_DirectDD_LAMBDA(rtk_t *rtk,double *bias,double *xa)
 {
@@ -3056,9 +3338,10 @@ static int arc_resamb_DirectDD_LAMBDA(rtk_t *rtk,double *bias,double *xa)
 
     amb_t *pamb=&rtk->sol.bias;
     prcopt_t *opt=&rtk->opt;
-    int i,j,index[MAXSAT],ny,nb,na=rtk->na,nx=rtk->nx,info=-1,nofix;
-    double *y,*Qy,*b,*Qb,*Qab,s[2];
+    int i,j,index[MAXSAT],ny,nb,na=rtk->na,nx=rtk->nx,info=-1,nofix,boot=0;
+    double *y,*Qy,*b,*Qb,*Qab,s[2],Ps=0.0,dl;
     double varf=0.0,var0=0.0;
+    PROF_SCOPE(rtk->prof,PROF_RESAMB);
 
     rtk->sol.ratio=0.0; /* initial lambda ratio */
     for (i=0;i<pamb->nb;i++) pamb->amb[i].flag=AMB_FLOAT;
@@ -3107,7 +3390,16 @@ static int arc_resamb_DirectDD_LAMBDA(rtk_t *rtk,double *bias,double *xa)
         arc_log(ARC_INFO,"ADOP=%8.4lf \n",rtk->sol.dop.dops[4]);
     }
     /* lambda/mlambda integer least-square estimation */
-    if (!(info=arc_lambda(nb,2,y+na,Qb,b,s,NULL,NULL))) {
+    dl=arc_lambda_deadline(rtk->ar_dl);
+    info=arc_lambda(nb,2,y+na,Qb,b,s,NULL,NULL);
+    arc_lambda_deadline(dl);
+
+    /* bootstrapping when search is out of time budget */
+    if ((boot=info==LAMBDA_TIMEOUT)) {
+        info=arc_bootstrap(nb,y+na,Qb,b,&Ps);
+        rtk->sol.p_ar=(float)Ps; s[0]=s[1]=0.0;
+    }
+    if (!info) {
 
         arc_log(ARC_INFO,"N(1)="); arc_tracemat(ARC_MATPRINTF,b   ,1,nb,10,4);
         arc_log(ARC_INFO,"N(2)="); arc_tracemat(ARC_MATPRINTF,b+nb,1,nb,10,4);
@@ -3115,10 +3407,11 @@ static int arc_resamb_DirectDD_LAMBDA(rtk_t *rtk,double *bias,double *xa)
         rtk->sol.ratio=s[0]>0?(float)(s[1]/s[0]):0.0f;
         if (rtk->sol.ratio>999.9) rtk->sol.ratio=999.9f;
 
-        /* validation by popular ratio-test */
-        if (s[0]<=0.0||s[1]/s[0]>=opt->thresar[0]
-            ||arc_lambda_diff_test(rtk,s[1],s[0])
-            ||arc_lambda_project_test(rtk,b,y,Qb,na,nb)) {
+        /* validation by popular ratio-test (success rate for bootstrapping) */
+        if (boot?arc_bootps_test(opt,Ps):
+            (s[0]<=0.0||s[1]/s[0]>=opt->thresar[0]
+             ||arc_lambda_diff_test(rtk,s[1],s[0])
+             ||arc_lambda_project_test(rtk,b,y,Qb,na,nb))) {
 
             arc_log(ARC_INFO,"arc_resamb_DirectDD_LAMBDA: "
                             "validation ok (nb=%d ratio=%.2f s=%.2f/%.2f)\n",
@@ -3209,6 +3502,10 @@ static int arc_resamb_DirectDD_LAMBDA(rtk_t *rtk,double *bias,double *xa)
         arc_log(ARC_WARNING,"lambda error (info=%d)\n",info);
         nb=0; /* set numbers of double-difference ambiguity to zero */
     }
+    if (boot) {
+        arc_ar_degrade(rtk,nb<=0?ARDEG_FLOAT:rtk->inherit_fix==AMB_INHERIT_FIX?
+                       ARDEG_INHERIT:ARDEG_BOOT,"arc_resamb_DirectDD_LAMBDA");
+    }
     free(y); free(Qy);
     free(b); free(Qb); free(Qab);
 
@@ -3218,10 +3515,11 @@ static int arc_resamb_DirectDD_LAMBDA(rtk_t *rtk,double *bias,double *xa)
 static int arc_resamb_LAMBDA(rtk_t *rtk,double *bias,double *xa)
 {
     prcopt_t *opt=&rtk->opt;
-    int i,j,ny,nb,nx=rtk->nx,na=rtk->na,k,ok=0,index[MAXSAT];
+    int i,j,ny,nb,nx=rtk->nx,na=rtk->na,k,ok=0,info,boot=0,index[MAXSAT];
     double *D,*DP,*y,*Qy,*b,*db,*Qb,*Qab,*QQ,s[2],*yb,*DB=NULL,*DD=NULL;
-    double varf=0.0,var0=0.0;
+    double varf=0.0,var0=0.0,dl;
     ddamb_t *pamb=NULL;
+    PROF_SCOPE(rtk->prof,PROF_RESAMB);
 
     arc_log(ARC_INFO,"arc_resamb_LAMBDA : nx=%d\n",nx);
 
@@ -3279,7 +3577,16 @@ static int arc_resamb_LAMBDA(rtk_t *rtk,double *bias,double *xa)
     }
 
     /* lambda/mlambda integer least-square estimation */
-    if (!(arc_lambda(nb,2,y+na,Qb,b,s,DB,NULL))) {
+    dl=arc_lambda_deadline(rtk->ar_dl);
+    info=arc_lambda(nb,2,y+na,Qb,b,s,DB,NULL);
+    arc_lambda_deadline(dl);
+
+    /* bootstrapping when search is out of time budget */
+    if ((boot=info==LAMBDA_TIMEOUT)) {
+        info=arc_bootstrap(nb,y+na,Qb,b,NULL);
+        s[0]=s[1]=0.0;
+    }
+    if (!info) {
 
         arc_log(ARC_INFO, "N(1)=");
         arc_tracemat(ARC_MATPRINTF,b,1,nb,10,3);
@@ -3297,8 +3604,10 @@ static int arc_resamb_LAMBDA(rtk_t *rtk,double *bias,double *xa)
         rtk->sol.ratio=s[0]>0?(float)(s[1]/s[0]):0.0f;
         if (rtk->sol.ratio>999.9) rtk->sol.ratio=999.9f;
 
-        /* validation by popular ratio-test, difference test and project test */
-        ok=((s[0]<=0.0||s[1]/s[0]>=(opt->thresar[0]))&&(s[0]<MAXAMBSQ))
+        /* validation by popular ratio-test, difference test and project test
+         * (success rate for bootstrapping) */
+        ok=boot?arc_bootps_test(opt,rtk->sol.p_ar):
+           ((s[0]<=0.0||s[1]/s[0]>=(opt->thresar[0]))&&(s[0]<MAXAMBSQ))
            ||arc_lambda_diff_test(rtk,s[1],s[0])
            ||arc_lambda_project_test(rtk,b,y,Qb,na,nb);
 
@@ -3417,10 +3726,14 @@ static int arc_resamb_LAMBDA(rtk_t *rtk,double *bias,double *xa)
         arc_log(ARC_WARNING,"lambda error \n");
         nb=0; /* set numbers of double-difference ambiguity to zero */
     }
-    if (rtk->sol.ratio<opt->thresar[0]) {
+    if (!boot&&rtk->sol.ratio<opt->thresar[0]) {
         arc_log(ARC_WARNING,"arc_resamb_LAMBDA : ambiguity validation "
                 "failed (nb=%d ratio=%.2f s=%.2f/%.2f)\n",nb,s[1]/s[0],s[0],s[1]);
     }
+    if (boot) {
+        arc_ar_degrade(rtk,nb<=0?ARDEG_FLOAT:rtk->inherit_fix==AMB_INHERIT_FIX?
+                       ARDEG_INHERIT:ARDEG_BOOT,"arc_resamb_LAMBDA");
+    }
     if (DD) free(DD);
     free(D); free(y); free(Qy); free(DP); free(DB);
     free(b); free(db); free(Qb); free(Qab); free(QQ);
@@ -3441,6 +3754,262 @@ static int arc_resamb_FFRATIO(rtk_t *rtk,double *bias,double *xa)
 {
     return arc_resamb_LAMBDA(rtk,bias,xa);;
 }
+/* ensemble ambiguity resolution----------------------------------------------*/
+#define ENS_MAXCAND 4               /* max candidates of ensemble ambiguity resolution */
+
+typedef struct {                    /* ensemble ambiguity resolution candidate type */
+    int type;                       /* candidate strategy (ENSCAND_???) */
+    int inherit;                    /* fixed by double-difference inherit */
+    rtk_t rtk;                      /* private copy of rtk control struct */
+    double *bias,*xa;               /* fixed double-difference ambiguity and fixed states */
+    int nb;                         /* numbers of fixed ambiguity */
+    int done;                       /* candidate finished flag */
+    unsigned int tick;              /* candidate processing time (ms) */
+} ens_cand_t;
+
+typedef struct {                    /* ensemble ambiguity resolution control type */
+    lock_t lock;                    /* lock flag */
+    int ncand,next,ndone;           /* candidates,next candidate and finished candidates */
+    double dl;                      /* deadline of candidates (s) (0:no limit) */
+    ens_cand_t cand[ENS_MAXCAND];   /* candidates */
+} ens_ctrl_t;
+
+/* copy rtk control struct for ensemble candidate----------------------------*/
+static void arc_ens_rtkcpy(rtk_t *dst,const rtk_t *src)
+{
+    int nx=src->nx,na=src->na;
+
+    *dst=*src;
+    dst->x =arc_mat(nx,1);  arc_matcpy(dst->x ,src->x ,nx,1);
+    dst->P =arc_mat(nx,nx); arc_matcpy(dst->P ,src->P ,nx,nx);
+    dst->xa=arc_mat(na,1);  arc_matcpy(dst->xa,src->xa,na,1);
+    dst->Pa=arc_mat(na,na); arc_matcpy(dst->Pa,src->Pa,na,na);
+    dst->ceres_active_x=arc_imat(nx,1);
+    memcpy(dst->ceres_active_x,src->ceres_active_x,sizeof(int)*nx);
+    dst->bias.amb=(ddamb_t*)malloc(sizeof(ddamb_t)*src->bias.nmax);
+    memcpy(dst->bias.amb,src->bias.amb,sizeof(ddamb_t)*src->bias.nmax);
+    dst->sol.bias.amb=(ddamb_t*)malloc(sizeof(ddamb_t)*src->sol.bias.nmax);
+    memcpy(dst->sol.bias.amb,src->sol.bias.amb,sizeof(ddamb_t)*src->sol.bias.nmax);
+
+    /* not used by ambiguity resolution */
+    dst->xd=dst->Pd=dst->x_pf=NULL; dst->ukf=NULL; dst->swin=NULL; dst->neq=NULL;
+    dst->fls=NULL;
+    dst->prof=NULL;
+}
+/* free ensemble control------------------------------------------------------*/
+static void arc_ens_free(ens_ctrl_t *ctrl)
+{
+    ens_cand_t *cand;
+    int i;
+
+    for (i=0;i<ctrl->ncand;i++) {
+        cand=ctrl->cand+i;
+        free(cand->rtk.x ); free(cand->rtk.P );
+        free(cand->rtk.xa); free(cand->rtk.Pa);
+        free(cand->rtk.ceres_active_x);
+        free(cand->rtk.bias.amb); free(cand->rtk.sol.bias.amb);
+        free(cand->bias); free(cand->xa);
+    }
+    pthread_mutex_destroy(&ctrl->lock);
+    free(ctrl);
+}
+/* resolve integer ambiguity of one ensemble candidate-----------------------*/
+static void arc_ens_resamb(ens_cand_t *cand)
+{
+    unsigned int tick=tickget();
+    double dl;
+
+    /* deadline of searches of the worker thread */
+    dl=arc_lambda_deadline(cand->rtk.ar_dl);
+
+    switch (cand->type) {
+        case ENSCAND_BOOTS: cand->nb=arc_resamb_BOOST       (&cand->rtk,cand->bias,cand->xa); break;
+        case ENSCAND_GROUP: cand->nb=arc_resamb_group_LAMBDA(&cand->rtk,cand->bias,cand->xa); break;
+        default:            cand->nb=arc_resamb_LAMBDA      (&cand->rtk,cand->bias,cand->xa); break;
+    }
+
+    arc_lambda_deadline(dl);
+
+    cand->inherit=cand->nb>0&&cand->rtk.inherit_fix==AMB_INHERIT_FIX;
+    cand->tick=tickget()-tick;
+}
+/* ensemble ambiguity resolution worker thread--------------------------------*/
+static void *arc_ens_thread(void *arg)
+{
+    ens_ctrl_t *ctrl=(ens_ctrl_t *)arg;
+    int i;
+
+    for (;;) {
+        lock(&ctrl->lock);
+        i=ctrl->next<ctrl->ncand?ctrl->next++:-1;
+        unlock(&ctrl->lock);
+        if (i<0||(ctrl->dl>0.0&&arc_prof_tic()>=ctrl->dl)) break;
+
+        arc_ens_resamb(ctrl->cand+i);
+
+        lock(&ctrl->lock);
+        ctrl->cand[i].done=1; ctrl->ndone++;
+        unlock(&ctrl->lock);
+    }
+    return NULL;
+}
+/* run ensemble candidates under time budget-----------------------------------
+* candidates search up to the deadline of the budget (see arc_lambda_deadline())
+* and fall back to bootstrapping after it,so workers are joined shortly after
+* the budget expires and never outlive the epoch
+*-----------------------------------------------------------------------------*/
+static void arc_ens_run(ens_ctrl_t *ctrl,int nthread,double budget)
+{
+    pthread_t thread[ENS_MAXCAND];
+    int i,n=0;
+
+    if (nthread<=0||nthread>ctrl->ncand) nthread=ctrl->ncand;
+
+    /* deadline of candidates */
+    if (budget>0.0) {
+        ctrl->dl=arc_prof_tic()+budget*1E-3;
+        for (i=0;i<ctrl->ncand;i++) {
+            if (ctrl->cand[i].rtk.ar_dl<=0.0||ctrl->dl<ctrl->cand[i].rtk.ar_dl) {
+                ctrl->cand[i].rtk.ar_dl=ctrl->dl;
+            }
+        }
+    }
+#ifndef WIN32
+    if (nthread>1) {
+        for (i=0;i<nthread;i++) {
+            if (pthread_create(thread+n,NULL,arc_ens_thread,ctrl)) break;
+            n++;
+        }
+    }
+    if (n>0) {
+        for (i=0;i<n;i++) pthread_join(thread[i],NULL);
+        return;
+    }
+#endif
+    /* serial candidates,checking budget between candidates */
+    for (i=0;i<ctrl->ncand;i++) {
+        if (ctrl->dl>0.0&&arc_prof_tic()>=ctrl->dl) break;
+        arc_ens_resamb(ctrl->cand+i);
+        ctrl->cand[i].done=1; ctrl->ndone++;
+    }
+}
+/* commit ensemble candidate to rtk control----------------------------------*/
+static void arc_ens_commit(rtk_t *rtk,const ens_cand_t *cand,double *bias,double *xa)
+{
+    const rtk_t *src=&cand->rtk;
+    int i;
+
+    arc_matcpy(rtk->xa,src->xa,rtk->na,1);
+    arc_matcpy(rtk->Pa,src->Pa,rtk->na,rtk->na);
+    if (cand->nb>0) {
+        arc_matcpy(bias,cand->bias,cand->nb,1);
+        arc_matcpy(xa,cand->xa,rtk->nx,1);
+    }
+    rtk->sol.ratio=src->sol.ratio;
+    rtk->sol.p_ar=src->sol.p_ar;
+    rtk->sol.dop.dops[4]=src->sol.dop.dops[4];
+    rtk->sol.ardeg=src->sol.ardeg;
+    rtk->inherit_fix=src->inherit_fix;
+    rtk->amb_nb=src->amb_nb;
+    if (rtk->prof) rtk->prof->ep.nb=src->amb_nb;
+
+    for (i=0;i<MAXSAT;i++) rtk->ssat[i]=src->ssat[i];
+    for (i=0;i<MAXSAT;i++) rtk->amb_index[i]=src->amb_index[i];
+    for (i=0;i<MAXSAT*2;i++) rtk->ddsat[i]=src->ddsat[i];
+    for (i=0;i<NUMOFSYS;i++) {
+        rtk->amb_refsat[i]=src->amb_refsat[i];
+        rtk->amb_group_refsat[i][0]=src->amb_group_refsat[i][0];
+        rtk->amb_group_refsat[i][1]=src->amb_group_refsat[i][1];
+    }
+}
+/* ensemble ambiguity resolution-----------------------------------------------
+* run the candidate strategies of opt->amb_ens_cand (lambda, lambda with
+* double-difference inherit, group-lambda and bootstrapping) on private copies
+* of the same float solution,then take the best validated candidate
+* args   : rtk_t *rtk       IO  rtk control/result struct
+*          double *bias     O   fixed double-difference ambiguity
+*          double *xa       O   fixed states
+* return : numbers of fixed double-difference ambiguity (0:float)
+* notes  : each candidate validates its own fix (ratio,difference and project
+*          test or success rate of bootstrapping). validated candidates are
+*          ranked by numbers of fixed ambiguity and ratio,inherit fix only when
+*          no other candidate is fixed. the selected fix is validated by
+*          post-fit residuals in arc_relpos() (arc_valpos()) and the epoch is
+*          float when no candidate is validated.
+*          candidates not started before opt->amb_ens_budget (ms) or the time
+*          budget of epoch (opt->amb_budget) are discarded,started ones stop
+*          searching at it
+*-----------------------------------------------------------------------------*/
+static int arc_resamb_ENSEMBLE(rtk_t *rtk,double *bias,double *xa)
+{
+    prcopt_t *opt=&rtk->opt;
+    ens_ctrl_t *ctrl;
+    ens_cand_t *cand;
+    int i,j,k,nb=0,order[ENS_MAXCAND],sel=-1,mask;
+    unsigned int tick=tickget();
+    PROF_SCOPE(rtk->prof,PROF_RESAMB);
+
+    arc_log(ARC_INFO,"arc_resamb_ENSEMBLE : nx=%d\n",rtk->nx);
+
+    if (opt->use_dd_sol) return arc_resamb_LAMBDA(rtk,bias,xa);
+
+    /* candidate strategies */
+    if (!(mask=opt->amb_ens_cand)) {
+        mask=ENSCAND_LAMBDA|ENSCAND_BOOTS|(opt->amb_inherit?ENSCAND_INHERIT:0);
+    }
+    ctrl=(ens_ctrl_t *)calloc(1,sizeof(ens_ctrl_t));
+    initlock(&ctrl->lock);
+
+    for (i=0;i<ENS_MAXCAND;i++) {
+        if (!(mask&(1<<i))) continue;
+        cand=ctrl->cand+ctrl->ncand++;
+        cand->type=1<<i;
+        arc_ens_rtkcpy(&cand->rtk,rtk);
+        cand->rtk.opt.amb_inherit=cand->type==ENSCAND_INHERIT;
+        cand->bias=arc_zeros(rtk->nx,1);
+        cand->xa=arc_zeros(rtk->nx,1);
+    }
+    arc_ens_run(ctrl,opt->amb_ens_nthread,arc_ar_budget(rtk,opt->amb_ens_budget));
+
+    /* rank finished candidates */
+    for (i=k=0;i<ctrl->ncand;i++) {
+        if (!ctrl->cand[i].done) continue;
+        cand=ctrl->cand+i;
+        arc_log(ARC_INFO,"arc_resamb_ENSEMBLE : type=%d inherit=%d nb=%3d ratio=%6.2f tick=%4u\n",
+                cand->type,cand->inherit,cand->nb,cand->rtk.sol.ratio,cand->tick);
+        for (j=k++;j>0;j--) {
+            ens_cand_t *c=ctrl->cand+order[j-1];
+            if (c->inherit<cand->inherit||(c->inherit==cand->inherit&&
+                (c->nb>cand->nb||(c->nb==cand->nb&&c->rtk.sol.ratio>=cand->rtk.sol.ratio)))) break;
+            order[j]=order[j-1];
+        }
+        order[j]=i;
+    }
+    /* best validated candidate */
+    for (i=0;i<k;i++) {
+        if (ctrl->cand[order[i]].nb>0) {sel=order[i]; break;}
+    }
+    if (sel>=0) {
+        arc_ens_commit(rtk,ctrl->cand+sel,bias,xa);
+        nb=ctrl->cand[sel].nb;
+    }
+    else if (k>0) { /* no candidate validated,keep float */
+        arc_ens_commit(rtk,ctrl->cand+order[0],bias,xa);
+    }
+    else { /* no candidate finished in budget */
+        rtk->sol.ratio=0.0;
+        rtk->sol.dop.dops[4]=-999.0;
+        rtk->sol.p_ar=(float)-999.0;
+        rtk->inherit_fix=AMB_INHERIT_FLOAT;
+        for (i=0;i<MAXSAT;i++) rtk->ssat[i].fix[0]=0;
+        if (arc_ar_expired(rtk)) arc_ar_degrade(rtk,ARDEG_FLOAT,"arc_resamb_ENSEMBLE");
+    }
+    arc_log(ARC_INFO,"arc_resamb_ENSEMBLE : finished=%d/%d select=%d nb=%d tick=%u\n",
+            k,ctrl->ncand,sel,nb,tickget()-tick);
+
+    arc_ens_free(ctrl);
+    return nb;
+}
 /* validation of solution ----------------------------------------------------*/
 static int arc_valpos(rtk_t *rtk,const double *v,const double *R,const int *vflg,
                       int nv,double thres)
@@ -3448,6 +4017,7 @@ static int arc_valpos(rtk_t *rtk,const double *v,const double *R,const int *vflg
     double fact=thres*thres;
     int i,stat=1,sat1,sat2,type,freq;
     char stype[8];
+    PROF_SCOPE(rtk->prof,PROF_VALPOS);
 
     arc_log(ARC_INFO,"arc_valpos  : nv=%d thres=%.1f\n",nv,thres);
 
@@ -3478,126 +4048,28 @@ static int arc_valpos(rtk_t *rtk,const double *v,const double *R,const int *vflg
     }
     return stat;
 }
-/* Q parameters for adaptive Kaman filter-------------------------------------*/
-static int arc_adap_Q(const rtk_t *rtk,double *Q,int n)
-{
-    arc_log(ARC_INFO,"arc_adap_Q : \n");
-
-    int i,k;
-    /* rover station position noise */
-    for (i=0;i<3;i++) Q[i+n*i]=SQR(rtk->opt.prn[5]);
-    /* ambguity noise */
-    for (i=3,k=0;i<rtk->nx;i++) {
-        if (rtk->ceres_active_x[i]) Q[(3+k)*n+(3+(k++))]=SQR(rtk->opt.prn[0]);
-    }
-    /* Q is positive definite matrix,and its col is equal to n */
-    if ((k+3)!=n) return 0;
-    return 1;
-}
-/* C0 matrix for adaptive Kaman filter----------------------------------------*/
-static int arc_adap_C0(const rtk_t* rtk,const double *v,double *C0,int m,
-                       double lam)
-{
-    arc_log(ARC_INFO,"arc_adap_C0 : \n");
-
-    static int first=1;
-    static double lamk;
-
-    if (first) {
-        arc_matmul("NT",m,m,1,0.5,v,v,0.0,C0); return 1; first=0;
-    }
-    if (lam<1.0) return 0;
-    lamk=lam/(1.0+lam);
-    arc_matmul("NT",m,m,1,lamk,v,v,0.0,C0);
-    return 1;
-}
-/* M matrix for adaptive Kaman filter-----------------------------------------*/
-static int arc_adap_M(const rtk_t* rtk,const double *H,const double *P,
-                      const double *R,int m,int n,double *M)
-{
-    arc_log(ARC_INFO,"arc_adap_M : \n");
-
-    double *F;
-    F=arc_mat(n,m);
-    arc_matmul("NN",n,m,n,1.0,P,H,0.0,F);
-    arc_matmul("TN",m,m,n,1.0,H,F,0.0,M);
-
-    free(F); return 1;
-}
-/* N matrix for adaptive kalman filter-----------------------------------------*/
-static int arc_adap_N(const rtk_t* rtk,const double *H,const double *Q,
-                      const double *R,const double *C0,int m,int n,double *N)
-{
-    arc_log(ARC_INFO,"arc_adap_N : \n");
-
-    int i,j;
-    double *F;
-
-    F=arc_mat(n,m);
-    arc_matcpy(N,R,m,m);
-    arc_matmul("NN",n,m,n,1.0,Q,H,0.0,F);
-    arc_matmul("TN",m,m,n,1.0,H,F,1.0,N);
-    for (i=0;i<m;i++) for (j=0;j<m;j++) N[i+j*m]=C0[i+j*m]-N[i+j*m];
-    return 1;
-}
-/* adaptive Kaman filter------------------------------------------------------*/
-extern int adap_kaman_filter(rtk_t* rtk,double *x,double *P,const double *H,
-                             const double *v,const double *R,int n,int m)
+/* innovation weighting options of kalman filter-----------------------------
+* robust mode takes IGG-III thresholds k0=chi2(1,1-alpha)^1/2 and k1=2.5*k0,
+* adaptive mode takes process noise of position (prn[5]) and other states
+* (prn[0]), adaptive mode is prior to robust mode
+*-----------------------------------------------------------------------------*/
+static void arc_innov_opt(const rtk_t *rtk,int nx,int robust,innov_t *inn,
+                          double *qd)
 {
-    arc_log(ARC_INFO,"adap_kaman_filter : \n");
-
-    int i,j,*ix,k;
-    double *C0,*M,*N,*Q,*H_,*P_;
-
-    ix=arc_imat(n,1);
-    for (i=0,k=0;i<rtk->nx;i++) if (rtk->ceres_active_x[i]) ix[k++]=i;
-    Q=arc_zeros(k,k);
-    if (!arc_adap_Q(rtk,Q,k)) {
-        free(ix); free(Q); return 0;
-    }
-    C0=arc_mat(m,m);
-    if (!arc_adap_C0(rtk,v,C0,m,rtk->lam)) {
-        free(ix); free(Q); free(C0); return 0;
-    }
-    H_=arc_mat(k,m); M=arc_mat(m,m); P_=arc_mat(k,k);
-    for (i=0;i<k;i++) {
-        for (j=0;j<m;j++) H_[i+j*k]=H[ix[i]+j*n];
-        for (j=0;j<k;j++) P_[i+j*k]=P[ix[i]+ix[j]*n];
-    }
-    if (!arc_adap_M(rtk,H_,P_,R,m,k,M)) {
-        free(ix); free(Q); free(P_); free(C0); free(H_); free(M);
-        return 0;
-    }
-    N=arc_mat(m,m);
-    if (!arc_adap_N(rtk,H_,Q,R,C0,m,k,N)) {
-        free(ix); free(Q); free(P_);
-        free(C0); free(H_); free(M); free(N);
-        return 0;
-    }
-    rtk->lam=MAX(1.0,arc_mattrace(N,m)/arc_mattrace(M,m));
+    const prcopt_t *opt=&rtk->opt;
+    double alpha=opt->kalman_robust_alpha;
+    int i;
 
-    double *F=arc_mat(k,m),*_Q_=arc_mat(m,m),*K=arc_mat(k,m),
-            *I=arc_eye(k),*xp=arc_mat(k,1),*Pp=arc_zeros(k,k);
-    arc_matcpy(_Q_,R,m,m);
-    arc_matcpy(Pp,P_,k,k);
-    for (i=0;i<k;i++) xp[i]=x[ix[i]];
+    memset(inn,0,sizeof(innov_t));
+    inn->mode=opt->adapt_filter?INNOV_ADAPT:(robust?INNOV_ROBUST:INNOV_NONE);
+    inn->k0=SQRT(alpha>0.0&&alpha<1.0?arc_re_chi2(1,1.0-alpha):chisqr[0]);
+    inn->k1=2.5*inn->k0;
+    inn->lam=1.0;
+    for (i=0;i<nx;i++) qd[i]=i<3?SQR(opt->prn[5]):SQR(opt->prn[0]);
+    inn->qd=qd;
 
-    arc_matmul("NN",k,m,k,1.0,P_,H_,0.0,F);            /* Q=H'*P*H+R */
-    arc_matmul("TN",m,m,k,1.0,H_,F,1.0,_Q_);
-    if (!(arc_matinv(_Q_,m))) {
-        arc_matmul("NN",k,m,m,1.0,F,_Q_,0.0,K);        /* K=P*H*Q^-1 */
-        arc_matmul("NN",k,1,m,rtk->lam,K,v,1.0,xp);    /* xp=x+K*v */
-        arc_matmul("NT",k,k,m,-1.0,K,H_,1.0,I);        /* Pp=(I-K*H')*P */
-        arc_matmul("NN",k,k,k,1.0,I,P_,0.0,Pp);
-    }
-    for (i=0;i<k;i++) {
-        if (x) x[ix[i]]=xp[i];
-        if (P) for (j=0;j<k;j++) P[ix[i]+ix[j]*n]=Pp[i+j*k];
-    }
-    free(F);  free(_Q_); free(K); free(I); free(xp); free(Pp);
-    free(ix); free(Q); free(P_);
-    free(C0); free(H_); free(M); free(N);
-    return 1;
+    arc_log(ARC_INFO,"arc_innov_opt : mode=%d k0=%.3f k1=%.3f\n",inn->mode,
+            inn->k0,inn->k1);
 }
 /* states updates of difference pseudorange positioning-----------------------*/
 static void arc_diff_pr_update(const rtk_t* rtk,double *xp,double *Pp,double tt)
@@ -3724,7 +4196,8 @@ static int arc_diff_pr_relpos(rtk_t *rtk, const obsd_t *obs, int nu, int nr,
 {
     prcopt_t *opt=&rtk->opt;
     gtime_t time=obs[0].time;
-    double *rs,*dts,*var,*y,*e,*azel,*v,*H,*R,*xp,*Pp,*bias,dt;
+    double *rs,*dts,*var,*y,*e,*azel,*v,*H,*R,*xp,*Pp,*bias,*qd,dt;
+    innov_t inn;
     int i,j,n=nu+nr,ns,ny,nv,sat[MAXSAT],iu[MAXSAT],ir[MAXSAT],niter,nx=NXDC(&rtk->opt);
     int info,vflg[MAXOBS*NFREQ*2+1],svh[MAXOBS*2];
     int nf=1,stat=PMODE_DGPS;
@@ -3744,12 +4217,12 @@ static int arc_diff_pr_relpos(rtk_t *rtk, const obsd_t *obs, int nu, int nr,
         rtk->ssat[i].snrf[0]=0;
         rtk->ssat[i].dcvl[0]=0; /* valid flag of dc-solution */
     }
-    /* satellite positions/clocks */
-    arc_satposs(time,obs,n,nav,opt->sateph,rs,dts,var,svh);
+    /* satellite positions/clocks and erp values and sun/moon position */
+    arc_epsatposs(rtk,obs,nu,nr,nav,rs,dts,var,svh);
 
     /* exclude measurements of eclipsing satellite (block IIA) */
     if (rtk->opt.posopt[3]) {
-        arc_testeclipse(obs,n,nav,rs);
+        arc_testeclipse(obs,n,nav,rtk->geo.rsun,rs);
     }
     /* undifferenced residuals for base station */
     if (!arc_zdres(1,obs+nu,nr,rs+nu*6,dts+nu*2,svh+nu,nav,rtk->rb,opt,1,
@@ -3788,7 +4261,10 @@ static int arc_diff_pr_relpos(rtk_t *rtk, const obsd_t *obs, int nu, int nr,
 
     ny=ns*nf*2+2+ns;
     v=arc_mat(ny,1); H=arc_zeros(nx,ny);
-    R=arc_zeros(ny,ny); bias=arc_mat(nx,1);
+    R=arc_zeros(ny,ny); bias=arc_mat(nx,1); qd=arc_mat(nx,1);
+
+    /* innovation weighting options of kalman filter */
+    arc_innov_opt(rtk,nx,0,&inn,qd);
 
     /* add 2 iterations for baseline-constraint moving-base */
     niter=opt->niter+(opt->mode==PMODE_MOVEB&&opt->baseline[0]>0.0?2:0);
@@ -3810,27 +4286,19 @@ static int arc_diff_pr_relpos(rtk_t *rtk, const obsd_t *obs, int nu, int nr,
         arc_log(ARC_INFO,"arc_diff_pr_relpos ：double-differenced residual vector : \n");
         arc_tracemat(ARC_MATPRINTF,v,nv,1,10,4);
 
-        /* adaptive kaman filter */
-        if (opt->adapt_filter) {
-            if (!adap_kaman_filter(rtk,xp,Pp,H,v,R,nx,nv)) {
-                arc_log(ARC_WARNING,"arc_diff_pr_relpos : adaptive filter error (info=%d)\n",info);
-                stat=SOLQ_NONE;
-                break;
-            }
-        }
         /* kalman filter measurement update */
-        else {
-            if ((info=arc_filter(xp,Pp,H,v,R,nx,nv,NULL))) {
-                arc_log(ARC_WARNING,"arc_diff_pr_relpos : filter error (info=%d)\n",info);
-                stat=SOLQ_NONE;
-                break;
-            }
-            arc_log(ARC_INFO,"arc_diff_pr_relpos : x(%d)=",i+1);
-            arc_tracemat(ARC_MATPRINTF,xp,nx,1,10,4);
-
-            arc_log(ARC_INFO,"arc_diff_pr_relpos : P(%d)=",i+1);
-            arc_tracemat(ARC_MATPRINTF,Pp,nx,nx,10,4);
+        if ((info=arc_filter_inno(xp,Pp,H,v,R,nx,nv,NULL,0,&inn))) {
+            arc_log(ARC_WARNING,"arc_diff_pr_relpos : filter error (info=%d)\n",info);
+            stat=SOLQ_NONE;
+            break;
         }
+        if (inn.mode==INNOV_ADAPT) rtk->lam=inn.lam;
+
+        arc_log(ARC_INFO,"arc_diff_pr_relpos : x(%d)=",i+1);
+        arc_tracemat(ARC_MATPRINTF,xp,nx,1,10,4);
+
+        arc_log(ARC_INFO,"arc_diff_pr_relpos : P(%d)=",i+1);
+        arc_tracemat(ARC_MATPRINTF,Pp,nx,nx,10,4);
     }
     /* post-fit residuals for float solution */
     if (stat!=SOLQ_NONE&&arc_zdres(0,obs,nu,rs,dts,svh,
@@ -3856,7 +4324,7 @@ static int arc_diff_pr_relpos(rtk_t *rtk, const obsd_t *obs, int nu, int nr,
         }
     }
     free(rs); free(dts); free(var); free(y); free(e); free(azel);
-    free(xp); free(Pp);  free(v); free(H); free(R); free(bias);
+    free(xp); free(Pp);  free(v); free(H); free(R); free(bias); free(qd);
     return stat;
 }
 /* another version for extract double-difference ambiguity--------------------*/
@@ -3952,17 +4420,97 @@ static int arc_filter_index(const rtk_t *rtk,int *index)
 
     return j;
 }
+/* ukf double-differenced measurement model -----------------------------------
+* double-differenced residuals of a sigma point are predicted from the residuals
+* v0 at the linearization point x0: the rover position enters by the exact
+* geometric ranges, all other states by the design matrix (they are linear).
+* only reads its context, so sigma points can be evaluated in parallel.
+*-----------------------------------------------------------------------------*/
+typedef struct {                        /* ukf double-difference model type */
+    const double *x0;                   /* states at linearization point (nx) */
+    const double *v0;                   /* residuals at linearization point (nv) */
+    const double *H;                    /* transpose of design matrix (nx x nv) */
+    const int *vflg;                    /* residual flags (nv) */
+    const int *ix;                      /* active states index (na) */
+    const double *rs[MAXSAT];           /* rover satellite positions (NULL: none) */
+    double r0[MAXSAT];                  /* geometric ranges at linearization point */
+    int nx,nv,na;
+} ukf_ddmodel_t;
+
+static int arc_ukf_ddmodel(const double *x, int n, double *h, int m, void *arg)
+{
+    const ukf_ddmodel_t *md=(const ukf_ddmodel_t *)arg;
+    const double *Hk;
+    double r[MAXSAT],e[3],dv;
+    int i,j,k,s1,s2,geo;
+
+    for (i=0;i<MAXSAT;i++) {
+        r[i]=md->rs[i]&&md->r0[i]>0.0?arc_geodist(md->rs[i],x,e):0.0;
+    }
+    for (k=0;k<m;k++) {
+        Hk=md->H+k*md->nx;
+        s1=(md->vflg[k]>>16)&0xFF; s2=(md->vflg[k]>>8)&0xFF;
+        geo=s1>0&&s2>0&&s1<=MAXSAT&&s2<=MAXSAT&&r[s1-1]>0.0&&r[s2-1]>0.0;
+
+        for (i=0,dv=0.0;i<md->na;i++) {
+            j=md->ix[i];
+            if (geo&&j<3) continue;
+            dv+=Hk[j]*(x[j]-md->x0[j]);
+        }
+        if (geo) {
+            dv+=(r[s1-1]-r[s2-1])-(md->r0[s1-1]-md->r0[s2-1]);
+        }
+        h[k]=dv-md->v0[k]; /* h=-v, measurement z=0 */
+    }
+    return 1;
+}
+/* square-root ukf measurement update of relative positioning ----------------*/
+static int arc_relpos_srukf(rtk_t *rtk, double *xp, double *Pp, const double *S0,
+                            const int *ix, int na, const double *rs, const int *sat,
+                            const int *iu, int ns, const double *v, const double *H,
+                            const double *R, const int *vflg, int nv)
+{
+    prcopt_t *opt=&rtk->opt;
+    ukf_ddmodel_t *md;
+    double *S,*z,e[3];
+    int i,info;
+
+    arc_log(ARC_INFO,"arc_relpos_srukf : na=%d nv=%d\n",na,nv);
+
+    if (!(md=(ukf_ddmodel_t *)calloc(1,sizeof(ukf_ddmodel_t)))) return -1;
+    md->x0=arc_mat(rtk->nx,1); arc_matcpy((double *)md->x0,xp,rtk->nx,1);
+    md->v0=v; md->H=H; md->vflg=vflg; md->ix=ix;
+    md->nx=rtk->nx; md->nv=nv; md->na=na;
+    for (i=0;i<ns;i++) {
+        md->rs[sat[i]-1]=rs+iu[i]*6;
+        if ((md->r0[sat[i]-1]=arc_geodist(md->rs[sat[i]-1],xp,e))<=0.0) {
+            md->rs[sat[i]-1]=NULL;
+        }
+    }
+    /* start from the factor of the predicted covariance */
+    S=arc_mat(na,na); z=arc_zeros(nv,1);
+    arc_matcpy(S,S0,na,na);
+
+    info=arc_srukf_update(xp,Pp,rtk->nx,ix,na,S,z,R,nv,arc_ukf_ddmodel,md,
+                          opt->ukf_alpha,opt->ukf_ZCount,opt->ukf_beta,
+                          opt->ukf_nthread);
+
+    free((double *)md->x0); free(md); free(S); free(z);
+    return info;
+}
 /* relative positioning ------------------------------------------------------*/
 static int arc_relpos(rtk_t *rtk, const obsd_t *obs, int nu, int nr,
                       const nav_t *nav)
 {
     prcopt_t *opt=&rtk->opt;
     gtime_t time=obs[0].time;
-    double *rs,*dts,*var,*y,*e,*azel,*v,*H,*R,*xp,*Pp,*xa,*bias,dt,*D=NULL,*Qv=NULL,*ve=NULL;
+    double *rs,*dts,*var,*y,*e,*azel,*v,*H,*R,*xp,*Pp,*xa,*bias,*qd,dt;
     int i,j,f,n=nu+nr,ns,ny,nv,sat[MAXSAT],iu[MAXSAT],ir[MAXSAT],niter;
     int info,vflg[MAXOBS*NFREQ*2+1],svh[MAXOBS*2];
     int stat=rtk->opt.mode<=PMODE_DGPS?SOLQ_DGPS:SOLQ_FLOAT;
-    int nf=1,nk=0,pnx=rtk->nx,index[MAXSAT],ni=0;
+    int nf=1,pnx=rtk->nx,index[MAXSAT],ni=0,*ukf_ix=NULL,ukf_na=0;
+    double *ukf_S=NULL;
+    innov_t inn;
 
     arc_log(ARC_INFO,"arc_relpos  : nx=%d nu=%d nr=%d\n",rtk->nx,nu,nr);
 
@@ -3984,12 +4532,12 @@ static int arc_relpos(rtk_t *rtk, const obsd_t *obs, int nu, int nr,
     /* reset ceres problem solver active states index list */
     for (i=0;i<rtk->nx;i++) rtk->ceres_active_x[i]=0;
 
-    /* satellite positions/clocks */
-    arc_satposs(time,obs,n,nav,opt->sateph,rs,dts,var,svh);
+    /* satellite positions/clocks and erp values and sun/moon position */
+    arc_epsatposs(rtk,obs,nu,nr,nav,rs,dts,var,svh);
 
     /* exclude measurements of eclipsing satellite (block IIA) */
     if (rtk->opt.posopt[3]) {
-        arc_testeclipse(obs,n,nav,rs);
+        arc_testeclipse(obs,n,nav,rtk->geo.rsun,rs);
     }
     /* undifferenced residuals for base station */
     if (!arc_zdres(1,obs+nu,nr,rs+nu*6,dts+nu*2,svh+nu,nav,rtk->rb,opt,1,
@@ -4031,10 +4579,39 @@ static int arc_relpos(rtk_t *rtk, const obsd_t *obs, int nu, int nr,
     /* add 2 iterations for baseline-constraint moving-base */
     niter=opt->niter+(opt->mode==PMODE_MOVEB&&opt->baseline[0]>0.0?2:0);
 
-    if (opt->ceres==0) {
+    if (rtk->neq) { /* static normal equation accumulation */
+
+        for (i=0;i<3;i++) xp[i]=rtk->neq->x0[i];
+
+        if (!arc_zdres(0,obs,nu,rs,dts,svh,nav,xp,opt,0,y,e,azel,rtk,NULL)) {
+            arc_log(ARC_WARNING,"arc_relpos : rover initial position error\n");
+        }
+        else if ((nv=arc_ddres(rtk,nav,dt,xp,Pp,sat,y,e,azel,iu,ir,ns,v,H,R,vflg))<1) {
+            arc_log(ARC_WARNING,"arc_relpos : no double-differenced residual\n");
+        }
+        else if (arc_neq_add(rtk->neq,time,xp,rtk->P,v,H,R,nv,SQR(opt->std[0]))) {
+            arc_log(ARC_WARNING,"arc_relpos : static normal equation error\n");
+        }
+        else { /* update ambiguity control struct */
+            rtk->sol.ns=0;
+            for (i=0;i<ns;i++) for (f=0;f<nf;f++) {
+                if (!rtk->ssat[sat[i]-1].vsat[f]) continue;
+                rtk->ssat[sat[i]-1].lock[f]++;
+                rtk->ssat[sat[i]-1].outc[f]=0;
+                if (f==0) rtk->sol.ns++;
+            }
+        }
+        /* no epoch solution, see arc_neq_solve() */
+        stat=SOLQ_NONE;
+    }
+    else if (opt->ceres==0) {
 
         if (opt->ukf==0) {
 
+            /* innovation weighting options of kalman filter (robust/adaptive) */
+            qd=arc_mat(rtk->nx,1);
+            arc_innov_opt(rtk,rtk->nx,opt->kalman_robust,&inn,qd);
+
             for (i=0;i<niter;i++) {  /* iterations compute */
 
                 /* undifferenced residuals for rover */
@@ -4053,6 +4630,8 @@ static int arc_relpos(rtk_t *rtk, const obsd_t *obs, int nu, int nr,
                         free(xp); xp=arc_mat(1,      rtk->nx); /* new size */
                         free(Pp); Pp=arc_mat(rtk->nx,rtk->nx); /* new size */
                         free(xa); xa=arc_mat(1,      rtk->nx); /* new size */
+                        free(qd); qd=arc_mat(rtk->nx,1);       /* new size */
+                        arc_innov_opt(rtk,rtk->nx,opt->kalman_robust,&inn,qd);
                     }
                     arc_matcpy(xp,rtk->x,rtk->nx,1);
 
@@ -4078,54 +4657,139 @@ static int arc_relpos(rtk_t *rtk, const obsd_t *obs, int nu, int nr,
                 arc_log(ARC_INFO,"arc_relpos ： double-differenced residual vector : \n");
                 arc_tracemat(ARC_MATPRINTF,v,nv,1,10,4);
 
-                /* robust kalman filter */
-                if (opt->kalman_robust) {
-                    D=arc_eye(nv); Qv=arc_mat(nv,nv); ve=arc_mat(nv,1);
-                    arc_kalman_norm_inno(rtk,v,nv,H,R,ve); arc_kalman_norm_Qino(ve,nv,Qv);
-                    arc_kalman_robust_phi(rtk,ve,nv,nk,D,Qv);
-                }
                 arc_matcpy(Pp,rtk->P,rtk->nx,rtk->nx);
 
                 arc_log(ARC_INFO,"Pp=\n");
                 arc_tracemat(ARC_MATPRINTF,Pp,rtk->nx,rtk->nx,10,4);
 
-                /* adaptive kaman filter */
-                if (opt->adapt_filter) {
-                    if (!adap_kaman_filter(rtk,xp,Pp,H,v,R,rtk->nx,nv)) {
-                        arc_log(ARC_WARNING,"arc_relpos : adaptive filter error (info=%d)\n",info);
-                        stat=SOLQ_NONE;
-                        break;
+                /* kalman filter measurement update (robust/adaptive) */
+                PROF_TIC(rtk->prof,PROF_FILTER,tf);
+                if (opt->use_dd_sol) {
+                    ni=arc_filter_index(rtk,index);
+                    info=arc_filter_inno(xp,Pp,H,v,R,rtk->nx,nv,index,ni,&inn);
+                }
+                else info=arc_filter_inno(xp,Pp,H,v,R,rtk->nx,nv,NULL,0,&inn);
+                PROF_TOC(rtk->prof,PROF_FILTER,tf);
+
+                if (info) {
+                    arc_log(ARC_WARNING,"arc_relpos : filter error (info=%d)\n",info);
+                    stat=SOLQ_NONE;
+                    break;
+                }
+                if (inn.mode==INNOV_ADAPT) rtk->lam=inn.lam;
+
+                arc_log(ARC_INFO,"arc_relpos : x(%d)=",i+1);
+                arc_tracemat(ARC_MATPRINTF,xp,1,rtk->nx,10,4);
+
+                arc_log(ARC_INFO,"arc_relpos : P(%d)=",i+1);
+                arc_tracemat(ARC_MATPRINTF,Pp,rtk->nx,rtk->nx,10,4);
+            }
+            free(qd);
+        }
+        else if (opt->ukf) { /* square-root ukf over active states */
+
+            for (i=0;i<niter;i++) {
+
+                /* undifferenced residuals for rover */
+                if (!arc_zdres(0,obs,nu,rs,dts,svh,nav,xp,opt,0,y,e,azel,rtk,NULL)) {
+                    arc_log(ARC_WARNING,"arc_relpos : rover initial position error\n");
+                    stat=SOLQ_NONE;
+                    break;
+                }
+                if (opt->use_dd_sol) {
+
+                    /* updates double-difference ambiguity */
+                    arc_update_ddamb(rtk,obs,sat,iu,ir,ns,nav,rs,y,azel);
+
+                    if (rtk->nx!=pnx&&i==0) { /* states size changed */
+                        free(xp); xp=arc_mat(1,      rtk->nx); /* new size */
+                        free(Pp); Pp=arc_mat(rtk->nx,rtk->nx); /* new size */
+                        free(xa); xa=arc_mat(1,      rtk->nx); /* new size */
                     }
+                    if (i==0) arc_matcpy(xp,rtk->x,rtk->nx,1);
+
+                    nv=arc_ddres_ddamb(rtk,nav,dt,xp,Pp,sat,y,e,azel,iu,ir,ns,v,H,R,vflg);
                 }
-                /* kalman filter measurement update */
-                else {
-                    if (opt->use_dd_sol) {
-                        ni=arc_filter_index(rtk,index);
-                        if ((info=arc_filter_active(xp,Pp,H,v,R,rtk->nx,nv,
-                                                    opt->kalman_robust?D:NULL,index,ni))) {
-                            arc_log(ARC_WARNING,"arc_relpos : filter error (info=%d)\n",info);
-                            stat=SOLQ_NONE;
-                            break;
-                        }
+                else nv=arc_ddres(rtk,nav,dt,xp,Pp,sat,y,e,azel,iu,ir,ns,v,H,R,vflg);
+
+                if (nv<1) {
+                    arc_log(ARC_WARNING,"arc_relpos : no double-differenced residual\n");
+                    stat=SOLQ_NONE;
+                    break;
+                }
+                arc_matcpy(Pp,rtk->P,rtk->nx,rtk->nx);
+
+                /* cholesky factor of predicted covariance (once per epoch) */
+                if (!ukf_S) {
+                    ukf_ix=arc_imat(rtk->nx,1);
+                    if (opt->use_dd_sol) ukf_na=arc_filter_index(rtk,ukf_ix);
+                    else for (j=ukf_na=0;j<rtk->nx;j++) {
+                        if (xp[j]!=0.0&&Pp[j+j*rtk->nx]>0.0) ukf_ix[ukf_na++]=j;
                     }
-                    else {
-                        if ((info=arc_filter(xp,Pp,H,v,R,rtk->nx,nv,
-                                             opt->kalman_robust?D:NULL))) {
-                            arc_log(ARC_WARNING,"arc_relpos : filter error (info=%d)\n",info);
-                            stat=SOLQ_NONE;
-                            break;
-                        }
+                    ukf_S=arc_mat(ukf_na>0?ukf_na:1,ukf_na>0?ukf_na:1);
+                    if (ukf_na<=0||arc_srukf_factor(Pp,rtk->nx,ukf_ix,ukf_na,ukf_S)) {
+                        arc_log(ARC_WARNING,"arc_relpos : ukf covariance not positive definite\n");
+                        stat=SOLQ_NONE;
+                        break;
                     }
-                    arc_log(ARC_INFO,"arc_relpos : x(%d)=",i+1);
-                    arc_tracemat(ARC_MATPRINTF,xp,1,rtk->nx,10,4);
+                }
+                /* square-root ukf measurement update (ekf if it fails) */
+                PROF_TIC(rtk->prof,PROF_FILTER,tf);
+                if ((info=arc_relpos_srukf(rtk,xp,Pp,ukf_S,ukf_ix,ukf_na,rs,sat,iu,ns,
+                                           v,H,R,vflg,nv))) {
+                    arc_log(ARC_WARNING,"arc_relpos : ukf error (info=%d)\n",info);
 
-                    arc_log(ARC_INFO,"arc_relpos : P(%d)=",i+1);
-                    arc_tracemat(ARC_MATPRINTF,Pp,rtk->nx,rtk->nx,10,4);
+                    info=arc_filter_active(xp,Pp,H,v,R,rtk->nx,nv,NULL,ukf_ix,ukf_na);
                 }
+                PROF_TOC(rtk->prof,PROF_FILTER,tf);
+
+                if (info) {
+                    arc_log(ARC_WARNING,"arc_relpos : filter error (info=%d)\n",info);
+                    stat=SOLQ_NONE;
+                    break;
+                }
+                arc_log(ARC_INFO,"arc_relpos : x(%d)=",i+1);
+                arc_tracemat(ARC_MATPRINTF,xp,1,rtk->nx,10,4);
             }
+            if (ukf_S) {free(ukf_S); free(ukf_ix);}
+        }
+    }
+    else { /* sliding-window batch solver */
+
+        if (!arc_zdres(0,obs,nu,rs,dts,svh,nav,xp,opt,0,y,e,azel,rtk,NULL)) {
+            arc_log(ARC_WARNING,"arc_relpos : rover initial position error\n");
+            stat=SOLQ_NONE;
+        }
+        else if (opt->use_dd_sol) {
+            arc_log(ARC_WARNING,"arc_relpos : window solver needs single-difference ambiguity\n");
+            stat=SOLQ_NONE;
         }
-        else if (opt->ukf) {
-            fprintf(stderr,"ukf filter haven't been open-source\n");
+        else if ((nv=arc_ddres(rtk,nav,dt,xp,Pp,sat,y,e,azel,iu,ir,ns,v,H,R,vflg))<1) {
+            arc_log(ARC_WARNING,"arc_relpos : no double-differenced residual\n");
+            stat=SOLQ_NONE;
+        }
+        else {
+            PROF_TIC(rtk->prof,PROF_FILTER,tf);
+            arc_matcpy(Pp,rtk->P,rtk->nx,rtk->nx);
+
+            if (!rtk->swin) rtk->swin=arc_swin_new(rtk->nx,NR(opt),opt->ceres_windows);
+
+            if (!rtk->swin||arc_swin_update(rtk->swin,time,xp,Pp,v,H,R,vflg,nv,rs,sat,iu,ns,
+                                            SQR(opt->std[0]),opt->ceres_prior)) {
+                arc_log(ARC_WARNING,"arc_relpos : window solver error,reset window\n");
+                arc_swin_free(rtk->swin); rtk->swin=NULL;
+
+                /* kalman filter for this epoch */
+                arc_matcpy(xp,rtk->x,rtk->nx,1);
+                arc_matcpy(Pp,rtk->P,rtk->nx,rtk->nx);
+                if ((info=arc_filter(xp,Pp,H,v,R,rtk->nx,nv,NULL))) {
+                    arc_log(ARC_WARNING,"arc_relpos : filter error (info=%d)\n",info);
+                    stat=SOLQ_NONE;
+                }
+            }
+            PROF_TOC(rtk->prof,PROF_FILTER,tf);
+            arc_log(ARC_INFO,"arc_relpos : window x=");
+            arc_tracemat(ARC_MATPRINTF,xp,1,rtk->nx,10,4);
         }
     }
     if (stat!=SOLQ_NONE&&arc_zdres(0,obs,nu,rs,dts,svh,nav,xp,opt,0,y,e,azel,rtk,NULL)) {
@@ -4157,11 +4821,16 @@ static int arc_relpos(rtk_t *rtk, const obsd_t *obs, int nu, int nr,
         }
         else stat=SOLQ_NONE;
     }
+    /* time budget of epoch exhausted,keep float solution */
+    if (stat!=SOLQ_NONE&&arc_ar_skip(rtk)) {
+        arc_log(ARC_INFO,"arc_relpos : skip ambiguity resolution\n");
+    }
     /* resolve integer ambiguity by LAMBDA */
-    if (stat!=SOLQ_NONE&&(opt->amb_group?arc_resamb_group_LAMBDA(rtk,bias,xa)
+    else if (stat!=SOLQ_NONE&&(opt->amb_group?arc_resamb_group_LAMBDA(rtk,bias,xa)
                          :opt->amb_fix_mode==AMBFIX_LAMBDA?arc_resamb_LAMBDA(rtk,bias,xa)
                          :opt->amb_fix_mode==AMBFIX_BOOTS?arc_resamb_BOOST(rtk,bias,xa)
                          :opt->amb_fix_mode==AMBFIX_PART?arc_resamb_PART(rtk,bias,xa)
+                         :opt->amb_fix_mode==AMBFIX_ENSEMBLE?arc_resamb_ENSEMBLE(rtk,bias,xa)
                          :arc_resamb_LAMBDA(rtk,bias,xa))) {
 
         /* extract double-difference ambiguity */
@@ -4285,7 +4954,6 @@ static int arc_relpos(rtk_t *rtk, const obsd_t *obs, int nu, int nr,
         if (rtk->ssat[i].fix[j]==2&&stat==SOLQ_FIX) rtk->ssat[i].fix[j]=1;
         if (rtk->ssat[i].slip[j]&1) rtk->ssat[i].slipc[j]++;
     }
-    if (D) free(D); if (Qv) free(Qv); if (ve) free(ve);
     free(rs); free(dts); free(var);
     free(y); free(e); free(azel);
     free(xp); free(Pp); free(xa);
@@ -4328,6 +4996,7 @@ extern void arc_rtkinit(rtk_t *rtk, const prcopt_t *opt)
     rtk->xd=arc_zeros(NXDC(&rtk->opt),1);
     rtk->Pd=arc_zeros(NXDC(&rtk->opt),NXDC(&rtk->opt));
     rtk->nfix=rtk->neb=rtk->fixc=rtk->halffix=0;
+    rtk->ntu=0;
     for (i=0;i<MAXSAT;i++) {
         rtk->ambc[i]=ambc0;
         rtk->ssat[i]=ssat0;
@@ -4336,6 +5005,18 @@ extern void arc_rtkinit(rtk_t *rtk, const prcopt_t *opt)
 
     /* ceres solver options */
     rtk->ceres_active_x=arc_imat(rtk->nx,1);
+    rtk->swin=NULL;
+    rtk->neq=NULL;
+    rtk->fls=NULL;
+
+    /* undifferenced residual, geophysical and mapping function context */
+    memset(rtk->zdc,0,sizeof(rtk->zdc));
+    memset(&rtk->geo,0,sizeof(geoctx_t));
+    memset(rtk->mapt,0,sizeof(rtk->mapt));
+    rtk->epc=NULL;
+
+    /* receiver antenna pcv table */
+    for (i=0;i<2;i++) arc_pcvt_init(rtk->pcvt+i,opt->pcvr+i,opt->antdel[i]);
 
     /* ambiguity solver options */
     for (i=0;i<MAXSAT;i++) rtk->amb_index[i]=0;
@@ -4351,6 +5032,16 @@ extern void arc_rtkinit(rtk_t *rtk, const prcopt_t *opt)
     rtk->sol.bias.amb=(ddamb_t*)malloc(sizeof(ddamb_t)*MAXSAT);
     rtk->sol.bias.nmax=MAXSAT; rtk->sol.bias.nb=0;
     for (i=0;i<MAXSAT;i++) rtk->sol.bias.amb[i]=amb0;
+
+    /* per-stage latency profiler */
+#ifdef ARC_PROF
+    rtk->prof=arc_prof_new();
+#else
+    rtk->prof=NULL;
+#endif
+    rtk->ar_dl=0.0;
+    arc_ephc_init(&rtk->ephc,opt->glodense);
+    rtk->trpc=rtk->nobsb=0;
 }
 /* free rtk control ------------------------------------------------------------
 * free memory for rtk control struct
@@ -4371,15 +5062,22 @@ extern void arc_rtkfree(rtk_t *rtk)
     if (rtk->ceres_active_x) {
         free(rtk->ceres_active_x); rtk->ceres_active_x=NULL;
     }
+    arc_swin_free(rtk->swin); rtk->swin=NULL;
+    arc_neq_free(rtk->neq); rtk->neq=NULL;
     if (rtk->bias.amb) {
         free(rtk->bias.amb); rtk->bias.nb=rtk->bias.nmax=0;
     }
     if (rtk->sol.bias.amb) {
         free(rtk->sol.bias.amb); rtk->sol.bias.nb=rtk->sol.bias.nmax=0;
     }
+    if (rtk->prof) {
+        arc_prof_dump(rtk->prof,stderr);
+        arc_prof_free(rtk->prof); rtk->prof=NULL;
+    }
+    arc_ephc_free(&rtk->ephc);
 }
-/* arc single rtk precise positioning ---------------------------------------*/
-extern int arc_srtkpos(rtk_t *rtk, const obsd_t *obs, int n, const nav_t *nav)
+/* single rtk precise positioning of one epoch ------------------------------*/
+static int arc_srtkpos_epoch(rtk_t *rtk, const obsd_t *obs, int n, const nav_t *nav)
 {
     prcopt_t *opt=&rtk->opt;
     sol_t solb={{0}};
@@ -4503,4 +5201,24 @@ extern int arc_srtkpos(rtk_t *rtk, const obsd_t *obs, int n, const nav_t *nav)
     arc_relpos(rtk,obs,nu,nr,nav);
     outsolstat(rtk);
     return 1;
+}
+/* arc single rtk precise positioning ---------------------------------------*/
+extern int arc_srtkpos(rtk_t *rtk, const obsd_t *obs, int n, const nav_t *nav)
+{
+    ephc_t *ephc;
+    int stat;
+
+    /* time budget of ambiguity resolution from start of epoch */
+    rtk->ar_dl=rtk->opt.amb_budget>0.0?arc_prof_tic()+rtk->opt.amb_budget*1E-3:0.0;
+    rtk->sol.ardeg=ARDEG_NONE;
+
+    /* ephemeris evaluation state of rtk for calling thread */
+    ephc=arc_ephc_bind(&rtk->ephc);
+
+    arc_prof_begin(rtk->prof);
+    stat=arc_srtkpos_epoch(rtk,obs,n,nav);
+    arc_prof_end(rtk->prof,obs[0].time,rtk->sol.ns,rtk->nx);
+
+    arc_ephc_bind(ephc);
+    return stat;
 }
\ No newline at end of file
@@ -1048,7 +1048,7 @@ static double intpres(gtime_t time, const obsd_t *obs, int n, const nav_t *nav,
     ttb=timediff(time,obsb[0].time);
     if (fabs(ttb)>opt->maxtdiff*2.0||ttb==tt) return tt;
     
-    arc_satposs(time,obsb,nb,nav,opt->sateph,rs,dts,var,svh);
+    arc_satposs(time,obsb,nb,nav,opt->sateph,NULL,rs,dts,var,svh);
     
     if (!zdres(1,obsb,nb,rs,dts,svh,nav,rtk->rb,opt,1,yb,e,azel)) {
         return tt;
@@ -1310,7 +1310,7 @@ static int relpos(rtk_t *rtk, const obsd_t *obs, int nu, int nr,
         for (j=0;j<NFREQ;j++) rtk->ssat[i].vsat[j]=rtk->ssat[i].snr[j]=0;
     }
     /* satellite positions/clocks */
-    arc_satposs(time,obs,n,nav,opt->sateph,rs,dts,var,svh);
+    arc_satposs(time,obs,n,nav,opt->sateph,NULL,rs,dts,var,svh);
     
     /* undifferenced residuals for base station */
     if (!zdres(1,obs+nu,nr,rs+nu*6,dts+nu*2,svh+nu,nav,rtk->rb,opt,1,
@@ -1485,6 +1485,7 @@ extern void rtkinit(rtk_t *rtk, const prcopt_t *opt)
     }
     for (i=0;i<MAXERRMSG;i++) rtk->errbuf[i]=0;
     rtk->opt=*opt;
+    rtk->prof=NULL;
 }
 /* free rtk control ------------------------------------------------------------
 * free memory for rtk control struct
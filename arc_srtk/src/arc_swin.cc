@@ -0,0 +1,501 @@
+/*********************************************************************************
+ *  ARC-SRTK - Single Frequency RTK Pisitioning Library
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************************/
+
+/**
+ * @brief ARC-SRTK sliding-window batch solver
+ *
+ * the window keeps the double-differenced residual blocks of the last nw
+ * epochs. every epoch has its own epoch states (position, ionosphere,
+ * troposphere...,states index < NR) and shares the phase-bias states of the
+ * window, which are held in "slots". a slot lives as long as its phase-bias is
+ * not reset (cycle slip, outage), then it is retired and a new slot starts.
+ *
+ * the normal equation is arrow-shaped: small epoch blocks coupled only by the
+ * slots. each gauss-newton iteration eliminates the epoch states by schur
+ * complement and solves the reduced slots system. residual blocks are stored
+ * linearized once, only the geometric ranges of the rover are re-evaluated, so
+ * no observation model (arc_zdres/arc_ddres) has to be rerun for old epochs.
+ * when the window is full, the oldest epoch is marginalized into a prior on
+ * the slots by schur complement; retired slots are eliminated from the prior
+ * when their last residual has left the window.
+ */
+#include "arc.h"
+
+#define SWIN_DEFWIN     10          /* default window size (epochs) */
+#define SWIN_MAXITER    5           /* max gauss-newton iterations per epoch */
+#define SWIN_CONV       1E-4        /* convergence threshold of states update */
+#define SWIN_NSLOT      32          /* initial number of slots */
+
+#define LP(w,i,j)       ((w)->L[(i)+(j)*(w)->nsmax])
+
+/* Macro for defining an exception--------------------------------------------*/
+ARC_DEFINE_EXCEPTION(Exception, std::runtime_error);
+
+/* free epoch block ----------------------------------------------------------*/
+static void arc_swin_blkfree(swblk_t *b)
+{
+    free(b->ie); free(b->xe); free(b->x0); free(b->xp); free(b->Ip);
+    free(b->v0); free(b->He); free(b->bs); free(b->bh); free(b->b0);
+    free(b->rs); free(b->geo); free(b->W);
+    memset(b,0,sizeof(swblk_t));
+}
+/* enlarge slots -------------------------------------------------------------*/
+static int arc_swin_grow(swin_t *w, int nsmax)
+{
+    double *L,*A;
+    int i,j;
+
+    if (nsmax<=w->nsmax) return 1;
+    if (!(L=arc_zeros(nsmax,nsmax))||!(A=arc_mat(nsmax,nsmax))) return 0;
+    for (i=0;i<w->ns;i++) for (j=0;j<w->ns;j++) L[i+j*nsmax]=LP(w,i,j);
+    free(w->L); w->L=L;
+    free(w->A); w->A=A;
+    w->sidx=(int   *)realloc(w->sidx,sizeof(int   )*nsmax);
+    w->sref=(int   *)realloc(w->sref,sizeof(int   )*nsmax);
+    w->sx0 =(double*)realloc(w->sx0, sizeof(double)*nsmax);
+    w->sx  =(double*)realloc(w->sx,  sizeof(double)*nsmax);
+    w->eta =(double*)realloc(w->eta, sizeof(double)*nsmax);
+    w->g   =(double*)realloc(w->g,   sizeof(double)*nsmax);
+    if (!w->sidx||!w->sref||!w->sx0||!w->sx||!w->eta||!w->g) return 0;
+    w->nsmax=nsmax;
+    return 1;
+}
+/* new slot of phase-bias state i --------------------------------------------*/
+static int arc_swin_newslot(swin_t *w, int i, double x, double var)
+{
+    int j,s;
+
+    if (w->ns>=w->nsmax&&!arc_swin_grow(w,w->nsmax*2)) return -1;
+    s=w->ns++;
+    w->sidx[s]=i; w->sref[s]=0; w->sx0[s]=x; w->sx[s]=0.0; w->eta[s]=0.0;
+    for (j=0;j<w->ns;j++) LP(w,s,j)=LP(w,j,s)=0.0;
+    if (var>0.0) LP(w,s,s)=1.0/var; /* initial variance as prior */
+    w->slot[i-w->nr]=s;
+    return s;
+}
+/* eliminate slot s from prior and remove it ---------------------------------*/
+static void arc_swin_delslot(swin_t *w, int s)
+{
+    double lss=LP(w,s,s);
+    int i,j,k,ns=w->ns;
+
+    if (lss>0.0) {
+        for (i=0;i<ns;i++) {
+            if (i==s) continue;
+            w->eta[i]-=LP(w,i,s)*w->eta[s]/lss;
+        }
+        for (j=0;j<ns;j++) for (i=0;i<ns;i++) {
+            if (i==s||j==s) continue;
+            LP(w,i,j)-=LP(w,i,s)*LP(w,s,j)/lss;
+        }
+    }
+    for (j=0;j<ns;j++) for (i=s;i<ns-1;i++) LP(w,i,j)=LP(w,i+1,j);
+    for (j=s;j<ns-1;j++) for (i=0;i<ns-1;i++) LP(w,i,j)=LP(w,i,j+1);
+    for (i=s;i<ns-1;i++) {
+        w->sidx[i]=w->sidx[i+1]; w->sref[i]=w->sref[i+1];
+        w->sx0 [i]=w->sx0 [i+1]; w->sx  [i]=w->sx  [i+1];
+        w->eta [i]=w->eta [i+1];
+    }
+    w->ns--;
+
+    /* remap slots */
+    for (i=0;i<w->nx-w->nr;i++) if (w->slot[i]>s) w->slot[i]--;
+    for (k=0;k<w->nw;k++) {
+        for (i=0;i<w->blk[k].nv*SWIN_NBROW;i++) {
+            if (w->blk[k].bs&&w->blk[k].bs[i]>s) w->blk[k].bs[i]--;
+        }
+    }
+}
+/* eliminate retired slots without residuals ---------------------------------*/
+static void arc_swin_purge(swin_t *w)
+{
+    int s;
+    for (s=w->ns-1;s>=0;s--) {
+        if (w->sidx[s]<0&&w->sref[s]<=0) arc_swin_delslot(w,s);
+    }
+}
+/* new sliding-window solver -----------------------------------------------------
+* args   : int    nx        I   number of states
+*          int    nr        I   number of epoch states (states index < nr)
+*          int    nw        I   window size (epochs) (0:default)
+* return : sliding-window solver (NULL:error)
+*-----------------------------------------------------------------------------*/
+extern swin_t *arc_swin_new(int nx, int nr, int nw)
+{
+    swin_t *w;
+    int i;
+
+    arc_log(ARC_INFO,"arc_swin_new : nx=%d nr=%d nw=%d\n",nx,nr,nw);
+
+    if (nx<=nr||!(w=(swin_t *)calloc(1,sizeof(swin_t)))) return NULL;
+    w->nw=nw>0?nw:SWIN_DEFWIN;
+    w->nx=nx; w->nr=nr; w->nl=-1;
+    w->blk=(swblk_t *)calloc(w->nw,sizeof(swblk_t));
+    w->slot=arc_imat(nx-nr,1);
+    if (!w->blk||!w->slot||!arc_swin_grow(w,SWIN_NSLOT)) {
+        arc_swin_free(w);
+        return NULL;
+    }
+    for (i=0;i<nx-nr;i++) w->slot[i]=-1;
+    return w;
+}
+/* free sliding-window solver ------------------------------------------------*/
+extern void arc_swin_free(swin_t *w)
+{
+    int i;
+
+    if (!w) return;
+    if (w->blk) for (i=0;i<w->nw;i++) arc_swin_blkfree(w->blk+i);
+    free(w->blk); free(w->slot); free(w->sidx); free(w->sref); free(w->sx0);
+    free(w->sx); free(w->eta); free(w->g); free(w->L); free(w->A);
+    free(w);
+}
+/* residuals and partials of epoch block at current estimate -----------------
+* r=v0-h(x)+h(x0) (nv), Je: partials by epoch states (nv x ne), Jb: partials by
+* block slots u (nv x nu)
+*-----------------------------------------------------------------------------*/
+static void arc_swin_res(const swin_t *w, const swblk_t *b, const int *u, int nu,
+                         double *r, double *Je, double *Jb)
+{
+    double e1[3],e2[3],f1[3],f2[3],d;
+    int i,k,q,c,s;
+
+    for (i=0;i<nu*b->nv;i++) Jb[i]=0.0;
+
+    for (k=0;k<b->nv;k++) {
+        r[k]=b->v0[k];
+        for (i=0;i<b->ne;i++) {
+            Je[k+i*b->nv]=b->He[i+k*b->ne];
+            if (b->geo[k]&&i<3) continue;
+            r[k]-=b->He[i+k*b->ne]*(b->xe[i]-b->x0[i]);
+        }
+        if (b->geo[k]) { /* geometric ranges of rover */
+            d =arc_geodist(b->rs+k*6,b->xe,e1)-arc_geodist(b->rs+k*6+3,b->xe,e2);
+            d-=arc_geodist(b->rs+k*6,b->x0,f1)-arc_geodist(b->rs+k*6+3,b->x0,f2);
+            r[k]-=d;
+            for (i=0;i<3;i++) Je[k+i*b->nv]=-e1[i]+e2[i];
+        }
+        for (q=0;q<SWIN_NBROW;q++) {
+            if ((s=b->bs[q+k*SWIN_NBROW])<0) continue;
+            r[k]-=b->bh[q+k*SWIN_NBROW]*(w->sx[s]-b->b0[q+k*SWIN_NBROW]);
+            for (c=0;c<nu;c++) if (u[c]==s) break;
+            Jb[k+c*b->nv]+=b->bh[q+k*SWIN_NBROW];
+        }
+    }
+}
+/* slots of epoch block ------------------------------------------------------*/
+static int arc_swin_blkslot(const swblk_t *b, int *u)
+{
+    int i,c,s,nu=0;
+
+    for (i=0;i<b->nv*SWIN_NBROW;i++) {
+        if ((s=b->bs[i])<0) continue;
+        for (c=0;c<nu;c++) if (u[c]==s) break;
+        if (c==nu) u[nu++]=s;
+    }
+    return nu;
+}
+/* schur complement of epoch block -----------------------------------------------
+* eliminate the epoch states of block from its normal equation:
+*   Aei=Aee^-1, T=Aei*Aeb, Lk=Abb-Aeb'*T, gk=gb-T'*ge
+* return : status (0:ok,-1:error)
+*-----------------------------------------------------------------------------*/
+static int arc_swin_schur(const swin_t *w, const swblk_t *b, const int *u, int nu,
+                          double *Aei, double *T, double *ge, double *Lk, double *gk)
+{
+    double *r,*Je,*Jb,*WJe,*WJb,*Wr,*Aeb;
+    int i,j,ne=b->ne,nv=b->nv,info;
+
+    r=arc_mat(nv,1); Je=arc_mat(nv,ne); Jb=arc_mat(nv,nu>0?nu:1);
+    WJe=arc_mat(nv,ne); WJb=arc_mat(nv,nu>0?nu:1); Wr=arc_mat(nv,1);
+    Aeb=arc_mat(ne,nu>0?nu:1);
+
+    arc_swin_res(w,b,u,nu,r,Je,Jb);
+
+    arc_matmul("NN",nv,ne,nv,1.0,b->W,Je,0.0,WJe);
+    arc_matmul("NN",nv,1, nv,1.0,b->W,r, 0.0,Wr);
+    arc_matmul("TN",ne,ne,nv,1.0,Je,WJe,0.0,Aei);  /* Aee=Je'*W*Je+Ip */
+    arc_matmul("TN",ne,1, nv,1.0,Je,Wr, 0.0,ge);   /* ge=Je'*W*r+Ip*(xp-xe) */
+    for (i=0;i<ne;i++) for (j=0;j<ne;j++) {
+        Aei[i+j*ne]+=b->Ip[i+j*ne];
+        ge[i]+=b->Ip[i+j*ne]*(b->xp[j]-b->xe[j]);
+    }
+    if (nu>0) {
+        arc_matmul("NN",nv,nu,nv,1.0,b->W,Jb,0.0,WJb);
+        arc_matmul("TN",ne,nu,nv,1.0,Je,WJb,0.0,Aeb); /* Aeb=Je'*W*Jb */
+        arc_matmul("TN",nu,nu,nv,1.0,Jb,WJb,0.0,Lk);  /* Abb=Jb'*W*Jb */
+        arc_matmul("TN",nu,1, nv,1.0,Jb,Wr, 0.0,gk);  /* gb=Jb'*W*r */
+    }
+    if (!(info=arc_matinv(Aei,ne))&&nu>0) {
+        arc_matmul("NN",ne,nu,ne, 1.0,Aei,Aeb,0.0,T);
+        arc_matmul("TN",nu,nu,ne,-1.0,Aeb,T,  1.0,Lk);
+        arc_matmul("TN",nu,1, ne,-1.0,T,  ge, 1.0,gk);
+    }
+    free(r); free(Je); free(Jb); free(WJe); free(WJb); free(Wr); free(Aeb);
+    return info?-1:0;
+}
+/* marginalize oldest epoch block into prior ---------------------------------*/
+static int arc_swin_marg(swin_t *w)
+{
+    swblk_t *b=w->blk+(w->nl-w->nb+1+w->nw)%w->nw;
+    double *Aei,*T,*ge,*Lk,*gk;
+    int i,j,nu,*u,ne=b->ne,info;
+
+    arc_log(ARC_INFO,"arc_swin_marg : nv=%d\n",b->nv);
+
+    u=arc_imat(b->nv*SWIN_NBROW+1,1); nu=arc_swin_blkslot(b,u);
+    Aei=arc_mat(ne,ne); T=arc_mat(ne,nu+1); ge=arc_mat(ne,1);
+    Lk=arc_zeros(nu+1,nu+1); gk=arc_zeros(nu+1,1);
+
+    if (!(info=arc_swin_schur(w,b,u,nu,Aei,T,ge,Lk,gk))) {
+        /* L+=Lk, eta+=Lk*sx+gk */
+        for (i=0;i<nu;i++) {
+            w->eta[u[i]]+=gk[i];
+            for (j=0;j<nu;j++) {
+                LP(w,u[i],u[j])+=Lk[i+j*nu];
+                w->eta[u[i]]+=Lk[i+j*nu]*w->sx[u[j]];
+            }
+        }
+    }
+    else arc_log(ARC_WARNING,"arc_swin_marg : singular epoch block, dropped\n");
+
+    for (i=0;i<b->nv*SWIN_NBROW;i++) if (b->bs[i]>=0) w->sref[b->bs[i]]--;
+    arc_swin_blkfree(b);
+    w->nb--;
+    arc_swin_purge(w);
+
+    free(u); free(Aei); free(T); free(ge); free(Lk); free(gk);
+    return info;
+}
+/* add epoch block -------------------------------------------------------------*/
+static int arc_swin_add(swin_t *w, gtime_t time, const double *x, const double *P,
+                        const double *v, const double *H, const double *R,
+                        const int *vflg, int nv, const double *rs, const int *sat,
+                        const int *iu, int ns, int prior)
+{
+    const double *srs[MAXSAT]={0};
+    swblk_t *b;
+    int i,j,k,q,s,s1,s2,ne,nx=w->nx,pos;
+
+    w->nl=(w->nl+1)%w->nw;
+    b=w->blk+w->nl;
+    b->time=time;
+
+    /* epoch states */
+    b->ie=arc_imat(w->nr,1);
+    for (i=ne=0;i<w->nr;i++) if (x[i]!=0.0&&P[i+i*nx]>0.0) b->ie[ne++]=i;
+    b->ne=ne; b->nv=nv;
+    b->xe=arc_mat(ne,1); b->x0=arc_mat(ne,1); b->xp=arc_mat(ne,1);
+    b->Ip=arc_zeros(ne,ne);
+    b->v0=arc_mat(nv,1); b->He=arc_mat(ne,nv); b->W=arc_mat(nv,nv);
+    b->bs=arc_imat(SWIN_NBROW,nv); b->bh=arc_zeros(SWIN_NBROW,nv);
+    b->b0=arc_zeros(SWIN_NBROW,nv); b->rs=arc_zeros(6,nv); b->geo=arc_imat(nv,1);
+    w->nb++;
+
+    for (i=0;i<ne;i++) b->xe[i]=b->x0[i]=b->xp[i]=x[b->ie[i]];
+    if (prior) {
+        for (i=0;i<ne;i++) for (j=0;j<ne;j++) {
+            b->Ip[i+j*ne]=P[b->ie[i]+b->ie[j]*nx];
+        }
+        if (arc_matinv(b->Ip,ne)) return -1;
+    }
+    arc_matcpy(b->v0,v,nv,1);
+    arc_matcpy(b->W,R,nv,nv);
+    if (arc_matinv(b->W,nv)) return -1;
+
+    pos=ne>=3&&b->ie[0]==0&&b->ie[1]==1&&b->ie[2]==2;
+    for (i=0;i<ns;i++) srs[sat[i]-1]=rs+iu[i]*6;
+
+    for (k=0;k<nv;k++) {
+        for (i=0;i<ne;i++) b->He[i+k*ne]=H[b->ie[i]+k*nx];
+
+        /* phase-bias partials */
+        for (q=0;q<SWIN_NBROW;q++) b->bs[q+k*SWIN_NBROW]=-1;
+        for (j=w->nr,q=0;j<nx;j++) {
+            if (H[j+k*nx]==0.0) continue;
+            if (q>=SWIN_NBROW) return -1;
+            if ((s=w->slot[j-w->nr])<0&&(s=arc_swin_newslot(w,j,x[j],P[j+j*nx]))<0) {
+                return -1;
+            }
+            b->bs[q+k*SWIN_NBROW]=s;
+            b->bh[q+k*SWIN_NBROW]=H[j+k*nx];
+            b->b0[q+k*SWIN_NBROW]=x[j]-w->sx0[s];
+            w->sref[s]++; q++;
+        }
+        /* satellite pair of residual */
+        s1=(vflg[k]>>16)&0xFF; s2=(vflg[k]>>8)&0xFF;
+        b->geo[k]=pos&&s1>0&&s2>0&&s1<=MAXSAT&&s2<=MAXSAT&&srs[s1-1]&&srs[s2-1];
+        if (b->geo[k]) {
+            arc_matcpy(b->rs+k*6,  srs[s1-1],3,1);
+            arc_matcpy(b->rs+k*6+3,srs[s2-1],3,1);
+        }
+    }
+    return 0;
+}
+/* sliding-window solver update --------------------------------------------------
+* add the double-differenced residuals of current epoch, solve the window by
+* gauss-newton iterations and output the estimate of current epoch
+* args   : swin_t *w        IO  sliding-window solver
+*          gtime_t time     I   epoch time
+*          double *x        IO  states vector (predicted -> estimated) (nx x 1)
+*          double *P        IO  covariance of states (predicted -> estimated) (nx x nx)
+*          double *v        I   double-differenced residuals at x (nv x 1)
+*          double *H        I   transpose of design matrix at x (nx x nv)
+*          double *R        I   covariance matrix of residuals (nv x nv)
+*          int    *vflg     I   residual flags (nv x 1)
+*          int    nv        I   number of residuals
+*          double *rs       I   satellite positions (6 x n)
+*          int    *sat,*iu  I   satellites and their rover observation index (ns)
+*          int    ns        I   number of satellites
+*          double varb      I   initial variance of phase-bias (reset detection)
+*          int    prior     I   add predicted epoch states as prior (0:off,1:on)
+* return : status (0:ok,-1:error)
+* notes  : epoch states of x/P are the states index < nr of arc_swin_new().
+*          the phase-bias states of the window and the epoch states of current
+*          epoch are written back with their marginal covariance
+*-----------------------------------------------------------------------------*/
+extern int arc_swin_update(swin_t *w, gtime_t time, double *x, double *P,
+                           const double *v, const double *H, const double *R,
+                           const int *vflg, int nv, const double *rs,
+                           const int *sat, const int *iu, int ns, double varb,
+                           int prior)
+{
+    swblk_t *b;
+    double **Aei,**T,**ge,*Lk,*gk,*db,dmax,t;
+    int i,j,k,c,d,n,it,s,nx=w->nx,nr=w->nr,**u,*nu,info=0,*wix,nwix;
+
+    arc_log(ARC_INFO,"arc_swin_update : nb=%d ns=%d nv=%d\n",w->nb,w->ns,nv);
+
+    /* retire slots of removed or re-initialized phase-bias */
+    for (k=0;k<nx-nr;k++) {
+        if ((s=w->slot[k])<0) continue;
+        i=k+nr;
+        if (x[i]!=0.0&&P[i+i*nx]!=varb) continue;
+        for (j=0;j<nx;j++) if (j!=i&&P[i+j*nx]!=0.0) break;
+        if (x[i]!=0.0&&j<nx) continue;
+        w->sidx[s]=-1; w->slot[k]=-1;
+    }
+    arc_swin_purge(w);
+
+    /* marginalize oldest epoch */
+    if (w->nb>=w->nw) arc_swin_marg(w);
+
+    if (arc_swin_add(w,time,x,P,v,H,R,vflg,nv,rs,sat,iu,ns,prior)) {
+        arc_log(ARC_WARNING,"arc_swin_update : add epoch block error\n");
+        return -1;
+    }
+    Aei=(double **)calloc(w->nb,sizeof(double *)); T =(double **)calloc(w->nb,sizeof(double *));
+    ge =(double **)calloc(w->nb,sizeof(double *)); u =(int    **)calloc(w->nb,sizeof(int    *));
+    nu =arc_imat(w->nb,1);
+    for (n=0;n<w->nb;n++) {
+        b=w->blk+(w->nl-n+w->nw)%w->nw; /* n=0: newest */
+        u[n]=arc_imat(b->nv*SWIN_NBROW+1,1);
+        Aei[n]=arc_mat(b->ne,b->ne); T[n]=arc_mat(b->ne,b->nv*SWIN_NBROW+1);
+        ge[n]=arc_mat(b->ne,1);
+    }
+    Lk=arc_mat(nv*SWIN_NBROW+1,nv*SWIN_NBROW+1); gk=arc_mat(nv*SWIN_NBROW+1,1);
+    db=arc_mat(w->ns+1,1);
+
+    for (it=0;it<SWIN_MAXITER;it++) {
+
+        /* reduced normal equation of slots, starting with prior */
+        for (i=0;i<w->ns;i++) {
+            w->g[i]=w->eta[i];
+            for (j=0;j<w->ns;j++) {
+                w->A[i+j*w->ns]=LP(w,i,j);
+                w->g[i]-=LP(w,i,j)*w->sx[j];
+            }
+        }
+        for (n=0;n<w->nb&&!info;n++) {
+            b=w->blk+(w->nl-n+w->nw)%w->nw;
+            nu[n]=arc_swin_blkslot(b,u[n]);
+            free(Lk); free(gk);
+            Lk=arc_zeros(nu[n]+1,nu[n]+1); gk=arc_zeros(nu[n]+1,1);
+            if (arc_swin_schur(w,b,u[n],nu[n],Aei[n],T[n],ge[n],Lk,gk)) {
+                info=-1;
+                break;
+            }
+            for (c=0;c<nu[n];c++) {
+                w->g[u[n][c]]+=gk[c];
+                for (d=0;d<nu[n];d++) w->A[u[n][c]+u[n][d]*w->ns]+=Lk[c+d*nu[n]];
+            }
+        }
+        if (info) break;
+
+        /* solve slots: A*db=g, A:=A^-1 */
+        if (w->ns>0&&arc_matinv(w->A,w->ns)) {
+            info=-1;
+            break;
+        }
+        for (i=0,dmax=0.0;i<w->ns;i++) {
+            for (j=0,db[i]=0.0;j<w->ns;j++) db[i]+=w->A[i+j*w->ns]*w->g[j];
+        }
+        for (i=0;i<w->ns;i++) {
+            w->sx[i]+=db[i];
+            if (fabs(db[i])>dmax) dmax=fabs(db[i]);
+        }
+        /* back-substitution of epoch states: de=Aei*ge-T*db */
+        for (n=0;n<w->nb;n++) {
+            b=w->blk+(w->nl-n+w->nw)%w->nw;
+            for (i=0;i<b->ne;i++) {
+                for (j=0,t=0.0;j<b->ne;j++) t+=Aei[n][i+j*b->ne]*ge[n][j];
+                for (c=0;c<nu[n];c++) t-=T[n][i+c*b->ne]*db[u[n][c]];
+                b->xe[i]+=t;
+                if (fabs(t)>dmax) dmax=fabs(t);
+            }
+        }
+        arc_log(ARC_INFO,"arc_swin_update : iteration=%d dx=%.6f\n",it+1,dmax);
+        if (dmax<SWIN_CONV) break;
+    }
+    if (!info) {
+        /* write back estimates and marginal covariance of current epoch */
+        b=w->blk+w->nl;
+        wix=arc_imat(b->ne+w->ns,1);
+        for (i=nwix=0;i<b->ne;i++) wix[nwix++]=b->ie[i];
+        for (s=0;s<w->ns;s++) if (w->sidx[s]>=0) wix[nwix++]=w->sidx[s];
+        for (k=0;k<nwix;k++) for (j=0;j<nx;j++) {
+            P[wix[k]+j*nx]=P[j+wix[k]*nx]=0.0;
+        }
+        for (i=0;i<b->ne;i++) x[b->ie[i]]=b->xe[i];
+        for (s=0;s<w->ns;s++) if (w->sidx[s]>=0) x[w->sidx[s]]=w->sx0[s]+w->sx[s];
+
+        /* Pbb=A^-1, Peb=-T*Pbb, Pee=Aei+T*Pbb*T' */
+        for (s=0;s<w->ns;s++) {
+            if (w->sidx[s]<0) continue;
+            for (j=0;j<w->ns;j++) {
+                if (w->sidx[j]<0) continue;
+                P[w->sidx[s]+w->sidx[j]*nx]=w->A[s+j*w->ns];
+            }
+            for (i=0;i<b->ne;i++) {
+                for (c=0,t=0.0;c<nu[0];c++) t-=T[0][i+c*b->ne]*w->A[u[0][c]+s*w->ns];
+                P[b->ie[i]+w->sidx[s]*nx]=P[w->sidx[s]+b->ie[i]*nx]=t;
+            }
+        }
+        for (i=0;i<b->ne;i++) for (j=0;j<b->ne;j++) {
+            t=Aei[0][i+j*b->ne];
+            for (c=0;c<nu[0];c++) for (d=0;d<nu[0];d++) {
+                t+=T[0][i+c*b->ne]*w->A[u[0][c]+u[0][d]*w->ns]*T[0][j+d*b->ne];
+            }
+            P[b->ie[i]+b->ie[j]*nx]=t;
+        }
+        free(wix);
+    }
+    else arc_log(ARC_WARNING,"arc_swin_update : singular normal equation\n");
+
+    for (n=0;n<w->nb;n++) {free(Aei[n]); free(T[n]); free(ge[n]); free(u[n]);}
+    free(Aei); free(T); free(ge); free(u); free(nu); free(Lk); free(gk); free(db);
+    return info;
+}
@@ -0,0 +1,102 @@
+// bench_peph.cpp : accuracy and timing of precise ephemeris coefficients
+//                  against polynomial interpolation of arc_peph2pos()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "arc.h"
+
+#define NSAT    32
+#define NEPH    97              /* 1 day of 15 min sp3 */
+#define NCLK    2881            /* 1 day of 30 s clock */
+#define TSP3    900.0
+#define TCLK    30.0
+#define NEPOCH  3600
+
+/* circular orbit in ecef as sp3 data ----------------------------------------*/
+static void orbit(int sat, double t, double *r)
+{
+    double a=26560E3,n=sqrt(3.986005E14/(a*a*a)),inc=55.0*D2R;
+    double omg=(sat%6)*60.0*D2R,u=sat*0.7+n*t,th=omg-OMGE*t,x,y;
+
+    x=a*cos(u); y=a*sin(u)*cos(inc);
+    r[0]=x*cos(th)-y*sin(th);
+    r[1]=x*sin(th)+y*cos(th);
+    r[2]=a*sin(u)*sin(inc);
+}
+
+int main()
+{
+    double ep[]={2017,7,13,0,0,0},*rs1,*rs2,*dts1,*dts2,*var;
+    double err_p=0.0,err_v=0.0,err_c=0.0,t1,t2;
+    gtime_t t0=epoch2time(ep),time[NSAT];
+    nav_t nav={0};
+    ephc_t ephc;
+    clock_t c;
+    int i,j,k,sat[NSAT],stat[NSAT],nok=0;
+
+    nav.peph=(peph_t *)calloc(NEPH,sizeof(peph_t));
+    nav.pclk=(pclk_t *)calloc(NCLK,sizeof(pclk_t));
+    nav.ne=nav.nemax=NEPH;
+    nav.nc=nav.ncmax=NCLK;
+
+    for (i=0;i<NEPH;i++) {
+        nav.peph[i].time=timeadd(t0,i*TSP3);
+        for (j=0;j<NSAT;j++) {
+            orbit(j,i*TSP3,nav.peph[i].pos[j]);
+            nav.peph[i].pos[j][3]=1E-4*sin(j+i*1E-3);
+        }
+    }
+    for (i=0;i<NCLK;i++) {
+        nav.pclk[i].time=timeadd(t0,i*TCLK);
+        for (j=0;j<NSAT;j++) nav.pclk[i].clk[j][0]=1E-4*sin(j+i*3E-5);
+    }
+    if (!arc_pephc_init(&nav)) return 1;
+    arc_ephc_init(&ephc,0);
+    arc_ephc_bind(&ephc);
+
+    rs1=(double *)malloc(sizeof(double)*6*NSAT); dts1=(double *)malloc(sizeof(double)*2*NSAT);
+    rs2=(double *)malloc(sizeof(double)*6*NSAT); dts2=(double *)malloc(sizeof(double)*2*NSAT);
+    var=(double *)malloc(sizeof(double)*NSAT);
+
+    /* accuracy against arc_peph2pos() */
+    for (k=0;k<NEPOCH;k++) {
+        for (j=0;j<NSAT;j++) {
+            sat[j]=j+1; time[j]=timeadd(t0,100.0+k*23.9-0.07-j*1E-3);
+            arc_peph2pos(time[j],sat[j],&nav,0,rs1+j*6,dts1+j*2,NULL);
+        }
+        nok+=arc_peph2poss(time,sat,NSAT,&nav,0,NULL,rs2,dts2,var,stat);
+        for (j=0;j<NSAT*3;j++) {
+            err_p=fmax(err_p,fabs(rs1[j/3*6+j%3]-rs2[j/3*6+j%3]));
+            err_v=fmax(err_v,fabs(rs1[j/3*6+3+j%3]-rs2[j/3*6+3+j%3]));
+        }
+        for (j=0;j<NSAT;j++) err_c=fmax(err_c,fabs(dts1[j*2]-dts2[j*2])*CLIGHT);
+    }
+    printf("satellites ok : %d/%d\n",nok,NSAT*NEPOCH);
+    printf("max error     : pos=%.2E m vel=%.2E m/s clk=%.2E m\n",err_p,err_v,err_c);
+
+    /* timing of 1 hz epochs */
+    c=clock();
+    for (k=0;k<NEPOCH;k++) for (j=0;j<NSAT;j++) {
+        time[j]=timeadd(t0,3600.0+k-0.07);
+        arc_peph2pos(time[j],j+1,&nav,1,rs1+j*6,dts1+j*2,NULL);
+    }
+    t1=(double)(clock()-c)/CLOCKS_PER_SEC;
+    c=clock();
+    for (k=0;k<NEPOCH;k++) {
+        for (j=0;j<NSAT;j++) time[j]=timeadd(t0,3600.0+k-0.07);
+        arc_peph2poss(time,sat,NSAT,&nav,1,NULL,rs2,dts2,var,stat);
+    }
+    t2=(double)(clock()-c)/CLOCKS_PER_SEC;
+    printf("time/sat      : peph2pos=%.2f us peph2poss=%.2f us (x%.1f)\n",
+           t1/NEPOCH/NSAT*1E6,t2/NEPOCH/NSAT*1E6,t2>0.0?t1/t2:0.0);
+
+    arc_ephc_bind(NULL);
+    arc_ephc_free(&ephc);
+    arc_pephc_free(&nav);
+    free(nav.peph); free(nav.pclk);
+    free(rs1); free(rs2); free(dts1); free(dts2); free(var);
+    return 0;
+}
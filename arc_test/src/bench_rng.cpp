@@ -0,0 +1,76 @@
+
+// bench_rng.cpp : accuracy and timing of particle filter random number generators
+
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include "libPF/CRandomNumberGenerator.h"
+#include "libPF/CPhiloxRandomNumberGenerator.h"
+
+#define NVAL    400000          /* values per fill (5000 particles x 80 states) */
+#define NLOOP   50
+
+using namespace libPF;
+
+static double elapsed(clock_t c) {return (double)(clock()-c)/CLOCKS_PER_SEC;}
+
+int main()
+{
+    static double u[NVAL],g[NVAL];
+    const double TWO_PI=6.283185307179586476925286766559;
+    CRandomNumberGenerator rng(1);
+    CPhiloxRandomNumberGenerator ph(1,0),pr(1,0);
+    double x,r,err=0.0,mean=0.0,var=0.0,sum=0.0,t[4];
+    unsigned int ctr[4]={0},key[2]={0},out[4];
+    int i,j,nerr=0;
+    clock_t c;
+
+    /* known-answer test of block function */
+    CPhiloxRandomNumberGenerator::philox(ctr,key,out);
+    printf("philox(0,0)    : %08x %08x %08x %08x\n",out[0],out[1],out[2],out[3]);
+
+    /* batch uniforms equal the sequence of getUniform() */
+    ph.getUniform(); pr.getUniform(); /* start inside a block */
+    ph.fillUniform(u,NVAL-3);
+    for (i=0;i<NVAL-3;i++) if (u[i]!=pr.getUniform()) nerr++;
+    printf("fillUniform    : %d values differ from getUniform()\n",nerr);
+
+    /* batch normals against libm Box-Muller on the same uniforms */
+    ph.setSeed(7,3); pr.setSeed(7,3);
+    ph.fillGaussian(g,NVAL-1,2.0);
+    pr.fillUniform(u,NVAL);
+    for (i=0;i<NVAL-1;i++) {
+        r=2.0*sqrt(-2.0*log(1.0-u[i/2*2]));
+        x=i%2?r*sin(TWO_PI*u[i/2*2+1]):r*cos(TWO_PI*u[i/2*2+1]);
+        err=fmax(err,fabs(g[i]-x)/fmax(fabs(x),1.0));
+        mean+=g[i]; var+=g[i]*g[i];
+    }
+    mean/=NVAL-1; var=var/(NVAL-1)-mean*mean;
+    printf("fillGaussian   : max err=%.2E mean=%8.5f std=%8.5f (2.0)\n\n",err,mean,sqrt(var));
+
+    /* timing */
+    c=clock(); for (j=0;j<NLOOP;j++) for (i=0;i<NVAL;i++) sum+=rng.getGaussian(1.0);
+    t[0]=elapsed(c);
+    c=clock(); for (j=0;j<NLOOP;j++) for (i=0;i<NVAL;i++) sum+=ph.getGaussian(1.0);
+    t[1]=elapsed(c);
+    c=clock(); for (j=0;j<NLOOP;j++) {ph.fillGaussian(g,NVAL,1.0); sum+=g[j];}
+    t[2]=elapsed(c);
+    c=clock(); for (j=0;j<NLOOP;j++) for (i=0;i<NVAL;i+=3) {ph.fillGaussian(g+i,3,1.0); sum+=g[i];}
+    t[3]=elapsed(c);
+
+    printf("%-34s %10s %8s\n","gaussian","ns/value","speedup");
+    printf("%-34s %10.2f %8.2f\n","CRandomNumberGenerator getGaussian",t[0]*1E9/NVAL/NLOOP,1.0);
+    printf("%-34s %10.2f %8.2f\n","Philox getGaussian",t[1]*1E9/NVAL/NLOOP,t[0]/t[1]);
+    printf("%-34s %10.2f %8.2f\n","Philox fillGaussian",t[2]*1E9/NVAL/NLOOP,t[0]/t[2]);
+    printf("%-34s %10.2f %8.2f\n","Philox fillGaussian (3 per call)",t[3]*1E9/NVAL/NLOOP,t[0]/t[3]);
+
+    c=clock(); for (j=0;j<NLOOP;j++) for (i=0;i<NVAL;i++) sum+=rng.getUniform();
+    t[0]=elapsed(c);
+    c=clock(); for (j=0;j<NLOOP;j++) {ph.fillUniform(u,NVAL); sum+=u[j];}
+    t[2]=elapsed(c);
+    printf("\n%-34s %10s %8s\n","uniform","ns/value","speedup");
+    printf("%-34s %10.2f %8.2f\n","CRandomNumberGenerator getUniform",t[0]*1E9/NVAL/NLOOP,1.0);
+    printf("%-34s %10.2f %8.2f\n","Philox fillUniform",t[2]*1E9/NVAL/NLOOP,t[0]/t[2]);
+
+    return sum==0.0;
+}
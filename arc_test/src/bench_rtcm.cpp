@@ -0,0 +1,308 @@
+// bench_rtcm.cpp : round trip and throughput of rtcm 3 decoder with synthetic
+//                  MSM4/5/7 (GPS,BDS), 1019/1042 and 1005 messages
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "arc.h"
+
+#define NSAT    12              /* satellites per system */
+#define NEPOCH  3000            /* epochs of stream */
+#define NLOOP   20              /* decoding loops for timing */
+#define NCORR   97              /* corrupt one of NCORR frames */
+#define RANGE_MS (CLIGHT*0.001)
+#define P2_50   8.881784197001252E-16 /* 2^-50 */
+#define P2_66   1.355252715606880E-20 /* 2^-66 */
+
+typedef struct {                /* synthetic satellite signal */
+    int sat;
+    double P[3],L[3],D[3],rate;
+} sigd_t;
+
+static const int sig_gps[3]={2,10,23};  /* signal ids: 1C,2W,5Q */
+static const int sig_cmp[3]={2,8,14};   /* signal ids: 1I(B1),6I(B3),7I(B2) */
+static const int frq_gps[3]={0,1,2};    /* frequency index of signals */
+static const int frq_cmp[3]={0,2,1};
+
+/* set rtcm 3 frame ----------------------------------------------------------*/
+static int setframe(unsigned char *buff, int nbit)
+{
+    int len=(nbit+7)/8;
+    unsigned int crc;
+
+    buff[0]=0xD3;
+    setbitu(buff,8,6,0);
+    setbitu(buff,14,10,len);
+    crc=arc_crc24q(buff,len+3);
+    setbitu(buff,(len+3)*8,24,crc);
+    return len+6;
+}
+/* encode msm 4/5/7 ----------------------------------------------------------*/
+static int encode_msm(unsigned char *buff, int sys, int msm, double tow,
+                      const sigd_t *sig, int nsat, int sync)
+{
+    const int *sigs=sys==SYS_CMP?sig_cmp:sig_gps,*frq=sys==SYS_CMP?frq_cmp:frq_gps;
+    double r[64],rr[64],lam,v;
+    int i=24,j,k,prn,type,ncell=nsat*3,ms[64],mod[64];
+
+    memset(buff,0,1200);
+    type=(sys==SYS_CMP?1120:1070)+msm;
+    setbitu(buff,i,12,type);                   i+=12;
+    setbitu(buff,i,12,1);                      i+=12;
+    setbitu(buff,i,30,(unsigned int)(tow*1000.0+0.5)); i+=30;
+    setbitu(buff,i, 1,sync);                   i+= 1;
+    i+=3+7+2+2+1+3;
+    for (j=0;j<nsat;j++) {
+        satsys(sig[j].sat,&prn);
+        setbitu(buff,i+prn-1,1,1);
+    }
+    i+=64;
+    for (k=0;k<3;k++) setbitu(buff,i+sigs[k]-1,1,1);
+    i+=32;
+    for (j=0;j<ncell;j++) setbitu(buff,i+j,1,1); /* signals in id order */
+    i+=ncell;
+
+    for (j=0;j<nsat;j++) {
+        ms[j]=(int)floor(sig[j].P[0]/RANGE_MS);
+        mod[j]=(int)floor((sig[j].P[0]/RANGE_MS-ms[j])*1024.0+0.5);
+        if (mod[j]>=1024) {ms[j]++; mod[j]-=1024;}
+        r[j]=(ms[j]+mod[j]/1024.0)*RANGE_MS;
+        rr[j]=floor(sig[j].rate+0.5);
+    }
+    for (j=0;j<nsat;j++) {setbitu(buff,i,8,ms[j]); i+=8;}
+    if (msm!=4) i+=4*nsat;
+    for (j=0;j<nsat;j++) {setbitu(buff,i,10,mod[j]); i+=10;}
+    if (msm!=4) for (j=0;j<nsat;j++) {setbits(buff,i,14,(int)rr[j]); i+=14;}
+
+    /* cells in order of satellite and signal id */
+    for (j=0;j<nsat;j++) for (k=0;k<3;k++) { /* fine pseudorange */
+        v=(sig[j].P[frq[k]]-r[j])/RANGE_MS;
+        if (msm==7) {setbits(buff,i,20,(int)floor(v/P2_29+0.5)); i+=20;}
+        else        {setbits(buff,i,15,(int)floor(v/P2_24+0.5)); i+=15;}
+    }
+    for (j=0;j<nsat;j++) for (k=0;k<3;k++) { /* fine phase range */
+        lam=arc_satwavelen(sig[j].sat,frq[k],NULL);
+        v=(sig[j].L[frq[k]]*lam-r[j])/RANGE_MS;
+        if (msm==7) {setbits(buff,i,24,(int)floor(v/P2_31+0.5)); i+=24;}
+        else        {setbits(buff,i,22,(int)floor(v/P2_29+0.5)); i+=22;}
+    }
+    for (j=0;j<ncell;j++) { /* lock time */
+        if (msm==7) {setbitu(buff,i,10,500); i+=10;} else {setbitu(buff,i,4,12); i+=4;}
+    }
+    i+=ncell; /* half-cycle ambiguity */
+    for (j=0;j<ncell;j++) { /* cnr */
+        if (msm==7) {setbitu(buff,i,10,45*16); i+=10;} else {setbitu(buff,i,6,45); i+=6;}
+    }
+    if (msm!=4) {
+        for (j=0;j<nsat;j++) for (k=0;k<3;k++) { /* fine phase range rate */
+            lam=arc_satwavelen(sig[j].sat,frq[k],NULL);
+            v=-sig[j].D[frq[k]]*lam-rr[j];
+            setbits(buff,i,15,(int)floor(v/0.0001+0.5)); i+=15;
+        }
+    }
+    return setframe(buff,i-24);
+}
+/* angle to 32 bit semi-circles wrapped to [-1,1) -------------------------*/
+static int semicirc(double ang)
+{
+    double x=ang/SC2RAD/P2_31;
+
+    x=floor(x+0.5);
+    x-=4294967296.0*floor((x+2147483648.0)/4294967296.0);
+    return (int)x;
+}
+/* encode 1019/1042 ----------------------------------------------------------*/
+static int encode_eph(unsigned char *buff, const eph_t *eph)
+{
+    int i=24,prn,sys=satsys(eph->sat,&prn),bds=sys==SYS_CMP;
+    double toc;
+
+    memset(buff,0,1200);
+    toc=bds?time2bdt(gpst2bdt(eph->toc),NULL):time2gpst(eph->toc,NULL);
+    setbitu(buff,i,12,bds?1042:1019); i+=12;
+    setbitu(buff,i, 6,prn);           i+= 6;
+    setbitu(buff,i,bds?13:10,eph->week%(bds?8192:1024)); i+=bds?13:10;
+    setbitu(buff,i, 4,eph->sva);      i+= 4;
+    if (!bds) {setbitu(buff,i,2,eph->code); i+=2;}
+    setbits(buff,i,14,(int)floor(eph->idot/P2_43/SC2RAD+0.5)); i+=14;
+    setbitu(buff,i,bds?5:8,eph->iode); i+=bds?5:8;
+    setbitu(buff,i,bds?17:16,(unsigned int)(toc/(bds?8.0:16.0))); i+=bds?17:16;
+    if (bds) {
+        setbits(buff,i,11,(int)floor(eph->f2/P2_66+0.5)); i+=11;
+        setbits(buff,i,22,(int)floor(eph->f1/P2_50+0.5)); i+=22;
+        setbits(buff,i,24,(int)floor(eph->f0/P2_33+0.5)); i+=24;
+        setbitu(buff,i, 5,eph->iodc); i+=5;
+        setbits(buff,i,18,(int)floor(eph->crs/P2_6+0.5)); i+=18;
+    }
+    else {
+        setbits(buff,i, 8,(int)floor(eph->f2/P2_55+0.5)); i+= 8;
+        setbits(buff,i,16,(int)floor(eph->f1/P2_43+0.5)); i+=16;
+        setbits(buff,i,22,(int)floor(eph->f0/P2_31+0.5)); i+=22;
+        setbitu(buff,i,10,eph->iodc); i+=10;
+        setbits(buff,i,16,(int)floor(eph->crs/P2_5+0.5)); i+=16;
+    }
+    setbits(buff,i,16,(int)floor(eph->deln/P2_43/SC2RAD+0.5)); i+=16;
+    setbits(buff,i,32,semicirc(eph->M0)); i+=32;
+    setbits(buff,i,bds?18:16,(int)floor(eph->cuc/(bds?P2_31:P2_29)+0.5)); i+=bds?18:16;
+    setbitu(buff,i,32,(unsigned int)floor(eph->e/P2_33+0.5)); i+=32;
+    setbits(buff,i,bds?18:16,(int)floor(eph->cus/(bds?P2_31:P2_29)+0.5)); i+=bds?18:16;
+    setbitu(buff,i,32,(unsigned int)floor(sqrt(eph->A)/P2_19+0.5)); i+=32;
+    setbitu(buff,i,bds?17:16,(unsigned int)(eph->toes/(bds?8.0:16.0))); i+=bds?17:16;
+    setbits(buff,i,bds?18:16,(int)floor(eph->cic/(bds?P2_31:P2_29)+0.5)); i+=bds?18:16;
+    setbits(buff,i,32,semicirc(eph->OMG0)); i+=32;
+    setbits(buff,i,bds?18:16,(int)floor(eph->cis/(bds?P2_31:P2_29)+0.5)); i+=bds?18:16;
+    setbits(buff,i,32,semicirc(eph->i0)); i+=32;
+    setbits(buff,i,bds?18:16,(int)floor(eph->crc/(bds?P2_6:P2_5)+0.5)); i+=bds?18:16;
+    setbits(buff,i,32,semicirc(eph->omg)); i+=32;
+    setbits(buff,i,24,(int)floor(eph->OMGd/P2_43/SC2RAD+0.5)); i+=24;
+    if (bds) {
+        setbits(buff,i,10,(int)floor(eph->tgd[0]/1E-10+0.5)); i+=10;
+        setbits(buff,i,10,(int)floor(eph->tgd[1]/1E-10+0.5)); i+=10;
+        setbitu(buff,i, 1,eph->svh); i+=1;
+    }
+    else {
+        setbits(buff,i, 8,(int)floor(eph->tgd[0]/P2_31+0.5)); i+= 8;
+        setbitu(buff,i, 6,eph->svh); i+= 6;
+        setbitu(buff,i, 1,eph->flag); i+= 1;
+        setbitu(buff,i, 1,eph->fit>0.0?0:1); i+= 1;
+    }
+    return setframe(buff,i-24);
+}
+/* encode 1005 ---------------------------------------------------------------*/
+static int encode_1005(unsigned char *buff, const double *rr)
+{
+    double v;
+    int i=24,j;
+
+    memset(buff,0,1200);
+    setbitu(buff,i,12,1005); i+=12;
+    setbitu(buff,i,12,1);    i+=12;
+    i+=6+4;
+    for (j=0;j<3;j++) {
+        v=floor(rr[j]/0.0001+0.5);
+        setbits(buff,i,32,(int)floor(v/64.0));
+        setbitu(buff,i+32,6,(unsigned int)(v-floor(v/64.0)*64.0));
+        i+=38+2;
+    }
+    return setframe(buff,i-2-24);
+}
+/* synthetic signals of an epoch ---------------------------------------------*/
+static void gensig(gtime_t time, int sys, sigd_t *sig)
+{
+    double t=time2gpst(time,NULL),lam;
+    int j,f;
+
+    for (j=0;j<NSAT;j++) {
+        sig[j].sat=satno(sys,j+1);
+        sig[j].rate=600.0*sin(t*1E-3+j);
+        for (f=0;f<3;f++) {
+            lam=arc_satwavelen(sig[j].sat,f,NULL);
+            sig[j].P[f]=2.1E7+3E6*sin(t*1E-4+j*0.5)+f*1.7;
+            sig[j].L[f]=(sig[j].P[f]+(j*37%200-100)*lam)/lam;
+            sig[j].D[f]=-sig[j].rate/lam;
+        }
+    }
+}
+
+int main()
+{
+    double ep[]={2017,7,13,1,0,0},tow,err_p=0.0,err_l=0.0,err_d=0.0,t,rr[3];
+    double rb[3]={-2267815.1675,5009407.1635,3220952.9060};
+    gtime_t t0=epoch2time(ep),time;
+    sigd_t sig[2][NSAT];
+    eph_t eph={0};
+    rtcm_t *rtcm=(rtcm_t *)malloc(sizeof(rtcm_t));
+    unsigned char *strm[3];
+    int msms[3]={4,5,7},len[3]={0},nmsg[3]={0},ncorr[3]={0},nobs,neph,nsta;
+    int i,j,k,l,m,n,f,sys,ret,idx;
+    clock_t c;
+
+    for (m=0;m<3;m++) {
+        strm[m]=(unsigned char *)malloc((size_t)NEPOCH*2*1200+100*1200);
+    }
+    /* encode streams of MSM4/5/7 with ephemerides and station position */
+    for (m=0;m<3;m++) {
+        for (k=0;k<NEPOCH;k++) {
+            time=timeadd(t0,k*1.0);
+            tow=time2gpst(time,NULL);
+            if (k%300==0) {
+                len[m]+=encode_1005(strm[m]+len[m],rb); nmsg[m]++;
+                for (j=0;j<2*NSAT;j++) {
+                    eph.sat=j<NSAT?satno(SYS_GPS,j+1):satno(SYS_CMP,j-NSAT+1);
+                    eph.toe=eph.toc=time;
+                    eph.toes=j<NSAT?time2gpst(time,&eph.week):time2bdt(gpst2bdt(time),&eph.week);
+                    eph.iode=eph.iodc=k/300%32; eph.A=26560E3; eph.e=0.01;
+                    eph.i0=0.96; eph.OMG0=j*0.5-3.0; eph.M0=j*0.2-2.0; eph.omg=0.3;
+                    eph.OMGd=-8E-9; eph.f0=1E-5; eph.crs=10.0; eph.cuc=1E-6;
+                    len[m]+=encode_eph(strm[m]+len[m],&eph); nmsg[m]++;
+                }
+            }
+            for (l=0;l<2;l++) {
+                sys=l?SYS_CMP:SYS_GPS;
+                gensig(time,sys,sig[l]);
+                n=encode_msm(strm[m]+len[m],sys,msms[m],l?tow-14.0:tow,sig[l],NSAT,!l);
+                if ((k*2+l)%NCORR==NCORR-1) { /* corrupt payload */
+                    strm[m][len[m]+10]^=0x5A; ncorr[m]++;
+                }
+                len[m]+=n; nmsg[m]++;
+            }
+        }
+    }
+    /* round trip */
+    for (m=0;m<3;m++) {
+        arc_init_rtcm(rtcm);
+        rtcm->time=t0;
+        nobs=neph=nsta=0; err_p=err_l=err_d=0.0;
+        for (i=0;i<len[m];i++) {
+            if ((ret=arc_input_rtcm3(rtcm,strm[m][i]))==2) neph++;
+            else if (ret==5) {
+                nsta++;
+                for (j=0;j<3;j++) rr[j]=rtcm->sta.pos[j]-rb[j];
+                if (arc_norm(rr,3)>1E-3) printf("station position error\n");
+            }
+            if (ret!=1) continue;
+            nobs++;
+            for (l=0;l<2;l++) {
+                gensig(rtcm->time,l?SYS_CMP:SYS_GPS,sig[l]);
+                for (j=0;j<NSAT;j++) {
+                    for (idx=0;idx<rtcm->obs.n;idx++) {
+                        if (rtcm->obs.data[idx].sat==sig[l][j].sat) break;
+                    }
+                    if (idx>=rtcm->obs.n) continue;
+                    for (f=0;f<3;f++) {
+                        err_p=fmax(err_p,fabs(rtcm->obs.data[idx].P[f]-sig[l][j].P[f]));
+                        err_l=fmax(err_l,fabs(rtcm->obs.data[idx].L[f]-sig[l][j].L[f]));
+                        if (msms[m]!=4) {
+                            err_d=fmax(err_d,fabs(rtcm->obs.data[idx].D[f]-sig[l][j].D[f]));
+                        }
+                    }
+                }
+            }
+        }
+        printf("MSM%d: messages=%d corrupted=%d parity errors=%u decoded=%d\n",
+               msms[m],nmsg[m],ncorr[m],rtcm->nerr,
+               rtcm->nmsg3[1005-1000]+rtcm->nmsg3[1019-1000]+rtcm->nmsg3[1042-1000]+
+               rtcm->nmsg3[1070+msms[m]-1000]+rtcm->nmsg3[1120+msms[m]-1000]);
+        printf("      epochs=%d eph=%d sta=%d max error: P=%.2E m L=%.2E cyc D=%.2E Hz\n",
+               nobs,neph,nsta,err_p,err_l,err_d);
+        arc_free_rtcm(rtcm);
+    }
+    /* throughput */
+    for (m=0;m<3;m++) {
+        arc_init_rtcm(rtcm);
+        c=clock();
+        for (k=0;k<NLOOP;k++) {
+            rtcm->time=t0;
+            for (i=0;i<len[m];i++) arc_input_rtcm3(rtcm,strm[m][i]);
+        }
+        t=(double)(clock()-c)/CLOCKS_PER_SEC;
+        printf("MSM%d: %8.0f messages/s %6.1f MB/s (%d sats x 3 sigs per message)\n",
+               msms[m],(double)nmsg[m]*NLOOP/t,len[m]*NLOOP/t/1E6,NSAT);
+        arc_free_rtcm(rtcm);
+    }
+    for (m=0;m<3;m++) free(strm[m]);
+    free(rtcm);
+    return 0;
+}
@@ -0,0 +1,77 @@
+// bench_tropmapf.cpp : accuracy and timing of troposphere mapping function tables
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include "arc.h"
+
+#define NFUNC   8
+#define NCALL   2000000
+
+int main()
+{
+    double ep[]={2017,7,13,6,27,35.2},lat[]={0.5,30.5,45.3,-62.0,80.0};
+    double pos[3],azel[2]={0},el,mh,mw,th,tw,err_h,err_w,err_s,sum=0.0,te,tt;
+    const char *name[NFUNC]={
+        "nmf","unsw931","chao","ifadis","mtt","ma_mu","cfa2_2","exp"
+    };
+    mapfunc_t func[NFUNC]={
+        arc_tropmapf,arc_tropmapf_UNSW931,arc_tropmapf_chao,arc_tropmapf_ifadis,
+        arc_tropmapf_mtt,arc_tropmapf_ma_mu,arc_tropmapf_cfa2_2,arc_tropmapf_exp
+    };
+    gtime_t t0=epoch2time(ep),t1=timeadd(t0,3599.0);
+    mapt_t mapt;
+    clock_t c;
+    int i,j,k;
+
+    printf("%-8s %12s %12s %14s %14s\n","func","err(dry)","err(wet)",
+           "slant(mm)","slant+tol(mm)");
+
+    for (i=0;i<NFUNC;i++) {
+        err_h=err_w=err_s=0.0;
+        for (j=0;j<5;j++) {
+            pos[0]=lat[j]*D2R; pos[1]=114.0*D2R; pos[2]=50.0;
+            memset(&mapt,0,sizeof(mapt)); mapt.func=func[i];
+
+            /* interpolation error above 5 deg */
+            for (el=5.0;el<=90.0;el+=0.01) {
+                azel[1]=el*D2R;
+                mh=func[i](t0,pos,azel,&mw);
+                th=arc_mapt(&mapt,t0,pos,azel,&tw);
+                err_h=fmax(err_h,fabs(mh-th)); err_w=fmax(err_w,fabs(mw-tw));
+            }
+            /* slant delay error at the edge of table tolerances */
+            pos[0]+=0.0099*D2R; pos[1]+=0.0099*D2R; pos[2]+=49.9;
+            for (el=5.0;el<=90.0;el+=0.05) {
+                azel[1]=el*D2R;
+                mh=func[i](t1,pos,azel,&mw);
+                th=arc_mapt(&mapt,t1,pos,azel,&tw);
+                err_s=fmax(err_s,fmax(fabs(mh-th)*2.3,fabs(mw-tw)*0.3));
+            }
+        }
+        printf("%-8s %12.2E %12.2E %14.4f %14.4f\n",name[i],err_h,err_w,
+               err_h*2300.0,err_s*1000.0);
+    }
+    printf("\n%-8s %12s %12s %8s\n","func","exact(ns)","table(ns)","speedup");
+
+    pos[0]=30.5*D2R; pos[1]=114.0*D2R; pos[2]=50.0;
+    for (i=0;i<NFUNC;i++) {
+        memset(&mapt,0,sizeof(mapt)); mapt.func=func[i];
+
+        c=clock();
+        for (k=0;k<NCALL;k++) {
+            azel[1]=(5.0+k%850*0.1)*D2R; sum+=func[i](t0,pos,azel,&mw);
+        }
+        te=(double)(clock()-c)/CLOCKS_PER_SEC;
+        c=clock();
+        for (k=0;k<NCALL;k++) {
+            azel[1]=(5.0+k%850*0.1)*D2R; sum+=arc_mapt(&mapt,t0,pos,azel,&mw);
+        }
+        tt=(double)(clock()-c)/CLOCKS_PER_SEC;
+
+        printf("%-8s %12.1f %12.1f %8.1f\n",name[i],te/NCALL*1E9,tt/NCALL*1E9,
+               tt>0.0?te/tt:0.0);
+    }
+    return sum==0.0;
+}
@@ -0,0 +1,161 @@
+// rtsvr.cpp : real-time rtk positioning server of rinex and rtcm 3 streams
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include "arc.h"
+
+static const char *help[]={
+    "",
+    " usage: rtsvr [option ...] [-n nav ...]",
+    "",
+    " options:",
+    "  -k file      configuration file [defaults]",
+    "  -r stream    rover observation stream [tcpcli://:52001]",
+    "  -b stream    base observation stream [tcpcli://:52002]",
+    "  -o stream    solution output stream [file://rtsvr.pos]",
+    "  -n file      rinex navigation file (needed for rinex streams)",
+    "  -rf file     replay rover observation file to rover stream",
+    "  -bf file     replay base observation file to base stream",
+    "  -x speed     replay speed (x real time) (0:no wait) [1]",
+    "  -w ms        wait of base epoch after rover epoch (ms) [10]",
+    "  -t sec       stop after sec seconds (0:end of replay or ctrl-c) [0]",
+    "",
+    " stream: file://path, pipe://path, tcpsvr://:port, tcpcli://host:port",
+    " with format suffix #rinex (default) or #rtcm3 for rover and base.",
+    " replayed files have the format of the stream.",
+    " replay writes the files to a tcp server at the port of the stream",
+    " (tcpcli://host:port -> tcpsvr://:port) or to the same pipe."
+};
+static volatile int intrflg=0;
+
+static void sigfunc(int sig)
+{
+    intrflg=1;
+}
+/* stream format suffix -----------------------------------------------------*/
+static int strfmt(char *spec)
+{
+    char *p;
+
+    if (!(p=strrchr(spec,'#'))) return STRFMT_RINEX;
+    *p='\0';
+    if (!strcmp(p+1,"rtcm3")) return STRFMT_RTCM3;
+    if (!strcmp(p+1,"rinex")) return STRFMT_RINEX;
+    return -1;
+}
+/* replay stream of input stream ---------------------------------------------*/
+static int replaystr(int type, const char *path, char *rpath)
+{
+    const char *p;
+
+    if (type==STR_TCPCLI) {
+        if (!(p=strrchr(path,':'))) return STR_NONE;
+        sprintf(rpath,":%s",p+1);
+        return STR_TCPSVR;
+    }
+    strcpy(rpath,path);
+    return type==STR_PIPE?STR_PIPE:STR_NONE;
+}
+int main(int argc, char **argv)
+{
+    static rtsvr_t svr;
+    static replay_t rp[2];
+    prcopt_t popt=prcopt_default;
+    solopt_t sopt=solopt_default;
+    filopt_t fopt={""};
+    obs_t obs={0};
+    nav_t nav={0};
+    char *spec[3]={(char *)"tcpcli://:52001",(char *)"tcpcli://:52002",
+                   (char *)"file://rtsvr.pos"};
+    char *navs[16],*rfile[2]={NULL,NULL},*conf=NULL;
+    char spec_[3][MAXSTRPATH],path[3][MAXSTRPATH],rpath[MAXSTRPATH],*paths[3];
+    double speed=1.0,tmax=0.0,t=0.0;
+    int i,n=0,type[3],fmt[3]={0},rtype,syncwait=0;
+
+    for (i=1;i<argc;i++) {
+        if      (!strcmp(argv[i],"-k" )&&i+1<argc) conf=argv[++i];
+        else if (!strcmp(argv[i],"-r" )&&i+1<argc) spec[0]=argv[++i];
+        else if (!strcmp(argv[i],"-b" )&&i+1<argc) spec[1]=argv[++i];
+        else if (!strcmp(argv[i],"-o" )&&i+1<argc) spec[2]=argv[++i];
+        else if (!strcmp(argv[i],"-n" )&&i+1<argc) {if (n<16) navs[n++]=argv[++i]; else i++;}
+        else if (!strcmp(argv[i],"-rf")&&i+1<argc) rfile[0]=argv[++i];
+        else if (!strcmp(argv[i],"-bf")&&i+1<argc) rfile[1]=argv[++i];
+        else if (!strcmp(argv[i],"-x" )&&i+1<argc) speed=atof(argv[++i]);
+        else if (!strcmp(argv[i],"-w" )&&i+1<argc) syncwait=atoi(argv[++i]);
+        else if (!strcmp(argv[i],"-t" )&&i+1<argc) tmax=atof(argv[++i]);
+        else {
+            for (i=0;i<(int)(sizeof(help)/sizeof(*help));i++) {
+                fprintf(stderr,"%s\n",help[i]);
+            }
+            return -1;
+        }
+    }
+    if (conf) {
+        resetsysopts();
+        if (!loadopts(conf,sysopts)) {
+            fprintf(stderr,"options file read error: %s\n",conf);
+            return -1;
+        }
+        getsysopts(&popt,&sopt,&fopt);
+    }
+    for (i=0;i<3;i++) {
+        strcpy(spec_[i],spec[i]);
+        if ((fmt[i]=strfmt(spec_[i]))<0||
+            (type[i]=arc_strtype(spec_[i],path[i]))==STR_NONE) {
+            fprintf(stderr,"stream error: %s\n",spec[i]);
+            return -1;
+        }
+        paths[i]=path[i];
+    }
+    for (i=0;i<n;i++) arc_readrnx(navs[i],0,"",&obs,&nav,NULL);
+    free(obs.data);
+    if (nav.n<=0&&nav.ng<=0&&(fmt[0]!=STRFMT_RTCM3||fmt[1]!=STRFMT_RTCM3)) {
+        fprintf(stderr,"no navigation data\n");
+        return -1;
+    }
+    uniqnav(&nav);
+
+    /* replay sources to be ready before server connects */
+    for (i=0;i<2;i++) {
+        if (!rfile[i]) continue;
+        if ((rtype=replaystr(type[i],path[i],rpath))==STR_NONE||
+            !arc_replay_start(rp+i,rfile[i],fmt[i],rtype,rpath,speed)) {
+            fprintf(stderr,"replay error: %s\n",rfile[i]);
+            return -1;
+        }
+    }
+    signal(SIGINT,sigfunc);
+    signal(SIGTERM,sigfunc);
+
+    svr.syncwait=syncwait;
+    if (!arc_rtsvr_start(&svr,&popt,&sopt,&nav,type,fmt,paths)) {
+        fprintf(stderr,"server start error\n");
+        return -1;
+    }
+    while (!intrflg&&(tmax<=0.0||t<tmax)) {
+        sleepms(100); t+=0.1;
+
+        /* end of replay and all epochs processed */
+        if ((rfile[0]||rfile[1])&&tmax<=0.0&&
+            (!rfile[0]||rp[0].state==2)&&(!rfile[1]||rp[1].state==2)&&
+            svr.n[0]<=0) {
+            sleepms(500);
+            break;
+        }
+    }
+    for (i=0;i<2;i++) if (rfile[i]) arc_replay_stop(rp+i);
+    arc_rtsvr_stop(&svr);
+
+    fprintf(stderr,"epochs: rover=%u base=%u proc=%u sol=%u withbase=%u "
+            "overflow=%u/%u\n",svr.nrecv[0],svr.nrecv[1],svr.nproc,svr.nsol,
+            svr.nbase,svr.nover[0],svr.nover[1]);
+    if (svr.nproc>0) {
+        fprintf(stderr,"latency (ms): avg=%.2f p50=%.2f p99=%.2f max=%.2f\n",
+                svr.latsum/svr.nproc*1E3,arc_rtsvr_latency(&svr,0.5)*1E3,
+                arc_rtsvr_latency(&svr,0.99)*1E3,svr.latmax*1E3);
+    }
+    freenav(&nav,0xFF);
+    return 0;
+}
@@ -0,0 +1,121 @@
+// solconv.cpp : convert binary solution and solution statistics files to text
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arc.h"
+
+static const char *help[]={
+    "",
+    " usage: solconv [option ...] file.bin|file.sbin [file.pos|file.stat]",
+    "",
+    " options:",
+    "  -f fmt       output format (llh,xyz,enu) [llh]",
+    "  -w           output time as gps week and tow [yyyy/mm/dd hh:mm:ss.ss]",
+    "  -u           output time in utc [gpst]",
+    "  -d col       number of decimals in time [3]",
+    "  -g           output latitude/longitude as ddd mm ss.ss [ddd.dd]",
+    "  -s sep       field separator [' ']",
+    "  -x std       max std-dev of output solution (m) [0:all]",
+    "  -h           no header",
+    "",
+    " text solutions are written to stdout without output file. the base",
+    " station position of enu baselines is taken from each record. binary",
+    " solution statistics files are converted to text solution statistics"
+};
+/* convert binary solution statistics ----------------------------------------*/
+static int convstat(FILE *fp, FILE *ofp)
+{
+    solstate_t state;
+    solstat_t *sat;
+    sstat_t *s;
+    int n,ne=0;
+
+    if (!(s=sstat_openr(fp))) return -1;
+
+    if (!(sat=(solstat_t *)malloc(sizeof(solstat_t)*MAXSAT*NFREQ))) {
+        sstat_close(s);
+        return -1;
+    }
+    while ((n=sstat_read(s,&state,sat,MAXSAT*NFREQ))>=0) {
+        outsstat(ofp,&state,sat,n,s->level);
+        ne++;
+    }
+    free(sat);
+    sstat_close(s);
+    return ne;
+}
+
+int main(int argc, char **argv)
+{
+    solopt_t opt=solopt_default;
+    sol_t sol;
+    FILE *fp,*ofp=stdout;
+    double rb[3];
+    char *infile=NULL,*outfile=NULL;
+    int i,n=0;
+
+    opt.posf=SOLF_LLH;
+
+    for (i=1;i<argc;i++) {
+        if      (!strcmp(argv[i],"-f")&&i+1<argc) {
+            i++;
+            if      (!strcmp(argv[i],"llh")) opt.posf=SOLF_LLH;
+            else if (!strcmp(argv[i],"xyz")) opt.posf=SOLF_XYZ;
+            else if (!strcmp(argv[i],"enu")) opt.posf=SOLF_ENU;
+            else {
+                fprintf(stderr,"unsupported format: %s\n",argv[i]);
+                return -1;
+            }
+        }
+        else if (!strcmp(argv[i],"-w")) opt.timef=0;
+        else if (!strcmp(argv[i],"-u")) opt.times=TIMES_UTC;
+        else if (!strcmp(argv[i],"-d")&&i+1<argc) opt.timeu=atoi(argv[++i]);
+        else if (!strcmp(argv[i],"-g")) opt.degf=1;
+        else if (!strcmp(argv[i],"-s")&&i+1<argc) strcpy(opt.sep,argv[++i]);
+        else if (!strcmp(argv[i],"-x")&&i+1<argc) opt.maxsolstd=atof(argv[++i]);
+        else if (!strcmp(argv[i],"-h")) opt.outhead=0;
+        else if (argv[i][0]=='-') {
+            for (n=0;n<(int)(sizeof(help)/sizeof(*help));n++) {
+                fprintf(stderr,"%s\n",help[n]);
+            }
+            return 0;
+        }
+        else if (!infile) infile=argv[i];
+        else outfile=argv[i];
+    }
+    if (!infile) {
+        fprintf(stderr,"no input file\n");
+        return -1;
+    }
+    if (!(fp=fopen(infile,"rb"))) {
+        fprintf(stderr,"file open error: %s\n",infile);
+        return -1;
+    }
+    if (outfile&&!(ofp=fopen(outfile,"w"))) {
+        fprintf(stderr,"file open error: %s\n",outfile);
+        fclose(fp);
+        return -1;
+    }
+    if (!readsolbhead(fp)) {
+        rewind(fp);
+        if ((n=convstat(fp,ofp))<0) {
+            fprintf(stderr,"no binary solution file: %s\n",infile);
+        }
+        else fprintf(stderr,"%d epochs of statistics converted\n",n);
+        fclose(fp);
+        if (ofp!=stdout) fclose(ofp);
+        return n<0?-1:0;
+    }
+    outsolhead(ofp,&opt);
+
+    while (readsolb(fp,&sol,rb)) {
+        outsol(ofp,&sol,rb,&opt);
+        n++;
+    }
+    fprintf(stderr,"%d solutions converted\n",n);
+
+    fclose(fp);
+    if (ofp!=stdout) fclose(ofp);
+    return 0;
+}